@@ -0,0 +1,130 @@
+/**
+ * @file append.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Lock-free concurrent leaf ingestion with roots of the published prefixes
+ */
+
+#ifndef MERKLE_APPEND_H
+#define MERKLE_APPEND_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* LEVELS_MAX, level layout */
+
+#include <stdatomic.h>                  /* atomic_int */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Tree filled concurrently by several producers, up to a fixed capacity.
+ * A producer claims leaf slots, then publishes their digests in any order.
+ * Only complete nodes (all arity^l leaves published) are stored: the
+ * producer whose publication completes a group hashes its parent, and
+ * so on up while groups complete. The root of a published prefix is the
+ * stored complete nodes plus one partial node per level, recomputed by
+ * the reader. Nothing on the append path takes a lock. */
+struct merkle_append_t {
+    int capacity;                       /* leaf slots */
+    int arity;
+    enum merkle_padding_t padding;
+    int n_levels;                       /* levels holding complete nodes */
+    int level_size[LEVELS_MAX];         /* complete nodes of a full tree */
+    unsigned char *level[LEVELS_MAX];   /* complete node hashes, leaves first */
+    atomic_int *pending[LEVELS_MAX];    /* children completed per node, levels >= 1 */
+    atomic_uchar *published;            /* per leaf, set once its digest is in */
+    atomic_int next;                    /* first slot not claimed */
+    atomic_int frontier;                /* leaves [0, frontier) are all published */
+    atomic_long completed;              /* nodes hashed by the producers */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Allocates an empty tree of a fixed capacity.
+ *
+ * @param ap Tree to fill, released with AppendFree().
+ * @param capacity Number of leaf slots.
+ * @param arity Number of children per node.
+ * @param padding Completion of the partial groups of the prefix roots.
+ * @retval true  Success.
+ * @retval false Invalid parameters or allocation failure.
+ */
+bool AppendInit(struct merkle_append_t *ap, int capacity, int arity,
+                enum merkle_padding_t padding);
+
+/**
+ * @brief Claims consecutive leaf slots.
+ *
+ * Thread safe. Every claimed slot must be published, the prefixes
+ * beyond an unpublished slot never complete.
+ *
+ * @param ap Tree.
+ * @param count Number of slots.
+ * @return First claimed slot, -1 if fewer than count slots are left.
+ */
+int AppendClaim(struct merkle_append_t *ap, int count);
+
+/**
+ * @brief Publishes the digest of a claimed slot.
+ *
+ * Thread safe. Hashes the parents completed by this leaf before marking
+ * it published, so the complete nodes of a published prefix are in.
+ *
+ * @param ap Tree.
+ * @param slot Slot returned by AppendClaim() (or following it).
+ * @param digest Leaf hash.
+ * @retval true  Success.
+ * @retval false Slot out of range or hashing failure.
+ */
+bool AppendPublish(struct merkle_append_t *ap, int slot,
+                   const unsigned char digest[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Returns the length of the longest fully published prefix.
+ *
+ * @param ap Tree.
+ * @return Number of leaves.
+ */
+int AppendPublished(struct merkle_append_t *ap);
+
+/**
+ * @brief Computes the root of the tree of the first n leaves.
+ *
+ * Thread safe, concurrent with the producers. The root equals the one
+ * of LevelsFromLeafHashes() over the same n leaves, arity and padding.
+ *
+ * @param ap Tree.
+ * @param n Number of leaves, between 1 and AppendPublished().
+ * @param output Buffer to store the 32-byte root.
+ * @retval true  Success.
+ * @retval false Prefix not published or hashing failure.
+ */
+bool AppendPrefixRoot(struct merkle_append_t *ap, int n, unsigned char output[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Releases the tree, once every producer and reader is done.
+ *
+ * @param ap Tree.
+ */
+void AppendFree(struct merkle_append_t *ap);
+
+#endif /* MERKLE_APPEND_H */
@@ -0,0 +1,90 @@
+/**
+ * @file arena.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Single-block bump allocator reused across tree rebuilds
+ */
+
+#ifndef MERKLE_ARENA_H
+#define MERKLE_ARENA_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdbool.h>                    /* booleans */
+#include <stddef.h>                     /* size_t, max_align_t */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Alignment of every block carved from an arena */
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+/* A growing arena keeps 1/ARENA_HEADROOM spare bytes, so that
+ * rebuilds of a slightly larger tree reuse the same block */
+#define ARENA_HEADROOM 8
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* Bytes taken by a block of `n` bytes once aligned */
+#define ARENA_ROUND(n) (((size_t)(n) + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1))
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* One heap block carved in order; the blocks are never freed one by
+ * one, the whole arena is reset before the next use */
+struct merkle_arena_t {
+    unsigned char *base;
+    size_t capacity;                    /* bytes of the heap block */
+    size_t used;                        /* bytes handed out since the reset */
+    long grows;                         /* heap allocations of the block */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Resets an arena and makes sure it holds at least `bytes`.
+ *
+ * The block is kept when it is large enough, otherwise it is replaced
+ * by one with ARENA_HEADROOM spare room; its content is not preserved.
+ *
+ * @param a Arena, zero-initialized before its first use.
+ * @param bytes Total of the ARENA_ROUND() sizes that will be allocated.
+ * @retval true  Success.
+ * @retval false Allocation failure, the arena is empty.
+ */
+bool ArenaReserve(struct merkle_arena_t *a, size_t bytes);
+
+/**
+ * @brief Carves the next block of an arena.
+ *
+ * @param a Arena.
+ * @param bytes Size of the block.
+ * @return Aligned block, NULL if the reserved room is exhausted.
+ */
+void *ArenaAlloc(struct merkle_arena_t *a, size_t bytes);
+
+/**
+ * @brief Gives back every block, keeping the capacity.
+ *
+ * @param a Arena.
+ */
+void ArenaReset(struct merkle_arena_t *a);
+
+/**
+ * @brief Frees the heap block of an arena.
+ *
+ * @param a Arena.
+ */
+void ArenaRelease(struct merkle_arena_t *a);
+
+#endif /* MERKLE_ARENA_H */
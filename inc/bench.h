@@ -0,0 +1,77 @@
+/**
+ * @file bench.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Microbenchmarks of the hash kernels
+ */
+
+#ifndef MERKLE_BENCH_H
+#define MERKLE_BENCH_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdbool.h>                    /* booleans */
+#include <stdio.h>                      /* FILE */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Defaults of the measurement */
+#define BENCH_DEFAULT_RUNS   51         /* timed runs per kernel */
+#define BENCH_DEFAULT_WARMUP 5          /* untimed runs before */
+#define BENCH_DEFAULT_RUN_US 2000       /* target duration of one run */
+
+/* Upper bound of the timed runs per kernel */
+#define BENCH_MAX_RUNS 1000
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* How the kernels are measured */
+struct bench_options_t {
+    int runs;                           /* timed runs per kernel */
+    int warmup;                         /* untimed runs before them */
+    int run_us;                         /* target duration of one run */
+    const char *filter;                 /* only the kernels whose name contains it, NULL for all */
+};
+
+/* Measurement of one kernel. Every run repeats the operation `ops`
+ * times; the statistics are over the per-operation time of the runs. */
+struct bench_result_t {
+    const char *name;
+    size_t bytes;                       /* bytes hashed per operation */
+    long ops;                           /* operations per run */
+    int runs;
+    double ns_median;                   /* ns per operation */
+    double ns_p99;
+    double ns_min;
+    double cycles_per_byte;             /* median, in timestamp counter cycles, 0 if unavailable */
+    double mb_per_s;                    /* at the median */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Measures the hash kernels and prints one line per kernel.
+ *
+ * @param opt Measurement options.
+ * @param out Destination of the table.
+ * @param json Destination of the JSON report, may be NULL.
+ * @return Number of kernels that failed.
+ */
+int RunHashBenchmarks(const struct bench_options_t *opt, FILE *out, FILE *json);
+
+#endif /* MERKLE_BENCH_H */
@@ -0,0 +1,91 @@
+/**
+ * @file blocked.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Subtree-blocked layout of the tree hashes for proof-heavy workloads
+ */
+
+#ifndef MERKLE_BLOCKED_H
+#define MERKLE_BLOCKED_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* flat tree levels, level sources */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Levels per block when none is given */
+#define BLOCKED_DEFAULT_HEIGHT 4
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Hashes grouped by subtree instead of by level. The levels are cut in
+ * bands of `height` levels from the leaves up; every node just above a
+ * band owns one block holding its descendants inside the band, its
+ * children first. A proof reads `height` sibling groups from one block
+ * per band, instead of one group from every level array. */
+struct blocked_levels_t {
+    long n_leaves;
+    int n_levels;
+    int arity;
+    enum merkle_padding_t padding;
+    int height;                         /* levels per band */
+    int n_bands;
+    long level_size[LEVELS_MAX];        /* nodes per level, as the source levels */
+    int band_top[LEVELS_MAX];           /* level of the block owners of every band */
+    long block_nodes[LEVELS_MAX];       /* nodes per block of every band */
+    size_t band_offset[LEVELS_MAX];     /* first node of every band */
+    int level_band[LEVELS_MAX];         /* band of every level */
+    long level_above[LEVELS_MAX];       /* block nodes stored before the row of a level */
+    long level_width[LEVELS_MAX];       /* nodes of the block row of a level */
+    int level_shift[LEVELS_MAX];        /* log2 of level_width, -1 if not a power of 2 */
+    unsigned char *hashes;              /* every block, band after band */
+    size_t map_size;                    /* mapped size of hashes, 0 when on the heap */
+    size_t n_nodes;                     /* nodes allocated, empty slots included */
+    unsigned char root[SHA256_DIGEST_LENGTH];
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Copies the hashes of a tree into the subtree-blocked layout.
+ *
+ * @param lv Whole tree.
+ * @param height Levels per block, 0 for BLOCKED_DEFAULT_HEIGHT.
+ * @param bl Blocked tree to fill, released with BlockedFree().
+ * @retval true  Success.
+ * @retval false Invalid parameters or allocation failure.
+ */
+bool BlockedFromLevels(const struct merkle_levels_t *lv, int height, struct blocked_levels_t *bl);
+
+/**
+ * @brief Exposes a blocked tree as a level source.
+ *
+ * @param bl Blocked tree, kept alive while the source is used.
+ * @param src Source to fill.
+ */
+void BlockedSource(const struct blocked_levels_t *bl, struct level_source_t *src);
+
+/**
+ * @brief Releases the blocks.
+ *
+ * @param bl Blocked tree.
+ */
+void BlockedFree(struct blocked_levels_t *bl);
+
+#endif /* MERKLE_BLOCKED_H */
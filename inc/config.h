@@ -0,0 +1,138 @@
+/**
+ * @file config.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Run-time configuration of the tree construction
+ */
+
+#ifndef MERKLE_CONFIG_H
+#define MERKLE_CONFIG_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/utils.h"               /* enum merkle_padding_t */
+#include "../inc/placement.h"           /* enum placement_huge_t */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Environment variables selecting the arity and the padding mode */
+#define CONFIG_ENV_ARITY   "MERKLE_ARITY"
+#define CONFIG_ENV_PADDING "MERKLE_PADDING"
+#define CONFIG_ENV_BUDGET  "MERKLE_RAM_BUDGET_KB"
+#define CONFIG_ENV_HUGE    "MERKLE_HUGE_PAGES"
+#define CONFIG_ENV_PIN     "MERKLE_PIN_THREADS"
+#define CONFIG_ENV_THREADS "MERKLE_THREADS"
+#define CONFIG_ENV_READ    "MERKLE_READ_BUFFER"
+#define CONFIG_ENV_BACKEND "MERKLE_BACKEND"
+#define CONFIG_ENV_PROFILE "MERKLE_PROFILE"
+
+/* Accepted arity range */
+#define CONFIG_DEFAULT_ARITY 2
+#define CONFIG_MAX_ARITY     64
+
+/* Memory of the out-of-core proof lookups, in KiB */
+#define CONFIG_DEFAULT_BUDGET_KB 1024
+
+/* Bytes per read() of the leaf files, the buffer is on the stack */
+#define CONFIG_DEFAULT_READ_BUFFER 4096
+#define CONFIG_MAX_READ_BUFFER     65536
+
+/* Calibration profile: <cache dir>/merkle/<host name>.profile, written by
+ * merkleTree_tune; CONFIG_ENV_PROFILE gives another file, or "off" */
+#define CONFIG_PROFILE_DIR    "merkle"
+#define CONFIG_PROFILE_SUFFIX ".profile"
+#define CONFIG_PROFILE_OFF    "off"
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* How the parents are hashed */
+enum hash_backend_t {
+    HASH_BACKEND_CTX,                   /* reused context, EVP_sha256() at every init */
+    HASH_BACKEND_FETCHED,               /* reused context, implementation fetched once */
+    HASH_BACKEND_ONESHOT,               /* EVP_Digest() */
+    HASH_BACKEND_DIRECT,                /* low-level SHA-256 on the stack, nothing allocated */
+    HASH_BACKENDS
+};
+
+/* Parameters of the trees built by the application */
+struct merkle_config_t {
+    int arity;                          /* children per node */
+    enum merkle_padding_t padding;      /* completion of the partial groups */
+    int ram_budget_kb;                  /* hashes cached from level files */
+    enum placement_huge_t huge_pages;   /* backing of the large level blocks */
+    int pin_threads;                    /* pin the build workers to their CPUs */
+    int threads;                        /* build workers, 0 for one per online CPU */
+    int read_buffer;                    /* bytes per read() of a leaf file */
+    enum hash_backend_t backend;        /* hashing of the leaves and the parents */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+extern struct merkle_config_t merkle_config;
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Overrides the defaults with the calibration profile of the host,
+ *        then with the environment variables.
+ *
+ * Invalid values are reported and ignored. A missing profile is not an
+ * error, see ConfigLoadProfile().
+ *
+ * @retval true  Every variable set was valid.
+ * @retval false At least one variable was ignored.
+ */
+bool ConfigLoadEnv(void);
+
+/**
+ * @brief Gives the calibration profile file of the host.
+ *
+ * @param path Receives CONFIG_ENV_PROFILE when set, else the profile in
+ *             $XDG_CACHE_HOME, or in ~/.cache.
+ * @param size Size of path.
+ * @retval true  A profile applies.
+ * @retval false Profiles are off, or no cache directory is known.
+ */
+bool ConfigProfilePath(char *path, size_t size);
+
+/**
+ * @brief Loads the threads, read buffer and backend of a calibration profile.
+ *
+ * The profile records the host it was measured on (host name, CPU model
+ * and online CPUs): the profile of another host, or of the same host
+ * with other CPUs, is reported and ignored.
+ *
+ * @param path Profile, NULL for ConfigProfilePath().
+ * @retval true  The profile was applied.
+ * @retval false Missing, foreign or malformed profile, merkle_config unchanged.
+ */
+bool ConfigLoadProfile(const char *path);
+
+/**
+ * @brief Writes the threads, read buffer and backend of merkle_config as
+ *        the calibration profile of the host.
+ *
+ * @param path Profile, NULL for ConfigProfilePath(); missing directories
+ *             are created.
+ * @retval true  Success.
+ * @retval false I/O error, reported on stderr.
+ */
+bool ConfigSaveProfile(const char *path);
+
+/**
+ * @brief Returns the name of a hash backend, as in MERKLE_BACKEND.
+ */
+const char *ConfigBackendName(enum hash_backend_t backend);
+
+#endif /* MERKLE_CONFIG_H */
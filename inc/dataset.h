@@ -0,0 +1,133 @@
+/**
+ * @file dataset.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Parallel generation of seeded synthetic leaf datasets
+ */
+
+#ifndef MERKLE_DATASET_H
+#define MERKLE_DATASET_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/sweep.h"               /* struct sweep_dist_t */
+
+#include <stdbool.h>                    /* booleans */
+#include <stddef.h>                     /* size_t */
+#include <stdint.h>                     /* uint64_t */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Files next to a dataset folder, outside it: the folder only holds leaves */
+#define DATASET_MANIFEST_SUFFIX ".dataset"
+#define DATASET_PACK_SUFFIX     ".pack"
+
+/* Default seed of the sizes and contents */
+#define DATASET_DEFAULT_SEED 0x4D45524B4C45ull
+
+/* Largest dataset, in leaves */
+#define DATASET_MAX_FILES 100000000L
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* What to generate */
+struct dataset_spec_t {
+    long files;                         /* leaves */
+    struct sweep_dist_t size;           /* size distribution of the leaves */
+    uint64_t seed;                      /* sizes and contents */
+    bool pack;                          /* also write the packed container */
+    int threads;                        /* writers, 0 for merkle_config.threads */
+};
+
+/* Outcome of a generation */
+struct dataset_stats_t {
+    long files;
+    long long bytes;
+    double elapsed_ms;
+    bool reused;                        /* the manifest matched, nothing was written */
+    bool tmpfs;                         /* the folder is in memory */
+};
+
+/* Packed container mapped for reading */
+struct dataset_pack_t {
+    long files;
+    const uint64_t *offsets;            /* files + 1 offsets from the start of the map */
+    const unsigned char *map;
+    size_t map_size;
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Generates a dataset, or reuses the one already there.
+ *
+ * Leaf i of the folder (LEAF_FILE_FORMAT) holds SweepLeafSize() bytes of
+ * the seed, filled with a pseudo-random stream of the seed and i: the
+ * same specification always gives the same bytes, whatever the number
+ * of writers. The writers claim chunks of leaves and write each file
+ * with a single write(). The packed container holds the same leaves
+ * back to back, after a header and an offset table.
+ *
+ * The manifest, written last, records the specification. When it
+ * matches and the folder holds as many leaves, the dataset is reused.
+ * Otherwise the folder is emptied and generated again.
+ *
+ * @param folder Folder of the leaves, ending with '/'; its parent must exist.
+ * @param spec Dataset to generate.
+ * @param st Receives the outcome, may be NULL.
+ * @retval true  The dataset is in place.
+ * @retval false Invalid specification or I/O error, reported on stderr.
+ */
+bool DatasetGenerate(const char *folder, const struct dataset_spec_t *spec,
+                     struct dataset_stats_t *st);
+
+/**
+ * @brief Removes a dataset: its leaves, folder, manifest and container.
+ *
+ * @param folder Folder of the leaves, ending with '/'.
+ * @retval true  Nothing of the dataset is left.
+ * @retval false I/O error, reported on stderr.
+ */
+bool DatasetRemove(const char *folder);
+
+/**
+ * @brief Maps the packed container of a dataset.
+ *
+ * @param folder Folder of the leaves, ending with '/'.
+ * @param pack Receives the mapping, released with DatasetPackClose().
+ * @retval true  Success.
+ * @retval false Missing or malformed container.
+ */
+bool DatasetPackOpen(const char *folder, struct dataset_pack_t *pack);
+
+/**
+ * @brief Returns leaf i of a packed container and its size.
+ */
+const unsigned char *DatasetPackLeaf(const struct dataset_pack_t *pack, long i, size_t *size);
+
+/**
+ * @brief Unmaps a packed container.
+ */
+void DatasetPackClose(struct dataset_pack_t *pack);
+
+/**
+ * @brief Tells if a path is on a tmpfs, where leaves are never read from a disk.
+ */
+bool DatasetOnTmpfs(const char *path);
+
+#endif /* MERKLE_DATASET_H */
@@ -0,0 +1,80 @@
+/**
+ * @file diff.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Top-down comparison of two Merkle trees
+ */
+
+#ifndef MERKLE_DIFF_H
+#define MERKLE_DIFF_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* flat tree levels */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Compares two hashes.
+ *
+ * @param a First SHA-256 hash.
+ * @param b Second SHA-256 hash.
+ * @retval true  The hashes differ.
+ * @retval false The hashes are equal.
+ */
+bool HashDiffers(const unsigned char *a, const unsigned char *b);
+
+/**
+ * @brief Compares a run of contiguous hashes.
+ *
+ * Each pair of hashes is compared with one 32-byte SIMD compare
+ * (two with SSE2) and its result set in the mask without a branch.
+ *
+ * @param a First run of hashes.
+ * @param b Second run of hashes.
+ * @param count Number of hashes to compare (at most 64).
+ * @return Bit i is set when the i-th hashes differ.
+ */
+uint64_t HashRunDiffMask(const unsigned char *a, const unsigned char *b, int count);
+
+/**
+ * @brief Finds the leaves that differ between two trees.
+ *
+ * Walks both trees from the top, descending only into the
+ * subtrees whose hashes differ, so the cost is O(k log n) for
+ * k changed leaves. Leaves present in only one of the trees
+ * are reported as changed. Both trees must share arity and padding.
+ *
+ * @param a First tree.
+ * @param b Second tree.
+ * @param changed Allocated array of changed leaf indexes, ascending,
+ *                to be released with free(). NULL when nothing differs.
+ * @return Number of changed leaves, -1 on failure or for a tree of more
+ *         than INT_MAX nodes per level.
+ */
+int DiffLevels(const struct merkle_levels_t *a, const struct merkle_levels_t *b, int **changed);
+
+#endif /* MERKLE_DIFF_H */
@@ -0,0 +1,169 @@
+/**
+ * @file levelfile.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Out-of-core tree construction into level files
+ */
+
+#ifndef MERKLE_LEVELFILE_H
+#define MERKLE_LEVELFILE_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* flat tree levels, level sources */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Files of a tree stored out of core, inside its directory */
+#define LEVEL_FILE_FORMAT     "%slevel_%02d.bin"
+#define LEVEL_MANIFEST_FORMAT "%smanifest.bin"
+
+/* Default write buffer of every level file */
+#define LEVEL_IO_BUFFER (64 * 1024)
+
+/* Unit of the read cache of a level store */
+#define LEVEL_PAGE_SIZE 4096
+
+/* Most nodes of a level: its pages must fit the 40 bits of a cache tag */
+#define LEVEL_STORE_MAX_NODES ((1L << 40) * (LEVEL_PAGE_SIZE / SHA256_DIGEST_LENGTH))
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Streaming construction: leaves are pushed in order, every node is
+ * appended to the file of its level as soon as it is known, only the
+ * open group of every level stays in memory */
+struct level_writer_t {
+    char dir[256];                      /* directory, with trailing '/' */
+    int arity;
+    enum merkle_padding_t padding;
+    int n_levels;                       /* levels with a file so far */
+    long n_leaves;                      /* leaves pushed, padding excluded */
+    size_t io_buffer;                   /* write buffer per level */
+    FILE *fp[LEVELS_MAX];
+    long count[LEVELS_MAX];             /* nodes written per level */
+    int pending[LEVELS_MAX];            /* nodes of the open group */
+    unsigned char *group;               /* LEVELS_MAX open groups of arity hashes */
+    unsigned char root[SHA256_DIGEST_LENGTH];
+};
+
+/* Read-only access to a tree stored out of core, through a page cache
+ * that never holds more than the RAM budget */
+struct level_store_t {
+    long n_leaves;
+    int n_levels;
+    int arity;
+    enum merkle_padding_t padding;
+    long level_size[LEVELS_MAX];
+    int fd[LEVELS_MAX];
+    unsigned char root[SHA256_DIGEST_LENGTH];
+    int n_pages;                        /* cache slots, budget / LEVEL_PAGE_SIZE */
+    long *page_tag;                     /* level and page of every slot, -1 if empty */
+    unsigned char *cache;               /* n_pages * LEVEL_PAGE_SIZE bytes */
+    long reads;                         /* pages read from the files */
+    long hits;                          /* pages found in the cache */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Starts an out-of-core construction.
+ *
+ * @param w Writer to initialize.
+ * @param dir Existing directory receiving the level files (with trailing '/').
+ * @param arity Number of children per node.
+ * @param padding Completion of the partial groups.
+ * @param io_buffer Write buffer of every level file, 0 for LEVEL_IO_BUFFER.
+ * @retval true  Success.
+ * @retval false Invalid parameters or allocation failure.
+ */
+bool LevelWriterOpen(struct level_writer_t *w, const char *dir, int arity,
+                     enum merkle_padding_t padding, size_t io_buffer);
+
+/**
+ * @brief Appends the next leaf hash.
+ *
+ * Completes the parents whose last child it is, up the tree.
+ *
+ * @param w Writer.
+ * @param leaf Leaf hash.
+ * @retval true  Success.
+ * @retval false LEVEL_STORE_MAX_NODES leaves already pushed, hashing or
+ *               I/O error.
+ */
+bool LevelWriterPush(struct level_writer_t *w, const unsigned char leaf[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Completes the partial groups, writes the manifest and closes the files.
+ *
+ * The level files then hold the same hashes as LevelsFromLeafHashes().
+ *
+ * @param w Writer, closed in any case.
+ * @retval true  Success, the root is in w->root.
+ * @retval false No leaf, hashing or I/O error.
+ */
+bool LevelWriterFinish(struct level_writer_t *w);
+
+/**
+ * @brief Builds the level files of a transactions folder without holding the tree.
+ *
+ * @param folder Transactions folder (with trailing '/').
+ * @param dir Existing directory receiving the level files (with trailing '/').
+ * @param arity Number of children per node.
+ * @param padding Completion of the partial groups.
+ * @param root Buffer to store the root hash.
+ * @retval true  Success.
+ * @retval false Hashing or I/O error.
+ */
+bool LevelFilesBuild(const char *folder, const char *dir, int arity,
+                     enum merkle_padding_t padding, unsigned char root[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Deletes the level files and the manifest of a directory.
+ *
+ * @param dir Directory of the level files (with trailing '/').
+ */
+void LevelFilesRemove(const char *dir);
+
+/**
+ * @brief Opens the level files of a tree.
+ *
+ * @param s Store to initialize, released with LevelStoreClose().
+ * @param dir Directory of the level files (with trailing '/').
+ * @param ram_budget Bytes of hashes kept in memory, 0 to read every time.
+ * @retval true  Success.
+ * @retval false Missing or malformed files, a level of more than
+ *               LEVEL_STORE_MAX_NODES nodes, allocation failure.
+ */
+bool LevelStoreOpen(struct level_store_t *s, const char *dir, size_t ram_budget);
+
+/**
+ * @brief Exposes a level store as a level source.
+ *
+ * @param s Opened store.
+ * @param src Source to fill.
+ */
+void LevelStoreSource(struct level_store_t *s, struct level_source_t *src);
+
+/**
+ * @brief Closes the level files and releases the cache.
+ *
+ * @param s Store.
+ */
+void LevelStoreClose(struct level_store_t *s);
+
+#endif /* MERKLE_LEVELFILE_H */
@@ -0,0 +1,276 @@
+/**
+ * @file levels.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Flat per-level hash storage of a Merkle tree (snapshots)
+ */
+
+#ifndef MERKLE_LEVELS_H
+#define MERKLE_LEVELS_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/utils.h"               /* utilities */
+
+#include <stddef.h>                     /* size_t */
+#include <stdio.h>                      /* FILE */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Default location of the stored snapshot of the tree */
+#define SNAPSHOT_FILE "data/snapshot.bin"
+
+/* Upper bound of the levels of a tree */
+#define LEVELS_MAX 64
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* Address of the hash of node `idx` at level `lvl` */
+#define LEVEL_HASH(lv, lvl, idx) \
+    ((lv)->level[(lvl)] + (size_t)(idx) * SHA256_DIGEST_LENGTH)
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Hashes of a tree stored level by level, leaves first.
+ * Each level is a contiguous array of level_size[l] hashes,
+ * padding nodes included (PADDING_DUPLICATE only); the children
+ * of node i are the nodes [i * arity, (i + 1) * arity) of the
+ * level below that exist. */
+struct merkle_levels_t {
+    long n_leaves;                      /* real leaves (files) */
+    int n_levels;                       /* levels, root included */
+    int arity;                          /* children per node */
+    enum merkle_padding_t padding;      /* completion of the partial groups */
+    long *level_size;                   /* nodes per level */
+    unsigned char **level;              /* hashes per level */
+    void *map;                          /* mapped snapshot or huge-page block */
+    size_t map_size;                    /* size of the mapping */
+    size_t mem_size;                    /* bytes charged to MEM_LEVELS, see mem.h */
+};
+
+/**
+ * @brief Reads consecutive hashes of one level.
+ *
+ * @param ctx Storage of the levels.
+ * @param level Level of the hashes.
+ * @param first Index of the first hash.
+ * @param count Number of hashes.
+ * @param out Buffer receiving count hashes.
+ * @retval true  Success.
+ * @retval false Out of range or I/O error.
+ */
+typedef bool (*level_read_t)(void *ctx, int level, long first, int count, unsigned char *out);
+
+/* Read access to the hashes of a tree, whatever keeps them
+ * (memory, level files, partial storage...) */
+struct level_source_t {
+    long n_leaves;
+    int n_levels;
+    int arity;
+    enum merkle_padding_t padding;
+    const long *level_size;             /* nodes per level */
+    level_read_t read;
+    void *ctx;
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Copies the hashes of a node tree into flat level arrays.
+ *
+ * @param nodes Null terminated matrix of the tree nodes (leaves first).
+ * @param n_leaves Number of real leaves (without padding).
+ * @param padding Completion used to build the node tree.
+ * @param lv Levels to fill, released with LevelsFree().
+ * @retval true  Success.
+ * @retval false Empty tree or allocation failure.
+ */
+bool LevelsFromNodes(struct node_t ***nodes, int n_leaves, enum merkle_padding_t padding,
+                     struct merkle_levels_t *lv);
+
+/**
+ * @brief Builds all the levels of a tree from its leaf hashes.
+ *
+ * With PADDING_DUPLICATE every level is padded to a multiple of the
+ * arity with copies of its last hash. With PADDING_PROMOTE a partial
+ * last group is hashed as is and a lone last node moves up unchanged.
+ * With arity 2 both give the layout of the node tree of the same mode.
+ * A parent is the hash of its concatenated children.
+ * Large levels are cut in one range per CPU, the same worker copying
+ * then hashing the same range of every level (pinned to its CPU when
+ * merkle_config.pin_threads is set).
+ *
+ * @param leaves n_leaves contiguous leaf hashes.
+ * @param n_leaves Number of leaves.
+ * @param arity Number of children per node (2, 4, 8, 16...).
+ * @param padding Completion of the partial groups.
+ * @param lv Levels to fill, released with LevelsFree().
+ * @retval true  Success.
+ * @retval false Empty input, allocation or hashing failure.
+ */
+bool LevelsFromLeafHashes(const unsigned char *leaves, int n_leaves, int arity,
+                          enum merkle_padding_t padding, struct merkle_levels_t *lv);
+
+/**
+ * @brief Computes the root of a subtree from its leaf hashes.
+ *
+ * Completes the partial groups like the whole tree does below its root,
+ * so the result equals the node of level `height` covering these leaves.
+ *
+ * @param hashes Leaf hashes, overwritten; room for count + arity - 1 hashes.
+ * @param count Number of leaves (at least 1).
+ * @param height Level of the subtree root.
+ * @param arity Number of children per node.
+ * @param padding Completion of the partial groups.
+ * @param output Buffer to store the 32-byte root.
+ * @retval true  Success.
+ * @retval false Hashing failure.
+ */
+bool SubtreeRoot(unsigned char *hashes, int count, int height, int arity,
+                 enum merkle_padding_t padding, unsigned char output[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Returns the number of parent hashes computed to build the levels.
+ *
+ * Padding nodes and promoted nodes are copies and do not count.
+ *
+ * @param lv Levels.
+ * @return Number of hash computations above the leaves.
+ */
+long LevelsHashCalls(const struct merkle_levels_t *lv);
+
+/**
+ * @brief Returns the number of leaves covered by a node of a level.
+ *
+ * @param arity Number of children per node.
+ * @param level Level of the node.
+ * @return arity^level.
+ */
+long LevelSpan(int arity, int level);
+
+/**
+ * @brief Allocates the level arrays for the given level sizes.
+ *
+ * All the hashes live in one block pointed by level[0]. A block of at
+ * least PLACEMENT_HUGE_PAGE bytes is mapped with merkle_config.huge_pages
+ * and left untouched, so that its pages land on the NUMA node of the
+ * threads that fill it.
+ *
+ * @param lv Levels to allocate, released with LevelsFree().
+ * @param sizes Nodes per level.
+ * @param n_levels Number of levels.
+ * @retval true  Success.
+ * @retval false Allocation failure.
+ */
+bool LevelsAlloc(struct merkle_levels_t *lv, const long *sizes, int n_levels);
+
+/**
+ * @brief Fills the padding of a level with copies of its last real hash.
+ *
+ * @param hashes Hashes of the level.
+ * @param count Number of real hashes.
+ * @param padded Size of the padded level.
+ */
+void LevelsPad(unsigned char *hashes, int count, int padded);
+
+/**
+ * @brief Computes the parents of the real nodes of a level.
+ *
+ * With PADDING_DUPLICATE the level is first padded in place to a
+ * multiple of the arity. With PADDING_PROMOTE a partial last group is
+ * hashed as is and a lone last node is copied up without hashing.
+ * parents may be equal to children.
+ *
+ * @param children Hashes of the level, room for the padding.
+ * @param count Number of real nodes of the level.
+ * @param arity Number of children per node.
+ * @param padding Completion of the last group.
+ * @param parents Buffer receiving the parents.
+ * @return Number of parents, -1 on hashing failure.
+ */
+int LevelsHashUp(unsigned char *children, int count, int arity,
+                 enum merkle_padding_t padding, unsigned char *parents);
+
+/**
+ * @brief Writes the levels to a snapshot file.
+ *
+ * @param lv Levels to store.
+ * @param filename Destination file.
+ * @retval true  Success.
+ * @retval false I/O error, or a tree of INT_MAX - arity leaves or more.
+ */
+bool LevelsSave(const struct merkle_levels_t *lv, const char *filename);
+
+/**
+ * @brief Writes the levels in the snapshot format to an open stream.
+ *
+ * @param lv Levels to store.
+ * @param fp Destination stream, left open.
+ * @retval true  Success.
+ * @retval false I/O error, or a tree of INT_MAX - arity leaves or more.
+ */
+bool LevelsWrite(const struct merkle_levels_t *lv, FILE *fp);
+
+/**
+ * @brief Maps a snapshot file read-only.
+ *
+ * Nothing is read upfront, the pages touched by a query
+ * are the only ones loaded from disk.
+ *
+ * @param lv Levels to fill, released with LevelsFree().
+ * @param filename Snapshot file.
+ * @retval true  Success.
+ * @retval false Missing or malformed snapshot.
+ */
+bool LevelsLoad(struct merkle_levels_t *lv, const char *filename);
+
+/**
+ * @brief Maps levels in the snapshot format from an open descriptor.
+ *
+ * The mapping is read-only and outlives the descriptor, which the
+ * caller closes. Any file works: a snapshot, a shared memory segment...
+ * The level sizes must be those NodesNumberLevels() gives for the leaves,
+ * arity and padding of the header.
+ *
+ * @param lv Levels to fill, released with LevelsFree().
+ * @param fd Descriptor open for reading.
+ * @retval true  Success.
+ * @retval false Malformed content, sizes of another shape or mapping failure.
+ */
+bool LevelsMapFd(struct merkle_levels_t *lv, int fd);
+
+/**
+ * @brief Releases the memory (or mapping) held by the levels.
+ *
+ * @param lv Levels to release.
+ */
+void LevelsFree(struct merkle_levels_t *lv);
+
+/**
+ * @brief Exposes in-memory levels as a level source.
+ *
+ * @param lv Levels, kept alive while the source is used.
+ * @param src Source to fill.
+ */
+void LevelsSource(const struct merkle_levels_t *lv, struct level_source_t *src);
+
+/**
+ * @brief Returns the root hash of the levels.
+ *
+ * @param lv Levels.
+ * @return Pointer to the root hash, NULL for an empty tree.
+ */
+const unsigned char *LevelsRoot(const struct merkle_levels_t *lv);
+
+#endif /* MERKLE_LEVELS_H */
@@ -0,0 +1,142 @@
+/**
+ * @file mem.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Allocation accounting of the tree, per subsystem
+ *
+ * Every block a tree keeps, builds with or serves from is charged here.
+ * Left out: the small size tables of NodesNumberLevels() and
+ * LevelsFromNodes(), the arrays DiffLevels() and SyncPull() hand to their
+ * caller, and the buffers of the bench, sweep, tune, results and dataset
+ * tools, which hold no tree.
+ */
+
+#ifndef MERKLE_MEM_H
+#define MERKLE_MEM_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <openssl/evp.h>                /* EVP_MD_CTX */
+#include <stdbool.h>                    /* booleans */
+#include <stddef.h>                     /* size_t */
+#include <stdio.h>                      /* FILE */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Owners of the accounted memory */
+enum mem_subsystem_t {
+    MEM_LEVELS,                         /* level storage, heap or mapped */
+    MEM_NODES,                          /* node tree arena */
+    MEM_SCRATCH,                        /* temporary hash buffers of the builds */
+    MEM_HASH_CTX,                       /* digest contexts, counted only */
+    MEM_IO,                             /* read, write, cache and socket buffers */
+    MEM_PROOFS,                         /* siblings of the proofs built or decoded */
+    MEM_SUBSYSTEMS
+};
+
+/* Usage of one subsystem */
+struct mem_usage_t {
+    long long current;                  /* bytes held now */
+    long long peak;                     /* most bytes held, since MemResetPeaks() */
+    long long count;                    /* allocations made */
+    long long live;                     /* allocations not released */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief malloc() charged to a subsystem.
+ *
+ * @return The block, or NULL with nothing charged.
+ */
+void *MemAlloc(enum mem_subsystem_t sub, size_t size);
+
+/**
+ * @brief calloc() charged to a subsystem.
+ */
+void *MemCalloc(enum mem_subsystem_t sub, size_t n, size_t size);
+
+/**
+ * @brief realloc() charged to a subsystem.
+ *
+ * @param p Block of MemAlloc(), MemCalloc() or MemRealloc(), may be NULL.
+ * @param old_size Size it was allocated with, 0 for NULL.
+ * @param size New size.
+ * @return The block, or NULL with p left allocated and charged.
+ */
+void *MemRealloc(enum mem_subsystem_t sub, void *p, size_t old_size, size_t size);
+
+/**
+ * @brief Frees a block of MemAlloc(), MemCalloc() or MemRealloc().
+ *
+ * @param p Block, may be NULL.
+ * @param size Size it was allocated with.
+ */
+void MemFree(enum mem_subsystem_t sub, void *p, size_t size);
+
+/**
+ * @brief Charges memory obtained elsewhere (mmap) to a subsystem.
+ */
+void MemTrack(enum mem_subsystem_t sub, size_t size);
+
+/**
+ * @brief Releases memory charged by MemTrack().
+ */
+void MemUntrack(enum mem_subsystem_t sub, size_t size);
+
+/**
+ * @brief EVP_MD_CTX_new() counted in MEM_HASH_CTX.
+ *
+ * The context is opaque: only the allocations are counted, not its bytes.
+ */
+EVP_MD_CTX *MemHashCtxNew(void);
+
+/**
+ * @brief EVP_MD_CTX_free() of a context of MemHashCtxNew(), NULL accepted.
+ */
+void MemHashCtxFree(EVP_MD_CTX *ctx);
+
+/**
+ * @brief Reads the usage of a subsystem, from any thread.
+ */
+void MemUsage(enum mem_subsystem_t sub, struct mem_usage_t *u);
+
+/**
+ * @brief Restarts the peaks of every subsystem at their current bytes.
+ */
+void MemResetPeaks(void);
+
+/**
+ * @brief Returns the name of a subsystem.
+ */
+const char *MemSubsystemName(enum mem_subsystem_t sub);
+
+/**
+ * @brief Prints the usage of every subsystem and their total.
+ *
+ * @param fp Destination.
+ * @param title Header of the table.
+ * @param leaves Leaves of the tree, for the bytes per leaf; 0 to omit them.
+ */
+void MemReport(FILE *fp, const char *title, long leaves);
+
+#endif /* MERKLE_MEM_H */
@@ -12,11 +12,14 @@
  * INCLUDE FILES
  *-----------------------------------*/
 #include "../inc/utils.h"               /* utilities */
+#include "../inc/levels.h"              /* flat tree levels */
+#include "../inc/arena.h"               /* node tree memory */
 
 /*-----------------------------------*
  * PUBLIC DEFINES
  *-----------------------------------*/
-/* None */
+/* Name of the leaf files inside a transactions folder */
+#define LEAF_FILE_FORMAT "%sblock_%d.txt"
 
 /*-----------------------------------*
  * PUBLIC MACROS
@@ -37,6 +40,13 @@ extern struct node_t ***nodes;                 /* nodes of the tree */
  * ptr to the root node, head */
 extern struct node_t *root_node;
 
+/* Number of leaves (files) and levels of the current tree */
+extern int n_files;
+extern int tree_levels;
+
+/* Memory of the node tree, kept across rebuilds */
+extern struct merkle_arena_t tree_arena;
+
 /*-----------------------------------*
  * PUBLIC FUNCTION PROTOTYPES
  *-----------------------------------*/
@@ -47,4 +57,54 @@ extern struct node_t *root_node;
 */
 void BuildMerkleTree(const char *filename);
 
+/**
+ * @brief builds the merkleTree and keeps it in memory
+ *
+ * The tree stays available through `nodes` and `root_node`
+ * until MerkleTreeFree() is called. With PADDING_PROMOTE no padding
+ * node is allocated: a parent with a single child copies its hash.
+ * The leaves and the nodes are hashed with merkle_config.backend:
+ * HASH_BACKEND_DIRECT allocates nothing, the EVP backends keep one
+ * digest context per worker until MerkleTreeRelease() (OpenSSL 3.0 still
+ * allocates its provider state on every EVP_DigestInit_ex()). The leaf
+ * files are read on merkle_config.threads workers, with
+ * merkle_config.read_buffer: the settings of a calibration profile.
+ *
+ * @param filename Transactions folder (with trailing '/').
+ * @param padding Completion of the odd levels.
+ * @return The number of levels of the tree, 0 on failure.
+*/
+int MerkleTreeBuild(const char *filename, enum merkle_padding_t padding);
+
+/**
+ * @brief builds the merkleTree and keeps only its levels
+ *
+ * Arity 2 goes through MerkleTreeBuild(). Any other arity hashes the leaf
+ * files alone, like MerkleTreeBuild(), and builds the parents with
+ * LevelsFromLeafHashes().
+ *
+ * @param filename Transactions folder (with trailing '/').
+ * @param arity Number of children per node of the levels.
+ * @param padding Completion of the partial groups.
+ * @param lv Levels to fill, released with LevelsFree().
+ * @retval true  Success.
+ * @retval false Build or allocation failure.
+*/
+bool BuildMerkleLevels(const char *filename, int arity, enum merkle_padding_t padding,
+                       struct merkle_levels_t *lv);
+
+/**
+ * @brief frees the tree built by MerkleTreeBuild()
+ *
+ * The memory stays in `tree_arena`, so that the next build of a tree
+ * of similar size performs no heap allocation.
+*/
+void MerkleTreeFree(void);
+
+/**
+ * @brief frees the tree and releases the memory and the digest context
+ * kept for the next builds
+*/
+void MerkleTreeRelease(void);
+
 #endif /* MERKLE_TREE_H */
\ No newline at end of file
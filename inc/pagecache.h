@@ -0,0 +1,83 @@
+/**
+ * @file pagecache.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Page cache state of the leaf files before a build
+ */
+
+#ifndef MERKLE_PAGECACHE_H
+#define MERKLE_PAGECACHE_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdbool.h>                    /* booleans */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Page cache state a build starts from */
+enum pagecache_mode_t {
+    PAGECACHE_AS_IS,                    /* whatever the previous runs left */
+    PAGECACHE_COLD,                     /* file data evicted, the build reads the disk */
+    PAGECACHE_WARM,                     /* file data read beforehand */
+    PAGECACHE_MODES
+};
+
+/* Leaf files of a folder */
+struct pagecache_stats_t {
+    int files;
+    long long bytes;
+    long long resident_bytes;           /* file data in the page cache */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Puts the leaf files of a folder in the given page cache state.
+ *
+ * Cold mode writes back and drops the data of every file
+ * (posix_fadvise(POSIX_FADV_DONTNEED)); directory entries and inodes stay
+ * cached, dropping them needs root. Warm mode reads every file once.
+ *
+ * @param folder Folder of the leaf files (LEAF_FILE_FORMAT).
+ * @param mode State to reach.
+ * @param st Receives the files and their residency afterwards.
+ * @retval true  Every file was prepared.
+ * @retval false A file could not be opened or read.
+ */
+bool PageCachePrepare(const char *folder, enum pagecache_mode_t mode, struct pagecache_stats_t *st);
+
+/**
+ * @brief Measures how much of the leaf files is in the page cache (mincore).
+ *
+ * @param folder Folder of the leaf files.
+ * @param st Receives the files, their size and resident bytes.
+ * @retval true  Every file was measured.
+ * @retval false A file could not be opened or mapped.
+ */
+bool PageCacheResidency(const char *folder, struct pagecache_stats_t *st);
+
+/**
+ * @brief Name of a mode.
+ */
+const char *PageCacheModeName(enum pagecache_mode_t mode);
+
+#endif /* MERKLE_PAGECACHE_H */
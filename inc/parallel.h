@@ -0,0 +1,91 @@
+/**
+ * @file parallel.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Minimal worker pool running independent tasks
+ */
+
+#ifndef MERKLE_PARALLEL_H
+#define MERKLE_PARALLEL_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdbool.h>                    /* booleans */
+#include <stdatomic.h>                  /* atomic_bool */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Upper bound of the worker threads */
+#define PARALLEL_MAX_THREADS 64
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/**
+ * @brief Task run by a worker.
+ *
+ * @param ctx Context shared by all the tasks.
+ * @param task Task index.
+ * @param worker Index of the worker running the task.
+ * @retval true  Keep going.
+ * @retval false Cancel the outstanding tasks.
+ */
+typedef bool (*parallel_task_t)(void *ctx, int task, int worker);
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Returns the default number of worker threads (online CPUs).
+ */
+int ParallelDefaultThreads(void);
+
+/**
+ * @brief Runs n_tasks tasks on n_threads workers.
+ *
+ * Workers claim the tasks in ascending order. Once a task returns false,
+ * or once `cancel` is set, no new task is started; running tasks may
+ * poll `cancel` to stop early.
+ *
+ * @param n_tasks Number of tasks.
+ * @param n_threads Number of workers, 0 for the default.
+ * @param fn Task function.
+ * @param ctx Context passed to every task.
+ * @param cancel Cancellation flag, may be NULL.
+ * @retval true  Every task ran and returned true.
+ * @retval false Cancelled or thread creation failure.
+ */
+bool ParallelFor(int n_tasks, int n_threads, parallel_task_t fn, void *ctx, atomic_bool *cancel);
+
+/**
+ * @brief Runs n_tasks tasks on n_threads workers with a fixed schedule.
+ *
+ * Task t always runs on worker t % n_threads, so that successive calls
+ * give a range of data to the same worker: the pages it writes first
+ * stay on its NUMA node. The first failing task cancels the others.
+ *
+ * @param n_tasks Number of tasks.
+ * @param n_threads Number of workers, 0 for the default.
+ * @param fn Task function.
+ * @param ctx Context passed to every task.
+ * @param pin Pin worker i to PlacementCpu(i, n_threads); the affinity
+ *            of the calling thread (worker 0) is restored on return.
+ * @retval true  Every task ran and returned true.
+ * @retval false Cancelled or thread creation failure.
+ */
+bool ParallelForStatic(int n_tasks, int n_threads, parallel_task_t fn, void *ctx, bool pin);
+
+#endif /* MERKLE_PARALLEL_H */
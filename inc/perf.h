@@ -0,0 +1,194 @@
+/**
+ * @file perf.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Hardware performance counters of the process (perf_event_open)
+ */
+
+#ifndef MERKLE_PERF_H
+#define MERKLE_PERF_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdbool.h>                    /* booleans */
+#include <stdio.h>                      /* FILE */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Value of a counter that could not be opened or was never scheduled */
+#define PERF_UNAVAILABLE (-1LL)
+
+/* Phases kept per build, the later ones are dropped */
+#define PERF_MAX_PHASES 64
+
+/* Level of a phase that hashes no level */
+#define PERF_NO_LEVEL (-1L)
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Counted events, user space only */
+enum perf_counter_id_t {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,                    /* L1 data cache read misses */
+    PERF_LLC_MISSES,                    /* last level cache misses */
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,                   /* data TLB read misses */
+    PERF_NODE_MISSES,                   /* loads served by the memory of another NUMA node */
+    PERF_TASK_CLOCK,                    /* ns on CPU, a software counter */
+    PERF_COUNTERS
+};
+
+/* Counters of the calling thread and of the threads it creates after
+ * PerfOpen(); those are added once they have exited */
+struct perf_counters_t {
+    int fd[PERF_COUNTERS];              /* -1 if unavailable */
+    int error;                          /* errno of the first counter not opened, 0 if none */
+};
+
+/* Counts between PerfStart() and PerfStop(), scaled when the kernel
+ * multiplexed the counters */
+struct perf_sample_t {
+    long long value[PERF_COUNTERS];     /* PERF_UNAVAILABLE if unknown */
+};
+
+/* Counts of one phase of a build */
+struct perf_phase_t {
+    const char *name;
+    long level;                         /* level hashed, PERF_NO_LEVEL if none */
+    long leaves;                        /* leaves of the tree */
+    long nodes;                         /* nodes handled by the phase, 0 if none */
+    struct perf_sample_t sample;
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Opens every counter the kernel allows, stopped.
+ *
+ * Counters refused (no PMU in a container or a VM, perf_event_paranoid)
+ * stay unavailable, the others still count.
+ *
+ * @param pc Counters to open.
+ * @retval true  At least one counter is available.
+ * @retval false None is.
+ */
+bool PerfOpen(struct perf_counters_t *pc);
+
+/**
+ * @brief Resets and starts the available counters.
+ *
+ * @param pc Opened counters.
+ */
+void PerfStart(struct perf_counters_t *pc);
+
+/**
+ * @brief Stops the counters and reads them.
+ *
+ * @param pc Started counters.
+ * @param sample Receives the counts.
+ */
+void PerfStop(struct perf_counters_t *pc, struct perf_sample_t *sample);
+
+/**
+ * @brief Reads the running counters, without stopping them.
+ *
+ * @param pc Started counters.
+ * @param sample Receives the counts since PerfStart().
+ */
+void PerfRead(const struct perf_counters_t *pc, struct perf_sample_t *sample);
+
+/**
+ * @brief Records the phases of the next builds against running counters.
+ *
+ * Clears the phases recorded so far. The counters must be started
+ * around the builds: each phase is the difference of two PerfRead().
+ *
+ * @param pc Counters, NULL to stop recording and keep the phases.
+ */
+void PerfPhasesAttach(const struct perf_counters_t *pc);
+
+/**
+ * @brief Marks the start of a build phase, nothing when no counters are attached.
+ *
+ * @param mark Receives the counts at the start.
+ */
+void PerfPhaseStart(struct perf_sample_t *mark);
+
+/**
+ * @brief Records a build phase started with PerfPhaseStart().
+ *
+ * Called from the thread driving the build: the workers of the phase
+ * are counted once they have exited.
+ *
+ * @param mark Counts at the start of the phase.
+ * @param name Name of the phase, a string literal.
+ * @param level Level hashed, PERF_NO_LEVEL if none.
+ * @param leaves Leaves of the tree.
+ * @param nodes Nodes handled by the phase, 0 if none.
+ */
+void PerfPhaseEnd(const struct perf_sample_t *mark, const char *name, long level, long leaves,
+                  long nodes);
+
+/**
+ * @brief Returns the phases recorded since PerfPhasesAttach().
+ *
+ * @param recorded Receives the recorded phases, in order.
+ * @return Number of phases.
+ */
+int PerfPhases(const struct perf_phase_t **recorded);
+
+/**
+ * @brief Prints the recorded phases with their rates per leaf and per node.
+ *
+ * Task clock ns and cycles per leaf and per node, and the IPC, of every
+ * phase; n/a for the counters that are unavailable.
+ *
+ * @param fp Destination.
+ * @param title Header of the table.
+ */
+void PerfPhasesReport(FILE *fp, const char *title);
+
+/**
+ * @brief Closes the counters.
+ *
+ * @param pc Counters of PerfOpen().
+ */
+void PerfClose(struct perf_counters_t *pc);
+
+/**
+ * @brief Name of a counter.
+ */
+const char *PerfCounterName(enum perf_counter_id_t id);
+
+/**
+ * @brief Prints the counts of a phase, per leaf and per node, and the IPC.
+ *
+ * The unavailable counters are printed as n/a, with the reason once.
+ *
+ * @param fp Destination.
+ * @param pc Counters the sample was read from.
+ * @param phase Name of the measured phase.
+ * @param sample Counts of the phase.
+ * @param leaves Leaves processed by the phase.
+ * @param nodes Nodes hashed by the phase.
+ */
+void PerfReport(FILE *fp, const struct perf_counters_t *pc, const char *phase,
+                const struct perf_sample_t *sample, long leaves, long nodes);
+
+#endif /* MERKLE_PERF_H */
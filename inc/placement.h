@@ -0,0 +1,126 @@
+/**
+ * @file placement.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Huge-page allocation, NUMA-aware thread pinning and memory counters
+ */
+
+#ifndef MERKLE_PLACEMENT_H
+#define MERKLE_PLACEMENT_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdbool.h>                    /* booleans */
+#include <stddef.h>                     /* size_t */
+#include <stdatomic.h>                  /* atomic_long */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Size of a huge page, blocks smaller than it stay on the heap */
+#define PLACEMENT_HUGE_PAGE (2UL << 20)
+
+/* Number of placement modes */
+#define PLACEMENT_MODES 3
+
+/* Upper bound of the NUMA nodes scanned */
+#define PLACEMENT_MAX_NODES 64
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Backing of the large blocks, each mode falls back to the next one */
+enum placement_huge_t {
+    PLACEMENT_PLAIN = 0,                /* regular pages */
+    PLACEMENT_THP,                      /* madvise(MADV_HUGEPAGE) */
+    PLACEMENT_HUGETLB,                  /* MAP_HUGETLB, reserved hugetlbfs pages */
+};
+
+/* Process memory counters, sampled before and after a build */
+struct placement_stats_t {
+    long minflt;                        /* minor page faults */
+    long majflt;                        /* major page faults */
+    long anon_huge_kb;                  /* anonymous memory on transparent huge pages */
+    long node_kb[PLACEMENT_MAX_NODES];  /* memory of the process resident on each node */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* Blocks obtained per effective mode, fallbacks included */
+extern atomic_long placement_allocs[PLACEMENT_MODES];
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Maps a block aligned on PLACEMENT_HUGE_PAGE.
+ *
+ * Nothing is touched: every page lands on the NUMA node of the thread
+ * that writes it first.
+ *
+ * @param bytes Size of the block.
+ * @param mode Preferred backing, PLACEMENT_HUGETLB falls back to
+ *             PLACEMENT_THP, which falls back to regular pages.
+ * @param mapped Receives the size to pass to PlacementFree().
+ * @return Block, NULL on failure.
+ */
+void *PlacementAlloc(size_t bytes, enum placement_huge_t mode, size_t *mapped);
+
+/**
+ * @brief Unmaps a block of PlacementAlloc().
+ *
+ * @param block Block, may be NULL.
+ * @param mapped Size returned by PlacementAlloc().
+ */
+void PlacementFree(void *block, size_t mapped);
+
+/**
+ * @brief Returns the CPU of a worker, spreading the workers over the NUMA nodes.
+ *
+ * The CPUs are ordered node by node, worker i of n gets the CPU at
+ * i * cpus / n: consecutive workers, which handle consecutive ranges,
+ * share a node.
+ *
+ * @param worker Index of the worker.
+ * @param n_workers Number of workers.
+ * @return CPU number.
+ */
+int PlacementCpu(int worker, int n_workers);
+
+/**
+ * @brief Pins the calling thread to one CPU.
+ *
+ * @param cpu CPU number.
+ * @retval true  Success.
+ * @retval false The CPU is not available to the process.
+ */
+bool PlacementPin(int cpu);
+
+/**
+ * @brief Samples the page faults, THP usage and resident memory per NUMA node.
+ *
+ * The memory per node is the process's own, from /proc/self/numa_maps:
+ * where its pages landed, not whether they are accessed remotely (see
+ * PERF_NODE_MISSES). Counters that the system does not expose read 0.
+ *
+ * @param stats Counters to fill.
+ */
+void PlacementSample(struct placement_stats_t *stats);
+
+/**
+ * @brief Returns the name of a placement mode.
+ *
+ * @param mode Mode.
+ * @return "plain", "thp" or "hugetlb".
+ */
+const char *PlacementName(enum placement_huge_t mode);
+
+#endif /* MERKLE_PLACEMENT_H */
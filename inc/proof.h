@@ -0,0 +1,146 @@
+/**
+ * @file proof.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Inclusion proofs of a leaf in a k-ary Merkle tree
+ */
+
+#ifndef MERKLE_PROOF_H
+#define MERKLE_PROOF_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* flat tree levels */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Size of the encoded proof header: leaf, leaves, arity, padding and levels */
+#define PROOF_HEADER_SIZE (5 * sizeof(uint32_t))
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Path from a leaf to the root: for every level below the root, the
+ * siblings of the node on the path, left to right. There are arity - 1
+ * of them per level, fewer in a partial group of an unpadded tree and
+ * none for a promoted node; the shape of the tree tells how many. */
+struct merkle_proof_t {
+    int leaf;                           /* leaf index */
+    int n_leaves;                       /* leaves of the tree */
+    int arity;                          /* children per node */
+    enum merkle_padding_t padding;      /* completion of the partial groups */
+    int n_levels;                       /* levels of the tree, root included */
+    unsigned char *siblings;            /* sibling hashes, leaves first */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Extracts the inclusion proof of a leaf.
+ *
+ * @param lv Whole tree.
+ * @param leaf Leaf index.
+ * @param proof Proof to fill, released with ProofFree().
+ * @retval true  Success.
+ * @retval false Leaf out of range or allocation failure.
+ */
+bool ProofBuild(const struct merkle_levels_t *lv, int leaf, struct merkle_proof_t *proof);
+
+/**
+ * @brief Extracts the inclusion proof of a leaf from any level storage.
+ *
+ * Reads one group of siblings per level.
+ *
+ * @param src Storage of the tree.
+ * @param leaf Leaf index.
+ * @param proof Proof to fill, released with ProofFree().
+ * @retval true  Success.
+ * @retval false Leaf out of range, tree of more than INT_MAX leaves,
+ *               read or allocation failure.
+ */
+bool ProofBuildFromSource(const struct level_source_t *src, int leaf,
+                          struct merkle_proof_t *proof);
+
+/**
+ * @brief Checks that a leaf hash leads to a root through a proof.
+ *
+ * @param proof Inclusion proof.
+ * @param leaf_hash Hash of the leaf.
+ * @param root Expected root.
+ * @retval true  The proof leads to the root.
+ * @retval false Mismatch or hashing failure.
+ */
+bool ProofVerify(const struct merkle_proof_t *proof,
+                 const unsigned char leaf_hash[SHA256_DIGEST_LENGTH],
+                 const unsigned char root[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Returns the encoded size of a proof.
+ *
+ * Up to (arity - 1) * log_arity(n) hashes plus the header: wider trees
+ * need fewer levels but more siblings per level.
+ *
+ * @param proof Inclusion proof.
+ * @return Size in bytes.
+ */
+size_t ProofSize(const struct merkle_proof_t *proof);
+
+/**
+ * @brief Encodes a proof: header in network order, then the siblings.
+ *
+ * @param proof Inclusion proof.
+ * @param buf Destination buffer.
+ * @param size Size of the buffer.
+ * @return Bytes written, 0 if the buffer is too small.
+ */
+size_t ProofEncode(const struct merkle_proof_t *proof, unsigned char *buf, size_t size);
+
+/**
+ * @brief Encodes the proof of a leaf straight from the level arrays.
+ *
+ * Same bytes as ProofBuild() then ProofEncode(), without allocating
+ * the siblings: they are copied from the levels into the buffer.
+ *
+ * @param lv Levels of the tree.
+ * @param leaf Index of the leaf.
+ * @param buf Destination buffer.
+ * @param size Size of the buffer.
+ * @return Bytes written, 0 for an invalid leaf, a tree ProofBuild()
+ *         rejects or a buffer too small.
+ */
+size_t ProofEncodeFromLevels(const struct merkle_levels_t *lv, int leaf, unsigned char *buf,
+                             size_t size);
+
+/**
+ * @brief Decodes a proof written by ProofEncode().
+ *
+ * @param buf Encoded proof.
+ * @param size Size of the encoded proof.
+ * @param proof Proof to fill, released with ProofFree().
+ * @retval true  Success.
+ * @retval false Malformed proof or allocation failure.
+ */
+bool ProofDecode(const unsigned char *buf, size_t size, struct merkle_proof_t *proof);
+
+/**
+ * @brief Releases the siblings of a proof.
+ *
+ * @param proof Inclusion proof.
+ */
+void ProofFree(struct merkle_proof_t *proof);
+
+#endif /* MERKLE_PROOF_H */
@@ -0,0 +1,209 @@
+/**
+ * @file rcu.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Copy-on-write tree with epoch-based reclamation: readers never block the writer
+ */
+
+#ifndef MERKLE_RCU_H
+#define MERKLE_RCU_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* flat tree levels, level sources */
+
+#include <stdatomic.h>                  /* atomic_ulong */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Number of reader slots, one per reading thread */
+#define RCU_MAX_READERS 64
+
+/* Upper bound of the versions kept for historical queries */
+#define RCU_MAX_VERSIONS 1024
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Node of the copy-on-write tree. A node reachable from a published
+ * root is never written again: an update copies it. */
+struct rcu_node_t {
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    unsigned long born;                 /* version that created the node */
+    int n_children;                     /* real children, 0 for a leaf */
+    struct rcu_node_t *child[];         /* real children, left to right */
+};
+
+/* Node replaced by an update, freed once no kept version holds it
+ * and no reader can */
+struct rcu_retired_t {
+    struct rcu_node_t *node;
+    unsigned long died;                 /* first version without the node */
+    unsigned long epoch;                /* global epoch when no kept version held it, 0 before */
+};
+
+/* Tree shared by one writer and any number of readers. The writer copies
+ * the paths of the updated leaves and publishes the new root with one
+ * atomic store as the next version; the last `keep` versions share all
+ * their unchanged nodes and stay queryable. A replaced node is retired,
+ * and freed once no kept version holds it and every reader has moved
+ * past the epoch in which the last such version was pruned. Readers
+ * announce the epoch they start in and read the root they find: an
+ * immutable snapshot. */
+struct merkle_rcu_t {
+    long n_leaves;
+    int n_levels;
+    int arity;
+    enum merkle_padding_t padding;
+    long level_size[LEVELS_MAX];        /* nodes per level, padding included */
+    long real_size[LEVELS_MAX];         /* real nodes per level */
+    long span[LEVELS_MAX];              /* leaves under a node of every level */
+    _Atomic(struct rcu_node_t *) root;  /* published snapshot */
+    unsigned long version;              /* updates applied, writer side */
+    int keep;                           /* versions kept, the current one included */
+    atomic_ulong oldest;                /* oldest kept version */
+    _Atomic(struct rcu_node_t *) history[RCU_MAX_VERSIONS]; /* root of version v at v % RCU_MAX_VERSIONS */
+    atomic_ulong epoch;                 /* global epoch, starts at 1 */
+    atomic_ulong reader[RCU_MAX_READERS]; /* epoch of each reader, 0 when idle */
+    struct rcu_retired_t *retired;      /* replaced nodes not freed yet */
+    size_t n_retired;
+    size_t retired_cap;
+    long freed;                         /* replaced nodes freed so far */
+};
+
+/* Snapshot held by one reader between RcuAcquire() and RcuRelease() */
+struct rcu_view_t {
+    const struct merkle_rcu_t *tree;
+    const struct rcu_node_t *root;
+    unsigned long version;
+    int reader;
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Builds the copy-on-write tree of whole levels.
+ *
+ * The tree is version 0 and only the current version is kept.
+ *
+ * @param lv Tree to copy.
+ * @param t Tree to fill, released with RcuFree().
+ * @retval true  Success.
+ * @retval false Empty tree or allocation failure.
+ */
+bool RcuFromLevels(const struct merkle_levels_t *lv, struct merkle_rcu_t *t);
+
+/**
+ * @brief Takes a snapshot of the current tree.
+ *
+ * Wait-free. The nodes of the snapshot stay valid until RcuRelease().
+ *
+ * @param t Tree.
+ * @param reader Slot of the calling thread, below RCU_MAX_READERS, used
+ *               by one thread at a time.
+ * @param view Snapshot to fill.
+ */
+void RcuAcquire(struct merkle_rcu_t *t, int reader, struct rcu_view_t *view);
+
+/**
+ * @brief Takes a snapshot of a kept version.
+ *
+ * Wait-free. The nodes of the snapshot stay valid until RcuRelease(),
+ * even if the version is pruned meanwhile.
+ *
+ * @param t Tree.
+ * @param reader Slot of the calling thread, as for RcuAcquire().
+ * @param version Version to read.
+ * @param view Snapshot to fill.
+ * @retval true  Success.
+ * @retval false The version is pruned or not created yet.
+ */
+bool RcuAcquireVersion(struct merkle_rcu_t *t, int reader, unsigned long version,
+                       struct rcu_view_t *view);
+
+/**
+ * @brief Ends a snapshot, its nodes may be freed afterwards.
+ *
+ * @param t Tree.
+ * @param view Snapshot of RcuAcquire().
+ */
+void RcuRelease(struct merkle_rcu_t *t, struct rcu_view_t *view);
+
+/**
+ * @brief Returns the root hash of a snapshot.
+ *
+ * @param view Snapshot.
+ * @return Pointer to the root hash.
+ */
+const unsigned char *RcuRoot(const struct rcu_view_t *view);
+
+/**
+ * @brief Exposes a snapshot as a level source, for ProofBuildFromSource().
+ *
+ * @param view Snapshot, held while the source is used.
+ * @param src Source to fill.
+ */
+void RcuSource(const struct rcu_view_t *view, struct level_source_t *src);
+
+/**
+ * @brief Changes leaf hashes and publishes the new tree.
+ *
+ * Writer side, one writer at a time. The paths of the leaves are copied
+ * once per call and rehashed bottom-up, then the new root replaces the
+ * old one atomically as the next version. The versions beyond `keep`
+ * are pruned and the nodes no kept version holds are reclaimed.
+ *
+ * @param t Tree.
+ * @param leaves Indices of the changed leaves.
+ * @param hashes New leaf hashes, count contiguous hashes.
+ * @param count Number of leaves.
+ * @retval true  Success.
+ * @retval false Leaf out of range, allocation or hashing failure; the
+ *               published tree is unchanged.
+ */
+bool RcuUpdate(struct merkle_rcu_t *t, const int *leaves, const unsigned char *hashes, int count);
+
+/**
+ * @brief Sets the number of versions kept for historical queries.
+ *
+ * Writer side. Shrinking prunes the oldest versions at once.
+ *
+ * @param t Tree.
+ * @param keep Versions kept, the current one included, up to RCU_MAX_VERSIONS.
+ * @retval true  Success.
+ * @retval false keep out of range.
+ */
+bool RcuRetain(struct merkle_rcu_t *t, int keep);
+
+/**
+ * @brief Frees the retired nodes that no reader can hold anymore.
+ *
+ * Writer side, also called by RcuUpdate().
+ *
+ * @param t Tree.
+ * @return Number of nodes still retired.
+ */
+size_t RcuReclaim(struct merkle_rcu_t *t);
+
+/**
+ * @brief Releases the tree, once no reader holds a snapshot.
+ *
+ * @param t Tree.
+ */
+void RcuFree(struct merkle_rcu_t *t);
+
+#endif /* MERKLE_RCU_H */
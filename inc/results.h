@@ -0,0 +1,117 @@
+/**
+ * @file results.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Machine-readable benchmark results and their comparison with a baseline
+ */
+
+#ifndef MERKLE_RESULTS_H
+#define MERKLE_RESULTS_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdbool.h>                    /* booleans */
+#include <stdio.h>                      /* FILE */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Results appended by every test run, one JSON object per line */
+#define RESULTS_JSON_FILE "tests_results.jsonl"
+
+/* Defaults of the comparison */
+#define RESULTS_DEFAULT_THRESHOLD 5.0   /* % change of the median flagged */
+#define RESULTS_DEFAULT_ALPHA     0.05  /* significance of the rank test */
+
+/* Samples per side below which the rank test cannot conclude */
+#define RESULTS_MIN_SAMPLES 3
+
+/* Distinct metrics and samples per metric compared */
+#define RESULTS_MAX_METRICS 256
+#define RESULTS_MAX_SAMPLES 256
+
+/* Length of a metric name and of the run tag */
+#define RESULTS_NAME_LEN 96
+#define RESULTS_TAG_LEN  512
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Direction of a metric */
+enum results_better_t {
+    RESULTS_LOWER,                      /* times, memory */
+    RESULTS_HIGHER                      /* throughputs */
+};
+
+/* Destination of the records of one run */
+struct results_t {
+    FILE *fp;
+    char tag[RESULTS_TAG_LEN];          /* git revision, host and time, as JSON members */
+};
+
+/* How two sets of results are compared */
+struct results_compare_t {
+    double threshold;                   /* % change of the median flagged */
+    double alpha;                       /* significance of the rank test */
+    const char *rev[2];                 /* revision of the baseline and current records,
+                                           NULL for the last one of each stream */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Starts a run writing to a stream.
+ *
+ * Every record carries the git revision of the build, the host name,
+ * CPU model and kernel, and the start time of the run.
+ *
+ * @param r Run to start.
+ * @param fp Destination, records are appended.
+ */
+void ResultsStart(struct results_t *r, FILE *fp);
+
+/**
+ * @brief Appends one sample of a metric.
+ *
+ * @param r Run of ResultsStart(), nothing is written if its stream is NULL.
+ * @param metric Name of the metric, without quotes nor backslashes.
+ * @param value Sample.
+ * @param unit Unit of the sample.
+ * @param better Direction of an improvement.
+ */
+void ResultsRecord(const struct results_t *r, const char *metric, double value, const char *unit,
+                   enum results_better_t better);
+
+/**
+ * @brief Compares the samples of every metric with those of a baseline.
+ *
+ * Each side only keeps the records of one revision, by default the one of
+ * its last record, since a results file accumulates the runs of every
+ * revision. The medians are compared, and a Mann-Whitney rank test tells
+ * if the samples differ. A metric regresses when its median is worse by
+ * more than the threshold and the test is significant. A metric with
+ * fewer than RESULTS_MIN_SAMPLES samples on a side is reported but not
+ * counted, a single noisy sample cannot conclude.
+ *
+ * @param baseline Records of the baseline, seekable.
+ * @param current Records to check, seekable.
+ * @param opt Threshold and significance.
+ * @param out Destination of the report.
+ * @return Number of regressed metrics, -1 if a side holds no record.
+ */
+int ResultsCompare(FILE *baseline, FILE *current, const struct results_compare_t *opt, FILE *out);
+
+#endif /* MERKLE_RESULTS_H */
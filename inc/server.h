@@ -0,0 +1,203 @@
+/**
+ * @file server.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Proof server on a Unix domain socket, with batched requests and latency histograms
+ */
+
+#ifndef MERKLE_SERVER_H
+#define MERKLE_SERVER_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* flat tree levels */
+
+#include <sys/un.h>                     /* sockaddr_un */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Message types: a request and its answer share the type.
+ *  - ROOT  a = 0                  answer a = 32, b = leaves, root hash
+ *  - PROOF a = leaf               answer a = size, b = leaf, ProofEncode() bytes
+ *  - LEAF  a = leaf               answer a = 32, b = leaf, leaf hash
+ *  - STATS a = 0                  answer a = size, b = requests, for each
+ *                                 request type the SERVER_HIST_BUCKETS
+ *                                 counts of its latency histogram (uint32)
+ *  - ERROR                        answer a = 0, b = type of the bad request */
+#define SERVER_ROOT  1
+#define SERVER_PROOF 2
+#define SERVER_LEAF  3
+#define SERVER_STATS 4
+#define SERVER_ERROR 5
+
+/* Request types, index of their histogram */
+#define SERVER_TYPES 4
+
+/* Latency buckets: bucket b counts the answers given in [2^b, 2^(b+1)) ns */
+#define SERVER_HIST_BUCKETS 32
+
+/* Maximum number of connected clients */
+#define SERVER_MAX_CLIENTS 64
+
+/* Maximum number of requests answered together */
+#define SERVER_BATCH_MAX 256
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Message header, in network order, followed by a bytes of payload
+ * in the answers */
+struct server_header_t {
+    uint8_t type;
+    uint8_t pad[3];
+    uint32_t a;
+    uint32_t b;
+};
+
+/* Latency of the valid answers to one request type, from the read that
+ * received the request to its answer being queued */
+struct server_histogram_t {
+    unsigned long count;
+    unsigned long bucket[SERVER_HIST_BUCKETS];
+};
+
+/* Activity of a server */
+struct server_stats_t {
+    unsigned long requests;             /* requests answered, errors included */
+    unsigned long errors;               /* malformed or out of range requests */
+    unsigned long batches;              /* groups of requests answered together */
+    unsigned long clients;              /* connections accepted */
+    struct server_histogram_t latency[SERVER_TYPES]; /* per request type - 1 */
+};
+
+/* Client connection, buffered in both directions */
+struct server_client_t {
+    int fd;
+    bool closing;                       /* no more requests will come */
+    bool gone;                          /* peer gone or out of memory, answers dropped */
+    uint32_t watched;                   /* epoll events watched */
+    unsigned char in[SERVER_BATCH_MAX * sizeof(struct server_header_t)];
+    size_t in_len;
+    unsigned long in_ns[SERVER_BATCH_MAX]; /* arrival time of each complete request in in */
+    int in_stamped;                     /* complete requests in in with their time set */
+    unsigned char *out;                 /* answers not written yet */
+    size_t out_len;
+    size_t out_sent;
+    size_t out_cap;
+};
+
+/* Request of the current batch */
+struct server_request_t {
+    int client;                         /* slot of the client */
+    uint8_t type;
+    uint32_t leaf;
+    unsigned long start_ns;             /* time its last byte was read */
+    size_t len;                         /* answer length, in the batch buffer */
+};
+
+/* Server of one tree. Single-threaded: ServerPoll() waits for the
+ * clients with epoll, takes the complete requests of every client round
+ * robin into one batch and answers the proofs of the batch in leaf
+ * order, so that neighbour proofs read the upper levels once. */
+struct merkle_server_t {
+    const struct merkle_levels_t *lv;
+    struct sockaddr_un addr;
+    int listen_fd;
+    int epoll_fd;
+    struct server_client_t *client[SERVER_MAX_CLIENTS];
+    struct server_request_t batch[SERVER_BATCH_MAX];
+    int n_batch;
+    bool backlog;                       /* complete requests left for the next batch */
+    unsigned char *answers;             /* SERVER_BATCH_MAX answers of answer_max bytes */
+    size_t answer_max;
+    struct server_stats_t stats;
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Listens for clients on a Unix domain socket.
+ *
+ * A stale socket file at the path is replaced.
+ *
+ * @param srv Server to fill, released with ServerClose().
+ * @param socket_path Path of the socket.
+ * @param lv Tree served, kept unchanged while the server is open.
+ * @retval true  Success.
+ * @retval false Empty tree, tree of more than INT_MAX leaves, socket or
+ *               allocation failure.
+ */
+bool ServerOpen(struct merkle_server_t *srv, const char *socket_path,
+                const struct merkle_levels_t *lv);
+
+/**
+ * @brief Waits for requests and answers one batch.
+ *
+ * @param srv Server.
+ * @param timeout_ms Longest wait, -1 for no limit.
+ * @return Number of requests answered, -1 on failure of the server.
+ */
+int ServerPoll(struct merkle_server_t *srv, int timeout_ms);
+
+/**
+ * @brief Disconnects the clients and removes the socket.
+ *
+ * @param srv Server.
+ */
+void ServerClose(struct merkle_server_t *srv);
+
+/**
+ * @brief Returns a percentile of a latency histogram.
+ *
+ * @param h Histogram.
+ * @param q Fraction of the answers, in [0, 1].
+ * @return Upper bound in ns of the bucket holding the percentile, 0 if empty.
+ */
+unsigned long ServerPercentile(const struct server_histogram_t *h, double q);
+
+/**
+ * @brief Connects to a server.
+ *
+ * @param socket_path Path of the socket.
+ * @return Connected socket, -1 on failure.
+ */
+int ServerConnect(const char *socket_path);
+
+/**
+ * @brief Sends a request; requests may be pipelined.
+ *
+ * @param fd Connected socket.
+ * @param type Request type.
+ * @param leaf Leaf index, 0 when unused.
+ * @retval true  Success.
+ * @retval false I/O error.
+ */
+bool ServerSend(int fd, uint8_t type, uint32_t leaf);
+
+/**
+ * @brief Receives the next answer, in the order of the requests.
+ *
+ * @param fd Connected socket.
+ * @param header Header to fill, in host order.
+ * @param payload Buffer receiving the payload.
+ * @param size Size of the buffer.
+ * @retval true  Success.
+ * @retval false I/O error or payload larger than the buffer.
+ */
+bool ServerReceive(int fd, struct server_header_t *header, unsigned char *payload, size_t size);
+
+#endif /* MERKLE_SERVER_H */
@@ -0,0 +1,124 @@
+/**
+ * @file shared.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Tree levels published in shared memory for zero-copy queries from other processes
+ */
+
+#ifndef MERKLE_SHARED_H
+#define MERKLE_SHARED_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* flat tree levels */
+
+#include <stdatomic.h>                  /* atomic_ulong */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Default name of the published tree (POSIX shared memory, under /dev/shm) */
+#define SHARED_DEFAULT_NAME "/merkle"
+
+/* Longest name of a published tree, generation suffix included */
+#define SHARED_NAME_MAX 128
+
+/* Identification of the control segment */
+#define SHARED_MAGIC   0x4D4B5348u      /* "MKSH" */
+#define SHARED_VERSION 1u
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Control segment `name`: the generation currently published. The levels
+ * of generation g live in segment `name.g`, in the snapshot format; a
+ * new generation is written in full before the counter moves, and the
+ * previous segment is unlinked: readers still mapping it keep it until
+ * they move on. */
+struct shared_control_t {
+    uint32_t magic;
+    uint32_t version;
+    atomic_ulong generation;            /* 0 until the first publication */
+};
+
+/* Builder side of a published tree */
+struct shared_publisher_t {
+    char name[SHARED_NAME_MAX];
+    struct shared_control_t *control;   /* mapped read-write */
+    unsigned long generation;           /* last generation published */
+};
+
+/* Reader side: the levels of one generation, mapped read-only */
+struct shared_reader_t {
+    char name[SHARED_NAME_MAX];
+    const struct shared_control_t *control;
+    unsigned long generation;           /* generation of lv */
+    struct merkle_levels_t lv;          /* mapped levels, usable as any levels */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Publishes the levels of a tree as the next generation.
+ *
+ * The first call creates the control segment (the publisher must be
+ * zeroed before). The levels are copied once into the new segment.
+ *
+ * @param pub Publisher.
+ * @param name Name of the tree, starting with '/'.
+ * @param lv Levels to publish.
+ * @retval true  Success.
+ * @retval false Invalid name, shared memory or I/O failure.
+ */
+bool SharedPublish(struct shared_publisher_t *pub, const char *name,
+                   const struct merkle_levels_t *lv);
+
+/**
+ * @brief Removes the published tree; readers keep their mappings.
+ *
+ * @param pub Publisher.
+ */
+void SharedUnpublish(struct shared_publisher_t *pub);
+
+/**
+ * @brief Maps the current generation of a published tree.
+ *
+ * @param rd Reader to fill, released with SharedDetach().
+ * @param name Name of the tree.
+ * @retval true  Success.
+ * @retval false Nothing published under this name, or mapping failure.
+ */
+bool SharedAttach(struct shared_reader_t *rd, const char *name);
+
+/**
+ * @brief Moves to the current generation if a newer one is published.
+ *
+ * rd->lv changes only on success; the old levels are unmapped then.
+ *
+ * @param rd Reader.
+ * @retval true  rd->lv is the current generation.
+ * @retval false Mapping failure, rd->lv is left as it was.
+ */
+bool SharedRefresh(struct shared_reader_t *rd);
+
+/**
+ * @brief Unmaps the levels and the control segment.
+ *
+ * @param rd Reader.
+ */
+void SharedDetach(struct shared_reader_t *rd);
+
+#endif /* MERKLE_SHARED_H */
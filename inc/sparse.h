@@ -0,0 +1,111 @@
+/**
+ * @file sparse.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Level-skipping storage: only some levels are kept, the others are recomputed
+ */
+
+#ifndef MERKLE_SPARSE_H
+#define MERKLE_SPARSE_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* flat tree levels, level sources */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Largest subtree recomputed for a missing node, in hashes of the
+ * stored level below (bounds stride for a given arity) */
+#define SPARSE_MAX_SPAN (1 << 20)
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Tree keeping only the levels multiple of `stride` and the `top` highest
+ * ones. A node of a skipped level is the root of the subtree of at most
+ * arity^(stride - 1) hashes of the nearest stored level below.
+ * stride trades resident size for recomputation per query: 1 keeps every
+ * level, a larger stride divides the memory by about arity^(stride - 1)
+ * above the leaves. */
+struct sparse_levels_t {
+    long n_leaves;
+    int n_levels;
+    int arity;
+    enum merkle_padding_t padding;
+    int stride;                         /* distance between stored levels */
+    int top;                            /* highest levels always stored */
+    long level_size[LEVELS_MAX];        /* nodes per level, padding included */
+    long real_size[LEVELS_MAX];         /* real nodes per level */
+    unsigned char *level[LEVELS_MAX];   /* hashes, NULL if the level is skipped */
+    unsigned char *scratch;             /* subtree being recomputed */
+    long recomputed;                    /* nodes recomputed so far */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Copies the stored levels of a whole tree.
+ *
+ * The leaves are always stored, so every node can be recomputed.
+ *
+ * @param lv Whole tree.
+ * @param stride Distance between stored levels (1 keeps them all).
+ * @param top Number of highest levels always stored.
+ * @param sp Sparse tree to fill, released with SparseFree().
+ * @retval true  Success.
+ * @retval false Invalid parameters or allocation failure.
+ */
+bool SparseFromLevels(const struct merkle_levels_t *lv, int stride, int top,
+                      struct sparse_levels_t *sp);
+
+/**
+ * @brief Exposes a sparse tree as a level source.
+ *
+ * Reads of a skipped level recompute the nodes from the stored level
+ * below; the source is not thread safe.
+ *
+ * @param sp Sparse tree, kept alive while the source is used.
+ * @param src Source to fill.
+ */
+void SparseSource(struct sparse_levels_t *sp, struct level_source_t *src);
+
+/**
+ * @brief Rebuilds all the levels of a sparse tree.
+ *
+ * @param sp Sparse tree.
+ * @param lv Levels to fill, released with LevelsFree().
+ * @retval true  Success.
+ * @retval false Allocation or hashing failure.
+ */
+bool SparseExpand(const struct sparse_levels_t *sp, struct merkle_levels_t *lv);
+
+/**
+ * @brief Returns the memory held by a sparse tree.
+ *
+ * @param sp Sparse tree.
+ * @return Bytes of stored hashes and scratch buffer.
+ */
+size_t SparseResidentBytes(const struct sparse_levels_t *sp);
+
+/**
+ * @brief Releases the stored levels.
+ *
+ * @param sp Sparse tree.
+ */
+void SparseFree(struct sparse_levels_t *sp);
+
+#endif /* MERKLE_SPARSE_H */
@@ -0,0 +1,129 @@
+/**
+ * @file stats.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Live progress and throughput counters of the builds
+ */
+
+#ifndef MERKLE_STATS_H
+#define MERKLE_STATS_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* LEVELS_MAX */
+
+#include <stdbool.h>                    /* booleans */
+#include <stddef.h>                     /* size_t */
+#include <signal.h>                     /* SIGUSR1 */
+#include <stdatomic.h>                  /* atomic_llong */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Signal dumping the counters, see StatsReporterStart() */
+#define STATS_SIGNAL SIGUSR1
+
+/* Length of the JSON line of a snapshot */
+#define STATS_JSON_LEN 2048
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* Adds to a counter of merkle_stats: relaxed, the readers only need each
+ * counter to be consistent on its own */
+#define STATS_ADD(counter, n) \
+    atomic_fetch_add_explicit(&merkle_stats.counter, (long long)(n), memory_order_relaxed)
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Counters updated by the build threads */
+struct merkle_stats_t {
+    atomic_llong start_ns;              /* CLOCK_MONOTONIC of the build start */
+    atomic_llong end_ns;                /* and of its end, 0 while it runs */
+    atomic_llong files_total;           /* leaves of the build in progress */
+    atomic_llong files_hashed;
+    atomic_llong bytes_read;
+    atomic_llong level_hashes[LEVELS_MAX]; /* parents hashed per level, 0 are the leaves */
+    atomic_llong tasks_queued;          /* worker pool tasks not started yet */
+    atomic_llong tasks_running;
+    atomic_llong errors;                /* files or nodes that could not be hashed */
+};
+
+/* Counters read at one time, with the rates derived from them */
+struct stats_snapshot_t {
+    long long files_total;
+    long long files_hashed;
+    long long bytes_read;
+    long long level_hashes[LEVELS_MAX];
+    int levels;                         /* levels with hashes */
+    long long tasks_queued;
+    long long tasks_running;
+    long long errors;
+    double elapsed_s;
+    double mb_per_s;
+    double files_per_s;
+    double eta_s;                       /* -1 when unknown */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+extern struct merkle_stats_t merkle_stats;
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Resets the counters at the start of a build.
+ *
+ * @param files Leaves the build is going to hash, 0 if unknown.
+ */
+void StatsBuildStart(long long files);
+
+/**
+ * @brief Freezes the elapsed time and the rates at the end of a build.
+ */
+void StatsBuildEnd(void);
+
+/**
+ * @brief Reads the counters, from any thread.
+ *
+ * Each counter is read atomically, but not all of them at the same
+ * instant: a snapshot taken during a build may mix counts a few files
+ * apart.
+ *
+ * @param s Receives the counters and the rates since StatsBuildStart(),
+ *          up to StatsBuildEnd() once the build is over.
+ */
+void StatsSnapshot(struct stats_snapshot_t *s);
+
+/**
+ * @brief Formats a snapshot as one line of JSON, newline included.
+ *
+ * @return Length of the line, truncated to size - 1.
+ */
+int StatsFormatJson(const struct stats_snapshot_t *s, char *buf, size_t size);
+
+/**
+ * @brief Starts the thread dumping a snapshot on STATS_SIGNAL.
+ *
+ * The signal is blocked in the calling thread, and in the threads it
+ * creates afterwards: call this before starting any thread, so that only
+ * the reporter receives it (`kill -USR1 <pid>`). Called again, only
+ * redirects the dumps.
+ *
+ * @param fd Destination of the JSON lines.
+ * @retval true  The reporter runs.
+ * @retval false The thread could not be started.
+ */
+bool StatsReporterStart(int fd);
+
+/**
+ * @brief Stops the reporter and unblocks STATS_SIGNAL in the calling thread.
+ */
+void StatsReporterStop(void);
+
+#endif /* MERKLE_STATS_H */
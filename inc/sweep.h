@@ -0,0 +1,159 @@
+/**
+ * @file sweep.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Scalability sweep over threads, leaf counts, leaf sizes and hash backends
+ */
+
+#ifndef MERKLE_SWEEP_H
+#define MERKLE_SWEEP_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdbool.h>                    /* booleans */
+#include <stdio.h>                      /* FILE */
+#include <stdint.h>                     /* uint64_t */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Default specification of merkleTree_sweep */
+#define SWEEP_SPEC_FILE "sweep_spec.txt"
+
+/* Values per parameter of a specification */
+#define SWEEP_MAX_VALUES 16
+
+/* Largest leaf, in bytes */
+#define SWEEP_MAX_LEAF_SIZE (64L << 20)
+
+/* Largest leaf count */
+#define SWEEP_MAX_LEAVES 100000000L
+
+/* Default payload pool, in MiB: larger than the last-level cache, so that
+ * the leaves are read from memory */
+#define SWEEP_POOL_MB 256
+
+/* Largest payload pool, in MiB */
+#define SWEEP_MAX_POOL_MB 65536L
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Shapes of the leaf size distribution */
+enum sweep_dist_kind_t {
+    SWEEP_FIXED,                        /* fixed:<bytes> */
+    SWEEP_LOGNORMAL,                    /* lognormal:<median bytes>:<sigma> */
+    SWEEP_MIXED                         /* mixed:<tiny bytes>:<huge bytes>:<huge fraction> */
+};
+
+/* Size distribution of the leaves */
+struct sweep_dist_t {
+    enum sweep_dist_kind_t kind;
+    long size;                          /* fixed size, median or tiny size */
+    long huge;                          /* huge size of SWEEP_MIXED */
+    double param;                       /* sigma, or fraction of huge leaves */
+    char label[48];                     /* as written in the specification */
+};
+
+/* How the leaves are hashed */
+enum sweep_backend_t {
+    SWEEP_CTX,                          /* reused context, EVP_sha256() at every init */
+    SWEEP_FETCHED,                      /* reused context, implementation fetched once */
+    SWEEP_ONESHOT,                      /* EVP_Digest() */
+    SWEEP_BACKENDS
+};
+
+/* Every combination of the values is measured */
+struct sweep_spec_t {
+    int threads[SWEEP_MAX_VALUES];      /* the first one that succeeds is the speedup baseline */
+    int n_threads;
+    long leaves[SWEEP_MAX_VALUES];
+    int n_leaves;
+    struct sweep_dist_t sizes[SWEEP_MAX_VALUES];
+    int n_sizes;
+    enum sweep_backend_t backends[SWEEP_MAX_VALUES];
+    int n_backends;
+    int repeats;                        /* runs per combination, the median is kept */
+    long pool_mb;                       /* payload pool the leaves are laid in, in MiB */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Reads a sweep specification.
+ *
+ * One parameter per line, its values separated by spaces; `#` starts a
+ * comment:
+ *
+ *     threads  1 2 4 8
+ *     leaves   65536 1048576 10000000
+ *     sizes    fixed:64 lognormal:1024:1.0 mixed:64:1048576:0.001
+ *     backends ctx fetched oneshot
+ *     repeats  3
+ *     pool     256
+ *
+ * Omitted parameters default to 1 thread, 65536 leaves, fixed:64, ctx,
+ * 3 repeats and a pool of SWEEP_POOL_MB.
+ *
+ * @param fp Specification text.
+ * @param spec Receives the specification.
+ * @retval true  Valid specification.
+ * @retval false Unknown parameter or invalid value, reported on stderr.
+ */
+bool SweepReadSpec(FILE *fp, struct sweep_spec_t *spec);
+
+/**
+ * @brief Parses a size distribution (see struct sweep_dist_t).
+ *
+ * @param str Distribution as written in a specification, e.g. lognormal:1024:1.0.
+ * @param dist Receives the distribution.
+ * @retval true  Valid distribution.
+ * @retval false Unknown shape or value out of range.
+ */
+bool SweepParseDist(const char *str, struct sweep_dist_t *dist);
+
+/**
+ * @brief Draws the size of a leaf.
+ *
+ * The size only depends on the distribution, the seed and the leaf index,
+ * so that leaves can be drawn in any order, by any thread.
+ *
+ * @param dist Size distribution.
+ * @param seed Seed of the draws.
+ * @param leaf Leaf index.
+ * @return Size of the leaf in bytes, at most SWEEP_MAX_LEAF_SIZE.
+ */
+long SweepLeafSize(const struct sweep_dist_t *dist, uint64_t seed, long leaf);
+
+/**
+ * @brief Builds a tree for every combination of the specification.
+ *
+ * Leaves are in-memory payloads drawn from the size distribution with a
+ * fixed seed, so that every combination hashes the same data without any
+ * I/O. They are laid one after the other through the payload pool, wrapping
+ * at its end, so that a pool larger than the last-level cache streams them
+ * from memory. The leaves are hashed by the worker threads, then the levels are
+ * built with as many workers (merkle_config.threads). The root of every
+ * run is checked against the first run of the same leaves.
+ *
+ * @param spec Combinations to measure.
+ * @param out Destination of the table.
+ * @param csv Destination of the CSV matrix, may be NULL.
+ * @return Number of failed combinations (allocation, hashing, root mismatch).
+ */
+int SweepRun(const struct sweep_spec_t *spec, FILE *out, FILE *csv);
+
+#endif /* MERKLE_SWEEP_H */
@@ -0,0 +1,83 @@
+/**
+ * @file sync.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Anti-entropy synchronization of two trees over a stream socket
+ */
+
+#ifndef MERKLE_SYNC_H
+#define MERKLE_SYNC_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* flat tree levels */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Maximum number of requests sent before waiting for an answer */
+#define SYNC_PIPELINE_DEPTH 8
+
+/* Maximum number of hashes asked by a single request */
+#define SYNC_REQUEST_HASHES 256
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Traffic of one synchronization */
+struct sync_stats_t {
+    size_t bytes_sent;
+    size_t bytes_received;
+    int requests;                       /* request messages */
+    int hashes;                         /* hashes exchanged */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Answers the requests of a peer running SyncPull().
+ *
+ * Serves the shape of the tree and the hashes of the requested
+ * node ranges until the peer is done or the connection closes.
+ *
+ * @param fd Connected stream socket (or pipe pair end).
+ * @param lv Authoritative tree.
+ * @param stats Traffic counters, may be NULL.
+ * @retval true  The peer completed the synchronization.
+ * @retval false Protocol or I/O error, or a tree of more than INT_MAX leaves.
+ */
+bool SyncServe(int fd, const struct merkle_levels_t *lv, struct sync_stats_t *stats);
+
+/**
+ * @brief Finds the blocks to fetch from a peer running SyncServe().
+ *
+ * Walks the remote tree top-down, asking only for the children of the
+ * nodes that differ from the local tree. Requests are pipelined, so the
+ * number of round trips does not grow with the number of differences.
+ *
+ * @param fd Connected stream socket.
+ * @param local Local tree.
+ * @param blocks Allocated array of remote block indexes to transfer,
+ *               ascending, to be released with free(). NULL if none.
+ * @param remote_leaves Number of blocks of the remote tree, may be NULL.
+ * @param stats Traffic counters, may be NULL.
+ * @return Number of blocks to transfer, -1 on failure or for a local
+ *         tree of more than INT_MAX leaves.
+ */
+int SyncPull(int fd, const struct merkle_levels_t *local, int **blocks,
+             int *remote_leaves, struct sync_stats_t *stats);
+
+#endif /* MERKLE_SYNC_H */
@@ -21,6 +21,9 @@ extern "C" {
  * PUBLIC DEFINES
  *-----------------------------------*/
 #define RESULTS_FILE "tests_results.txt"
+/* Chrome traces of the builds, written when built with TRACE=1 */
+#define TRACE_TREE_FILE   "tests_trace_tree.json"
+#define TRACE_LEVELS_FILE "tests_trace_levels.json"
 /* Maximum number of folders to be read from config file */
 #define MAX_TESTING_FOLDERS 10
  
@@ -63,8 +66,10 @@ extern int numFolders;
  * This function iterates over test folders, constructs a Merkle tree
  * for each dataset, and records performance metrics such as execution time
  * and memory usage.
+ *
+ * @return The number of failed functionality tests.
  */
-void RunMerkleTreeTests(void);
+int RunMerkleTreeTests(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,107 @@
+/**
+ * @file trace.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Timed spans of the build phases, exported as Chrome trace events
+ */
+
+#ifndef MERKLE_TRACE_H
+#define MERKLE_TRACE_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include <stdbool.h>                    /* booleans */
+#include <stdio.h>                      /* FILE */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Spans kept between two TraceReset(), the later ones are dropped */
+#define TRACE_MAX_EVENTS 65536
+
+/* Argument of the spans that have none */
+#define TRACE_NO_ARG (-1L)
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* Spans are compiled in with -DMERKLE_TRACE (make TRACE=1) and cost
+ * nothing otherwise. A span covers the code between TRACE_BEGIN() and
+ * TRACE_END() of the same variable, in one scope; its name must be a
+ * string literal. */
+#ifdef MERKLE_TRACE
+#define TRACE_BEGIN(span, name, arg) struct trace_span_t span = TraceBegin(name, arg)
+#define TRACE_END(span)              TraceEnd(&(span))
+#else
+#define TRACE_BEGIN(span, name, arg) do { } while (0)
+#define TRACE_END(span)              do { } while (0)
+#endif
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Span being timed */
+struct trace_span_t {
+    const char *name;
+    long arg;                           /* level, TRACE_NO_ARG if none */
+    unsigned long start_ns;             /* CLOCK_MONOTONIC */
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Tells if the spans are compiled in.
+ */
+bool TraceEnabled(void);
+
+/**
+ * @brief Starts a span, see TRACE_BEGIN().
+ *
+ * @param name Name of the span, a string literal.
+ * @param arg Argument shown with the span, TRACE_NO_ARG if none.
+ * @return Span to end with TraceEnd().
+ */
+struct trace_span_t TraceBegin(const char *name, long arg);
+
+/**
+ * @brief Records a span, from any thread.
+ *
+ * @param span Span of TraceBegin().
+ */
+void TraceEnd(const struct trace_span_t *span);
+
+/**
+ * @brief Forgets the recorded spans.
+ *
+ * Not to be called while spans are recorded.
+ */
+void TraceReset(void);
+
+/**
+ * @brief Writes the recorded spans as Chrome trace events.
+ *
+ * The file opens in chrome://tracing and in Perfetto, one track per thread.
+ *
+ * @param path Destination file.
+ * @retval true  Success.
+ * @retval false I/O error.
+ */
+bool TraceWriteChrome(const char *path);
+
+/**
+ * @brief Prints the total, mean and longest time of every span name
+ *        and argument, in order of first appearance.
+ *
+ * @param fp Destination.
+ */
+void TraceSummary(FILE *fp);
+
+#endif /* MERKLE_TRACE_H */
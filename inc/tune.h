@@ -0,0 +1,99 @@
+/**
+ * @file tune.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Calibration of the hash backend, read buffer and threads on a dataset sample
+ */
+
+#ifndef MERKLE_TUNE_H
+#define MERKLE_TUNE_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/config.h"              /* HASH_BACKENDS */
+
+#include <stdbool.h>                    /* booleans */
+#include <stdio.h>                      /* FILE */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Defaults of the probes */
+#define TUNE_DEFAULT_SAMPLE       4096  /* leaf files hashed, the first of the folder */
+#define TUNE_DEFAULT_REPEATS      5     /* runs per candidate, the median is kept */
+#define TUNE_DEFAULT_LEVEL_LEAVES 262144 /* leaves of the level builds */
+
+/* Candidates */
+#define TUNE_READ_BUFFERS 3             /* 4 KiB to CONFIG_MAX_READ_BUFFER */
+#define TUNE_MAX_THREADS  8             /* 1, 2, 4, ... and the online CPUs */
+
+/* Upper bound of the runs per candidate */
+#define TUNE_MAX_REPEATS 101
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* How the probes are run */
+struct tune_options_t {
+    int sample;                         /* leaf files of the sample */
+    int repeats;                        /* runs per candidate */
+    int level_leaves;                   /* leaves of the level builds */
+};
+
+/* Median time of every candidate, and the settings chosen */
+struct tune_result_t {
+    int files;                          /* sampled leaf files */
+    long long bytes;                    /* and their bytes */
+    double backend_ms[HASH_BACKENDS];   /* sample and level build, one thread */
+    int read_buffers[TUNE_READ_BUFFERS];
+    double read_ms[TUNE_READ_BUFFERS];  /* sample hashed by one thread */
+    int threads[TUNE_MAX_THREADS];
+    double threads_ms[TUNE_MAX_THREADS]; /* sample hashed in parallel, then a level build */
+    int n_threads;
+    enum hash_backend_t backend;        /* chosen */
+    int read_buffer;
+    int best_threads;
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Measures the tunable settings on a sample of a dataset.
+ *
+ * Warms the page cache with the sample, then probes in turn:
+ *  - each hash backend, timing the sample hashed with HashFileBackend() and
+ *    a level build, on one thread;
+ *  - each read buffer, timing the sample hashed by one thread;
+ *  - each thread count, timing the sample hashed in parallel and a level build.
+ * These are the leaf and parent paths of MerkleTreeBuild() and
+ * BuildMerkleLevels(), which read the settings from merkle_config.
+ * Each probe keeps the best setting of the previous ones. A candidate
+ * replaces the one before it only when it is a few percent faster, so
+ * noise keeps the defaults, the smaller buffers and the fewer threads.
+ * Every candidate must give the same hashes.
+ *
+ * @param folder Dataset folder, leaves named as LEAF_FILE_FORMAT.
+ * @param opt Probes, NULL for the defaults.
+ * @param result Receives the measurements and the chosen settings.
+ * @param out Table of the measurements, may be NULL.
+ * @retval true  merkle_config holds the chosen settings.
+ * @retval false Empty folder, I/O error or differing hashes; merkle_config
+ *               is unchanged.
+ */
+bool TuneRun(const char *folder, const struct tune_options_t *opt,
+             struct tune_result_t *result, FILE *out);
+
+#endif /* MERKLE_TUNE_H */
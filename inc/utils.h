@@ -38,12 +38,26 @@ struct node_t;  // Forward declaration of struct node_t
 /*-----------------------------------*
  * PUBLIC TYPEDEFS
  *-----------------------------------*/
-/* None */
+/* How a level that does not fill its last parent is completed */
+enum merkle_padding_t {
+    PADDING_DUPLICATE = 0,              /* copies of the last node fill the group */
+    PADDING_PROMOTE,                    /* partial group hashed as is, a lone node
+                                         * moves up unchanged (RFC 6962 shape) */
+};
 
 /*-----------------------------------*
  * PUBLIC FUNCTION PROTOTYPES
  *-----------------------------------*/
 
+/**
+ * @brief Returns the SHA-256 implementation of merkle_config.backend.
+ *
+ * HASH_BACKEND_FETCHED fetches it once for the process, the other
+ * backends look it up through EVP_sha256() (HASH_BACKEND_DIRECT uses no
+ * EVP digest).
+ */
+const EVP_MD *HashBackendMd(void);
+
 /**
  * @brief Computes the SHA-256 hash of a file.
  *
@@ -56,6 +70,51 @@ struct node_t;  // Forward declaration of struct node_t
  */
 bool HashFile(const char *filename, unsigned char output[SHA256_DIGEST_LENGTH]);
 
+/**
+ * @brief Computes the SHA-256 hash of a file with a caller's digest context.
+ *
+ * Reads with a stack buffer, merkle_config.read_buffer bytes at a time:
+ * nothing is allocated, so a build can reuse one context for every leaf.
+ *
+ * @param mdctx Digest context already set up for SHA-256 (EVP_DigestInit_ex()).
+ * @param filename Path to the file.
+ * @param output Buffer to store the 32-byte hash result.
+ * @retval true  Success (hash is stored in `output`).
+ * @retval false Error opening or reading the file.
+ */
+bool HashFileCtx(EVP_MD_CTX *mdctx, const char *filename,
+                 unsigned char output[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Computes the SHA-256 hash of a file without any allocation.
+ *
+ * Like HashFileCtx(), with the low-level SHA-256 of OpenSSL and its
+ * state on the stack: EVP_DigestInit_ex() of OpenSSL 3.0 allocates the
+ * provider state again on every call, even on a reused context.
+ *
+ * @param filename Path to the file.
+ * @param output Buffer to store the 32-byte hash result.
+ * @retval true  Success (hash is stored in `output`).
+ * @retval false Error opening or reading the file.
+ */
+bool HashFileDirect(const char *filename, unsigned char output[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Computes the SHA-256 hash of a file with merkle_config.backend.
+ *
+ * HASH_BACKEND_DIRECT hashes with HashFileDirect(); the other backends
+ * stream the file through mdctx (a file has no one-shot digest).
+ *
+ * @param mdctx Digest context set up with HashBackendMd(), unused and
+ *              may be NULL with HASH_BACKEND_DIRECT.
+ * @param filename Path to the file.
+ * @param output Buffer to store the 32-byte hash result.
+ * @retval true  Success (hash is stored in `output`).
+ * @retval false Error opening or reading the file.
+ */
+bool HashFileBackend(EVP_MD_CTX *mdctx, const char *filename,
+                     unsigned char output[SHA256_DIGEST_LENGTH]);
+
 /**
  * @brief Computes the SHA-256 hash of two concatenated hashes.
  *
@@ -71,17 +130,93 @@ bool HashTwoHashes(const unsigned char hashA[SHA256_DIGEST_LENGTH],
                 const unsigned char hashB[SHA256_DIGEST_LENGTH], 
                 unsigned char output[SHA256_DIGEST_LENGTH]);
 
+/**
+ * @brief Computes the SHA-256 hash of two concatenated hashes with a caller's digest context.
+ *
+ * @param mdctx Digest context already set up for SHA-256 (EVP_DigestInit_ex()).
+ * @param hashA First SHA-256 hash (32 bytes).
+ * @param hashB Second SHA-256 hash (32 bytes).
+ * @param output Buffer to store the resulting 32-byte hash.
+ * @retval true  Success.
+ * @retval false Failure in hash computation.
+ */
+bool HashTwoHashesCtx(EVP_MD_CTX *mdctx,
+                      const unsigned char hashA[SHA256_DIGEST_LENGTH],
+                      const unsigned char hashB[SHA256_DIGEST_LENGTH],
+                      unsigned char output[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Computes the SHA-256 hash of two concatenated hashes without any allocation.
+ *
+ * The low-level SHA-256 of OpenSSL, see HashFileDirect().
+ *
+ * @param hashA First SHA-256 hash (32 bytes).
+ * @param hashB Second SHA-256 hash (32 bytes).
+ * @param output Buffer to store the resulting 32-byte hash.
+ */
+void HashTwoHashesDirect(const unsigned char hashA[SHA256_DIGEST_LENGTH],
+                         const unsigned char hashB[SHA256_DIGEST_LENGTH],
+                         unsigned char output[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Computes the SHA-256 hash of two concatenated hashes with merkle_config.backend.
+ *
+ * @param mdctx Digest context set up with HashBackendMd(), used by
+ *              HASH_BACKEND_CTX and HASH_BACKEND_FETCHED only, may be NULL
+ *              with the other backends.
+ * @param hashA First SHA-256 hash (32 bytes).
+ * @param hashB Second SHA-256 hash (32 bytes).
+ * @param output Buffer to store the resulting 32-byte hash.
+ * @retval true  Success.
+ * @retval false Failure in hash computation.
+ */
+bool HashTwoHashesBackend(EVP_MD_CTX *mdctx,
+                          const unsigned char hashA[SHA256_DIGEST_LENGTH],
+                          const unsigned char hashB[SHA256_DIGEST_LENGTH],
+                          unsigned char output[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Computes the SHA-256 hash of contiguous concatenated hashes.
+ *
+ * @param children `count` contiguous SHA-256 hashes.
+ * @param count Number of hashes (the arity of the parent).
+ * @param output Buffer to store the resulting 32-byte hash.
+ * @retval true  Success.
+ * @retval false Failure in hash computation.
+ */
+bool HashChildren(const unsigned char *children, int count,
+                  unsigned char output[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Computes the hashes of a whole level from the level below.
+ *
+ * Parent i is the hash of children [i * arity, (i + 1) * arity).
+ * A single digest context is reused for every parent, or none with
+ * HASH_BACKEND_ONESHOT and HASH_BACKEND_DIRECT (see merkle_config.backend).
+ *
+ * @param children n_parents * arity contiguous hashes.
+ * @param n_parents Number of parents to compute.
+ * @param arity Number of children per parent.
+ * @param parents Buffer to store the n_parents resulting hashes.
+ * @retval true  Success.
+ * @retval false Failure in hash computation.
+ */
+bool HashLevel(const unsigned char *children, int n_parents, int arity,
+               unsigned char *parents);
+
 /**
  * @brief Computes the parent node's hash from its children's hashes.
  *
  * If both child nodes exist, their hashes are combined to compute the parent node's hash.
  * If only the left child exists, it copies the left child's hash.
+ * The children are hashed with merkle_config.backend (HashTwoHashesBackend()).
  *
+ * @param mdctx Digest context of the build, see HashTwoHashesBackend().
  * @param node Pointer to the node whose hash needs to be computed.
  * @retval true  Success.
  * @retval false Failure (e.g., missing child nodes).
  */
-bool HashNodeFromChildren(struct node_t **node);
+bool HashNodeFromChildren(EVP_MD_CTX *mdctx, struct node_t **node);
 
 /**
  * @brief Counts the number of regular files in a directory.
@@ -106,6 +241,37 @@ int CountFilesInDirectory(const char *folder);
  */
 int NodesNumberArrayFromFile(int **nodes_number_arr, const char *folder);
 
+/**
+ * @brief Computes the number of nodes per level for a given number of leaves.
+ *
+ * With PADDING_DUPLICATE every level (except the root) is rounded up to a
+ * multiple of the arity, the padding nodes later duplicate the hash of the
+ * last real node. With PADDING_PROMOTE no padding node is counted.
+ *
+ * @param nodes_number_arr Pointer to store an allocated array containing the node count per level.
+ * @param n_files Number of leaves of the tree.
+ * @param arity Number of children per node (2 for the binary tree).
+ * @param padding Completion of the partial groups.
+ * @return The number of levels in the Merkle tree, 0 on failure.
+ */
+int NodesNumberArray(int **nodes_number_arr, int n_files, int arity,
+                     enum merkle_padding_t padding);
+
+/**
+ * @brief Computes the number of nodes per level into a caller's array.
+ *
+ * Same sizes as NodesNumberArray(), without allocating.
+ *
+ * @param nodes_number_arr Array receiving the node count per level, NULL to only count the levels.
+ * @param max_levels Capacity of the array.
+ * @param n_files Number of leaves of the tree.
+ * @param arity Number of children per node.
+ * @param padding Completion of the partial groups.
+ * @return The number of levels, 0 on failure or if they do not fit.
+ */
+int NodesNumberLevels(int *nodes_number_arr, int max_levels, int n_files, int arity,
+                      enum merkle_padding_t padding);
+
 /**
  * @brief Checks whether a given file exists.
  *
@@ -115,6 +281,54 @@ int NodesNumberArrayFromFile(int **nodes_number_arr, const char *folder);
  */
 bool isValidFile(const char *filename);
 
+/**
+ * @brief Writes a whole buffer, retrying on partial writes and EINTR.
+ *
+ * A socket whose peer is gone fails without raising SIGPIPE.
+ *
+ * @param fd Destination: file, pipe or socket.
+ * @param buf Data.
+ * @param len Data length.
+ * @param offset Offset to write at (pwrite), or negative for the current position.
+ * @param bytes Counter of the written bytes, may be NULL.
+ * @retval true  Success.
+ * @retval false I/O error.
+ */
+bool WriteAll(int fd, const void *buf, size_t len, off_t offset, size_t *bytes);
+
+/**
+ * @brief Reads a whole buffer, retrying on partial reads and EINTR.
+ *
+ * @param fd Source.
+ * @param buf Destination.
+ * @param len Bytes to read.
+ * @param bytes Counter of the read bytes, may be NULL.
+ * @retval true  Success.
+ * @retval false I/O error or end of stream.
+ */
+bool ReadAll(int fd, void *buf, size_t len, size_t *bytes);
+
+/**
+ * @brief Returns the monotonic time (CLOCK_MONOTONIC) in ns.
+ */
+unsigned long NowNs(void);
+
+/**
+ * @brief Returns the median of n values, n > 0, sorting them in place.
+ */
+double Median(double *v, int n);
+
+/**
+ * @brief qsort() comparison of doubles, ascending.
+ */
+int CompareDoubles(const void *a, const void *b);
+
+/**
+ * @brief Returns the splitmix64 mix of x, the pseudo-random stream of the
+ * generated leaves.
+ */
+uint64_t SplitMix(uint64_t x);
+
 /* ######################################################################
 * PRINT FUNCTIONS 
 *###################################################################### */
@@ -0,0 +1,124 @@
+/**
+ * @file verify.h
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Integrity check of a folder against a stored root and checkpoints
+ */
+
+#ifndef MERKLE_VERIFY_H
+#define MERKLE_VERIFY_H
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"              /* flat tree levels */
+
+/*-----------------------------------*
+ * PUBLIC DEFINES
+ *-----------------------------------*/
+/* Default location of the stored root hash and checkpoints */
+#define ROOT_HASH_FILE "data/root_hash.txt"
+
+/* Maximum number of checkpoint hashes stored with the root */
+#define CHECKPOINT_MAX_NODES 1024
+
+/*-----------------------------------*
+ * PUBLIC MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC TYPEDEFS
+ *-----------------------------------*/
+/* Root of a tree with the hashes of one of its levels: every checkpoint
+ * hash is the root of a subtree of arity^level leaves */
+struct merkle_checkpoint_t {
+    int n_leaves;
+    int n_levels;                       /* levels of the whole tree */
+    int arity;                          /* children per node */
+    enum merkle_padding_t padding;      /* completion of the partial groups */
+    int level;                          /* level of the checkpoints */
+    int count;                          /* checkpoint hashes */
+    unsigned char root[SHA256_DIGEST_LENGTH];
+    unsigned char *hashes;              /* count hashes */
+};
+
+/* Outcome of a verification */
+struct verify_result_t {
+    bool match;                         /* folder matches the checkpoints */
+    int first_leaf;                     /* offending leaf range, */
+    int last_leaf;                      /* when match is false */
+    int subtrees_checked;
+    int files_hashed;
+};
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DECLARATIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Extracts the root and checkpoint hashes of a tree.
+ *
+ * The checkpoint level is the lowest one with at most
+ * CHECKPOINT_MAX_NODES nodes.
+ *
+ * @param lv Whole tree.
+ * @param cp Checkpoints to fill, released with CheckpointFree().
+ * @retval true  Success.
+ * @retval false Empty tree or allocation failure.
+ */
+bool CheckpointFromLevels(const struct merkle_levels_t *lv, struct merkle_checkpoint_t *cp);
+
+/**
+ * @brief Writes the root and checkpoint hashes as text.
+ *
+ * @param cp Checkpoints.
+ * @param filename Destination file.
+ * @retval true  Success.
+ * @retval false I/O error.
+ */
+bool CheckpointSave(const struct merkle_checkpoint_t *cp, const char *filename);
+
+/**
+ * @brief Reads the root and checkpoint hashes.
+ *
+ * The checkpoints are checked against the root before being accepted,
+ * and there must be one per subtree of the checkpoint level.
+ *
+ * @param cp Checkpoints to fill, released with CheckpointFree().
+ * @param filename Source file.
+ * @retval true  Success.
+ * @retval false Missing, malformed or inconsistent file.
+ */
+bool CheckpointLoad(struct merkle_checkpoint_t *cp, const char *filename);
+
+/**
+ * @brief Releases the checkpoint hashes.
+ *
+ * @param cp Checkpoints.
+ */
+void CheckpointFree(struct merkle_checkpoint_t *cp);
+
+/**
+ * @brief Rehashes a folder in parallel and compares it with checkpoints.
+ *
+ * Every worker hashes the files of one checkpoint subtree and compares
+ * its root as soon as it completes. The first mismatch cancels the
+ * outstanding work and reports the leaf range of the subtree.
+ *
+ * @param folder Transactions folder (with trailing '/').
+ * @param cp Stored checkpoints.
+ * @param n_threads Number of workers, 0 for the default.
+ * @param result Outcome of the verification.
+ * @retval true  The verification ran (see result->match).
+ * @retval false Allocation or thread failure.
+ */
+bool VerifyFolder(const char *folder, const struct merkle_checkpoint_t *cp,
+                  int n_threads, struct verify_result_t *result);
+
+#endif /* MERKLE_VERIFY_H */
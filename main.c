@@ -9,6 +9,21 @@
  * INCLUDE FILES
  *-----------------------------------*/
 #include "inc/merkleTree.h"
+#include "inc/diff.h"
+#include "inc/sync.h"
+#include "inc/verify.h"
+#include "inc/config.h"
+#include "inc/levelfile.h"
+#include "inc/proof.h"
+#include "inc/shared.h"
+#include "inc/server.h"
+#include "inc/stats.h"
+
+#include <errno.h>                      /* EINTR */
+#include <time.h>                       /* clock_gettime */
+#include <unistd.h>                     /* close, unlink */
+#include <sys/socket.h>                 /* socket */
+#include <sys/un.h>                     /* sockaddr_un */
 
 /*-----------------------------------*
  * PUBLIC VARIABLE DEFINITIONS
@@ -25,6 +40,8 @@
  *-----------------------------------*/
 #define MAIN_MENU_ROWS_N 4
 #define TRANSACTIONS_FOLDER "data/transactions/"
+/* Maximum number of changed blocks listed on screen */
+#define MAX_CHANGED_PRINTED 20
 
 /*-----------------------------------*
  * PRIVATE TYPEDEFS
@@ -40,10 +57,18 @@
  *
  * Initializes and displays the main menu, then waits
  * for user interaction to build or check a Merkle Tree.
+ * With arguments, runs one of the command line modes instead:
+ *   sync-serve <socket> [folder]
+ *   sync-pull <socket> [folder]
+ *   serve <socket> [folder]
+ *   build-levels <dir> [folder]
+ *   prove <dir> <block> [folder]
+ *   publish <name> [folder]
+ *   shared-prove <name> <block> [folder]
  *
  * @return 0 on successful exit.
  */
-int main();
+int main(int argc, char **argv);
 
 /**
  * @brief displays the user menu to
@@ -57,6 +82,66 @@ bool DisplayMenu(void);
 */
 void GenerateMerkleTree(void);
 
+/**
+ * @brief checks the transactions folder against the
+ * stored root hash and checkpoints
+*/
+void CheckRootHash(void);
+
+/**
+ * @brief builds the merkle tree and compares it with
+ * the stored snapshot, listing the changed blocks
+*/
+void CompareMerkleTree(void);
+
+/**
+ * @brief serves the tree of a folder to sync-pull peers
+ * on a Unix domain socket, until killed
+ * @retval int 1 when the tree, the socket or accept() fails
+*/
+int SyncServeMode(const char *socket_path, const char *folder);
+
+/**
+ * @brief pulls from a sync-serve peer the list of blocks
+ * missing or different in a folder
+ * @retval int 0 on success
+*/
+int SyncPullMode(const char *socket_path, const char *folder);
+
+/**
+ * @brief answers root, proof and leaf requests on a Unix
+ * domain socket with the tree of a folder
+ * @retval int 0 on success
+*/
+int ServeMode(const char *socket_path, const char *folder);
+
+/**
+ * @brief builds the level files of a folder out of core
+ * @retval int 0 on success
+*/
+int BuildLevelsMode(const char *dir, const char *folder);
+
+/**
+ * @brief proves the membership of a block with the level
+ * files, reading them within the RAM budget
+ * @retval int 0 if the proof verifies
+*/
+int ProveMode(const char *dir, int block, const char *folder);
+
+/**
+ * @brief publishes the tree of a folder in shared memory
+ * as the next generation
+ * @retval int 0 on success
+*/
+int PublishMode(const char *name, const char *folder);
+
+/**
+ * @brief proves the membership of a block with the tree
+ * published in shared memory
+ * @retval int 0 if the proof verifies
+*/
+int SharedProveMode(const char *name, int block, const char *folder);
+
 /**
  * @brief clears the screen
 */
@@ -78,13 +163,64 @@ char *mainMenu[MAIN_MENU_ROWS_N] =
 /*-----------------------------------*
  * PRIVATE FUNCTION DEFINITIONS
  *-----------------------------------*/
-int main()
+int main(int argc, char **argv)
 {
-    while(DisplayMenu())
+    int ret = 0;
+    const char *folder = argc > 3 ? argv[3] : TRANSACTIONS_FOLDER;
+
+    ConfigLoadEnv();
+    /* before the first thread: `kill -USR1` dumps the build counters */
+    StatsReporterStart(STDERR_FILENO);
+
+    if (argc > 2 && strcmp(argv[1], "sync-serve") == 0)
+    {
+        ret = SyncServeMode(argv[2], folder);
+    }
+    else if (argc > 2 && strcmp(argv[1], "sync-pull") == 0)
+    {
+        ret = SyncPullMode(argv[2], folder);
+    }
+    else if (argc > 2 && strcmp(argv[1], "serve") == 0)
+    {
+        ret = ServeMode(argv[2], folder);
+    }
+    else if (argc > 2 && strcmp(argv[1], "build-levels") == 0)
+    {
+        ret = BuildLevelsMode(argv[2], folder);
+    }
+    else if (argc > 3 && strcmp(argv[1], "prove") == 0)
     {
+        ret = ProveMode(argv[2], atoi(argv[3]), argc > 4 ? argv[4] : TRANSACTIONS_FOLDER);
+    }
+    else if (argc > 2 && strcmp(argv[1], "publish") == 0)
+    {
+        ret = PublishMode(argv[2], folder);
+    }
+    else if (argc > 3 && strcmp(argv[1], "shared-prove") == 0)
+    {
+        ret = SharedProveMode(argv[2], atoi(argv[3]), argc > 4 ? argv[4] : TRANSACTIONS_FOLDER);
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: %s [sync-serve|sync-pull|serve <socket> [folder/]]\n"
+                        "       %s [build-levels <dir/> [folder/]]\n"
+                        "       %s [prove <dir/> <block> [folder/]]\n"
+                        "       %s [publish <name> [folder/]]\n"
+                        "       %s [shared-prove <name> <block> [folder/]]\n",
+                argv[0], argv[0], argv[0], argv[0], argv[0]);
+        ret = 1;
+    }
+    else
+    {
+        while(DisplayMenu())
+        {
 
+        }
     }
-	return 0;
+    /* memory kept across the rebuilds of the menu */
+    MerkleTreeRelease();
+    StatsReporterStop();
+	return ret;
 }
 
 bool DisplayMenu()
@@ -100,7 +236,11 @@ bool DisplayMenu()
         printf("%s\n", mainMenu[i]);
     }
     printf("Select an option: ");
-    scanf("%c", &cmd);
+    if (scanf("%c", &cmd) != 1)
+    {
+        /* end of input */
+        cmd = 'q';
+    }
 	getchar();
 	printf("\n");
 
@@ -108,9 +248,11 @@ bool DisplayMenu()
     {
         case '1':
             printf("Checking if root hash exists...\n");
+            CheckRootHash();
             break;
         case '2':
             printf("Generating and comparing root hashes...\n");
+            CompareMerkleTree();
             break;
         case 'x':
             printf("Regenerating root hash...\n");
@@ -133,10 +275,354 @@ bool DisplayMenu()
     return ret;
 }
 
+void CheckRootHash()
+{
+    struct merkle_checkpoint_t cp;
+    struct verify_result_t result;
+    struct timespec start, end;
+
+    if (!CheckpointLoad(&cp, ROOT_HASH_FILE))
+    {
+        printf("No root hash in %s, regenerate the root hash first.\n", ROOT_HASH_FILE);
+        return;
+    }
+
+    printf("Stored root hash: \n");
+    PrintHashHex(cp.root);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool done = VerifyFolder(TRANSACTIONS_FOLDER, &cp, 0, &result);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (done && result.match)
+    {
+        printf("%s matches the root hash.\n", TRANSACTIONS_FOLDER);
+    }
+    else if (done)
+    {
+        printf("%s does NOT match the root hash: blocks %d to %d differ.\n",
+               TRANSACTIONS_FOLDER, result.first_leaf, result.last_leaf);
+    }
+    printf("%d files hashed, %d subtrees checked in %.3f ms\n",
+           result.files_hashed, result.subtrees_checked,
+           (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+
+    CheckpointFree(&cp);
+}
+
 void GenerateMerkleTree()
 {
+    struct merkle_levels_t lv;
+    struct merkle_checkpoint_t cp;
+
     printf("Initializing Merkle Tree...\n");
-    BuildMerkleTree(TRANSACTIONS_FOLDER);
+    if (BuildMerkleLevels(TRANSACTIONS_FOLDER, merkle_config.arity,
+                          merkle_config.padding, &lv))
+    {
+        printf("tree_levels: %d (arity %d)\n", lv.n_levels, lv.arity);
+        printf("Root hash hex: \n");
+        PrintHashHex(LevelsRoot(&lv));
+
+        /* store the snapshot for later comparisons */
+        if (LevelsSave(&lv, SNAPSHOT_FILE))
+        {
+            printf("Snapshot saved to %s\n", SNAPSHOT_FILE);
+        }
+        /* store the root hash with its checkpoints */
+        if (CheckpointFromLevels(&lv, &cp))
+        {
+            if (CheckpointSave(&cp, ROOT_HASH_FILE))
+            {
+                printf("Root hash saved to %s\n", ROOT_HASH_FILE);
+            }
+            CheckpointFree(&cp);
+        }
+        LevelsFree(&lv);
+    }
+}
+
+void CompareMerkleTree()
+{
+    struct merkle_levels_t stored, current;
+    struct timespec start, end;
+    int *changed = NULL;
+
+    if (!LevelsLoad(&stored, SNAPSHOT_FILE))
+    {
+        printf("No snapshot in %s, regenerate the root hash first.\n", SNAPSHOT_FILE);
+        return;
+    }
+
+    /* same shape as the snapshot, node hashes must line up */
+    if (BuildMerkleLevels(TRANSACTIONS_FOLDER, stored.arity, stored.padding, &current))
+    {
+        printf("Stored root hash: \n");
+        PrintHashHex(LevelsRoot(&stored));
+        printf("Current root hash: \n");
+        PrintHashHex(LevelsRoot(&current));
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int n_changed = DiffLevels(&stored, &current, &changed);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (n_changed == 0)
+        {
+            printf("Root hashes match, no block changed.\n");
+        }
+        else if (n_changed > 0)
+        {
+            printf("%d changed block(s) (%ld stored, %ld current):\n",
+                   n_changed, stored.n_leaves, current.n_leaves);
+            for (int i = 0; i < n_changed && i < MAX_CHANGED_PRINTED; i++)
+            {
+                printf("  " LEAF_FILE_FORMAT "\n", TRANSACTIONS_FOLDER, changed[i]);
+            }
+            if (n_changed > MAX_CHANGED_PRINTED)
+            {
+                printf("  ...\n");
+            }
+        }
+        printf("Diff time: %.3f us\n",
+               (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3);
+
+        free(changed);
+        LevelsFree(&current);
+    }
+    LevelsFree(&stored);
+}
+
+int SyncServeMode(const char *socket_path, const char *folder)
+{
+    int ret = 1;
+    struct merkle_levels_t lv;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd = -1;
+
+    if (BuildMerkleLevels(folder, merkle_config.arity, merkle_config.padding, &lv))
+    {
+        strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+        unlink(socket_path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0)
+        {
+            perror("SyncServeMode");
+        }
+        else
+        {
+            printf("Serving %ld blocks of %s on %s\n", lv.n_leaves, folder, socket_path);
+            ret = 0;
+        }
+
+        /* one peer at a time, until killed or accept() fails for good */
+        while (ret == 0)
+        {
+            struct sync_stats_t stats = {0};
+            int peer = accept(fd, NULL, NULL);
+            if (peer >= 0)
+            {
+                bool done = SyncServe(peer, &lv, &stats);
+                printf("Peer %s: %d requests, %d hashes, %zu bytes sent, %zu bytes received\n",
+                       done ? "synchronized" : "failed", stats.requests, stats.hashes,
+                       stats.bytes_sent, stats.bytes_received);
+                close(peer);
+            }
+            else if (errno != EINTR && errno != ECONNABORTED)
+            {
+                perror("SyncServeMode: accept");
+                ret = 1;
+            }
+        }
+
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        LevelsFree(&lv);
+    }
+
+    return ret;
+}
+
+int ServeMode(const char *socket_path, const char *folder)
+{
+    struct merkle_levels_t lv;
+    struct merkle_server_t srv;
+    unsigned long reported = 0;
+
+    if (!BuildMerkleLevels(folder, merkle_config.arity, merkle_config.padding, &lv))
+    {
+        return 1;
+    }
+    if (!ServerOpen(&srv, socket_path, &lv))
+    {
+        LevelsFree(&lv);
+        return 1;
+    }
+
+    printf("Serving proofs of %ld blocks of %s on %s\n", lv.n_leaves, folder, socket_path);
+    fflush(stdout);
+    /* until killed, with a summary after every second without requests */
+    while (ServerPoll(&srv, 1000) >= 0)
+    {
+        const struct server_histogram_t *h = &srv.stats.latency[SERVER_PROOF - 1];
+
+        if (srv.stats.requests != reported && srv.n_batch == 0)
+        {
+            printf("%lu requests in %lu batches, %lu errors, %lu clients, proof p50 %.1f us p99 %.1f us\n",
+                   srv.stats.requests, srv.stats.batches, srv.stats.errors, srv.stats.clients,
+                   ServerPercentile(h, 0.5) / 1e3, ServerPercentile(h, 0.99) / 1e3);
+            fflush(stdout);
+            reported = srv.stats.requests;
+        }
+    }
+
+    ServerClose(&srv);
+    LevelsFree(&lv);
+    return 1;
+}
+
+int BuildLevelsMode(const char *dir, const char *folder)
+{
+    int ret = 1;
+    unsigned char root[SHA256_DIGEST_LENGTH];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (LevelFilesBuild(folder, dir, merkle_config.arity, merkle_config.padding, root))
+    {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("Level files of %s written to %s in %.3f ms\n", folder, dir,
+               (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+        printf("Root hash hex: \n");
+        PrintHashHex(root);
+        ret = 0;
+    }
+
+    return ret;
+}
+
+int ProveMode(const char *dir, int block, const char *folder)
+{
+    int ret = 1;
+    struct level_store_t store;
+    struct level_source_t src;
+    struct merkle_proof_t proof;
+    unsigned char leaf[SHA256_DIGEST_LENGTH];
+    char filename[256];
+
+    if (LevelStoreOpen(&store, dir, (size_t)merkle_config.ram_budget_kb * 1024))
+    {
+        LevelStoreSource(&store, &src);
+        snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, folder, block);
+        if (HashFile(filename, leaf) && ProofBuildFromSource(&src, block, &proof))
+        {
+            bool valid = ProofVerify(&proof, leaf, store.root);
+            printf("%s %s the tree of %s (%zu bytes proof, %ld pages read)\n",
+                   filename, valid ? "belongs to" : "does NOT belong to", dir,
+                   ProofSize(&proof), store.reads);
+            ret = valid ? 0 : 1;
+            ProofFree(&proof);
+        }
+        LevelStoreClose(&store);
+    }
+
+    return ret;
+}
+
+int PublishMode(const char *name, const char *folder)
+{
+    int ret = 1;
+    struct merkle_levels_t lv;
+    struct shared_publisher_t pub = {0};
+
+    if (BuildMerkleLevels(folder, merkle_config.arity, merkle_config.padding, &lv))
+    {
+        /* the segments outlive the process until the next generation */
+        if (SharedPublish(&pub, name, &lv))
+        {
+            printf("Tree of %s published as %s, generation %lu\n", folder, name, pub.generation);
+            printf("Root hash hex: \n");
+            PrintHashHex(LevelsRoot(&lv));
+            ret = 0;
+        }
+        LevelsFree(&lv);
+    }
+
+    return ret;
+}
+
+int SharedProveMode(const char *name, int block, const char *folder)
+{
+    int ret = 1;
+    struct shared_reader_t rd;
+    struct merkle_proof_t proof;
+    unsigned char leaf[SHA256_DIGEST_LENGTH];
+    char filename[256];
+
+    if (SharedAttach(&rd, name))
+    {
+        snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, folder, block);
+        if (HashFile(filename, leaf) && ProofBuild(&rd.lv, block, &proof))
+        {
+            bool valid = ProofVerify(&proof, leaf, LevelsRoot(&rd.lv));
+            printf("%s %s generation %lu of %s (%zu bytes proof)\n",
+                   filename, valid ? "belongs to" : "does NOT belong to", rd.generation,
+                   name, ProofSize(&proof));
+            ret = valid ? 0 : 1;
+            ProofFree(&proof);
+        }
+        SharedDetach(&rd);
+    }
+
+    return ret;
+}
+
+int SyncPullMode(const char *socket_path, const char *folder)
+{
+    int ret = 1;
+    struct merkle_levels_t lv;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct sync_stats_t stats = {0};
+    int *blocks = NULL;
+    int remote_leaves = 0;
+    int fd = -1;
+
+    if (!BuildMerkleLevels(folder, merkle_config.arity, merkle_config.padding, &lv))
+    {
+        return ret;
+    }
+
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        int n_blocks = SyncPull(fd, &lv, &blocks, &remote_leaves, &stats);
+        if (n_blocks >= 0)
+        {
+            printf("%d block(s) to transfer (%d remote, %ld local):\n",
+                   n_blocks, remote_leaves, lv.n_leaves);
+            for (int i = 0; i < n_blocks; i++)
+            {
+                printf("  " LEAF_FILE_FORMAT "\n", folder, blocks[i]);
+            }
+            printf("%d requests, %d hashes, %zu bytes sent, %zu bytes received\n",
+                   stats.requests, stats.hashes, stats.bytes_sent, stats.bytes_received);
+            free(blocks);
+            ret = 0;
+        }
+    }
+    else
+    {
+        perror("SyncPullMode");
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    LevelsFree(&lv);
+
+    return ret;
 }
 
 void ClearScreen()
@@ -144,6 +630,11 @@ void ClearScreen()
 #ifdef _WIN32
     system("cls");
 #else
-    system("clear");
+    /* no shell spawned, and nothing sent when the output is not a terminal */
+    if (isatty(STDOUT_FILENO))
+    {
+        printf("\033[H\033[2J");
+        fflush(stdout);
+    }
 #endif
 }
@@ -0,0 +1,119 @@
+/**
+ * @file main_bench.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Main entry point of the hash kernel benchmarks.
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "bench.h"
+#include <stdio.h>      /* printf */
+#include <stdlib.h>     /* atoi */
+#include <string.h>     /* strcmp */
+#include <unistd.h>     /* getopt */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Prints the command line options.
+ *
+ * @param prog Name of the program.
+ */
+static void usage(const char *prog);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+int main(int argc, char **argv)
+{
+    struct bench_options_t opt = {
+        .runs = BENCH_DEFAULT_RUNS,
+        .warmup = BENCH_DEFAULT_WARMUP,
+        .run_us = BENCH_DEFAULT_RUN_US,
+    };
+    const char *json_path = NULL;
+    FILE *json = NULL;
+    int failed;
+    int c;
+
+    while ((c = getopt(argc, argv, "r:w:t:f:j:h")) != -1)
+    {
+        switch (c)
+        {
+            case 'r': opt.runs = atoi(optarg); break;
+            case 'w': opt.warmup = atoi(optarg); break;
+            case 't': opt.run_us = atoi(optarg); break;
+            case 'f': opt.filter = optarg; break;
+            case 'j': json_path = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (opt.runs < 1 || opt.runs > BENCH_MAX_RUNS || opt.warmup < 0 || opt.run_us < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (json_path)
+    {
+        json = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (!json)
+        {
+            perror("Failed to open the JSON report");
+            return 1;
+        }
+    }
+
+    /* the table goes to stderr when the JSON report takes stdout */
+    failed = RunHashBenchmarks(&opt, json == stdout ? stderr : stdout, json);
+
+    if (json && json != stdout)
+    {
+        fclose(json);
+    }
+
+    return failed;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-r runs] [-w warmup runs] [-t run duration (us)]\n"
+                    "       %*s [-f kernel name filter] [-j report.json|-]\n"
+                    "defaults: %d runs of %d us after %d warm-up runs, up to %d runs\n",
+            prog, (int)strlen(prog), "", BENCH_DEFAULT_RUNS, BENCH_DEFAULT_RUN_US,
+            BENCH_DEFAULT_WARMUP, BENCH_MAX_RUNS);
+}
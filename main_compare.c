@@ -0,0 +1,124 @@
+/**
+ * @file main_compare.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Main entry point of the benchmark results comparison.
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "results.h"
+#include <stdio.h>      /* printf */
+#include <stdlib.h>     /* atof */
+#include <unistd.h>     /* getopt */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Prints the command line options.
+ *
+ * @param prog Name of the program.
+ */
+static void usage(const char *prog);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+int main(int argc, char **argv)
+{
+    struct results_compare_t opt = {
+        .threshold = RESULTS_DEFAULT_THRESHOLD,
+        .alpha = RESULTS_DEFAULT_ALPHA,
+    };
+    const char *current_path = RESULTS_JSON_FILE;
+    FILE *baseline;
+    FILE *current;
+    int regressions;
+    int c;
+
+    while ((c = getopt(argc, argv, "t:a:b:r:h")) != -1)
+    {
+        switch (c)
+        {
+            case 't': opt.threshold = atof(optarg); break;
+            case 'a': opt.alpha = atof(optarg); break;
+            case 'b': opt.rev[0] = optarg; break;
+            case 'r': opt.rev[1] = optarg; break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind >= argc || argc - optind > 2 || opt.threshold < 0.0 || opt.alpha <= 0.0 || opt.alpha >= 1.0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (argc - optind == 2)
+    {
+        current_path = argv[optind + 1];
+    }
+
+    baseline = fopen(argv[optind], "r");
+    current = fopen(current_path, "r");
+    if (!baseline || !current)
+    {
+        perror("Failed to open the results");
+        regressions = -1;
+    }
+    else
+    {
+        regressions = ResultsCompare(baseline, current, &opt, stdout);
+    }
+    if (baseline)
+    {
+        fclose(baseline);
+    }
+    if (current)
+    {
+        fclose(current);
+    }
+
+    /* 0: no regression, 1: regressions, 2: unusable input */
+    return regressions < 0 ? 2 : regressions > 0;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-t threshold %%] [-a alpha] [-b baseline rev] [-r current rev]\n"
+                    "       baseline.jsonl [current.jsonl]\n"
+                    "defaults: %.1f%% threshold, alpha %.2f, current results in %s,\n"
+                    "          the revision of the last record of each file\n",
+            prog, RESULTS_DEFAULT_THRESHOLD, RESULTS_DEFAULT_ALPHA, RESULTS_JSON_FILE);
+}
@@ -0,0 +1,119 @@
+/**
+ * @file main_sweep.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Main entry point of the scalability sweep.
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "sweep.h"
+#include <stdio.h>      /* printf */
+#include <string.h>     /* strcmp */
+#include <unistd.h>     /* getopt */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Prints the command line options.
+ *
+ * @param prog Name of the program.
+ */
+static void usage(const char *prog);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+int main(int argc, char **argv)
+{
+    struct sweep_spec_t spec;
+    const char *spec_path = SWEEP_SPEC_FILE;
+    const char *csv_path = NULL;
+    FILE *spec_fp;
+    FILE *csv = NULL;
+    int failed;
+    int c;
+
+    while ((c = getopt(argc, argv, "s:o:h")) != -1)
+    {
+        switch (c)
+        {
+            case 's': spec_path = optarg; break;
+            case 'o': csv_path = optarg; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    spec_fp = fopen(spec_path, "r");
+    if (!spec_fp)
+    {
+        perror("Failed to open the sweep specification");
+        return 1;
+    }
+    failed = !SweepReadSpec(spec_fp, &spec);
+    fclose(spec_fp);
+    if (failed)
+    {
+        return 1;
+    }
+
+    if (csv_path)
+    {
+        csv = strcmp(csv_path, "-") == 0 ? stdout : fopen(csv_path, "w");
+        if (!csv)
+        {
+            perror("Failed to open the CSV matrix");
+            return 1;
+        }
+    }
+
+    /* the table goes to stderr when the CSV matrix takes stdout */
+    failed = SweepRun(&spec, csv == stdout ? stderr : stdout, csv);
+
+    if (csv && csv != stdout)
+    {
+        fclose(csv);
+    }
+
+    return failed;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-s specification] [-o matrix.csv|-]\n"
+                    "default specification: %s\n",
+            prog, SWEEP_SPEC_FILE);
+}
@@ -9,9 +9,12 @@
  * INCLUDE FILES
  *-----------------------------------*/
 #include "tests.h"
+#include "dataset.h"    /* DatasetGenerate */
+#include "stats.h"      /* StatsReporterStart */
 #include <stdio.h>      /* printf */
-#include <stdlib.h>     /* system() */
-#include <sys/stat.h>
+#include <stdlib.h>     /* getenv */
+#include <errno.h>      /* errno */
+#include <sys/stat.h>   /* mkdir */
 #include <sys/types.h>
 #include <unistd.h>
 #include <stdbool.h>
@@ -24,7 +27,13 @@
  * PRIVATE DEFINES
  *-----------------------------------*/
 #define TEST_SPEC_FILE "test_spec.txt"
-#define FILE_NAME_FORMAT "block_%d.txt"
+/* Root of the test datasets, e.g. /dev/shm to keep them in memory */
+#define TEST_ENV_DATASET_DIR  "MERKLE_DATASET_DIR"
+#define TEST_DEFAULT_DATASET_DIR "data"
+/* Set to 1 to keep the datasets for the next runs */
+#define TEST_ENV_DATASET_KEEP "MERKLE_DATASET_KEEP"
+/* Leaf size distribution of the folders that do not give one */
+#define TEST_DEFAULT_SIZES "fixed:64"
 
 /*-----------------------------------*
  * PRIVATE MACROS
@@ -42,7 +51,9 @@
  * @brief Reads test specifications from a configuration file.
  *
  * This function reads the number of test files from a predefined configuration
- * file and initializes folder structures accordingly.
+ * file and initializes folder structures accordingly. Each line holds a
+ * number of files, optionally followed by their size distribution (see
+ * struct sweep_dist_t), fixed:64 by default.
  *
  * @retval true if the configuration file is successfully read.
  * @retval false if the file cannot be opened or parsed.
@@ -52,16 +63,19 @@ static bool readTestSpecifications(void);
 /**
  * @brief Generates test files for Merkle tree testing.
  *
- * This function creates dummy transaction files in specified folders
- * to simulate real-world data input for Merkle tree construction.
+ * This function writes the seeded dataset of every folder in parallel,
+ * or reuses the one a previous run kept.
+ *
+ * @retval true  Every dataset is in place.
+ * @retval false A dataset could not be written.
  */
-static void generateFiles(void);
+static bool generateFiles(void);
 
 /**
  * @brief Removes generated test files after testing.
  *
- * This function deletes the generated transaction files and directories
- * to ensure a clean environment after test execution.
+ * This function deletes the datasets to ensure a clean environment after
+ * test execution, unless MERKLE_DATASET_KEEP is set.
  */
 static void removeFiles(void);
 
@@ -71,21 +85,24 @@ static void removeFiles(void);
 /*-----------------------------------*
  * PRIVATE VARIABLES
  *-----------------------------------*/
-/* None */
+/* Leaf size distribution of every folder */
+static struct sweep_dist_t folder_sizes[MAX_TESTING_FOLDERS];
 
 /*-----------------------------------*
  * PUBLIC FUNCTION DEFINITIONS
  *-----------------------------------*/
 int main(int argc, char **argv)
 {
+    int failed = 0;
+
+    /* before the first thread: `kill -USR1` dumps the build counters */
+    StatsReporterStart(STDERR_FILENO);
+
     /* read test specifications */
-    if(readTestSpecifications())
+    if(readTestSpecifications() && generateFiles())
     {
-        /* generate test files */
-        generateFiles();
-    
         /* RUN TESTS */
-        RunMerkleTreeTests();
+        failed = RunMerkleTreeTests();
         
         /* Print results from file */
         // PrintResultsFromFile();
@@ -93,8 +110,9 @@ int main(int argc, char **argv)
         /* remove test files */
         removeFiles();
     }
+    StatsReporterStop();
 
-    return 0;
+    return failed;
 }
 
 /*-----------------------------------*
@@ -103,78 +121,90 @@ int main(int argc, char **argv)
 static bool readTestSpecifications(void)
 {
     bool ret = false;
+    const char *root = getenv(TEST_ENV_DATASET_DIR);
+    char line[256];
+    char sizes[64];
+
+    root = root && *root ? root : TEST_DEFAULT_DATASET_DIR;
     /* Open the test specification file */
     FILE *fp = fopen(TEST_SPEC_FILE, "r");
     if (fp)
     {
+        ret = true;
         numFolders = 0;
-        while (numFolders < MAX_TESTING_FOLDERS &&
-               fscanf(fp, "%d", &folders[numFolders].num_files) == 1)
+        while (ret && numFolders < MAX_TESTING_FOLDERS && fgets(line, sizeof(line), fp))
         {
+            int fields = sscanf(line, "%d %63s", &folders[numFolders].num_files, sizes);
+            if (fields < 1)
+            {
+                continue;
+            }
+            ret = SweepParseDist(fields == 2 ? sizes : TEST_DEFAULT_SIZES, &folder_sizes[numFolders]);
+            if (!ret)
+            {
+                fprintf(stderr, "Error: invalid size distribution in %s: %s", TEST_SPEC_FILE, line);
+            }
             snprintf(folders[numFolders].folder,
                      sizeof(folders[numFolders].folder),
-                     "data/transactions_%d/",
-                     folders[numFolders].num_files);
+                     "%s/transactions_%d/",
+                     root, folders[numFolders].num_files);
             numFolders++;
         }
         fclose(fp);
-        ret = true;
     }
     return ret;
 }
 
-static void generateFiles(void)
+static bool generateFiles(void)
 {
-    char filename[256];
+    bool ret = true;
+    const char *root = getenv(TEST_ENV_DATASET_DIR);
 
-    for (int i = 0; i < numFolders; i++)
+    /* the default root is part of the repository */
+    if (root && *root && mkdir(root, 0777) != 0 && errno != EEXIST)
     {
-        mkdir(folders[i].folder, 0777);
+        perror("Error creating the dataset directory");
+        ret = false;
+    }
 
-        for (int j = 0; j < folders[i].num_files; j++)
+    for (int i = 0; ret && i < numFolders; i++)
+    {
+        struct dataset_spec_t spec = {
+            .files = folders[i].num_files,
+            .size = folder_sizes[i],
+            .seed = DATASET_DEFAULT_SEED,
+        };
+        struct dataset_stats_t st;
+
+        ret = DatasetGenerate(folders[i].folder, &spec, &st);
+        if (ret)
         {
-            int written = snprintf(filename, sizeof(filename), "%s/" FILE_NAME_FORMAT, folders[i].folder, j);
-            if (written < 0 || written >= sizeof(filename))
-            {
-                fprintf(stderr, "Error: Filename truncated for folder: %s\n", folders[i].folder);
-                continue;
-            }
-            FILE *fp = fopen(filename, "w");
-            if (fp)
-            {
-                fprintf(fp, "This is dummy content for file %d in folder %s.\n",
-                        j, folders[i].folder);
-                fclose(fp);
-            }
-            else
-            {
-                perror("Error creating file");
-            }
+            printf("%s %s: %ld files, %lld bytes (%s) in %.1f ms%s\n",
+                   st.reused ? "Reused" : "Generated", folders[i].folder, st.files, st.bytes,
+                   spec.size.label, st.elapsed_ms, st.tmpfs ? ", tmpfs" : "");
         }
     }
 
-    printf("Folders and dummy files generated successfully.\n");
+    return ret;
 }
 
 static void removeFiles(void)
 {
-    char command[256];
+    const char *keep = getenv(TEST_ENV_DATASET_KEEP);
 
-    for (int i = 0; i < numFolders; i++)
+    if (keep && atoi(keep) != 0)
     {
-        int written = snprintf(command, sizeof(command), "rm -rf %s", folders[i].folder);
-        if (written < 0 || written >= sizeof(command))
-        {
-            fprintf(stderr, "Error: Command truncated for folder: %s\n", folders[i].folder);
-            continue;
-        }
-        if(!system(command))
+        printf("Test folders kept for the next runs.\n");
+    }
+    else
+    {
+        for (int i = 0; i < numFolders; i++)
         {
-            perror("removeFiles: system() call failed\n");
+            DatasetRemove(folders[i].folder);
         }
-    }
 
-    printf("All test folders removed.\n");
+        printf("All test folders removed.\n");
+    }
 }
 
 
@@ -0,0 +1,131 @@
+/**
+ * @file main_tune.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Main entry point of the calibration of the build settings.
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "tune.h"
+#include <stdio.h>      /* printf */
+#include <stdlib.h>     /* atoi */
+#include <unistd.h>     /* getopt */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Dataset sampled when none is given, the one of merkleTree */
+#define TUNE_FOLDER "data/transactions/"
+
+/* Length of the profile path */
+#define TUNE_PATH_LEN 512
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Prints the command line options.
+ *
+ * @param prog Name of the program.
+ */
+static void usage(const char *prog);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+int main(int argc, char **argv)
+{
+    struct tune_options_t opt = {
+        .sample = TUNE_DEFAULT_SAMPLE,
+        .repeats = TUNE_DEFAULT_REPEATS,
+        .level_leaves = TUNE_DEFAULT_LEVEL_LEAVES,
+    };
+    struct tune_result_t result;
+    char profile[TUNE_PATH_LEN];
+    const char *profile_path = NULL;
+    const char *folder = TUNE_FOLDER;
+    int ret = 0;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:r:l:o:h")) != -1)
+    {
+        switch (c)
+        {
+            case 'n': opt.sample = atoi(optarg); break;
+            case 'r': opt.repeats = atoi(optarg); break;
+            case 'l': opt.level_leaves = atoi(optarg); break;
+            case 'o': profile_path = optarg; break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (argc - optind > 1 || opt.sample < 1 || opt.repeats < 1 || opt.level_leaves < 1)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (optind < argc)
+    {
+        folder = argv[optind];
+    }
+    if (!profile_path && ConfigProfilePath(profile, sizeof(profile)))
+    {
+        profile_path = profile;
+    }
+
+    /* from the defaults: neither the environment nor an older profile */
+    if (!TuneRun(folder, &opt, &result, stdout))
+    {
+        ret = 1;
+    }
+    else if (!profile_path)
+    {
+        fprintf(stderr, "No profile location: set HOME, XDG_CACHE_HOME or %s\n",
+                CONFIG_ENV_PROFILE);
+        ret = 1;
+    }
+    else if (ConfigSaveProfile(profile_path))
+    {
+        printf("Profile written to %s, loaded by the next builds\n", profile_path);
+    }
+    else
+    {
+        ret = 1;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-n sample files] [-r repeats] [-l level leaves] [-o profile] [folder]\n"
+                    "defaults: %d files of %s, %d repeats, %d level leaves, the profile of the host\n",
+            prog, TUNE_DEFAULT_SAMPLE, TUNE_FOLDER, TUNE_DEFAULT_REPEATS, TUNE_DEFAULT_LEVEL_LEAVES);
+}
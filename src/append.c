@@ -0,0 +1,241 @@
+/**
+ * @file append.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Lock-free concurrent leaf ingestion with roots of the published prefixes
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/append.h"
+#include "../inc/mem.h"                 /* MEM_LEVELS and MEM_SCRATCH accounting */
+
+#include <stdio.h>                      /* fprintf */
+#include <string.h>                     /* memcpy, memset */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Moves the published frontier over the consecutive published leaves.
+ *
+ * Any producer may move it: a leaf published behind a slower one is
+ * taken over by the producer of that slower leaf.
+ *
+ * @param ap Tree.
+ */
+static void AdvanceFrontier(struct merkle_append_t *ap);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool AppendInit(struct merkle_append_t *ap, int capacity, int arity,
+                enum merkle_padding_t padding)
+{
+    bool ret = capacity >= 1 && arity >= 2;
+    size_t n_hashes = 0;
+    size_t n_pending = 0;
+
+    memset(ap, 0, sizeof(*ap));
+    if (ret)
+    {
+        ap->capacity = capacity;
+        ap->arity = arity;
+        ap->padding = padding;
+
+        /* a level holds the nodes whose whole subtree fits the capacity */
+        for (int size = capacity; size > 0 && ap->n_levels < LEVELS_MAX; size /= arity)
+        {
+            ap->level_size[ap->n_levels++] = size;
+            n_hashes += size;
+            n_pending += ap->n_levels > 1 ? size : 0;
+        }
+
+        ap->level[0] = MemCalloc(MEM_LEVELS, n_hashes, SHA256_DIGEST_LENGTH);
+        ap->pending[1] = n_pending ? MemCalloc(MEM_LEVELS, n_pending, sizeof(atomic_int)) : NULL;
+        ap->published = MemCalloc(MEM_LEVELS, capacity, sizeof(atomic_uchar));
+        ret = ap->level[0] && (ap->pending[1] || !n_pending) && ap->published;
+    }
+
+    for (int l = 1; l < ap->n_levels && ret; l++)
+    {
+        ap->level[l] = ap->level[l - 1] + (size_t)ap->level_size[l - 1] * SHA256_DIGEST_LENGTH;
+        if (l > 1)
+        {
+            ap->pending[l] = ap->pending[l - 1] + ap->level_size[l - 1];
+        }
+    }
+
+    if (!ret)
+    {
+        fprintf(stderr, "AppendInit: invalid parameters or allocation failure\n");
+        AppendFree(ap);
+    }
+
+    return ret;
+}
+
+int AppendClaim(struct merkle_append_t *ap, int count)
+{
+    int first = atomic_load(&ap->next);
+
+    /* on failure first is reloaded with the slots claimed meanwhile */
+    while (count >= 1 && first <= ap->capacity - count &&
+           !atomic_compare_exchange_weak(&ap->next, &first, first + count))
+    {
+    }
+
+    return count >= 1 && first <= ap->capacity - count ? first : -1;
+}
+
+bool AppendPublish(struct merkle_append_t *ap, int slot,
+                   const unsigned char digest[SHA256_DIGEST_LENGTH])
+{
+    bool ret = slot >= 0 && slot < ap->capacity;
+    bool up = ret;
+    long idx = slot;
+
+    if (ret)
+    {
+        memcpy(ap->level[0] + (size_t)slot * SHA256_DIGEST_LENGTH, digest, SHA256_DIGEST_LENGTH);
+    }
+
+    /* the last child in hashes the group; the counter orders its
+     * write before the reads of the producer completing the parent */
+    for (int l = 1; l < ap->n_levels && up; l++)
+    {
+        idx /= ap->arity;
+        up = idx < ap->level_size[l] && atomic_fetch_add(&ap->pending[l][idx], 1) + 1 == ap->arity;
+        if (up)
+        {
+            ret = HashChildren(ap->level[l - 1] + (size_t)idx * ap->arity * SHA256_DIGEST_LENGTH,
+                               ap->arity, ap->level[l] + (size_t)idx * SHA256_DIGEST_LENGTH);
+            atomic_fetch_add_explicit(&ap->completed, 1, memory_order_relaxed);
+            up = ret;
+        }
+    }
+
+    if (ret)
+    {
+        /* published after its parents: a prefix only counts complete nodes in */
+        atomic_store(&ap->published[slot], 1);
+        AdvanceFrontier(ap);
+    }
+    else
+    {
+        fprintf(stderr, "AppendPublish: invalid slot %d or hashing failure\n", slot);
+    }
+
+    return ret;
+}
+
+int AppendPublished(struct merkle_append_t *ap)
+{
+    return atomic_load(&ap->frontier);
+}
+
+bool AppendPrefixRoot(struct merkle_append_t *ap, int n, unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    int sizes[LEVELS_MAX];
+    int n_levels = n >= 1 ? NodesNumberLevels(sizes, LEVELS_MAX, n, ap->arity, ap->padding) : 0;
+    unsigned char *group = MemAlloc(MEM_SCRATCH, (size_t)ap->arity * SHA256_DIGEST_LENGTH);
+    unsigned char edge[SHA256_DIGEST_LENGTH];
+    bool partial = false;               /* edge holds the partial node of the level */
+    int count = n;                      /* real nodes of the level below */
+    int complete = n;                   /* complete nodes of the level below */
+    bool ret = group && n_levels > 0 && n <= AppendPublished(ap);
+
+    for (int l = 1; l < n_levels && ret; l++)
+    {
+        int above = complete / ap->arity;
+        int first = above * ap->arity;
+
+        /* the last group: stored complete children, then the partial one */
+        partial = count > first;
+        if (partial)
+        {
+            memcpy(group, ap->level[l - 1] + (size_t)first * SHA256_DIGEST_LENGTH,
+                   (size_t)(complete - first) * SHA256_DIGEST_LENGTH);
+            if (count > complete)
+            {
+                memcpy(group + (size_t)(complete - first) * SHA256_DIGEST_LENGTH, edge,
+                       SHA256_DIGEST_LENGTH);
+            }
+            ret = LevelsHashUp(group, count - first, ap->arity, ap->padding, edge) == 1;
+        }
+        count = (count + ap->arity - 1) / ap->arity;
+        complete = above;
+    }
+
+    if (ret)
+    {
+        memcpy(output, partial ? edge : ap->level[n_levels - 1], SHA256_DIGEST_LENGTH);
+    }
+    else
+    {
+        fprintf(stderr, "AppendPrefixRoot: prefix %d not published or hashing failure\n", n);
+    }
+    MemFree(MEM_SCRATCH, group, (size_t)ap->arity * SHA256_DIGEST_LENGTH);
+
+    return ret;
+}
+
+void AppendFree(struct merkle_append_t *ap)
+{
+    size_t n_hashes = 0;
+    size_t n_pending = 0;
+
+    for (int l = 0; l < ap->n_levels; l++)
+    {
+        n_hashes += ap->level_size[l];
+        n_pending += l > 0 ? ap->level_size[l] : 0;
+    }
+    MemFree(MEM_LEVELS, ap->level[0], n_hashes * SHA256_DIGEST_LENGTH);
+    MemFree(MEM_LEVELS, ap->pending[1], n_pending * sizeof(atomic_int));
+    MemFree(MEM_LEVELS, ap->published, (size_t)ap->capacity * sizeof(atomic_uchar));
+    memset(ap, 0, sizeof(*ap));
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void AdvanceFrontier(struct merkle_append_t *ap)
+{
+    int frontier = atomic_load(&ap->frontier);
+
+    /* a failed exchange reloads the frontier moved by another producer */
+    while (frontier < ap->capacity && atomic_load(&ap->published[frontier]))
+    {
+        if (atomic_compare_exchange_weak(&ap->frontier, &frontier, frontier + 1))
+        {
+            frontier++;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+/**
+ * @file arena.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Single-block bump allocator reused across tree rebuilds
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/arena.h"
+#include "../inc/mem.h"                 /* MEM_NODES accounting */
+
+#include <stdio.h>                      /* fprintf */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool ArenaReserve(struct merkle_arena_t *a, size_t bytes)
+{
+    bool ret = true;
+
+    a->used = 0;
+    if (bytes > a->capacity)
+    {
+        size_t capacity = ARENA_ROUND(bytes + bytes / ARENA_HEADROOM);
+
+        /* nothing to keep: free first, the peak stays at one block */
+        MemFree(MEM_NODES, a->base, a->capacity);
+        a->base = MemAlloc(MEM_NODES, capacity);
+        a->capacity = a->base ? capacity : 0;
+        a->grows++;
+        ret = a->base != NULL;
+        if (!ret)
+        {
+            fprintf(stderr, "ArenaReserve: unable to allocate %zu bytes\n", capacity);
+        }
+    }
+
+    return ret;
+}
+
+void *ArenaAlloc(struct merkle_arena_t *a, size_t bytes)
+{
+    void *ret = NULL;
+    size_t size = ARENA_ROUND(bytes);
+
+    if (a->base && size <= a->capacity - a->used)
+    {
+        ret = a->base + a->used;
+        a->used += size;
+    }
+
+    return ret;
+}
+
+void ArenaReset(struct merkle_arena_t *a)
+{
+    a->used = 0;
+}
+
+void ArenaRelease(struct merkle_arena_t *a)
+{
+    MemFree(MEM_NODES, a->base, a->capacity);
+    a->base = NULL;
+    a->capacity = 0;
+    a->used = 0;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+/* None */
@@ -0,0 +1,525 @@
+/**
+ * @file bench.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Microbenchmarks of the hash kernels
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#define _GNU_SOURCE                     /* memfd_create */
+#include "../inc/bench.h"
+#include "../inc/utils.h"               /* CompareDoubles */
+
+#include <stdlib.h>                     /* malloc, qsort */
+#include <string.h>                     /* strstr */
+#include <time.h>                       /* clock_gettime */
+#include <unistd.h>                     /* write, close */
+#include <sys/mman.h>                   /* memfd_create */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>                  /* __rdtsc */
+#endif
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Largest buffer hashed by a kernel */
+#define BENCH_MAX_BYTES (1 << 20)
+
+/* Parents hashed by one call of the level kernel */
+#define BENCH_LEVEL_PARENTS 256
+
+/* In-memory files hashed by the file kernels */
+#define BENCH_SMALL_FILE 4096
+#define BENCH_LARGE_FILE BENCH_MAX_BYTES
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Inputs shared by the kernels */
+struct bench_data_t {
+    unsigned char *buf;                 /* BENCH_MAX_BYTES of data */
+    unsigned char out[BENCH_LEVEL_PARENTS * SHA256_DIGEST_LENGTH];
+    EVP_MD_CTX *ctx;                    /* set up for SHA-256 */
+    EVP_MD *md;                         /* SHA-256 implementation, fetched once */
+    int small_fd;                       /* memfd of BENCH_SMALL_FILE bytes */
+    int large_fd;                       /* memfd of BENCH_LARGE_FILE bytes */
+    char small_path[64];                /* /proc path of the memfds, for HashFile() */
+    char large_path[64];
+};
+
+/**
+ * @brief Runs an operation `ops` times.
+ *
+ * @param d Inputs.
+ * @param bytes Bytes hashed per operation.
+ * @param ops Number of operations.
+ * @retval true  Success.
+ * @retval false Hashing failure.
+ */
+typedef bool (*bench_kernel_t)(struct bench_data_t *d, size_t bytes, long ops);
+
+/* Kernel of the suite */
+struct bench_entry_t {
+    const char *name;
+    size_t bytes;
+    bench_kernel_t run;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Sets up the inputs: random data, digest context, in-memory files.
+ *
+ * @param d Inputs to fill, released with DataFree().
+ * @retval true  Success.
+ * @retval false Allocation or file failure.
+ */
+static bool DataInit(struct bench_data_t *d);
+
+/**
+ * @brief Releases the inputs.
+ */
+static void DataFree(struct bench_data_t *d);
+
+/**
+ * @brief Creates an in-memory file filled with the start of the data.
+ *
+ * @param d Inputs.
+ * @param size Size of the file.
+ * @param path Buffer of 64 bytes receiving a path opening the file.
+ * @return Descriptor of the file, -1 on failure.
+ */
+static int MemoryFile(struct bench_data_t *d, size_t size, char *path);
+
+/**
+ * @brief Calibrates, warms up and times one kernel.
+ *
+ * @param d Inputs.
+ * @param e Kernel.
+ * @param opt Measurement options.
+ * @param res Result to fill.
+ * @retval true  Success.
+ * @retval false Hashing failure.
+ */
+static bool Measure(struct bench_data_t *d, const struct bench_entry_t *e,
+                    const struct bench_options_t *opt, struct bench_result_t *res);
+
+/**
+ * @brief Times one run of a kernel.
+ *
+ * @param ns Duration in ns.
+ * @param cycles Duration in timestamp counter cycles, 0 if unavailable.
+ * @retval true  Success.
+ * @retval false Hashing failure.
+ */
+static bool TimeRun(struct bench_data_t *d, const struct bench_entry_t *e, long ops,
+                    double *ns, double *cycles);
+
+/**
+ * @brief Reads the timestamp counter, 0 where there is none.
+ */
+static unsigned long long Cycles(void);
+
+/**
+ * @brief Writes one result as a JSON object.
+ */
+static void PrintJson(FILE *json, const struct bench_result_t *res, bool first);
+
+/* The kernels */
+static bool KernelTwoHashes(struct bench_data_t *d, size_t bytes, long ops);
+static bool KernelTwoHashesCtx(struct bench_data_t *d, size_t bytes, long ops);
+static bool KernelTwoHashesDirect(struct bench_data_t *d, size_t bytes, long ops);
+static bool KernelLevel(struct bench_data_t *d, size_t bytes, long ops);
+static bool KernelFile(struct bench_data_t *d, size_t bytes, long ops);
+static bool KernelFileCtx(struct bench_data_t *d, size_t bytes, long ops);
+static bool KernelFileDirect(struct bench_data_t *d, size_t bytes, long ops);
+static bool KernelEvpImplicit(struct bench_data_t *d, size_t bytes, long ops);
+static bool KernelEvpFetched(struct bench_data_t *d, size_t bytes, long ops);
+static bool KernelEvpOneShot(struct bench_data_t *d, size_t bytes, long ops);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* The suite: the tree primitives, then the OpenSSL entry points alone */
+static const struct bench_entry_t bench_suite[] =
+{
+    { "HashTwoHashes",         2 * SHA256_DIGEST_LENGTH, KernelTwoHashes },
+    { "HashTwoHashesCtx",      2 * SHA256_DIGEST_LENGTH, KernelTwoHashesCtx },
+    { "HashTwoHashesDirect",   2 * SHA256_DIGEST_LENGTH, KernelTwoHashesDirect },
+    { "HashLevel 256x2",       BENCH_LEVEL_PARENTS * 2 * SHA256_DIGEST_LENGTH, KernelLevel },
+    { "HashFile 4KiB",         BENCH_SMALL_FILE, KernelFile },
+    { "HashFile 1MiB",         BENCH_LARGE_FILE, KernelFile },
+    { "HashFileCtx 4KiB",      BENCH_SMALL_FILE, KernelFileCtx },
+    { "HashFileDirect 4KiB",   BENCH_SMALL_FILE, KernelFileDirect },
+    { "evp-implicit 64B",      64, KernelEvpImplicit },
+    { "evp-implicit 4KiB",     4096, KernelEvpImplicit },
+    { "evp-fetched 64B",       64, KernelEvpFetched },
+    { "evp-fetched 4KiB",      4096, KernelEvpFetched },
+    { "evp-oneshot 64B",       64, KernelEvpOneShot },
+    { "evp-oneshot 4KiB",      4096, KernelEvpOneShot },
+};
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+int RunHashBenchmarks(const struct bench_options_t *opt, FILE *out, FILE *json)
+{
+    int failed = 0;
+    bool first = true;
+    struct bench_data_t d;
+
+    if (!DataInit(&d))
+    {
+        fprintf(stderr, "RunHashBenchmarks: unable to set up the inputs\n");
+        DataFree(&d);
+        return 1;
+    }
+
+    fprintf(out, "%-20s %10s %10s %12s %12s %12s %10s %10s\n",
+        "HASH KERNEL", "BYTES", "OPS/RUN", "MEDIAN (ns)", "P99 (ns)", "MIN (ns)", "CYC/BYTE", "MB/s");
+    fprintf(out, "------------------------------------------------------------------------------------------------------\n");
+    if (json)
+    {
+        fprintf(json, "{\n  \"benchmark\": \"hash\",\n  \"runs\": %d,\n  \"warmup\": %d,\n"
+                      "  \"run_us\": %d,\n  \"cycles\": \"%s\",\n  \"results\": [",
+                opt->runs, opt->warmup, opt->run_us, Cycles() ? "tsc" : "none");
+    }
+
+    for (size_t k = 0; k < sizeof(bench_suite) / sizeof(bench_suite[0]); k++)
+    {
+        const struct bench_entry_t *e = &bench_suite[k];
+        struct bench_result_t res;
+
+        if (opt->filter && !strstr(e->name, opt->filter))
+        {
+            continue;
+        }
+        if (!Measure(&d, e, opt, &res))
+        {
+            fprintf(out, "%-20s %10zu %10s\n", e->name, e->bytes, "FAILED");
+            failed++;
+            continue;
+        }
+
+        fprintf(out, "%-20s %10zu %10ld %12.1f %12.1f %12.1f %10.2f %10.1f\n",
+            res.name, res.bytes, res.ops, res.ns_median, res.ns_p99, res.ns_min,
+            res.cycles_per_byte, res.mb_per_s);
+        if (json)
+        {
+            PrintJson(json, &res, first);
+            first = false;
+        }
+    }
+
+    fprintf(out, "------------------------------------------------------------------------------------------------------\n");
+    if (json)
+    {
+        fprintf(json, "\n  ]\n}\n");
+    }
+    DataFree(&d);
+
+    return failed;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool DataInit(struct bench_data_t *d)
+{
+    bool ret;
+    uint64_t x = 88172645463325252ull;
+
+    memset(d, 0, sizeof(*d));
+    d->small_fd = -1;
+    d->large_fd = -1;
+    d->buf = malloc(BENCH_MAX_BYTES);
+    d->ctx = EVP_MD_CTX_new();
+    d->md = EVP_MD_fetch(NULL, "SHA256", NULL);
+    ret = d->buf && d->ctx && d->md && EVP_DigestInit_ex(d->ctx, d->md, NULL);
+
+    for (size_t i = 0; i < BENCH_MAX_BYTES / sizeof(x) && ret; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        memcpy(d->buf + i * sizeof(x), &x, sizeof(x));
+    }
+
+    if (ret)
+    {
+        d->small_fd = MemoryFile(d, BENCH_SMALL_FILE, d->small_path);
+        d->large_fd = MemoryFile(d, BENCH_LARGE_FILE, d->large_path);
+        ret = d->small_fd >= 0 && d->large_fd >= 0;
+    }
+
+    return ret;
+}
+
+static void DataFree(struct bench_data_t *d)
+{
+    if (d->small_fd >= 0)
+    {
+        close(d->small_fd);
+    }
+    if (d->large_fd >= 0)
+    {
+        close(d->large_fd);
+    }
+    EVP_MD_free(d->md);
+    EVP_MD_CTX_free(d->ctx);
+    free(d->buf);
+    memset(d, 0, sizeof(*d));
+}
+
+static int MemoryFile(struct bench_data_t *d, size_t size, char *path)
+{
+    int fd = memfd_create("merkle-bench", MFD_CLOEXEC);
+
+    if (fd >= 0 && write(fd, d->buf, size) != (ssize_t)size)
+    {
+        close(fd);
+        fd = -1;
+    }
+    if (fd >= 0)
+    {
+        /* opened again by HashFile() on every operation, as a block file */
+        snprintf(path, 64, "/proc/self/fd/%d", fd);
+    }
+    else
+    {
+        perror("MemoryFile");
+    }
+
+    return fd;
+}
+
+static bool Measure(struct bench_data_t *d, const struct bench_entry_t *e,
+                    const struct bench_options_t *opt, struct bench_result_t *res)
+{
+    double *ns = malloc(2 * (size_t)opt->runs * sizeof(double));
+    double *cycles = ns ? ns + opt->runs : NULL;
+    double target = opt->run_us * 1e3;
+    double run_ns = 0, run_cycles = 0;
+    long ops = 1;
+    bool ret = ns != NULL;
+
+    /* the number of operations that fills one run */
+    while (ret && (ret = TimeRun(d, e, ops, &run_ns, &run_cycles)) && run_ns < target / 10)
+    {
+        ops *= 2;
+    }
+    if (ret && run_ns > 0)
+    {
+        ops = (long)(ops * target / run_ns);
+        ops = ops > 0 ? ops : 1;
+    }
+
+    for (int r = 0; r < opt->warmup && ret; r++)
+    {
+        ret = TimeRun(d, e, ops, &run_ns, &run_cycles);
+    }
+    for (int r = 0; r < opt->runs && ret; r++)
+    {
+        ret = TimeRun(d, e, ops, &ns[r], &cycles[r]);
+        ns[r] /= ops;
+        cycles[r] /= ops;
+    }
+
+    if (ret)
+    {
+        qsort(ns, opt->runs, sizeof(double), CompareDoubles);
+        qsort(cycles, opt->runs, sizeof(double), CompareDoubles);
+        int p99 = (int)(0.99 * opt->runs + 0.999999) - 1;
+
+        res->name = e->name;
+        res->bytes = e->bytes;
+        res->ops = ops;
+        res->runs = opt->runs;
+        res->ns_median = ns[opt->runs / 2];
+        res->ns_p99 = ns[p99 > 0 ? p99 : 0];
+        res->ns_min = ns[0];
+        res->cycles_per_byte = cycles[opt->runs / 2] / e->bytes;
+        res->mb_per_s = res->ns_median > 0 ? e->bytes / res->ns_median * 1e3 : 0;
+    }
+    free(ns);
+
+    return ret;
+}
+
+static bool TimeRun(struct bench_data_t *d, const struct bench_entry_t *e, long ops,
+                    double *ns, double *cycles)
+{
+    struct timespec start, end;
+    unsigned long long c0, c1;
+    bool ret;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    c0 = Cycles();
+    ret = e->run(d, e->bytes, ops);
+    c1 = Cycles();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    *cycles = (double)(c1 - c0);
+
+    return ret;
+}
+
+static unsigned long long Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void PrintJson(FILE *json, const struct bench_result_t *res, bool first)
+{
+    fprintf(json, "%s\n    { \"name\": \"%s\", \"bytes\": %zu, \"ops_per_run\": %ld, \"runs\": %d,"
+                  " \"ns_per_op\": { \"median\": %.2f, \"p99\": %.2f, \"min\": %.2f },"
+                  " \"cycles_per_byte\": %.3f, \"mb_per_s\": %.2f }",
+            first ? "" : ",", res->name, res->bytes, res->ops, res->runs,
+            res->ns_median, res->ns_p99, res->ns_min, res->cycles_per_byte, res->mb_per_s);
+}
+
+static bool KernelTwoHashes(struct bench_data_t *d, size_t bytes, long ops)
+{
+    bool ret = true;
+
+    /* a new context per call (HashTwoHashes()), the node tree build keeps one */
+    for (long i = 0; i < ops && ret; i++)
+    {
+        ret = HashTwoHashes(d->buf, d->buf + SHA256_DIGEST_LENGTH, d->out);
+    }
+
+    return ret;
+}
+
+static bool KernelTwoHashesCtx(struct bench_data_t *d, size_t bytes, long ops)
+{
+    bool ret = true;
+
+    for (long i = 0; i < ops && ret; i++)
+    {
+        ret = HashTwoHashesCtx(d->ctx, d->buf, d->buf + SHA256_DIGEST_LENGTH, d->out);
+    }
+
+    return ret;
+}
+
+static bool KernelTwoHashesDirect(struct bench_data_t *d, size_t bytes, long ops)
+{
+    for (long i = 0; i < ops; i++)
+    {
+        HashTwoHashesDirect(d->buf, d->buf + SHA256_DIGEST_LENGTH, d->out);
+    }
+
+    return true;
+}
+
+static bool KernelLevel(struct bench_data_t *d, size_t bytes, long ops)
+{
+    bool ret = true;
+
+    for (long i = 0; i < ops && ret; i++)
+    {
+        ret = HashLevel(d->buf, BENCH_LEVEL_PARENTS, 2, d->out);
+    }
+
+    return ret;
+}
+
+static bool KernelFile(struct bench_data_t *d, size_t bytes, long ops)
+{
+    const char *path = bytes == BENCH_SMALL_FILE ? d->small_path : d->large_path;
+    bool ret = true;
+
+    for (long i = 0; i < ops && ret; i++)
+    {
+        ret = HashFile(path, d->out);
+    }
+
+    return ret;
+}
+
+static bool KernelFileCtx(struct bench_data_t *d, size_t bytes, long ops)
+{
+    const char *path = bytes == BENCH_SMALL_FILE ? d->small_path : d->large_path;
+    bool ret = true;
+
+    for (long i = 0; i < ops && ret; i++)
+    {
+        ret = HashFileCtx(d->ctx, path, d->out);
+    }
+
+    return ret;
+}
+
+static bool KernelFileDirect(struct bench_data_t *d, size_t bytes, long ops)
+{
+    const char *path = bytes == BENCH_SMALL_FILE ? d->small_path : d->large_path;
+    bool ret = true;
+
+    for (long i = 0; i < ops && ret; i++)
+    {
+        ret = HashFileDirect(path, d->out);
+    }
+
+    return ret;
+}
+
+static bool KernelEvpImplicit(struct bench_data_t *d, size_t bytes, long ops)
+{
+    bool ret = true;
+
+    /* EVP_sha256() looks the implementation up at every init */
+    for (long i = 0; i < ops && ret; i++)
+    {
+        ret = EVP_DigestInit_ex(d->ctx, EVP_sha256(), NULL) &&
+              EVP_DigestUpdate(d->ctx, d->buf, bytes) &&
+              EVP_DigestFinal_ex(d->ctx, d->out, NULL);
+    }
+
+    return ret;
+}
+
+static bool KernelEvpFetched(struct bench_data_t *d, size_t bytes, long ops)
+{
+    bool ret = true;
+
+    for (long i = 0; i < ops && ret; i++)
+    {
+        ret = EVP_DigestInit_ex(d->ctx, d->md, NULL) &&
+              EVP_DigestUpdate(d->ctx, d->buf, bytes) &&
+              EVP_DigestFinal_ex(d->ctx, d->out, NULL);
+    }
+
+    return ret;
+}
+
+static bool KernelEvpOneShot(struct bench_data_t *d, size_t bytes, long ops)
+{
+    bool ret = true;
+
+    for (long i = 0; i < ops && ret; i++)
+    {
+        ret = EVP_Digest(d->buf, bytes, d->out, NULL, d->md, NULL);
+    }
+
+    return ret;
+}
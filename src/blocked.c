@@ -0,0 +1,220 @@
+/**
+ * @file blocked.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Subtree-blocked layout of the tree hashes for proof-heavy workloads
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/blocked.h"
+#include "../inc/config.h"              /* placement of the blocks */
+#include "../inc/mem.h"                 /* allocation accounting */
+
+#include <stdio.h>                      /* fprintf */
+#include <string.h>                     /* memcpy, memset */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Locates a node below the root in the blocks.
+ *
+ * @param bl Blocked tree.
+ * @param level Level of the node, below the root.
+ * @param idx Index of the node in its level.
+ * @param run Receives the number of nodes of the same level stored
+ *            contiguously from this one (up to the end of its block row).
+ * @return Index of the node in bl->hashes.
+ */
+static size_t BlockedIndex(const struct blocked_levels_t *bl, int level, long idx, long *run);
+
+/**
+ * @brief level_read_t of a blocked tree.
+ */
+static bool BlockedRead(void *ctx, int level, long first, int count, unsigned char *out);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool BlockedFromLevels(const struct merkle_levels_t *lv, int height, struct blocked_levels_t *bl)
+{
+    bool ret = lv->n_levels > 0 && height >= 0;
+
+    memset(bl, 0, sizeof(*bl));
+    if (ret)
+    {
+        bl->n_leaves = lv->n_leaves;
+        bl->n_levels = lv->n_levels;
+        bl->arity = lv->arity;
+        bl->padding = lv->padding;
+        bl->height = height ? height : BLOCKED_DEFAULT_HEIGHT;
+        memcpy(bl->level_size, lv->level_size, lv->n_levels * sizeof(long));
+        memcpy(bl->root, LevelsRoot(lv), SHA256_DIGEST_LENGTH);
+
+        /* bands from the leaves up, the last one ends below the root */
+        for (int low = 0; low < lv->n_levels - 1; low += bl->height)
+        {
+            int b = bl->n_bands++;
+            int top = low + bl->height < lv->n_levels - 1 ? low + bl->height : lv->n_levels - 1;
+            long width = 1;
+
+            bl->band_top[b] = top;
+            bl->band_offset[b] = bl->n_nodes;
+            /* block rows from the children of the owner down */
+            for (int l = top - 1; l >= low; l--)
+            {
+                width *= lv->arity;
+                bl->level_band[l] = b;
+                bl->level_above[l] = bl->block_nodes[b];
+                bl->level_width[l] = width;
+                bl->level_shift[l] = (width & (width - 1)) ? -1 : __builtin_ctzl(width);
+                bl->block_nodes[b] += width;
+            }
+            bl->n_nodes += (size_t)lv->level_size[top] * bl->block_nodes[b];
+        }
+
+        /* slots of missing descendants stay zero, so do fresh mappings */
+        if (bl->n_nodes * SHA256_DIGEST_LENGTH >= PLACEMENT_HUGE_PAGE)
+        {
+            bl->hashes = PlacementAlloc(bl->n_nodes * SHA256_DIGEST_LENGTH, merkle_config.huge_pages,
+                                        &bl->map_size);
+            if (bl->hashes)
+            {
+                MemTrack(MEM_LEVELS, bl->map_size);
+            }
+        }
+        else
+        {
+            bl->hashes = MemCalloc(MEM_LEVELS, bl->n_nodes ? bl->n_nodes : 1, SHA256_DIGEST_LENGTH);
+        }
+        ret = bl->hashes != NULL;
+    }
+
+    for (int l = 0; l < lv->n_levels - 1 && ret; l++)
+    {
+        for (long i = 0; i < lv->level_size[l]; )
+        {
+            long run;
+            size_t at = BlockedIndex(bl, l, i, &run);
+
+            if (run > lv->level_size[l] - i)
+            {
+                run = lv->level_size[l] - i;
+            }
+            memcpy(bl->hashes + at * SHA256_DIGEST_LENGTH, LEVEL_HASH(lv, l, i),
+                   (size_t)run * SHA256_DIGEST_LENGTH);
+            i += run;
+        }
+    }
+
+    if (!ret)
+    {
+        fprintf(stderr, "BlockedFromLevels: invalid parameters or allocation failure\n");
+        BlockedFree(bl);
+    }
+
+    return ret;
+}
+
+void BlockedSource(const struct blocked_levels_t *bl, struct level_source_t *src)
+{
+    *src = (struct level_source_t){
+        .n_leaves = bl->n_leaves,
+        .n_levels = bl->n_levels,
+        .arity = bl->arity,
+        .padding = bl->padding,
+        .level_size = bl->level_size,
+        .read = BlockedRead,
+        .ctx = (void *)bl,
+    };
+}
+
+void BlockedFree(struct blocked_levels_t *bl)
+{
+    if (bl->map_size)
+    {
+        PlacementFree(bl->hashes, bl->map_size);
+        MemUntrack(MEM_LEVELS, bl->map_size);
+    }
+    else
+    {
+        MemFree(MEM_LEVELS, bl->hashes, (bl->n_nodes ? bl->n_nodes : 1) * SHA256_DIGEST_LENGTH);
+    }
+    memset(bl, 0, sizeof(*bl));
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static size_t BlockedIndex(const struct blocked_levels_t *bl, int level, long idx, long *run)
+{
+    int b = bl->level_band[level];
+    long width = bl->level_width[level];
+    /* power-of-two arities: no division on the proof path */
+    long owner = bl->level_shift[level] >= 0 ? idx >> bl->level_shift[level] : idx / width;
+    long pos = idx - owner * width;
+
+    *run = width - pos;
+
+    return bl->band_offset[b] + (size_t)owner * bl->block_nodes[b] + bl->level_above[level] + pos;
+}
+
+static bool BlockedRead(void *ctx, int level, long first, int count, unsigned char *out)
+{
+    const struct blocked_levels_t *bl = ctx;
+    bool ret = level >= 0 && level < bl->n_levels && first >= 0 &&
+               first + count <= bl->level_size[level];
+
+    if (ret && level == bl->n_levels - 1)
+    {
+        memcpy(out, bl->root, SHA256_DIGEST_LENGTH);
+    }
+    else
+    {
+        /* a sibling group never crosses a block: one copy per group */
+        while (ret && count > 0)
+        {
+            long run;
+            size_t at = BlockedIndex(bl, level, first, &run);
+
+            if (run > count)
+            {
+                run = count;
+            }
+            memcpy(out, bl->hashes + at * SHA256_DIGEST_LENGTH, (size_t)run * SHA256_DIGEST_LENGTH);
+            out += (size_t)run * SHA256_DIGEST_LENGTH;
+            first += run;
+            count -= (int)run;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,453 @@
+/**
+ * @file config.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Run-time configuration of the tree construction
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/config.h"
+#include "../inc/parallel.h"            /* PARALLEL_MAX_THREADS */
+
+#include <errno.h>                      /* errno */
+#include <stdio.h>                      /* fprintf, rename */
+#include <stdlib.h>                     /* getenv, strtol */
+#include <string.h>                     /* strcmp */
+#include <unistd.h>                     /* sysconf */
+#include <sys/stat.h>                   /* mkdir */
+#include <sys/utsname.h>                /* uname */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+struct merkle_config_t merkle_config = {
+    .arity = CONFIG_DEFAULT_ARITY,
+    .padding = PADDING_DUPLICATE,
+    .ram_budget_kb = CONFIG_DEFAULT_BUDGET_KB,
+    .huge_pages = PLACEMENT_THP,
+    .pin_threads = 1,
+    .read_buffer = CONFIG_DEFAULT_READ_BUFFER,
+    .backend = HASH_BACKEND_DIRECT,
+};
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Smallest read buffer accepted */
+#define CONFIG_MIN_READ_BUFFER 512
+
+/* Longest line and path of a profile */
+#define PROFILE_LINE_LEN 256
+#define PROFILE_PATH_LEN 512
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* What a profile is only valid for */
+struct host_id_t {
+    char name[65];                      /* utsname.nodename */
+    char cpu[128];                      /* model name of /proc/cpuinfo, may be empty */
+    long cpus;                          /* online CPUs */
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Reads an integer environment variable within a range.
+ *
+ * @param name Variable name.
+ * @param min Smallest accepted value.
+ * @param max Largest accepted value.
+ * @param value Updated only when the variable is set and valid.
+ * @retval true  Variable unset or valid.
+ * @retval false Variable set to an invalid value.
+ */
+static bool ReadEnvInt(const char *name, int min, int max, int *value);
+
+/**
+ * @brief Reads the padding mode environment variable.
+ *
+ * @param value Updated only when the variable is "duplicate" or "promote".
+ * @retval true  Variable unset or valid.
+ * @retval false Variable set to an unknown mode.
+ */
+static bool ReadEnvPadding(enum merkle_padding_t *value);
+
+/**
+ * @brief Reads the huge page mode environment variable.
+ *
+ * @param value Updated only when the variable is "plain", "thp" or "hugetlb".
+ * @retval true  Variable unset or valid.
+ * @retval false Variable set to an unknown mode.
+ */
+static bool ReadEnvHugePages(enum placement_huge_t *value);
+
+/**
+ * @brief Reads the hash backend environment variable.
+ *
+ * @param value Updated only when the variable names a backend.
+ * @retval true  Variable unset or valid.
+ * @retval false Variable set to an unknown backend.
+ */
+static bool ReadEnvBackend(enum hash_backend_t *value);
+
+/**
+ * @brief Parses a hash backend name.
+ *
+ * @retval true  Known name, stored in value.
+ * @retval false Unknown name.
+ */
+static bool ParseBackend(const char *str, enum hash_backend_t *value);
+
+/**
+ * @brief Identifies the host: name, CPU model and online CPUs.
+ */
+static void HostIdentify(struct host_id_t *id);
+
+/**
+ * @brief Creates the missing parent directories of a file.
+ *
+ * @retval true  The directories exist.
+ * @retval false A directory could not be created.
+ */
+static bool MakeParents(const char *path);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* Names of the backends in MERKLE_BACKEND and the profiles */
+static const char *backend_names[HASH_BACKENDS] = { "ctx", "fetched", "oneshot", "direct" };
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool ConfigLoadEnv(void)
+{
+    bool ret = true;
+
+    /* the measured settings first, the environment overrides them */
+    ConfigLoadProfile(NULL);
+
+    ret = ReadEnvInt(CONFIG_ENV_ARITY, 2, CONFIG_MAX_ARITY, &merkle_config.arity) && ret;
+    ret = ReadEnvPadding(&merkle_config.padding) && ret;
+    ret = ReadEnvInt(CONFIG_ENV_BUDGET, 0, 1 << 30, &merkle_config.ram_budget_kb) && ret;
+    ret = ReadEnvHugePages(&merkle_config.huge_pages) && ret;
+    ret = ReadEnvInt(CONFIG_ENV_PIN, 0, 1, &merkle_config.pin_threads) && ret;
+    ret = ReadEnvInt(CONFIG_ENV_THREADS, 0, PARALLEL_MAX_THREADS, &merkle_config.threads) && ret;
+    ret = ReadEnvInt(CONFIG_ENV_READ, CONFIG_MIN_READ_BUFFER, CONFIG_MAX_READ_BUFFER,
+                     &merkle_config.read_buffer) && ret;
+    ret = ReadEnvBackend(&merkle_config.backend) && ret;
+
+    return ret;
+}
+
+bool ConfigProfilePath(char *path, size_t size)
+{
+    bool ret = false;
+    const char *env = getenv(CONFIG_ENV_PROFILE);
+    const char *cache = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    struct utsname host;
+    int len = -1;
+
+    if (env && *env)
+    {
+        len = strcmp(env, CONFIG_PROFILE_OFF) != 0 ? snprintf(path, size, "%s", env) : -1;
+    }
+    else if (uname(&host) == 0 && cache && *cache)
+    {
+        len = snprintf(path, size, "%s/" CONFIG_PROFILE_DIR "/%s" CONFIG_PROFILE_SUFFIX,
+                       cache, host.nodename);
+    }
+    else if (uname(&host) == 0 && home && *home)
+    {
+        len = snprintf(path, size, "%s/.cache/" CONFIG_PROFILE_DIR "/%s" CONFIG_PROFILE_SUFFIX,
+                       home, host.nodename);
+    }
+    ret = len > 0 && (size_t)len < size;
+
+    return ret;
+}
+
+bool ConfigLoadProfile(const char *path)
+{
+    bool ret = false;
+    char filename[PROFILE_PATH_LEN];
+    char line[PROFILE_LINE_LEN];
+    struct host_id_t host;
+    struct host_id_t seen = { .cpus = -1 };
+    struct merkle_config_t loaded = merkle_config;
+    int fields = 0;
+    bool valid = true;
+    FILE *fp = NULL;
+
+    if (!path && ConfigProfilePath(filename, sizeof(filename)))
+    {
+        path = filename;
+    }
+    fp = path ? fopen(path, "r") : NULL;
+    if (fp)
+    {
+        HostIdentify(&host);
+        while (fgets(line, sizeof(line), fp))
+        {
+            char *value = strchr(line, '=');
+            char *end = NULL;
+
+            line[strcspn(line, "\n")] = '\0';
+            if (value)
+            {
+                *value++ = '\0';
+            }
+            if (!value || line[0] == '#')
+            {
+                /* comment */
+            }
+            else if (strcmp(line, "host") == 0)
+            {
+                snprintf(seen.name, sizeof(seen.name), "%s", value);
+            }
+            else if (strcmp(line, "cpu") == 0)
+            {
+                snprintf(seen.cpu, sizeof(seen.cpu), "%s", value);
+            }
+            else if (strcmp(line, "cpus") == 0)
+            {
+                seen.cpus = strtol(value, &end, 10);
+            }
+            else if (strcmp(line, "threads") == 0)
+            {
+                loaded.threads = (int)strtol(value, &end, 10);
+                valid = valid && *end == '\0' && loaded.threads >= 0 &&
+                        loaded.threads <= PARALLEL_MAX_THREADS;
+                fields++;
+            }
+            else if (strcmp(line, "read_buffer") == 0)
+            {
+                loaded.read_buffer = (int)strtol(value, &end, 10);
+                valid = valid && *end == '\0' && loaded.read_buffer >= CONFIG_MIN_READ_BUFFER &&
+                        loaded.read_buffer <= CONFIG_MAX_READ_BUFFER;
+                fields++;
+            }
+            else if (strcmp(line, "backend") == 0)
+            {
+                valid = ParseBackend(value, &loaded.backend) && valid;
+                fields++;
+            }
+        }
+        fclose(fp);
+
+        ret = valid && fields == 3 && strcmp(seen.name, host.name) == 0 &&
+              strcmp(seen.cpu, host.cpu) == 0 && seen.cpus == host.cpus;
+        if (ret)
+        {
+            merkle_config = loaded;
+        }
+        else
+        {
+            fprintf(stderr, "ConfigLoadProfile: ignoring %s (malformed, or measured on "
+                            "another host: run merkleTree_tune again)\n", path);
+        }
+    }
+
+    return ret;
+}
+
+bool ConfigSaveProfile(const char *path)
+{
+    bool ret = false;
+    char filename[PROFILE_PATH_LEN];
+    char tmp[PROFILE_PATH_LEN + 8];
+    struct host_id_t host;
+
+    if (!path && ConfigProfilePath(filename, sizeof(filename)))
+    {
+        path = filename;
+    }
+    if (path && MakeParents(path) &&
+        (size_t)snprintf(tmp, sizeof(tmp), "%s.tmp", path) < sizeof(tmp))
+    {
+        FILE *fp = fopen(tmp, "w");
+
+        HostIdentify(&host);
+        ret = fp && fprintf(fp, "# merkleTree calibration profile\n"
+                                "host=%s\ncpu=%s\ncpus=%ld\n"
+                                "threads=%d\nread_buffer=%d\nbackend=%s\n",
+                            host.name, host.cpu, host.cpus, merkle_config.threads,
+                            merkle_config.read_buffer,
+                            ConfigBackendName(merkle_config.backend)) > 0;
+        ret = fp && fclose(fp) == 0 && ret;
+        /* readers see the old profile or the new one, never a part */
+        ret = ret && rename(tmp, path) == 0;
+    }
+    if (!ret)
+    {
+        fprintf(stderr, "ConfigSaveProfile: unable to write %s: %s\n",
+                path ? path : "the profile (no cache directory)", strerror(errno));
+    }
+
+    return ret;
+}
+
+const char *ConfigBackendName(enum hash_backend_t backend)
+{
+    return backend < HASH_BACKENDS ? backend_names[backend] : "unknown";
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool ReadEnvInt(const char *name, int min, int max, int *value)
+{
+    bool ret = true;
+    const char *str = getenv(name);
+
+    if (str && *str)
+    {
+        char *end = NULL;
+        long v = strtol(str, &end, 10);
+
+        ret = *end == '\0' && v >= min && v <= max;
+        if (ret)
+        {
+            *value = (int)v;
+        }
+        else
+        {
+            fprintf(stderr, "ConfigLoadEnv: ignoring %s=%s (expected %d..%d)\n",
+                    name, str, min, max);
+        }
+    }
+
+    return ret;
+}
+
+static bool ReadEnvPadding(enum merkle_padding_t *value)
+{
+    bool ret = true;
+    const char *str = getenv(CONFIG_ENV_PADDING);
+
+    if (str && strcmp(str, "duplicate") == 0)
+    {
+        *value = PADDING_DUPLICATE;
+    }
+    else if (str && strcmp(str, "promote") == 0)
+    {
+        *value = PADDING_PROMOTE;
+    }
+    else if (str && *str)
+    {
+        fprintf(stderr, "ConfigLoadEnv: ignoring %s=%s (expected duplicate or promote)\n",
+                CONFIG_ENV_PADDING, str);
+        ret = false;
+    }
+
+    return ret;
+}
+
+static bool ReadEnvHugePages(enum placement_huge_t *value)
+{
+    bool ret = false;
+    const char *str = getenv(CONFIG_ENV_HUGE);
+
+    for (int mode = 0; mode < PLACEMENT_MODES && str && !ret; mode++)
+    {
+        if (strcmp(str, PlacementName(mode)) == 0)
+        {
+            *value = mode;
+            ret = true;
+        }
+    }
+    if (!ret && str && *str)
+    {
+        fprintf(stderr, "ConfigLoadEnv: ignoring %s=%s (expected plain, thp or hugetlb)\n",
+                CONFIG_ENV_HUGE, str);
+    }
+
+    return ret || !str || !*str;
+}
+
+static bool ReadEnvBackend(enum hash_backend_t *value)
+{
+    bool ret = true;
+    const char *str = getenv(CONFIG_ENV_BACKEND);
+
+    if (str && *str && !ParseBackend(str, value))
+    {
+        fprintf(stderr, "ConfigLoadEnv: ignoring %s=%s (expected ctx, fetched, oneshot or direct)\n",
+                CONFIG_ENV_BACKEND, str);
+        ret = false;
+    }
+
+    return ret;
+}
+
+static bool ParseBackend(const char *str, enum hash_backend_t *value)
+{
+    bool ret = false;
+
+    for (int b = 0; b < HASH_BACKENDS && !ret; b++)
+    {
+        if (strcmp(str, backend_names[b]) == 0)
+        {
+            *value = (enum hash_backend_t)b;
+            ret = true;
+        }
+    }
+
+    return ret;
+}
+
+static void HostIdentify(struct host_id_t *id)
+{
+    struct utsname host;
+    char line[PROFILE_LINE_LEN];
+    FILE *fp = fopen("/proc/cpuinfo", "r");
+
+    memset(id, 0, sizeof(*id));
+    if (uname(&host) == 0)
+    {
+        snprintf(id->name, sizeof(id->name), "%s", host.nodename);
+    }
+    while (fp && !id->cpu[0] && fgets(line, sizeof(line), fp))
+    {
+        char *value = strchr(line, ':');
+
+        if (strncmp(line, "model name", 10) == 0 && value)
+        {
+            value += strspn(value + 1, " \t") + 1;
+            value[strcspn(value, "\n")] = '\0';
+            snprintf(id->cpu, sizeof(id->cpu), "%s", value);
+        }
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    id->cpus = sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+static bool MakeParents(const char *path)
+{
+    bool ret = true;
+    char dir[PROFILE_PATH_LEN];
+
+    snprintf(dir, sizeof(dir), "%s", path);
+    for (char *slash = strchr(dir + 1, '/'); slash && ret; slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        ret = mkdir(dir, 0755) == 0 || errno == EEXIST;
+        *slash = '/';
+    }
+
+    return ret;
+}
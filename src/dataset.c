@@ -0,0 +1,439 @@
+/**
+ * @file dataset.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Parallel generation of seeded synthetic leaf datasets
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/dataset.h"
+#include "../inc/merkleTree.h"          /* LEAF_FILE_FORMAT */
+#include "../inc/config.h"              /* merkle_config.threads */
+#include "../inc/parallel.h"            /* ParallelFor */
+#include "../inc/utils.h"               /* CountFilesInDirectory, NowNs, SplitMix, WriteAll */
+
+#include <dirent.h>                     /* opendir, readdir */
+#include <errno.h>                      /* errno */
+#include <fcntl.h>                      /* open */
+#include <stdio.h>                      /* snprintf, fprintf */
+#include <stdlib.h>                     /* malloc, free */
+#include <string.h>                     /* memcpy, strcmp */
+#include <unistd.h>                     /* close */
+#include <linux/magic.h>                /* TMPFS_MAGIC */
+#include <sys/mman.h>                   /* mmap */
+#include <sys/stat.h>                   /* mkdir, fstat */
+#include <sys/vfs.h>                    /* statfs */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Leaves written per task: workers claim them dynamically, so that huge
+ * leaves do not leave the other workers idle */
+#define DATASET_CHUNK 256
+
+/* First bytes of a packed container */
+#define DATASET_PACK_MAGIC "MRKLPACK"
+
+/* First word of a manifest, with the version of the contents */
+#define DATASET_MANIFEST_TAG "merkle-dataset 1"
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Header of a packed container, followed by files + 1 uint64_t offsets */
+struct dataset_pack_header_t {
+    char magic[8];
+    uint64_t files;
+};
+
+/* Generation shared by the writers */
+struct dataset_job_t {
+    const char *folder;
+    const struct dataset_spec_t *spec;
+    const uint64_t *offsets;            /* offset of every leaf in the container */
+    int pack_fd;                        /* -1 without container */
+    unsigned char *buffer[PARALLEL_MAX_THREADS]; /* one per worker */
+    size_t buffer_size;                 /* largest leaf */
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Writes the path of the file next to a folder with the given suffix.
+ *
+ * data/transactions_4096/ gives data/transactions_4096<suffix>.
+ *
+ * @retval true  Success.
+ * @retval false Path too long.
+ */
+static bool SiblingPath(const char *folder, const char *suffix, char *path, size_t size);
+
+/**
+ * @brief Writes the manifest line of a specification, without the byte count.
+ */
+static void ManifestLine(const struct dataset_spec_t *spec, char *line, size_t size);
+
+/**
+ * @brief Tells if the dataset in place matches a specification.
+ *
+ * @param bytes Receives the size of the leaves recorded in the manifest.
+ */
+static bool DatasetReusable(const char *folder, const struct dataset_spec_t *spec,
+                            long long *bytes);
+
+/**
+ * @brief Writes one chunk of leaves (parallel_task_t).
+ */
+static bool DatasetChunkTask(void *ctx, int task, int worker);
+
+/**
+ * @brief Fills a leaf with the pseudo-random stream of the seed and its index.
+ */
+static void FillLeaf(unsigned char *buffer, size_t size, uint64_t seed, long leaf);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool DatasetGenerate(const char *folder, const struct dataset_spec_t *spec,
+                     struct dataset_stats_t *st)
+{
+    bool ret = spec->files >= 1 && spec->files <= DATASET_MAX_FILES;
+    struct dataset_stats_t stats = { .files = spec->files };
+    struct dataset_job_t job = { .folder = folder, .spec = spec, .pack_fd = -1 };
+    uint64_t *offsets = NULL;
+    char manifest[256];
+    char pack[256];
+    char line[128];
+    double start = NowNs() / 1e6;
+    int n_threads = spec->threads > 0 ? spec->threads : merkle_config.threads;
+
+    n_threads = n_threads > 0 ? n_threads : ParallelDefaultThreads();
+    n_threads = n_threads < PARALLEL_MAX_THREADS ? n_threads : PARALLEL_MAX_THREADS;
+    ret = ret && SiblingPath(folder, DATASET_MANIFEST_SUFFIX, manifest, sizeof(manifest))
+              && SiblingPath(folder, DATASET_PACK_SUFFIX, pack, sizeof(pack));
+    if (!ret)
+    {
+        fprintf(stderr, "DatasetGenerate: invalid dataset %s (%ld files)\n", folder, spec->files);
+    }
+    else if (DatasetReusable(folder, spec, &stats.bytes))
+    {
+        stats.reused = true;
+    }
+    else
+    {
+        /* an interrupted or different dataset: start from an empty folder */
+        ret = DatasetRemove(folder);
+        if (ret && mkdir(folder, 0777) != 0)
+        {
+            perror("DatasetGenerate: mkdir");
+            ret = false;
+        }
+
+        /* the offsets give the container layout and the largest leaf */
+        offsets = ret ? malloc((spec->files + 1) * sizeof(*offsets)) : NULL;
+        ret = ret && offsets;
+        if (offsets)
+        {
+            offsets[0] = sizeof(struct dataset_pack_header_t) + (spec->files + 1) * sizeof(*offsets);
+            for (long i = 0; i < spec->files; i++)
+            {
+                size_t size = (size_t)SweepLeafSize(&spec->size, spec->seed, i);
+
+                offsets[i + 1] = offsets[i] + size;
+                job.buffer_size = size > job.buffer_size ? size : job.buffer_size;
+            }
+            stats.bytes = (long long)(offsets[spec->files] - offsets[0]);
+            job.offsets = offsets;
+        }
+
+        if (ret && spec->pack)
+        {
+            struct dataset_pack_header_t header = { .files = (uint64_t)spec->files };
+
+            memcpy(header.magic, DATASET_PACK_MAGIC, sizeof(header.magic));
+            job.pack_fd = open(pack, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            ret = job.pack_fd >= 0
+               && WriteAll(job.pack_fd, &header, sizeof(header), 0, NULL)
+               && WriteAll(job.pack_fd, offsets, (spec->files + 1) * sizeof(*offsets),
+                           sizeof(header), NULL);
+            if (!ret)
+            {
+                perror("DatasetGenerate: packed container");
+            }
+        }
+
+        for (int w = 0; ret && w < n_threads; w++)
+        {
+            /* at least one byte, so that empty leaves get a buffer too */
+            job.buffer[w] = malloc(job.buffer_size + 1);
+            ret = job.buffer[w] != NULL;
+        }
+
+        ret = ret && ParallelFor((int)((spec->files + DATASET_CHUNK - 1) / DATASET_CHUNK),
+                                 n_threads, DatasetChunkTask, &job, NULL);
+
+        if (job.pack_fd >= 0 && close(job.pack_fd) != 0)
+        {
+            ret = false;
+        }
+
+        /* the manifest goes last: only a complete dataset is ever reused */
+        if (ret)
+        {
+            FILE *fp = fopen(manifest, "w");
+
+            ManifestLine(spec, line, sizeof(line));
+            ret = fp && fprintf(fp, "%s bytes=%lld\n", line, stats.bytes) > 0;
+            ret = fp && fclose(fp) == 0 && ret;
+            if (!ret)
+            {
+                perror("DatasetGenerate: manifest");
+            }
+        }
+        for (int w = 0; w < n_threads; w++)
+        {
+            free(job.buffer[w]);
+        }
+        free(offsets);
+    }
+
+    stats.elapsed_ms = NowNs() / 1e6 - start;
+    stats.tmpfs = DatasetOnTmpfs(folder);
+    if (st)
+    {
+        *st = stats;
+    }
+
+    return ret;
+}
+
+bool DatasetRemove(const char *folder)
+{
+    bool ret = true;
+    char path[256];
+    DIR *dir = opendir(folder);
+
+    if (dir)
+    {
+        struct dirent *entry;
+
+        while ((entry = readdir(dir)) != NULL)
+        {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0 &&
+                unlinkat(dirfd(dir), entry->d_name, 0) != 0)
+            {
+                fprintf(stderr, "DatasetRemove: %s%s: %s\n", folder, entry->d_name, strerror(errno));
+                ret = false;
+            }
+        }
+        closedir(dir);
+        if (rmdir(folder) != 0)
+        {
+            perror("DatasetRemove: rmdir");
+            ret = false;
+        }
+    }
+    else if (errno != ENOENT)
+    {
+        perror("DatasetRemove: opendir");
+        ret = false;
+    }
+
+    if (SiblingPath(folder, DATASET_MANIFEST_SUFFIX, path, sizeof(path)))
+    {
+        ret = (unlink(path) == 0 || errno == ENOENT) && ret;
+    }
+    if (SiblingPath(folder, DATASET_PACK_SUFFIX, path, sizeof(path)))
+    {
+        ret = (unlink(path) == 0 || errno == ENOENT) && ret;
+    }
+
+    return ret;
+}
+
+bool DatasetPackOpen(const char *folder, struct dataset_pack_t *pack)
+{
+    bool ret = false;
+    char path[256];
+    struct stat sb;
+    int fd = SiblingPath(folder, DATASET_PACK_SUFFIX, path, sizeof(path))
+           ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+
+    memset(pack, 0, sizeof(*pack));
+    if (fd >= 0 && fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(struct dataset_pack_header_t))
+    {
+        void *map = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map != MAP_FAILED)
+        {
+            const struct dataset_pack_header_t *header = map;
+            size_t table = sizeof(*header) + (header->files + 1) * sizeof(uint64_t);
+
+            pack->map = map;
+            pack->map_size = (size_t)sb.st_size;
+            pack->files = (long)header->files;
+            pack->offsets = (const uint64_t *)(pack->map + sizeof(*header));
+            ret = memcmp(header->magic, DATASET_PACK_MAGIC, sizeof(header->magic)) == 0
+               && header->files <= DATASET_MAX_FILES && table <= pack->map_size
+               && pack->offsets[0] == table && pack->offsets[pack->files] == pack->map_size;
+            if (!ret)
+            {
+                fprintf(stderr, "DatasetPackOpen: malformed container %s\n", path);
+                DatasetPackClose(pack);
+            }
+        }
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    return ret;
+}
+
+const unsigned char *DatasetPackLeaf(const struct dataset_pack_t *pack, long i, size_t *size)
+{
+    *size = (size_t)(pack->offsets[i + 1] - pack->offsets[i]);
+
+    return pack->map + pack->offsets[i];
+}
+
+void DatasetPackClose(struct dataset_pack_t *pack)
+{
+    if (pack->map)
+    {
+        munmap((void *)pack->map, pack->map_size);
+    }
+    memset(pack, 0, sizeof(*pack));
+}
+
+bool DatasetOnTmpfs(const char *path)
+{
+    struct statfs sfs;
+
+    return statfs(path, &sfs) == 0 && sfs.f_type == TMPFS_MAGIC;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool SiblingPath(const char *folder, const char *suffix, char *path, size_t size)
+{
+    size_t len = strlen(folder);
+
+    while (len > 1 && folder[len - 1] == '/')
+    {
+        len--;
+    }
+    int written = snprintf(path, size, "%.*s%s", (int)len, folder, suffix);
+
+    return written > 0 && (size_t)written < size;
+}
+
+static void ManifestLine(const struct dataset_spec_t *spec, char *line, size_t size)
+{
+    snprintf(line, size, DATASET_MANIFEST_TAG " files=%ld size=%s seed=%llx pack=%d",
+             spec->files, spec->size.label, (unsigned long long)spec->seed, spec->pack);
+}
+
+static bool DatasetReusable(const char *folder, const struct dataset_spec_t *spec,
+                            long long *bytes)
+{
+    bool ret = false;
+    char manifest[256];
+    char expected[128];
+    char line[256];
+    FILE *fp = SiblingPath(folder, DATASET_MANIFEST_SUFFIX, manifest, sizeof(manifest))
+             ? fopen(manifest, "r") : NULL;
+
+    if (fp)
+    {
+        size_t len;
+
+        ManifestLine(spec, expected, sizeof(expected));
+        len = strlen(expected);
+        ret = fgets(line, sizeof(line), fp) && strncmp(line, expected, len) == 0
+           && sscanf(line + len, " bytes=%lld", bytes) == 1
+           && CountFilesInDirectory(folder) == spec->files;
+        fclose(fp);
+    }
+    if (ret && spec->pack)
+    {
+        struct dataset_pack_t pack;
+
+        ret = DatasetPackOpen(folder, &pack) && pack.files == spec->files
+           && (long long)(pack.offsets[pack.files] - pack.offsets[0]) == *bytes;
+        DatasetPackClose(&pack);
+    }
+
+    return ret;
+}
+
+static bool DatasetChunkTask(void *ctx, int task, int worker)
+{
+    struct dataset_job_t *job = ctx;
+    const struct dataset_spec_t *spec = job->spec;
+    unsigned char *buffer = job->buffer[worker];
+    bool ret = true;
+    char filename[256];
+    long first = (long)task * DATASET_CHUNK;
+    long last = first + DATASET_CHUNK < spec->files ? first + DATASET_CHUNK : spec->files;
+
+    for (long i = first; ret && i < last; i++)
+    {
+        size_t size = (size_t)(job->offsets[i + 1] - job->offsets[i]);
+
+        FillLeaf(buffer, size, spec->seed, i);
+        snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, job->folder, (int)i);
+        int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        ret = fd >= 0 && WriteAll(fd, buffer, size, -1, NULL);
+        if (fd >= 0)
+        {
+            ret = close(fd) == 0 && ret;
+        }
+        if (ret && job->pack_fd >= 0)
+        {
+            ret = WriteAll(job->pack_fd, buffer, size, (off_t)job->offsets[i], NULL);
+        }
+        if (!ret)
+        {
+            fprintf(stderr, "DatasetGenerate: %s: %s\n", filename, strerror(errno));
+        }
+    }
+
+    return ret;
+}
+
+static void FillLeaf(unsigned char *buffer, size_t size, uint64_t seed, long leaf)
+{
+    /* the sizes use the even and odd draws of the seed, the contents its complement */
+    uint64_t base = SplitMix(~seed ^ (uint64_t)leaf);
+
+    for (size_t i = 0; i < size; i += sizeof(uint64_t))
+    {
+        uint64_t word = SplitMix(base + i);
+        size_t n = size - i < sizeof(word) ? size - i : sizeof(word);
+
+        memcpy(buffer + i, &word, n);
+    }
+}
+
@@ -0,0 +1,268 @@
+/**
+ * @file diff.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Top-down comparison of two Merkle trees
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/diff.h"
+#include "../inc/mem.h"                 /* MemRealloc, MemFree, MemUntrack */
+
+#include <limits.h>                     /* INT_MAX */
+#include <string.h>                     /* memcmp */
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>                  /* SIMD compare */
+#endif
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Hashes compared per mask */
+#define DIFF_RUN_MAX 64
+
+/* Initial capacity of a frontier */
+#define FRONTIER_MIN_CAPACITY 64
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Growable list of node indexes at one level */
+struct frontier_t {
+    int *idx;
+    int count;
+    int capacity;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Appends a node index to a frontier.
+ *
+ * @param f Frontier.
+ * @param idx Node index.
+ * @retval true  Success.
+ * @retval false Allocation failure.
+ */
+static bool FrontierPush(struct frontier_t *f, int idx);
+
+/**
+ * @brief Compares the children range [first, last] of one level.
+ *
+ * Children existing in only one tree are always different.
+ * Differing children are appended to the next frontier.
+ *
+ * @param a First tree.
+ * @param b Second tree.
+ * @param level Level of the children.
+ * @param first First child index.
+ * @param last Last child index (included).
+ * @param next Frontier receiving the differing children.
+ * @retval true  Success.
+ * @retval false Allocation failure.
+ */
+static bool DiffRange(const struct merkle_levels_t *a, const struct merkle_levels_t *b,
+                      int level, int first, int last, struct frontier_t *next);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool HashDiffers(const unsigned char *a, const unsigned char *b)
+{
+#if defined(__AVX2__)
+    __m256i x = _mm256_loadu_si256((const __m256i *)a);
+    __m256i y = _mm256_loadu_si256((const __m256i *)b);
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != -1;
+#elif defined(__SSE2__)
+    __m128i lo = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a),
+                                _mm_loadu_si128((const __m128i *)b));
+    __m128i hi = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + 16)),
+                                _mm_loadu_si128((const __m128i *)(b + 16)));
+    return _mm_movemask_epi8(_mm_and_si128(lo, hi)) != 0xFFFF;
+#else
+    return memcmp(a, b, SHA256_DIGEST_LENGTH) != 0;
+#endif
+}
+
+uint64_t HashRunDiffMask(const unsigned char *a, const unsigned char *b, int count)
+{
+    uint64_t mask = 0;
+
+    /* one equality movemask per hash, folded into the mask without a branch */
+#if defined(__AVX2__)
+    for (int i = 0; i < count; i++)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + (size_t)i * SHA256_DIGEST_LENGTH));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + (size_t)i * SHA256_DIGEST_LENGTH));
+        uint32_t eq = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        mask |= (uint64_t)(eq != 0xFFFFFFFFu) << i;
+    }
+#elif defined(__SSE2__)
+    for (int i = 0; i < count; i++)
+    {
+        const unsigned char *pa = a + (size_t)i * SHA256_DIGEST_LENGTH;
+        const unsigned char *pb = b + (size_t)i * SHA256_DIGEST_LENGTH;
+        __m128i lo = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)pa),
+                                    _mm_loadu_si128((const __m128i *)pb));
+        __m128i hi = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(pa + 16)),
+                                    _mm_loadu_si128((const __m128i *)(pb + 16)));
+        mask |= (uint64_t)(_mm_movemask_epi8(_mm_and_si128(lo, hi)) != 0xFFFF) << i;
+    }
+#else
+    for (int i = 0; i < count; i++)
+    {
+        mask |= (uint64_t)(memcmp(a + (size_t)i * SHA256_DIGEST_LENGTH,
+                                  b + (size_t)i * SHA256_DIGEST_LENGTH,
+                                  SHA256_DIGEST_LENGTH) != 0) << i;
+    }
+#endif
+
+    return mask;
+}
+
+int DiffLevels(const struct merkle_levels_t *a, const struct merkle_levels_t *b, int **changed)
+{
+    int ret = -1;
+    struct frontier_t cur = {0}, next = {0};
+    bool ok = true;
+
+    *changed = NULL;
+
+    /* the changed leaves are returned as ints */
+    if (a->n_levels > 0 && b->n_levels > 0 && a->arity == b->arity &&
+        a->padding == b->padding && a->level_size[0] <= INT_MAX && b->level_size[0] <= INT_MAX)
+    {
+        int k = a->arity;
+
+        /* Nodes at the same index cover the same leaves in both trees,
+         * start from the highest level they have in common */
+        int top = MIN(a->n_levels, b->n_levels) - 1;
+        ok = DiffRange(a, b, top, 0,
+                       MAX(a->level_size[top], b->level_size[top]) - 1, &cur);
+
+        for (int l = top - 1; l >= 0 && ok; l--)
+        {
+            next.count = 0;
+            /* coalesce consecutive parents into one children run */
+            for (int i = 0; i < cur.count && ok; )
+            {
+                int j = i;
+                while (j + 1 < cur.count && cur.idx[j + 1] == cur.idx[j] + 1)
+                {
+                    j++;
+                }
+                ok = DiffRange(a, b, l, k * cur.idx[i], k * cur.idx[j] + k - 1, &next);
+                i = j + 1;
+            }
+
+            /* swap the frontiers */
+            struct frontier_t tmp = cur;
+            cur = next;
+            next = tmp;
+        }
+
+        if (ok)
+        {
+            /* drop the padding leaves */
+            long n_leaves = MAX(a->n_leaves, b->n_leaves);
+            ret = 0;
+            while (ret < cur.count && cur.idx[ret] < n_leaves)
+            {
+                ret++;
+            }
+            if (ret > 0)
+            {
+                /* the caller's now, released with free() */
+                MemUntrack(MEM_SCRATCH, (size_t)cur.capacity * sizeof(int));
+                *changed = cur.idx;
+                cur.idx = NULL;
+            }
+        }
+    }
+
+    MemFree(MEM_SCRATCH, cur.idx, (size_t)cur.capacity * sizeof(int));
+    MemFree(MEM_SCRATCH, next.idx, (size_t)next.capacity * sizeof(int));
+
+    return ret;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool FrontierPush(struct frontier_t *f, int idx)
+{
+    bool ret = true;
+
+    if (f->count == f->capacity)
+    {
+        int capacity = MAX(FRONTIER_MIN_CAPACITY, f->capacity * 2);
+        int *grown = MemRealloc(MEM_SCRATCH, f->idx, (size_t)f->capacity * sizeof(int),
+                                (size_t)capacity * sizeof(int));
+        if (grown)
+        {
+            f->idx = grown;
+            f->capacity = capacity;
+        }
+        else
+        {
+            fprintf(stderr, "FrontierPush: allocation failed\n");
+            ret = false;
+        }
+    }
+
+    if (ret)
+    {
+        f->idx[f->count++] = idx;
+    }
+
+    return ret;
+}
+
+static bool DiffRange(const struct merkle_levels_t *a, const struct merkle_levels_t *b,
+                      int level, int first, int last, struct frontier_t *next)
+{
+    bool ret = true;
+    int common = (int)MIN(a->level_size[level], b->level_size[level]);
+
+    /* children present in both trees: compare them run by run */
+    for (int i = first; i <= MIN(last, common - 1) && ret; i += DIFF_RUN_MAX)
+    {
+        int count = MIN(DIFF_RUN_MAX, MIN(last, common - 1) - i + 1);
+        uint64_t mask = HashRunDiffMask(LEVEL_HASH(a, level, i),
+                                        LEVEL_HASH(b, level, i), count);
+        while (mask && ret)
+        {
+            ret = FrontierPush(next, i + __builtin_ctzll(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    /* children present in only one tree */
+    for (int i = MAX(first, common);
+         i <= MIN(last, MAX(a->level_size[level], b->level_size[level]) - 1) && ret; i++)
+    {
+        ret = FrontierPush(next, i);
+    }
+
+    return ret;
+}
@@ -0,0 +1,476 @@
+/**
+ * @file levelfile.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Out-of-core tree construction into level files
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levelfile.h"
+#include "../inc/merkleTree.h"
+#include "../inc/stats.h"               /* live build counters */
+#include "../inc/mem.h"                 /* MEM_SCRATCH and MEM_IO accounting */
+
+#include <fcntl.h>                      /* open */
+#include <unistd.h>                     /* pread, close, unlink */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Manifest identification */
+#define MANIFEST_MAGIC   0x464c4b4du    /* "MKLF" */
+#define MANIFEST_VERSION 2u
+
+/* Largest arity of a level writer */
+#define WRITER_MAX_ARITY 256
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* Open group of a level of a writer */
+#define WRITER_GROUP(w, lvl) \
+    ((w)->group + (size_t)(lvl) * (w)->arity * SHA256_DIGEST_LENGTH)
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Manifest header, followed by n_levels uint64_t level sizes and the root */
+struct manifest_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t n_leaves;
+    uint32_t n_levels;
+    uint32_t arity;
+    uint32_t padding;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Appends a node to its level and completes its parent if needed.
+ *
+ * @param w Writer.
+ * @param level Level of the node.
+ * @param hash Hash of the node.
+ * @retval true  Success.
+ * @retval false Too many levels, hashing or I/O error.
+ */
+static bool LevelAppend(struct level_writer_t *w, int level, const unsigned char hash[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Writes the manifest of a finished writer.
+ *
+ * @param w Writer with its root set.
+ * @retval true  Success.
+ * @retval false I/O error.
+ */
+static bool ManifestWrite(const struct level_writer_t *w);
+
+/**
+ * @brief level_read_t of a level store.
+ */
+static bool LevelStoreRead(void *ctx, int level, long first, int count, unsigned char *out);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool LevelWriterOpen(struct level_writer_t *w, const char *dir, int arity,
+                     enum merkle_padding_t padding, size_t io_buffer)
+{
+    bool ret = false;
+
+    memset(w, 0, sizeof(*w));
+    if (arity >= 2 && arity <= WRITER_MAX_ARITY && strlen(dir) < sizeof(w->dir))
+    {
+        strcpy(w->dir, dir);
+        w->arity = arity;
+        w->padding = padding;
+        w->io_buffer = io_buffer ? io_buffer : LEVEL_IO_BUFFER;
+        w->group = MemAlloc(MEM_SCRATCH, (size_t)LEVELS_MAX * arity * SHA256_DIGEST_LENGTH);
+        ret = w->group != NULL;
+    }
+
+    if (!ret)
+    {
+        fprintf(stderr, "LevelWriterOpen: invalid parameters or allocation failure\n");
+    }
+
+    return ret;
+}
+
+bool LevelWriterPush(struct level_writer_t *w, const unsigned char leaf[SHA256_DIGEST_LENGTH])
+{
+    bool ret = w->n_leaves < LEVEL_STORE_MAX_NODES && LevelAppend(w, 0, leaf);
+
+    /* counted apart: LevelWriterFinish() appends the padding to level 0 */
+    w->n_leaves += ret;
+
+    return ret;
+}
+
+bool LevelWriterFinish(struct level_writer_t *w)
+{
+    bool ret = w->n_leaves > 0;
+
+    for (int l = 0; l < LEVELS_MAX && ret; l++)
+    {
+        unsigned char *group = WRITER_GROUP(w, l);
+
+        if (w->count[l] == 1 && (l + 1 == LEVELS_MAX || w->count[l + 1] == 0))
+        {
+            /* single node on the highest level: the root */
+            memcpy(w->root, group, SHA256_DIGEST_LENGTH);
+            w->n_levels = l + 1;
+            break;
+        }
+
+        if (w->pending[l] > 0 && w->padding == PADDING_DUPLICATE)
+        {
+            /* fill the group with copies of its last node */
+            unsigned char last[SHA256_DIGEST_LENGTH];
+            memcpy(last, group + (size_t)(w->pending[l] - 1) * SHA256_DIGEST_LENGTH,
+                   SHA256_DIGEST_LENGTH);
+            while (ret && w->pending[l] > 0)
+            {
+                ret = LevelAppend(w, l, last);
+            }
+        }
+        else if (w->pending[l] > 0)
+        {
+            /* partial group hashed as is, a lone node moves up */
+            unsigned char parent[SHA256_DIGEST_LENGTH];
+            if (w->pending[l] == 1)
+            {
+                memcpy(parent, group, SHA256_DIGEST_LENGTH);
+            }
+            else
+            {
+                ret = HashChildren(group, w->pending[l], parent);
+            }
+            w->pending[l] = 0;
+            ret = ret && LevelAppend(w, l + 1, parent);
+        }
+    }
+
+    ret = ret && ManifestWrite(w);
+
+    /* close every level file, flushing the buffers */
+    for (int l = 0; l < LEVELS_MAX; l++)
+    {
+        if (w->fp[l])
+        {
+            MemUntrack(MEM_IO, w->io_buffer);
+            ret = fclose(w->fp[l]) == 0 && ret;
+        }
+        w->fp[l] = NULL;
+    }
+    MemFree(MEM_SCRATCH, w->group, (size_t)LEVELS_MAX * w->arity * SHA256_DIGEST_LENGTH);
+    w->group = NULL;
+
+    if (!ret)
+    {
+        fprintf(stderr, "LevelWriterFinish: unable to complete the level files in %s\n", w->dir);
+    }
+
+    return ret;
+}
+
+bool LevelFilesBuild(const char *folder, const char *dir, int arity,
+                     enum merkle_padding_t padding, unsigned char root[SHA256_DIGEST_LENGTH])
+{
+    struct level_writer_t w;
+    char filename[256];
+    int n_leaves = CountFilesInDirectory(folder);
+    bool ret = LevelWriterOpen(&w, dir, arity, padding, 0);
+
+    StatsBuildStart(n_leaves);
+    for (int i = 0; i < n_leaves && ret; i++)
+    {
+        unsigned char leaf[SHA256_DIGEST_LENGTH];
+
+        snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, folder, i);
+        ret = HashFile(filename, leaf) && LevelWriterPush(&w, leaf);
+    }
+
+    /* finish in any case to close the files */
+    if (w.group)
+    {
+        ret = LevelWriterFinish(&w) && ret;
+    }
+    StatsBuildEnd();
+    if (ret)
+    {
+        memcpy(root, w.root, SHA256_DIGEST_LENGTH);
+    }
+
+    return ret;
+}
+
+void LevelFilesRemove(const char *dir)
+{
+    char filename[512];
+
+    for (int l = 0; l < LEVELS_MAX; l++)
+    {
+        snprintf(filename, sizeof(filename), LEVEL_FILE_FORMAT, dir, l);
+        unlink(filename);
+    }
+    snprintf(filename, sizeof(filename), LEVEL_MANIFEST_FORMAT, dir);
+    unlink(filename);
+}
+
+bool LevelStoreOpen(struct level_store_t *s, const char *dir, size_t ram_budget)
+{
+    bool ret = false;
+    char filename[512];
+    struct manifest_header_t header;
+    FILE *fp;
+
+    memset(s, 0, sizeof(*s));
+    for (int l = 0; l < LEVELS_MAX; l++)
+    {
+        s->fd[l] = -1;
+    }
+
+    snprintf(filename, sizeof(filename), LEVEL_MANIFEST_FORMAT, dir);
+    fp = fopen(filename, "rb");
+    if (fp)
+    {
+        ret = fread(&header, sizeof(header), 1, fp) == 1 &&
+              header.magic == MANIFEST_MAGIC && header.version == MANIFEST_VERSION &&
+              header.n_levels > 0 && header.n_levels <= LEVELS_MAX &&
+              header.arity >= 2 && header.padding <= PADDING_PROMOTE &&
+              header.n_leaves > 0 && header.n_leaves <= LEVEL_STORE_MAX_NODES;
+
+        if (ret)
+        {
+            s->n_leaves = header.n_leaves;
+            s->n_levels = header.n_levels;
+            s->arity = header.arity;
+            s->padding = header.padding;
+        }
+        for (int l = 0; l < s->n_levels && ret; l++)
+        {
+            uint64_t size;
+            ret = fread(&size, sizeof(size), 1, fp) == 1 && size <= LEVEL_STORE_MAX_NODES;
+            s->level_size[l] = ret ? (long)size : 0;
+        }
+        ret = ret && fread(s->root, SHA256_DIGEST_LENGTH, 1, fp) == 1;
+        fclose(fp);
+    }
+
+    /* every level file must hold its level */
+    for (int l = 0; l < s->n_levels && ret; l++)
+    {
+        struct stat st;
+
+        snprintf(filename, sizeof(filename), LEVEL_FILE_FORMAT, dir, l);
+        s->fd[l] = open(filename, O_RDONLY);
+        ret = s->fd[l] >= 0 && fstat(s->fd[l], &st) == 0 &&
+              st.st_size == (off_t)s->level_size[l] * SHA256_DIGEST_LENGTH;
+    }
+
+    if (ret)
+    {
+        s->n_pages = (int)(ram_budget / LEVEL_PAGE_SIZE);
+        if (s->n_pages > 0)
+        {
+            s->page_tag = MemAlloc(MEM_IO, s->n_pages * sizeof(long));
+            s->cache = MemAlloc(MEM_IO, (size_t)s->n_pages * LEVEL_PAGE_SIZE);
+            ret = s->page_tag && s->cache;
+            for (int i = 0; i < s->n_pages && ret; i++)
+            {
+                s->page_tag[i] = -1;
+            }
+        }
+    }
+
+    if (!ret)
+    {
+        fprintf(stderr, "LevelStoreOpen: missing or malformed level files in %s\n", dir);
+        LevelStoreClose(s);
+    }
+
+    return ret;
+}
+
+void LevelStoreSource(struct level_store_t *s, struct level_source_t *src)
+{
+    *src = (struct level_source_t){
+        .n_leaves = s->n_leaves,
+        .n_levels = s->n_levels,
+        .arity = s->arity,
+        .padding = s->padding,
+        .level_size = s->level_size,
+        .read = LevelStoreRead,
+        .ctx = s,
+    };
+}
+
+void LevelStoreClose(struct level_store_t *s)
+{
+    for (int l = 0; l < LEVELS_MAX; l++)
+    {
+        if (s->fd[l] >= 0)
+        {
+            close(s->fd[l]);
+        }
+    }
+    MemFree(MEM_IO, s->page_tag, s->n_pages * sizeof(long));
+    MemFree(MEM_IO, s->cache, (size_t)s->n_pages * LEVEL_PAGE_SIZE);
+    memset(s, 0, sizeof(*s));
+    for (int l = 0; l < LEVELS_MAX; l++)
+    {
+        s->fd[l] = -1;
+    }
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool LevelAppend(struct level_writer_t *w, int level, const unsigned char hash[SHA256_DIGEST_LENGTH])
+{
+    bool ret = level < LEVELS_MAX;
+
+    /* first node of the level: open its file */
+    if (ret && !w->fp[level])
+    {
+        char filename[512];
+
+        snprintf(filename, sizeof(filename), LEVEL_FILE_FORMAT, w->dir, level);
+        w->fp[level] = fopen(filename, "wb");
+        ret = w->fp[level] != NULL &&
+              setvbuf(w->fp[level], NULL, _IOFBF, w->io_buffer) == 0;
+        if (!w->fp[level])
+        {
+            perror("LevelAppend: unable to create level file");
+        }
+        else
+        {
+            /* stdio allocates the buffer itself, at the first write */
+            MemTrack(MEM_IO, w->io_buffer);
+        }
+    }
+
+    if (ret)
+    {
+        unsigned char *group = WRITER_GROUP(w, level);
+
+        ret = fwrite(hash, SHA256_DIGEST_LENGTH, 1, w->fp[level]) == 1;
+        memcpy(group + (size_t)w->pending[level] * SHA256_DIGEST_LENGTH, hash, SHA256_DIGEST_LENGTH);
+        w->pending[level]++;
+        w->count[level]++;
+
+        /* last child of its parent */
+        if (ret && w->pending[level] == w->arity)
+        {
+            unsigned char parent[SHA256_DIGEST_LENGTH];
+
+            w->pending[level] = 0;
+            ret = HashChildren(group, w->arity, parent) && LevelAppend(w, level + 1, parent);
+        }
+    }
+
+    return ret;
+}
+
+static bool ManifestWrite(const struct level_writer_t *w)
+{
+    bool ret = false;
+    char filename[512];
+    FILE *fp;
+
+    snprintf(filename, sizeof(filename), LEVEL_MANIFEST_FORMAT, w->dir);
+    fp = fopen(filename, "wb");
+    if (fp)
+    {
+        struct manifest_header_t header = {
+            .magic = MANIFEST_MAGIC,
+            .version = MANIFEST_VERSION,
+            .n_leaves = (uint64_t)w->n_leaves,
+            .n_levels = (uint32_t)w->n_levels,
+            .arity = (uint32_t)w->arity,
+            .padding = (uint32_t)w->padding,
+        };
+
+        ret = fwrite(&header, sizeof(header), 1, fp) == 1;
+        for (int l = 0; l < w->n_levels && ret; l++)
+        {
+            uint64_t size = (uint64_t)w->count[l];
+            ret = fwrite(&size, sizeof(size), 1, fp) == 1;
+        }
+        ret = ret && fwrite(w->root, SHA256_DIGEST_LENGTH, 1, fp) == 1;
+        ret = fclose(fp) == 0 && ret;
+    }
+
+    if (!ret)
+    {
+        perror("ManifestWrite: unable to write manifest");
+    }
+
+    return ret;
+}
+
+static bool LevelStoreRead(void *ctx, int level, long first, int count, unsigned char *out)
+{
+    struct level_store_t *s = ctx;
+    bool ret = level >= 0 && level < s->n_levels && first >= 0 &&
+               first + count <= s->level_size[level];
+    off_t offset = (off_t)first * SHA256_DIGEST_LENGTH;
+    size_t len = (size_t)count * SHA256_DIGEST_LENGTH;
+
+    if (ret && s->n_pages == 0)
+    {
+        /* no budget: straight from the file */
+        ret = pread(s->fd[level], out, len, offset) == (ssize_t)len;
+        s->reads++;
+        len = 0;
+    }
+
+    while (ret && len > 0)
+    {
+        long page = offset / LEVEL_PAGE_SIZE;
+        long tag = ((long)level << 40) | page;
+        int slot = (int)(((unsigned long)page * 0x9E3779B1ul + level) % (unsigned long)s->n_pages);
+        unsigned char *data = s->cache + (size_t)slot * LEVEL_PAGE_SIZE;
+        size_t in_page = offset % LEVEL_PAGE_SIZE;
+        size_t chunk = LEVEL_PAGE_SIZE - in_page < len ? LEVEL_PAGE_SIZE - in_page : len;
+
+        if (s->page_tag[slot] == tag)
+        {
+            s->hits++;
+        }
+        else
+        {
+            /* the last page of a level may be short */
+            ssize_t n = pread(s->fd[level], data, LEVEL_PAGE_SIZE, page * LEVEL_PAGE_SIZE);
+            ret = n >= (ssize_t)(in_page + chunk);
+            s->page_tag[slot] = ret ? tag : -1;
+            s->reads++;
+        }
+
+        if (ret)
+        {
+            memcpy(out, data + in_page, chunk);
+            out += chunk;
+            offset += chunk;
+            len -= chunk;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,644 @@
+/**
+ * @file levels.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Flat per-level hash storage of a Merkle tree (snapshots)
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/levels.h"
+#include "../inc/config.h"              /* placement of the level blocks */
+#include "../inc/parallel.h"            /* parallel build */
+#include "../inc/trace.h"               /* build phase spans */
+#include "../inc/stats.h"               /* live build counters */
+#include "../inc/mem.h"                 /* MEM_LEVELS accounting */
+
+#include <stdlib.h>                     /* malloc, free */
+#include <limits.h>                     /* INT_MAX */
+#include <fcntl.h>                      /* open */
+#include <unistd.h>                     /* close */
+#include <sys/mman.h>                   /* mmap */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Snapshot file identification */
+#define SNAPSHOT_MAGIC   0x564c4b4du    /* "MKLV" */
+#define SNAPSHOT_VERSION 3u
+
+/* Levels with fewer nodes are built by the calling thread alone */
+#define LEVELS_PARALLEL_MIN (1 << 14)
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Snapshot file header, followed by n_levels uint32_t level sizes
+ * and by the hashes of every level, leaves first */
+struct snapshot_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_leaves;
+    uint32_t n_levels;
+    uint32_t arity;
+    uint32_t padding;
+};
+
+/* One level of a parallel build, cut in n_tasks consecutive ranges:
+ * range t of every level is written by the same worker */
+struct level_build_t {
+    const unsigned char *src;           /* leaves, or children */
+    unsigned char *dst;                 /* level 0, or parents */
+    long count;                         /* leaves to copy, or full groups to hash */
+    int arity;                          /* 0 to copy the leaves */
+    int n_tasks;
+    int level;                          /* level written, for the trace */
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief level_read_t of in-memory levels.
+ */
+static bool LevelsRead(void *ctx, int level, long first, int count, unsigned char *out);
+
+/**
+ * @brief Copies or hashes one range of a level (parallel_task_t).
+ */
+static bool LevelBuildTask(void *ctx, int task, int worker);
+
+/**
+ * @brief LevelsHashUp() spread over the build workers for large levels.
+ *
+ * @param children Hashes of the level, room for the padding.
+ * @param count Number of real nodes of the level.
+ * @param arity Number of children per node.
+ * @param padding Completion of the last group.
+ * @param parents Buffer receiving the parents.
+ * @param n_threads Number of workers.
+ * @param level Level of the parents.
+ * @return Number of parents, -1 on hashing failure.
+ */
+static int LevelsHashUpParallel(unsigned char *children, int count, int arity,
+                                enum merkle_padding_t padding, unsigned char *parents,
+                                int n_threads, int level);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool LevelsFromNodes(struct node_t ***nodes, int n_leaves, enum merkle_padding_t padding,
+                     struct merkle_levels_t *lv)
+{
+    bool ret = false;
+    int n_levels = 0;
+    long *sizes = NULL;
+
+    TRACE_BEGIN(span, "LevelsFromNodes", TRACE_NO_ARG);
+    if (nodes && nodes[0])
+    {
+        while (nodes[n_levels])
+        {
+            n_levels++;
+        }
+        sizes = malloc(n_levels * sizeof(long));
+    }
+
+    if (sizes)
+    {
+        /* count the nodes of every null terminated row */
+        for (int l = 0; l < n_levels; l++)
+        {
+            sizes[l] = 0;
+            while (nodes[l][sizes[l]])
+            {
+                sizes[l]++;
+            }
+        }
+
+        if (LevelsAlloc(lv, sizes, n_levels))
+        {
+            lv->n_leaves = n_leaves;
+            lv->arity = 2;
+            lv->padding = padding;
+            for (int l = 0; l < n_levels; l++)
+            {
+                for (long i = 0; i < sizes[l]; i++)
+                {
+                    memcpy(LEVEL_HASH(lv, l, i), nodes[l][i]->hash, SHA256_DIGEST_LENGTH);
+                }
+            }
+            ret = true;
+        }
+        free(sizes);
+    }
+    TRACE_END(span);
+
+    return ret;
+}
+
+bool LevelsFromLeafHashes(const unsigned char *leaves, int n_leaves, int arity,
+                          enum merkle_padding_t padding, struct merkle_levels_t *lv)
+{
+    bool ret = false;
+    int *sizes = NULL;
+    int n_levels = NodesNumberArray(&sizes, n_leaves, arity, padding);
+    long wide[LEVELS_MAX];
+
+    for (int l = 0; l < n_levels && l < LEVELS_MAX; l++)
+    {
+        wide[l] = sizes[l];
+    }
+    if (n_levels > 0 && n_levels <= LEVELS_MAX && LevelsAlloc(lv, wide, n_levels))
+    {
+        int count = n_leaves;
+
+        lv->n_leaves = n_leaves;
+        lv->arity = arity;
+        lv->padding = padding;
+        ret = true;
+
+        int n_threads = merkle_config.threads > 0 ? merkle_config.threads : ParallelDefaultThreads();
+        struct level_build_t copy = {
+            .src = leaves,
+            .dst = lv->level[0],
+            .count = n_leaves,
+            .n_tasks = n_threads,
+        };
+
+        /* every worker first writes the leaves it hashes next,
+         * their pages stay on its NUMA node */
+        if (n_leaves < LEVELS_PARALLEL_MIN)
+        {
+            memcpy(lv->level[0], leaves, (size_t)n_leaves * SHA256_DIGEST_LENGTH);
+        }
+        else
+        {
+            ret = ParallelForStatic(n_threads, n_threads, LevelBuildTask, &copy,
+                                    merkle_config.pin_threads);
+        }
+
+        /* hash every level from the one below, padding it first if needed */
+        for (int l = 1; l < n_levels && ret; l++)
+        {
+            TRACE_BEGIN(span, "LevelsHashUp", l);
+            count = LevelsHashUpParallel(lv->level[l - 1], count, arity, padding, lv->level[l],
+                                         n_threads, l);
+            ret = count > 0;
+            STATS_ADD(level_hashes[l], ret ? count : 0);
+            TRACE_END(span);
+        }
+
+        if (!ret)
+        {
+            STATS_ADD(errors, 1);
+            fprintf(stderr, "LevelsFromLeafHashes: hashing failed\n");
+            LevelsFree(lv);
+        }
+    }
+    free(sizes);
+
+    return ret;
+}
+
+bool SubtreeRoot(unsigned char *hashes, int count, int height, int arity,
+                 enum merkle_padding_t padding, unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    bool ret = count >= 1;
+
+    for (int h = 0; h < height && ret; h++)
+    {
+        /* hash in place, a parent never overwrites an unread child */
+        count = LevelsHashUp(hashes, count, arity, padding, hashes);
+        ret = count > 0;
+    }
+
+    if (ret)
+    {
+        memcpy(output, hashes, SHA256_DIGEST_LENGTH);
+    }
+
+    return ret;
+}
+
+long LevelsHashCalls(const struct merkle_levels_t *lv)
+{
+    long ret = 0;
+    long count = lv->n_leaves;
+
+    for (int l = 1; l < lv->n_levels; l++)
+    {
+        if (lv->padding == PADDING_DUPLICATE)
+        {
+            /* every group is complete once padded */
+            count = (count + lv->arity - 1) / lv->arity;
+            ret += count;
+        }
+        else
+        {
+            /* a lone last node is copied, not hashed */
+            ret += count / lv->arity + (count % lv->arity > 1);
+            count = (count + lv->arity - 1) / lv->arity;
+        }
+    }
+
+    return ret;
+}
+
+long LevelSpan(int arity, int level)
+{
+    long span = 1;
+
+    for (int l = 0; l < level; l++)
+    {
+        span *= arity;
+    }
+
+    return span;
+}
+
+bool LevelsAlloc(struct merkle_levels_t *lv, const long *sizes, int n_levels)
+{
+    bool ret = false;
+    size_t total = 0;
+
+    memset(lv, 0, sizeof(*lv));
+    for (int l = 0; l < n_levels; l++)
+    {
+        total += (size_t)sizes[l];
+    }
+
+    lv->level_size = malloc(n_levels * sizeof(long));
+    lv->level = malloc(n_levels * sizeof(unsigned char *));
+    if (lv->level_size && lv->level)
+    {
+        unsigned char *block = NULL;
+
+        /* large trees on huge pages, untouched until built */
+        if (total * SHA256_DIGEST_LENGTH >= PLACEMENT_HUGE_PAGE)
+        {
+            block = PlacementAlloc(total * SHA256_DIGEST_LENGTH, merkle_config.huge_pages,
+                                   &lv->map_size);
+            lv->map = block;
+        }
+        else
+        {
+            block = malloc(total * SHA256_DIGEST_LENGTH);
+        }
+        if (block)
+        {
+            /* the arrays and the block, as one allocation */
+            lv->mem_size = n_levels * (sizeof(long) + sizeof(unsigned char *)) +
+                           (lv->map ? lv->map_size : total * SHA256_DIGEST_LENGTH);
+            MemTrack(MEM_LEVELS, lv->mem_size);
+            lv->n_levels = n_levels;
+            for (int l = 0; l < n_levels; l++)
+            {
+                lv->level_size[l] = sizes[l];
+                lv->level[l] = block;
+                block += (size_t)sizes[l] * SHA256_DIGEST_LENGTH;
+            }
+            ret = true;
+        }
+    }
+
+    if (!ret)
+    {
+        fprintf(stderr, "LevelsAlloc: allocation failed\n");
+        free(lv->level);
+        free(lv->level_size);
+        memset(lv, 0, sizeof(*lv));
+    }
+
+    return ret;
+}
+
+void LevelsPad(unsigned char *hashes, int count, int padded)
+{
+    for (int i = count; i < padded; i++)
+    {
+        memcpy(hashes + (size_t)i * SHA256_DIGEST_LENGTH,
+               hashes + (size_t)(count - 1) * SHA256_DIGEST_LENGTH,
+               SHA256_DIGEST_LENGTH);
+    }
+}
+
+int LevelsHashUp(unsigned char *children, int count, int arity,
+                 enum merkle_padding_t padding, unsigned char *parents)
+{
+    int ret = -1;
+
+    if (padding == PADDING_DUPLICATE)
+    {
+        int padded = (count + arity - 1) / arity * arity;
+        LevelsPad(children, count, padded);
+        count = padded;
+    }
+
+    int full = count / arity;
+    int rest = count % arity;
+    const unsigned char *last = children + (size_t)full * arity * SHA256_DIGEST_LENGTH;
+    unsigned char *out = parents + (size_t)full * SHA256_DIGEST_LENGTH;
+
+    if (HashLevel(children, full, arity, parents))
+    {
+        ret = full;
+        if (rest == 1)
+        {
+            /* lone node: promoted unchanged */
+            memmove(out, last, SHA256_DIGEST_LENGTH);
+            ret++;
+        }
+        else if (rest > 1)
+        {
+            ret = HashChildren(last, rest, out) ? ret + 1 : -1;
+        }
+    }
+
+    return ret;
+}
+
+bool LevelsSave(const struct merkle_levels_t *lv, const char *filename)
+{
+    FILE *fp = fopen(filename, "wb");
+    bool ret = fp && LevelsWrite(lv, fp);
+
+    if (fp && fclose(fp) != 0)
+    {
+        ret = false;
+    }
+
+    if (!ret)
+    {
+        perror("LevelsSave: unable to write snapshot");
+    }
+
+    return ret;
+}
+
+bool LevelsWrite(const struct merkle_levels_t *lv, FILE *fp)
+{
+    struct snapshot_header_t header = {
+        .magic = SNAPSHOT_MAGIC,
+        .version = SNAPSHOT_VERSION,
+        .n_leaves = (uint32_t)lv->n_leaves,
+        .n_levels = (uint32_t)lv->n_levels,
+        .arity = (uint32_t)lv->arity,
+        .padding = (uint32_t)lv->padding,
+    };
+    /* the reader checks the sizes with NodesNumberLevels(), in ints:
+     * larger trees go to level files */
+    bool ret = lv->n_levels > 0 && lv->n_leaves + lv->arity <= INT_MAX &&
+               fwrite(&header, sizeof(header), 1, fp) == 1;
+
+    for (int l = 0; l < lv->n_levels && ret; l++)
+    {
+        uint32_t size = (uint32_t)lv->level_size[l];
+        ret = fwrite(&size, sizeof(size), 1, fp) == 1;
+    }
+    for (int l = 0; l < lv->n_levels && ret; l++)
+    {
+        ret = fwrite(lv->level[l], SHA256_DIGEST_LENGTH,
+                     lv->level_size[l], fp) == (size_t)lv->level_size[l];
+    }
+
+    return ret;
+}
+
+bool LevelsLoad(struct merkle_levels_t *lv, const char *filename)
+{
+    int fd = open(filename, O_RDONLY);
+    bool ret = fd >= 0 && LevelsMapFd(lv, fd);
+
+    if (fd < 0)
+    {
+        memset(lv, 0, sizeof(*lv));
+    }
+    else
+    {
+        close(fd);
+    }
+
+    if (fd >= 0 && !ret)
+    {
+        fprintf(stderr, "LevelsLoad: malformed snapshot %s\n", filename);
+    }
+
+    return ret;
+}
+
+bool LevelsMapFd(struct merkle_levels_t *lv, int fd)
+{
+    bool ret = false;
+    struct stat st;
+
+    memset(lv, 0, sizeof(*lv));
+
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct snapshot_header_t))
+    {
+        unsigned char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            const struct snapshot_header_t *header = (const void *)map;
+            size_t offset = sizeof(*header) + header->n_levels * sizeof(uint32_t);
+            int expected[LEVELS_MAX];
+
+            lv->map = map;
+            lv->map_size = st.st_size;
+
+            /* the sizes must be those of the shape in the header: other
+             * sizes would place the levels, and the reads, elsewhere */
+            if (header->magic == SNAPSHOT_MAGIC &&
+                header->version == SNAPSHOT_VERSION &&
+                header->n_levels > 0 && header->n_levels <= LEVELS_MAX &&
+                header->arity >= 2 && header->padding <= PADDING_PROMOTE &&
+                (uint64_t)header->n_leaves + header->arity <= INT_MAX &&
+                NodesNumberLevels(expected, LEVELS_MAX, (int)header->n_leaves,
+                                  (int)header->arity, header->padding) == (int)header->n_levels &&
+                offset <= lv->map_size)
+            {
+                lv->n_leaves = header->n_leaves;
+                lv->arity = header->arity;
+                lv->padding = header->padding;
+                lv->n_levels = header->n_levels;
+                lv->level_size = malloc(lv->n_levels * sizeof(long));
+                lv->level = malloc(lv->n_levels * sizeof(unsigned char *));
+                ret = lv->level_size && lv->level;
+
+                /* point every level inside the mapping */
+                for (int l = 0; l < lv->n_levels && ret; l++)
+                {
+                    uint32_t size;
+                    memcpy(&size, map + sizeof(*header) + l * sizeof(uint32_t), sizeof(size));
+                    lv->level_size[l] = size;
+                    lv->level[l] = map + offset;
+                    offset += (size_t)size * SHA256_DIGEST_LENGTH;
+                    ret = size == (uint32_t)expected[l] && offset <= lv->map_size;
+                }
+            }
+
+            /* the file pages are the page cache's, only the arrays are ours */
+            if (ret)
+            {
+                lv->mem_size = lv->n_levels * (sizeof(long) + sizeof(unsigned char *));
+                MemTrack(MEM_LEVELS, lv->mem_size);
+            }
+
+            if (!ret)
+            {
+                LevelsFree(lv);
+            }
+        }
+    }
+
+    return ret;
+}
+
+void LevelsFree(struct merkle_levels_t *lv)
+{
+    if (lv->mem_size)
+    {
+        MemUntrack(MEM_LEVELS, lv->mem_size);
+    }
+    if (lv->map)
+    {
+        munmap(lv->map, lv->map_size);
+    }
+    else if (lv->level)
+    {
+        /* every level lives in the block of level 0 */
+        free(lv->level[0]);
+    }
+    free(lv->level);
+    free(lv->level_size);
+    memset(lv, 0, sizeof(*lv));
+}
+
+void LevelsSource(const struct merkle_levels_t *lv, struct level_source_t *src)
+{
+    *src = (struct level_source_t){
+        .n_leaves = lv->n_leaves,
+        .n_levels = lv->n_levels,
+        .arity = lv->arity,
+        .padding = lv->padding,
+        .level_size = lv->level_size,
+        .read = LevelsRead,
+        .ctx = (void *)lv,
+    };
+}
+
+const unsigned char *LevelsRoot(const struct merkle_levels_t *lv)
+{
+    const unsigned char *ret = NULL;
+
+    if (lv->n_levels > 0)
+    {
+        ret = LEVEL_HASH(lv, lv->n_levels - 1, 0);
+    }
+
+    return ret;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool LevelsRead(void *ctx, int level, long first, int count, unsigned char *out)
+{
+    const struct merkle_levels_t *lv = ctx;
+    bool ret = level >= 0 && level < lv->n_levels && first >= 0 &&
+               first + count <= lv->level_size[level];
+
+    if (ret)
+    {
+        memcpy(out, LEVEL_HASH(lv, level, first), (size_t)count * SHA256_DIGEST_LENGTH);
+    }
+
+    return ret;
+}
+
+static bool LevelBuildTask(void *ctx, int task, int worker)
+{
+    const struct level_build_t *b = ctx;
+    long first = b->count * task / b->n_tasks;
+    long last = b->count * (task + 1) / b->n_tasks;
+    bool ret = true;
+
+    (void)worker;
+    TRACE_BEGIN(span, "LevelBuildTask", b->level);
+    if (b->arity == 0)
+    {
+        memcpy(b->dst + (size_t)first * SHA256_DIGEST_LENGTH,
+               b->src + (size_t)first * SHA256_DIGEST_LENGTH,
+               (size_t)(last - first) * SHA256_DIGEST_LENGTH);
+    }
+    else
+    {
+        ret = HashLevel(b->src + (size_t)first * b->arity * SHA256_DIGEST_LENGTH,
+                        (int)(last - first), b->arity,
+                        b->dst + (size_t)first * SHA256_DIGEST_LENGTH);
+    }
+    TRACE_END(span);
+
+    return ret;
+}
+
+static int LevelsHashUpParallel(unsigned char *children, int count, int arity,
+                                enum merkle_padding_t padding, unsigned char *parents,
+                                int n_threads, int level)
+{
+    int ret = -1;
+
+    if (count / arity < LEVELS_PARALLEL_MIN)
+    {
+        ret = LevelsHashUp(children, count, arity, padding, parents);
+    }
+    else
+    {
+        if (padding == PADDING_DUPLICATE)
+        {
+            int padded = (count + arity - 1) / arity * arity;
+            LevelsPad(children, count, padded);
+            count = padded;
+        }
+
+        /* the full groups in parallel, the partial one (promote) after */
+        struct level_build_t hash = {
+            .src = children,
+            .dst = parents,
+            .count = count / arity,
+            .arity = arity,
+            .n_tasks = n_threads,
+            .level = level,
+        };
+        int rest = count % arity;
+
+        if (ParallelForStatic(n_threads, n_threads, LevelBuildTask, &hash, merkle_config.pin_threads))
+        {
+            ret = (int)hash.count;
+        }
+        if (ret >= 0 && rest > 0)
+        {
+            ret = LevelsHashUp(children + (size_t)ret * arity * SHA256_DIGEST_LENGTH, rest, arity,
+                               padding, parents + (size_t)ret * SHA256_DIGEST_LENGTH) == 1 ? ret + 1 : -1;
+        }
+    }
+
+    return ret;
+}
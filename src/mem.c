@@ -0,0 +1,253 @@
+/**
+ * @file mem.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Allocation accounting of the tree, per subsystem
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/mem.h"
+
+#include <stdatomic.h>                  /* atomic_llong */
+#include <stdlib.h>                     /* malloc, calloc, realloc, free */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Slot of the counters summing every subsystem */
+#define MEM_TOTAL MEM_SUBSYSTEMS
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* Relaxed: each counter is only read on its own */
+#define MEM_ADD(counter, n) atomic_fetch_add_explicit(&(counter), (n), memory_order_relaxed)
+#define MEM_READ(counter)   atomic_load_explicit(&(counter), memory_order_relaxed)
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Counters of one subsystem */
+struct mem_counters_t {
+    atomic_llong current;
+    atomic_llong peak;
+    atomic_llong count;
+    atomic_llong live;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Charges or releases bytes and one allocation, in a subsystem and the total.
+ *
+ * @param sub Subsystem.
+ * @param size Bytes, negative to release.
+ * @param blocks 1 for an allocation, -1 for a release, 0 for a resize.
+ */
+static void Account(enum mem_subsystem_t sub, long long size, int blocks);
+
+/**
+ * @brief Raises a peak to a value, if below.
+ */
+static void RaisePeak(atomic_llong *peak, long long value);
+
+/**
+ * @brief Prints one row of the report.
+ */
+static void ReportRow(FILE *fp, const char *name, const struct mem_usage_t *u, bool bytes,
+                      long leaves);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* Counters per subsystem, then of their total */
+static struct mem_counters_t counters[MEM_SUBSYSTEMS + 1];
+
+static const char *const names[MEM_SUBSYSTEMS] = {
+    [MEM_LEVELS] = "levels",
+    [MEM_NODES] = "nodes",
+    [MEM_SCRATCH] = "scratch",
+    [MEM_HASH_CTX] = "hash contexts",
+    [MEM_IO] = "I/O buffers",
+    [MEM_PROOFS] = "proofs",
+};
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+void *MemAlloc(enum mem_subsystem_t sub, size_t size)
+{
+    void *ret = malloc(size);
+
+    if (ret)
+    {
+        Account(sub, (long long)size, 1);
+    }
+
+    return ret;
+}
+
+void *MemCalloc(enum mem_subsystem_t sub, size_t n, size_t size)
+{
+    void *ret = calloc(n, size);
+
+    if (ret)
+    {
+        Account(sub, (long long)(n * size), 1);
+    }
+
+    return ret;
+}
+
+void *MemRealloc(enum mem_subsystem_t sub, void *p, size_t old_size, size_t size)
+{
+    void *ret = realloc(p, size);
+
+    if (ret)
+    {
+        /* a grown block is still one allocation */
+        Account(sub, (long long)size - (long long)old_size, p ? 0 : 1);
+    }
+
+    return ret;
+}
+
+void MemFree(enum mem_subsystem_t sub, void *p, size_t size)
+{
+    if (p)
+    {
+        free(p);
+        Account(sub, -(long long)size, -1);
+    }
+}
+
+void MemTrack(enum mem_subsystem_t sub, size_t size)
+{
+    Account(sub, (long long)size, 1);
+}
+
+void MemUntrack(enum mem_subsystem_t sub, size_t size)
+{
+    Account(sub, -(long long)size, -1);
+}
+
+EVP_MD_CTX *MemHashCtxNew(void)
+{
+    EVP_MD_CTX *ret = EVP_MD_CTX_new();
+
+    if (ret)
+    {
+        Account(MEM_HASH_CTX, 0, 1);
+    }
+
+    return ret;
+}
+
+void MemHashCtxFree(EVP_MD_CTX *ctx)
+{
+    if (ctx)
+    {
+        EVP_MD_CTX_free(ctx);
+        Account(MEM_HASH_CTX, 0, -1);
+    }
+}
+
+void MemUsage(enum mem_subsystem_t sub, struct mem_usage_t *u)
+{
+    struct mem_counters_t *c = &counters[sub];
+
+    u->current = MEM_READ(c->current);
+    u->peak = MEM_READ(c->peak);
+    u->count = MEM_READ(c->count);
+    u->live = MEM_READ(c->live);
+}
+
+void MemResetPeaks(void)
+{
+    for (int s = 0; s <= MEM_TOTAL; s++)
+    {
+        atomic_store_explicit(&counters[s].peak, MEM_READ(counters[s].current),
+                              memory_order_relaxed);
+    }
+}
+
+const char *MemSubsystemName(enum mem_subsystem_t sub)
+{
+    return sub < MEM_SUBSYSTEMS ? names[sub] : "total";
+}
+
+void MemReport(FILE *fp, const char *title, long leaves)
+{
+    struct mem_usage_t u;
+
+    fprintf(fp, "%-16s %14s %14s %10s %8s %12s %12s\n", title, "CURRENT (B)", "PEAK (B)",
+            "ALLOCS", "LIVE", "CUR B/LEAF", "PEAK B/LEAF");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    for (int s = 0; s <= MEM_TOTAL; s++)
+    {
+        MemUsage(s, &u);
+        ReportRow(fp, MemSubsystemName(s), &u, s != MEM_HASH_CTX, leaves);
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void Account(enum mem_subsystem_t sub, long long size, int blocks)
+{
+    struct mem_counters_t *c = &counters[sub];
+    struct mem_counters_t *t = &counters[MEM_TOTAL];
+
+    MEM_ADD(c->live, blocks);
+    MEM_ADD(t->live, blocks);
+    if (blocks > 0)
+    {
+        MEM_ADD(c->count, 1);
+        MEM_ADD(t->count, 1);
+    }
+    RaisePeak(&c->peak, MEM_ADD(c->current, size) + size);
+    RaisePeak(&t->peak, MEM_ADD(t->current, size) + size);
+}
+
+static void RaisePeak(atomic_llong *peak, long long value)
+{
+    long long seen = atomic_load_explicit(peak, memory_order_relaxed);
+
+    while (value > seen &&
+           !atomic_compare_exchange_weak_explicit(peak, &seen, value, memory_order_relaxed,
+                                                  memory_order_relaxed))
+    {
+        /* seen was reloaded, try again while still above it */
+    }
+}
+
+static void ReportRow(FILE *fp, const char *name, const struct mem_usage_t *u, bool bytes,
+                      long leaves)
+{
+    if (!bytes)
+    {
+        fprintf(fp, "%-16s %14s %14s %10lld %8lld %12s %12s\n", name, "-", "-",
+                u->count, u->live, "-", "-");
+    }
+    else if (leaves > 0)
+    {
+        fprintf(fp, "%-16s %14lld %14lld %10lld %8lld %12.2f %12.2f\n", name,
+                u->current, u->peak, u->count, u->live, (double)u->current / leaves,
+                (double)u->peak / leaves);
+    }
+    else
+    {
+        fprintf(fp, "%-16s %14lld %14lld %10lld %8lld %12s %12s\n", name,
+                u->current, u->peak, u->count, u->live, "-", "-");
+    }
+}
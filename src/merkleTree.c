@@ -9,6 +9,12 @@
  * INCLUDE FILES
  *-----------------------------------*/
 #include "../inc/merkleTree.h"
+#include "../inc/trace.h"                /* build phase spans */
+#include "../inc/stats.h"                /* live build counters */
+#include "../inc/mem.h"                  /* allocation accounting */
+#include "../inc/config.h"               /* merkle_config.backend, threads */
+#include "../inc/parallel.h"             /* parallel leaf hashing */
+#include "../inc/perf.h"                 /* counts per build phase */
 
 /*-----------------------------------*
  * PUBLIC VARIABLE DEFINITIONS
@@ -23,6 +29,13 @@ struct node_t *root_node = NULL;
 
 char *BASE_FOLDER = NULL;
 
+/* Number of leaves (files) and levels of the current tree */
+int n_files = 0;
+int tree_levels = 0;
+
+/* Memory of the node tree, kept across rebuilds */
+struct merkle_arena_t tree_arena = {0};
+
 /*-----------------------------------*
  * PRIVATE DEFINES
  *-----------------------------------*/
@@ -33,6 +46,9 @@ char *BASE_FOLDER = NULL;
 /* Define transaction data folder */
 #define FILE_NAME_MAX_LENGTH 50
 
+/* Leaf files per task of the parallel leaf hashing */
+#define LEAF_CHUNK 64
+
 /*-----------------------------------*
  * PRIVATE MACROS
  *-----------------------------------*/
@@ -41,7 +57,13 @@ char *BASE_FOLDER = NULL;
 /*-----------------------------------*
  * PRIVATE TYPEDEFS
  *-----------------------------------*/
-/* None */
+/* Leaf files hashed by the workers of a build */
+struct leaf_job_t {
+    const char *folder;
+    int n_leaves;
+    unsigned char *hashes;              /* flat output, or NULL */
+    struct node_t **leaves;             /* leaf nodes output, or NULL */
+};
 
 /*-----------------------------------*
  * PRIVATE FUNCTION PROTOTYPES
@@ -52,8 +74,9 @@ char *BASE_FOLDER = NULL;
  *
  * This function creates a two-dimensional (matrix) array of pointers to node_t structures,
  * based on the provided number of nodes per level and the total number of levels in the tree.
- * The memory for each row (level) is allocated and initialized, and a NULL pointer is placed at
- * the end of each row for easy iteration.
+ * The whole matrix is carved from `tree_arena`, sized once for the tree: a rebuild of a tree
+ * that fits in its capacity performs no heap allocation. Each row (level) is initialized, and
+ * a NULL pointer is placed at the end of each row for easy iteration.
  *
  * @param nodes_ptr Pointer to the pointer that will hold the allocated tree nodes matrix.
  * @param nodes_arr An array containing the number of nodes at each level.
@@ -64,8 +87,8 @@ void AllocateAllNodes(struct node_t ****nodes_ptr, int *nodes_arr, int tree_leve
 /**
  * @brief Frees allocated memory for all nodes in the Merkle tree.
  * 
- * This function releases the dynamically allocated memory used for the nodes
- * in the Merkle tree, ensuring no memory leaks occur.
+ * This function gives the nodes back to `tree_arena`, which keeps its
+ * capacity for the next build (see MerkleTreeRelease()).
  * 
  * @param tree_levels Total number of levels in the Merkle tree.
  */
@@ -95,6 +118,7 @@ void HashNodes(void);
  *
  * This function reads transaction files and computes SHA-256 hashes
  * for the leaf nodes, which serve as the base of the Merkle tree.
+ * The files are shared by BuildThreads() workers.
  */
 void HashLeaves(void);
 
@@ -121,46 +145,252 @@ void PrintMerkleTree(struct node_t ***nodes);
  */
 void PrintNode(struct node_t *node);
 
+/**
+ * @brief Returns the number of build workers: merkle_config.threads, or
+ * one per online CPU.
+ */
+static int BuildThreads(void);
+
+/**
+ * @brief Sets build_ctx up for merkle_config.backend, one per build worker.
+ *
+ * The contexts are created by the first build with an EVP backend and
+ * kept until MerkleTreeRelease(); HASH_BACKEND_DIRECT needs none.
+ *
+ * @retval true  The backend is ready.
+ * @retval false A context could not be created or initialized.
+ */
+static bool BuildContextInit(void);
+
+/**
+ * @brief Hashes LEAF_CHUNK leaf files of a struct leaf_job_t.
+ */
+static bool HashLeafTask(void *ctx, int task, int worker);
+
+/**
+ * @brief Hashes the leaf files of a job on BuildThreads() workers.
+ *
+ * @param job Folder, leaf count and output: a flat array or the leaf nodes.
+ * @retval true  Every file was hashed.
+ * @retval false A file is missing or unreadable.
+ */
+static bool HashLeafFiles(struct leaf_job_t *job);
+
 /*-----------------------------------*
  * PRIVATE VARIABLES
  *-----------------------------------*/
-/* define folder/file information */
-int n_files = 0;
+/* Digest contexts of the build workers with an EVP backend, kept like
+ * tree_arena until MerkleTreeRelease() */
+static EVP_MD_CTX *build_ctx[PARALLEL_MAX_THREADS] = { NULL };
 
 /*-----------------------------------*
  * PUBLIC FUNCTION DEFINITIONS
  *-----------------------------------*/
 void BuildMerkleTree(const char *transactions_folder)
 {
+    int tree_levels = MerkleTreeBuild(transactions_folder, PADDING_DUPLICATE);
+
+    if (tree_levels > 0)
+    {
+        printf("tree_levels: %d\n", tree_levels);
+        printf("Root hash hex: \n");
+        PrintHashHex(root_node->hash);
+
+        /* Free the tree */
+        MerkleTreeFree();
+    }
+}
+
+int MerkleTreeBuild(const char *transactions_folder, enum merkle_padding_t padding)
+{
+    int ret = 0;
+    struct perf_sample_t mark;
+
+    TRACE_BEGIN(build_span, "MerkleTreeBuild", TRACE_NO_ARG);
     BASE_FOLDER = (char *)transactions_folder;
     /* prepare the tree:
     int array with number of nodes for each level */
-    int *nodes_number_arr = NULL;
-    int tree_levels = NodesNumberArrayFromFile(&nodes_number_arr, BASE_FOLDER);
+    int nodes_number_arr[LEVELS_MAX];
+    TRACE_BEGIN(count_span, "CountFilesInDirectory", TRACE_NO_ARG);
+    PerfPhaseStart(&mark);
+    n_files = CountFilesInDirectory(BASE_FOLDER);
+    PerfPhaseEnd(&mark, "count", PERF_NO_LEVEL, n_files, 0);
+    TRACE_END(count_span);
+    printf("\nN FILES: %d in folder %s\n", n_files, BASE_FOLDER);
+    StatsBuildStart(n_files);
+    TRACE_BEGIN(levels_span, "NodesNumberLevels", TRACE_NO_ARG);
+    PerfPhaseStart(&mark);
+    tree_levels = NodesNumberLevels(nodes_number_arr, LEVELS_MAX, n_files, 2, padding);
+    PerfPhaseEnd(&mark, "level sizing", PERF_NO_LEVEL, n_files, 0);
+    TRACE_END(levels_span);
+
+    /* nodes of all the levels, for the rates of the phases */
+    long n_nodes = 0;
+    for (int l = 0; l < tree_levels; l++)
+    {
+        n_nodes += nodes_number_arr[l];
+    }
 
-    /* Allocate space for all the nodes */
-    AllocateAllNodes(&nodes, nodes_number_arr, tree_levels);
+    if (tree_levels > 0)
+    {
+        /* Allocate space for all the nodes */
+        TRACE_BEGIN(alloc_span, "AllocateAllNodes", TRACE_NO_ARG);
+        PerfPhaseStart(&mark);
+        AllocateAllNodes(&nodes, nodes_number_arr, tree_levels);
+        PerfPhaseEnd(&mark, "alloc", PERF_NO_LEVEL, n_files, n_nodes);
+        TRACE_END(alloc_span);
+    }
 
     if(nodes)
     {
         /* Set nodes relations */
+        TRACE_BEGIN(relations_span, "SetRelations", TRACE_NO_ARG);
+        PerfPhaseStart(&mark);
         SetRelations();
-        /* Hash all the nodes */
-        HashNodes();
+        PerfPhaseEnd(&mark, "relations", PERF_NO_LEVEL, n_files, n_nodes);
+        TRACE_END(relations_span);
+        /* Hash all the nodes with the configured backend: one context for the
+         * whole build, none with HASH_BACKEND_DIRECT */
+        if (BuildContextInit())
+        {
+            HashNodes();
+            ret = tree_levels;
+        }
+        else
+        {
+            fprintf(stderr, "MerkleTreeBuild: no digest context\n");
+        }
+    }
+    StatsBuildEnd();
+    TRACE_END(build_span);
 
-        printf("tree_levels: %d\n", tree_levels);
-        printf("Root hash hex: \n");
-        PrintHashHex(root_node->hash);
+    return ret;
+}
 
-        /* Free the tree */
-        FreeAllNodes(tree_levels);
+bool BuildMerkleLevels(const char *transactions_folder, int arity, enum merkle_padding_t padding,
+                       struct merkle_levels_t *lv)
+{
+    bool ret = false;
+
+    if (arity == 2)
+    {
+        /* the node tree is binary: its levels are the result */
+        if (MerkleTreeBuild(transactions_folder, padding))
+        {
+            ret = LevelsFromNodes(nodes, n_files, padding, lv);
+            MerkleTreeFree();
+        }
     }
+    else
+    {
+        /* only the leaves are hashed here, the levels build the parents */
+        int n_leaves = CountFilesInDirectory(transactions_folder);
+        size_t size = (size_t)(n_leaves > 0 ? n_leaves : 0) * SHA256_DIGEST_LENGTH;
+        unsigned char *leaves = size ? MemAlloc(MEM_SCRATCH, size) : NULL;
+
+        TRACE_BEGIN(build_span, "BuildMerkleLevels", arity);
+        StatsBuildStart(n_leaves);
+        if (leaves && BuildContextInit())
+        {
+            struct leaf_job_t job = { transactions_folder, n_leaves, leaves, NULL };
+
+            struct perf_sample_t mark;
 
+            TRACE_BEGIN(leaves_span, "HashLeaves", TRACE_NO_ARG);
+            PerfPhaseStart(&mark);
+            ret = HashLeafFiles(&job);
+            PerfPhaseEnd(&mark, "leaves", 0, n_leaves, n_leaves);
+            TRACE_END(leaves_span);
+            ret = ret && LevelsFromLeafHashes(leaves, n_leaves, arity, padding, lv);
+        }
+        StatsBuildEnd();
+        TRACE_END(build_span);
+        MemFree(MEM_SCRATCH, leaves, size);
+    }
+
+    return ret;
+}
+
+void MerkleTreeFree(void)
+{
+    FreeAllNodes(tree_levels);
+    root_node = NULL;
+    tree_levels = 0;
+    n_files = 0;
+}
+
+void MerkleTreeRelease(void)
+{
+    MerkleTreeFree();
+    ArenaRelease(&tree_arena);
+    for (int w = 0; w < PARALLEL_MAX_THREADS; w++)
+    {
+        MemHashCtxFree(build_ctx[w]);
+        build_ctx[w] = NULL;
+    }
 }
 
 /*-----------------------------------*
  * PRIVATE FUNCTION DEFINITIONS
  *-----------------------------------*/
+static int BuildThreads(void)
+{
+    int ret = merkle_config.threads > 0 ? merkle_config.threads : ParallelDefaultThreads();
+
+    return ret < PARALLEL_MAX_THREADS ? ret : PARALLEL_MAX_THREADS;
+}
+
+static bool BuildContextInit(void)
+{
+    bool ret = true;
+
+    for (int w = 0; w < BuildThreads() && ret && merkle_config.backend != HASH_BACKEND_DIRECT; w++)
+    {
+        if (!build_ctx[w])
+        {
+            build_ctx[w] = MemHashCtxNew();
+        }
+        ret = build_ctx[w] && EVP_DigestInit_ex(build_ctx[w], HashBackendMd(), NULL);
+    }
+
+    return ret;
+}
+
+static bool HashLeafTask(void *ctx, int task, int worker)
+{
+    struct leaf_job_t *job = ctx;
+    char filename[256];
+    int first = task * LEAF_CHUNK;
+    int last = first + LEAF_CHUNK < job->n_leaves ? first + LEAF_CHUNK : job->n_leaves;
+    bool ret = true;
+
+    for (int i = first; i < last && ret; i++)
+    {
+        unsigned char *out = job->hashes ? job->hashes + (size_t)i * SHA256_DIGEST_LENGTH
+                                         : job->leaves[i]->hash;
+
+        snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, job->folder, i);
+        ret = HashFileBackend(build_ctx[worker], filename, out);
+    }
+
+    return ret;
+}
+
+static bool HashLeafFiles(struct leaf_job_t *job)
+{
+    int n_tasks = (job->n_leaves + LEAF_CHUNK - 1) / LEAF_CHUNK;
+    bool ret = ParallelFor(n_tasks, BuildThreads(), HashLeafTask, job, NULL);
+
+    STATS_ADD(level_hashes[0], ret ? job->n_leaves : 0);
+    if (!ret)
+    {
+        fprintf(stderr, "HashLeafFiles: unable to hash the leaves of %s\n", job->folder);
+        STATS_ADD(errors, 1);
+    }
+
+    return ret;
+}
+
 void SetRelations()
 {
     struct node_t ***row; // point to array of ptrs node_t*
@@ -238,73 +468,58 @@ void HashNodes()
 
     struct node_t ***row = nodes;
     struct node_t **col;
+    struct perf_sample_t mark;
 
     /* Hash first the leaves */
+    TRACE_BEGIN(leaves_span, "HashLeaves", TRACE_NO_ARG);
+    PerfPhaseStart(&mark);
     HashLeaves();
+    PerfPhaseEnd(&mark, "leaves", 0, n_files, n_files);
+    TRACE_END(leaves_span);
 
     /* continue hashing nodes at levels 1+ */
     row++;
     while (*row)
     {
+        TRACE_BEGIN(level_span, "HashNodes level", (long)(row - nodes));
+        PerfPhaseStart(&mark);
         col = row[0];
         /* check if node is valid*/
         while (*col != NULL)
         {
             /* If the hashing from childre succeeds go to next node */
-            if(HashNodeFromChildren(col))
+            if(HashNodeFromChildren(build_ctx[0], col))
             {
                 col++;
             }
             else
             {
                 fprintf(stderr, "HashNodes: nodes not allocated \n");
+                STATS_ADD(errors, 1);
                 break;
             }
         }
+        /* one update per level for the live counters */
+        STATS_ADD(level_hashes[row - nodes], col - row[0]);
+        PerfPhaseEnd(&mark, "level", row - nodes, n_files, col - row[0]);
+        TRACE_END(level_span);
         row++;
     }
 }
 
 void HashLeaves(void)
 {
-    struct node_t ***row = nodes;
-    struct node_t **col;
-
-    int file_counter = 0;
-    char filename[256];
+    struct leaf_job_t job = { BASE_FOLDER, n_files, NULL, nodes[0] };
 
     /* Check inputs */
-    if (row[0])
+    if (nodes[0])
     {
-        col = row[0];
-        while (col)
+        /* the files, on the build workers */
+        if (HashLeafFiles(&job) && n_files > 0 && nodes[0][n_files])
         {
-            /* Generate filename */
-            snprintf(filename, sizeof(filename),
-                     "%sblock_%d.txt", BASE_FOLDER,
-                      file_counter);
-
-            /* Check if file exists */
-            if (isValidFile(filename))
-            {
-                HashFile(filename, (*col)->hash);
-                /* update the node counter */
-                file_counter++;
-                /* update the node */
-                col++;
-            }
-            /* Check if last node */
-            else if (!col[1])
-            {
-                /* Set the same hash of previous node */
-                memcpy(col[0]->hash, col[-1]->hash, sizeof(col[-1]->hash));
-                break;
-            }
-            else
-            {
-                fprintf(stderr, "HashLeaves: file not valid, not last node \n");
-                break;
-            }
+            /* last node of an odd row: it only pads the row,
+             * set the same hash of previous node */
+            memcpy(nodes[0][n_files]->hash, nodes[0][n_files - 1]->hash, SHA256_DIGEST_LENGTH);
         }
     }
     else
@@ -319,56 +534,44 @@ void AllocateAllNodes(struct node_t ****nodes_ptr, int *nodes_arr, int tree_leve
     struct node_t *helper_arr = NULL;
     /* Node number counter, for debugging purpose */
     int node_number_idx = 0;
-    /* Allocate memory for the top-level pointer array with +1 NULL node */
-    *nodes_ptr = (struct node_t ***)malloc((tree_levels + 1) * sizeof(struct node_t **));
+    /* Size the arena for the whole matrix: top-level array, rows, nodes */
+    size_t total = ARENA_ROUND((tree_levels + 1) * sizeof(struct node_t **));
+
+    for (int i = 0; i < tree_levels; i++)
+    {
+        total += ARENA_ROUND((nodes_arr[i] + 1) * sizeof(struct node_t *)) +
+                 ARENA_ROUND(nodes_arr[i] * sizeof(struct node_t));
+    }
+
+    /* Carve the top-level pointer array with +1 NULL node */
+    *nodes_ptr = NULL;
+    if (ArenaReserve(&tree_arena, total))
+    {
+        *nodes_ptr = ArenaAlloc(&tree_arena, (tree_levels + 1) * sizeof(struct node_t **));
+    }
 
     if (*nodes_ptr)
     {
-        /* clean the memory */
-        memset(*nodes_ptr, 0, (tree_levels + 1) * sizeof(struct node_t **));
         /* Set last ptr to arr to null */
         (*nodes_ptr)[tree_levels] = NULL;
         for (int i = 0; i < tree_levels; i++)
         {
-            /* Allocate memory for each level with +1 NULL node */
-            (*nodes_ptr)[i] = (struct node_t**)malloc((nodes_arr[i] + 1) * sizeof(struct node_t*));
-            
-            /* check if malloc succeeded */
-            if((*nodes_ptr)[i])
-            {
-                /* Set last ptr to null */
-                (*nodes_ptr)[i][nodes_arr[i]] = NULL;
+            /* Carve each level with +1 NULL node, the reservation covers them all */
+            (*nodes_ptr)[i] = ArenaAlloc(&tree_arena, (nodes_arr[i] + 1) * sizeof(struct node_t *));
+            helper_arr = ArenaAlloc(&tree_arena, nodes_arr[i] * sizeof(struct node_t));
 
-                /* allocate the helper array with the correct amount */
-                helper_arr = malloc(nodes_arr[i] * sizeof(struct node_t));
+            /* Set last ptr to null */
+            (*nodes_ptr)[i][nodes_arr[i]] = NULL;
+            /* clean the memory, it holds the previous tree */
+            memset(helper_arr, 0, nodes_arr[i] * sizeof(struct node_t));
 
-                /* check if malloc succeeded */
-                if (helper_arr)
-                {
-                    /* clean the memory */
-                    memset(helper_arr, 0, nodes_arr[i] * sizeof(struct node_t));
-                    
-                    /* Assign pointers to nodes */
-                    for (int j = 0; j < nodes_arr[i]; j++)
-                    {
-                        /* set the node's number */
-                        helper_arr[j].number = node_number_idx++;
-                        /* connect the pointers */
-                        (*nodes_ptr)[i][j] = &helper_arr[j];
-                    }
-                    helper_arr = NULL;
-                }
-                else
-                {
-                    free((*nodes_ptr)[i]);
-                    free(*nodes_ptr);
-                    *nodes_ptr = NULL;
-                }
-            }
-            else
+            /* Assign pointers to nodes */
+            for (int j = 0; j < nodes_arr[i]; j++)
             {
-                free(*nodes_ptr);
-                *nodes_ptr = NULL;
+                /* set the node's number */
+                helper_arr[j].number = node_number_idx++;
+                /* connect the pointers */
+                (*nodes_ptr)[i][j] = &helper_arr[j];
             }
         }
     }
@@ -376,20 +579,8 @@ void AllocateAllNodes(struct node_t ****nodes_ptr, int *nodes_arr, int tree_leve
 
 void FreeAllNodes(int tree_levels)
 {
-    if (nodes)
-    {
-        for (int i = 0; i < tree_levels; i++)
-        {
-            if (nodes[i])
-            {
-                /* Free the struct node_t array */
-                free(nodes[i][0]); // helper_arr was allocated as a single block
-                /* Free the array of pointers */
-                free(nodes[i]);
-            }
-        }
-    }
-    /* Free the top-level pointer array */
-    free(nodes);
+    /* every level lives in the arena, kept for the next build */
+    (void)tree_levels;
+    ArenaReset(&tree_arena);
     nodes = NULL;
-}
\ No newline at end of file
+}
@@ -0,0 +1,199 @@
+/**
+ * @file pagecache.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Page cache state of the leaf files before a build
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/pagecache.h"
+#include "../inc/merkleTree.h"          /* LEAF_FILE_FORMAT */
+
+#include <fcntl.h>                      /* open, posix_fadvise */
+#include <stdio.h>                      /* snprintf */
+#include <unistd.h>                     /* read, fdatasync */
+#include <sys/mman.h>                   /* mmap, mincore */
+#include <sys/stat.h>                   /* fstat */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Read size of the warm-up */
+#define PAGECACHE_READ_SIZE (64 * 1024)
+
+/* Pages checked per mincore() call */
+#define PAGECACHE_VEC_SIZE 4096
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Applies a mode to one open file.
+ *
+ * @retval true  Success.
+ * @retval false I/O error.
+ */
+static bool PrepareFile(int fd, enum pagecache_mode_t mode);
+
+/**
+ * @brief Returns the bytes of an open file in the page cache, -1 on error.
+ */
+static long long ResidentBytes(int fd, long long size);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* In the order of pagecache_mode_t */
+static const char *mode_names[PAGECACHE_MODES] = { "as-is", "cold", "warm" };
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool PageCachePrepare(const char *folder, enum pagecache_mode_t mode, struct pagecache_stats_t *st)
+{
+    bool ret = true;
+    int n_files = CountFilesInDirectory(folder);
+    char filename[256];
+
+    for (int i = 0; i < n_files && ret && mode != PAGECACHE_AS_IS; i++)
+    {
+        snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, folder, i);
+        int fd = open(filename, O_RDONLY);
+
+        ret = fd >= 0 && PrepareFile(fd, mode);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        if (!ret)
+        {
+            perror("PageCachePrepare: unable to prepare a leaf file");
+        }
+    }
+
+    return PageCacheResidency(folder, st) && ret;
+}
+
+bool PageCacheResidency(const char *folder, struct pagecache_stats_t *st)
+{
+    bool ret = true;
+    char filename[256];
+
+    st->files = CountFilesInDirectory(folder);
+    st->bytes = 0;
+    st->resident_bytes = 0;
+    for (int i = 0; i < st->files && ret; i++)
+    {
+        struct stat sb;
+        long long resident = -1;
+
+        snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, folder, i);
+        int fd = open(filename, O_RDONLY);
+        if (fd >= 0 && fstat(fd, &sb) == 0)
+        {
+            resident = ResidentBytes(fd, sb.st_size);
+            st->bytes += sb.st_size;
+            st->resident_bytes += resident;
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        ret = resident >= 0;
+    }
+    if (!ret)
+    {
+        perror("PageCacheResidency: unable to measure a leaf file");
+    }
+
+    return ret;
+}
+
+const char *PageCacheModeName(enum pagecache_mode_t mode)
+{
+    return mode < PAGECACHE_MODES ? mode_names[mode] : "?";
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool PrepareFile(int fd, enum pagecache_mode_t mode)
+{
+    bool ret = true;
+
+    if (mode == PAGECACHE_COLD)
+    {
+        /* only clean pages are dropped: write the fresh files back first */
+        ret = fdatasync(fd) == 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    }
+    else if (mode == PAGECACHE_WARM)
+    {
+        char buffer[PAGECACHE_READ_SIZE];
+        ssize_t n;
+
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        {
+        }
+        ret = n == 0;
+    }
+
+    return ret;
+}
+
+static long long ResidentBytes(int fd, long long size)
+{
+    long long ret = 0;
+    long page = sysconf(_SC_PAGESIZE);
+    void *map = size > 0 ? mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0) : NULL;
+
+    if (map == MAP_FAILED)
+    {
+        ret = -1;
+    }
+    else if (map)
+    {
+        long long pages = (size + page - 1) / page;
+        unsigned char vec[PAGECACHE_VEC_SIZE];
+
+        for (long long first = 0; first < pages && ret >= 0; first += PAGECACHE_VEC_SIZE)
+        {
+            long long count = pages - first < PAGECACHE_VEC_SIZE ? pages - first : PAGECACHE_VEC_SIZE;
+
+            if (mincore((char *)map + first * page, (size_t)(count * page), vec) == 0)
+            {
+                for (long long p = 0; p < count; p++)
+                {
+                    /* the last page counts for the end of the file only */
+                    long long bytes = first + p == pages - 1 ? size - (pages - 1) * page : page;
+                    ret += (vec[p] & 1) ? bytes : 0;
+                }
+            }
+            else
+            {
+                ret = -1;
+            }
+        }
+        munmap(map, (size_t)size);
+    }
+
+    return ret;
+}
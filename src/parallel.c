@@ -0,0 +1,229 @@
+/**
+ * @file parallel.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Minimal worker pool running independent tasks
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#define _GNU_SOURCE                     /* pthread_getaffinity_np */
+#include "../inc/parallel.h"
+#include "../inc/placement.h"           /* worker pinning */
+#include "../inc/stats.h"               /* queue depth counters */
+
+#include <stdio.h>                      /* fprintf */
+#include <pthread.h>                    /* threads */
+#include <sched.h>                      /* cpu_set_t */
+#include <unistd.h>                     /* sysconf */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* State shared by the workers of one ParallelFor() */
+struct parallel_pool_t {
+    int n_tasks;
+    parallel_task_t fn;
+    void *ctx;
+    atomic_int next;                    /* next task to claim */
+    atomic_int started;                 /* tasks claimed, for the queue depth */
+    atomic_bool *cancel;
+    int n_threads;                      /* workers started */
+    bool fixed;                         /* task t runs on worker t % n_threads */
+    bool pin;                           /* workers pinned to PlacementCpu() */
+};
+
+/* Argument of one worker */
+struct parallel_worker_t {
+    struct parallel_pool_t *pool;
+    int index;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Starts the workers of a pool, runs worker 0 and joins the others.
+ *
+ * @param pool Pool, its thread count is clamped.
+ * @retval true  Every task ran and returned true.
+ * @retval false Cancelled or thread creation failure.
+ */
+static bool RunPool(struct parallel_pool_t *pool);
+
+/**
+ * @brief Worker loop: claims and runs tasks until none is left.
+ *
+ * @param arg struct parallel_worker_t of the worker.
+ * @return NULL.
+ */
+static void *WorkerMain(void *arg);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+int ParallelDefaultThreads(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n < 1)
+    {
+        n = 1;
+    }
+    else if (n > PARALLEL_MAX_THREADS)
+    {
+        n = PARALLEL_MAX_THREADS;
+    }
+
+    return (int)n;
+}
+
+bool ParallelFor(int n_tasks, int n_threads, parallel_task_t fn, void *ctx, atomic_bool *cancel)
+{
+    atomic_bool local_cancel = false;
+    struct parallel_pool_t pool = {
+        .n_tasks = n_tasks,
+        .fn = fn,
+        .ctx = ctx,
+        .cancel = cancel ? cancel : &local_cancel,
+        .n_threads = n_threads,
+    };
+
+    return RunPool(&pool);
+}
+
+bool ParallelForStatic(int n_tasks, int n_threads, parallel_task_t fn, void *ctx, bool pin)
+{
+    atomic_bool cancel = false;
+    struct parallel_pool_t pool = {
+        .n_tasks = n_tasks,
+        .fn = fn,
+        .ctx = ctx,
+        .cancel = &cancel,
+        .n_threads = n_threads,
+        .fixed = true,
+        .pin = pin,
+    };
+    cpu_set_t caller;
+    bool restore = pin && pthread_getaffinity_np(pthread_self(), sizeof(caller), &caller) == 0;
+    bool ret = RunPool(&pool);
+
+    /* the calling thread was worker 0 */
+    if (restore)
+    {
+        pthread_setaffinity_np(pthread_self(), sizeof(caller), &caller);
+    }
+
+    return ret;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool RunPool(struct parallel_pool_t *pool)
+{
+    struct parallel_worker_t workers[PARALLEL_MAX_THREADS];
+    pthread_t threads[PARALLEL_MAX_THREADS];
+    int n_threads = pool->n_threads;
+    int started = 0;
+
+    atomic_init(&pool->next, 0);
+    atomic_init(&pool->started, 0);
+    STATS_ADD(tasks_queued, pool->n_tasks);
+    if (n_threads <= 0)
+    {
+        n_threads = ParallelDefaultThreads();
+    }
+    if (n_threads > PARALLEL_MAX_THREADS)
+    {
+        n_threads = PARALLEL_MAX_THREADS;
+    }
+    if (n_threads > pool->n_tasks)
+    {
+        n_threads = pool->n_tasks;
+    }
+    pool->n_threads = n_threads;
+
+    /* the calling thread is worker 0 */
+    for (int i = 1; i < n_threads; i++)
+    {
+        workers[i] = (struct parallel_worker_t){ pool, i };
+        if (pthread_create(&threads[i], NULL, WorkerMain, &workers[i]) != 0)
+        {
+            fprintf(stderr, "ParallelFor: unable to start worker %d\n", i);
+            atomic_store(pool->cancel, true);
+            break;
+        }
+        started = i;
+    }
+    workers[0] = (struct parallel_worker_t){ pool, 0 };
+    WorkerMain(&workers[0]);
+
+    for (int i = 1; i <= started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    /* tasks left over by a cancellation */
+    STATS_ADD(tasks_queued, atomic_load(&pool->started) - pool->n_tasks);
+
+    return !atomic_load(pool->cancel);
+}
+
+static void *WorkerMain(void *arg)
+{
+    struct parallel_worker_t *worker = arg;
+    struct parallel_pool_t *pool = worker->pool;
+
+    int task = worker->index;
+
+    if (pool->pin && !PlacementPin(PlacementCpu(worker->index, pool->n_threads)))
+    {
+        fprintf(stderr, "ParallelFor: unable to pin worker %d\n", worker->index);
+    }
+
+    while (!atomic_load_explicit(pool->cancel, memory_order_relaxed))
+    {
+        if (!pool->fixed)
+        {
+            task = atomic_fetch_add(&pool->next, 1);
+        }
+        if (task >= pool->n_tasks)
+        {
+            break;
+        }
+        STATS_ADD(tasks_queued, -1);
+        STATS_ADD(tasks_running, 1);
+        atomic_fetch_add_explicit(&pool->started, 1, memory_order_relaxed);
+        if (!pool->fn(pool->ctx, task, worker->index))
+        {
+            atomic_store(pool->cancel, true);
+        }
+        STATS_ADD(tasks_running, -1);
+        /* fixed schedule: the same worker always gets the same tasks */
+        task += pool->n_threads;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,332 @@
+/**
+ * @file perf.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Hardware performance counters of the process (perf_event_open)
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#define _GNU_SOURCE                     /* syscall */
+#include "../inc/perf.h"
+
+#include <errno.h>                      /* errno */
+#include <string.h>                     /* memset, strerror */
+#include <unistd.h>                     /* syscall, read, close */
+#include <sys/ioctl.h>                  /* ioctl */
+#include <sys/syscall.h>                /* SYS_perf_event_open */
+#include <linux/perf_event.h>           /* perf_event_attr */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Setting that restricts the counters of unprivileged users */
+#define PERF_PARANOID_FILE "/proc/sys/kernel/perf_event_paranoid"
+
+/* Cache event of PERF_TYPE_HW_CACHE: read misses of a cache */
+#define PERF_CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Kernel event of a counter */
+struct perf_event_t {
+    const char *name;
+    unsigned int type;
+    unsigned long long config;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Returns kernel.perf_event_paranoid, -99 if unreadable.
+ */
+static int PerfParanoid(void);
+
+/**
+ * @brief Prints a count divided by a work size, n/a or - when there is none.
+ */
+static void PrintRate(FILE *fp, long long value, long size);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* Counters of the recorded phases, NULL when not recording */
+static const struct perf_counters_t *phase_counters;
+
+/* Phases recorded since PerfPhasesAttach() */
+static struct perf_phase_t phases[PERF_MAX_PHASES];
+static int n_phases;
+
+/* In the order of perf_counter_id_t */
+static const struct perf_event_t perf_events[PERF_COUNTERS] = {
+    { "cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "L1d misses",    PERF_TYPE_HW_CACHE, PERF_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D) },
+    { "LLC misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "dTLB misses",   PERF_TYPE_HW_CACHE, PERF_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB) },
+    { "node misses",   PERF_TYPE_HW_CACHE, PERF_CACHE_READ_MISS(PERF_COUNT_HW_CACHE_NODE) },
+    { "task clock ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+};
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool PerfOpen(struct perf_counters_t *pc)
+{
+    bool ret = false;
+
+    pc->error = 0;
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_events[i].type;
+        attr.config = perf_events[i].config;
+        attr.disabled = 1;
+        attr.inherit = 1;               /* the build workers */
+        attr.exclude_kernel = 1;        /* allowed up to perf_event_paranoid 2 */
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        pc->fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (pc->fd[i] < 0 && pc->error == 0)
+        {
+            pc->error = errno;
+        }
+        ret |= pc->fd[i] >= 0;
+    }
+
+    return ret;
+}
+
+void PerfStart(struct perf_counters_t *pc)
+{
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        if (pc->fd[i] >= 0)
+        {
+            ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfStop(struct perf_counters_t *pc, struct perf_sample_t *sample)
+{
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        if (pc->fd[i] >= 0)
+        {
+            ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    PerfRead(pc, sample);
+}
+
+void PerfRead(const struct perf_counters_t *pc, struct perf_sample_t *sample)
+{
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        /* value, time enabled, time running */
+        unsigned long long v[3];
+
+        sample->value[i] = PERF_UNAVAILABLE;
+        if (pc->fd[i] >= 0)
+        {
+            if (read(pc->fd[i], v, sizeof(v)) == sizeof(v) && v[2] > 0)
+            {
+                /* extrapolated over the time the counter was multiplexed out */
+                sample->value[i] = v[2] < v[1] ? (long long)((double)v[0] * v[1] / v[2])
+                                               : (long long)v[0];
+            }
+        }
+    }
+}
+
+void PerfPhasesAttach(const struct perf_counters_t *pc)
+{
+    phase_counters = pc;
+    if (pc)
+    {
+        n_phases = 0;
+    }
+}
+
+void PerfPhaseStart(struct perf_sample_t *mark)
+{
+    if (phase_counters)
+    {
+        PerfRead(phase_counters, mark);
+    }
+}
+
+void PerfPhaseEnd(const struct perf_sample_t *mark, const char *name, long level, long leaves,
+                  long nodes)
+{
+    if (phase_counters && n_phases < PERF_MAX_PHASES)
+    {
+        struct perf_phase_t *phase = &phases[n_phases++];
+
+        PerfRead(phase_counters, &phase->sample);
+        for (int i = 0; i < PERF_COUNTERS; i++)
+        {
+            if (phase->sample.value[i] != PERF_UNAVAILABLE && mark->value[i] != PERF_UNAVAILABLE)
+            {
+                phase->sample.value[i] -= mark->value[i];
+            }
+            else
+            {
+                phase->sample.value[i] = PERF_UNAVAILABLE;
+            }
+        }
+        phase->name = name;
+        phase->level = level;
+        phase->leaves = leaves;
+        phase->nodes = nodes;
+    }
+}
+
+int PerfPhases(const struct perf_phase_t **recorded)
+{
+    *recorded = phases;
+
+    return n_phases;
+}
+
+void PerfPhasesReport(FILE *fp, const char *title)
+{
+    fprintf(fp, "%-20s %5s %9s %9s %9s %9s %9s %8s\n", title, "LEVEL", "NODES",
+            "NS/LEAF", "NS/NODE", "CYC/LEAF", "CYC/NODE", "IPC");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    for (int p = 0; p < n_phases; p++)
+    {
+        const struct perf_phase_t *phase = &phases[p];
+        const long long *v = phase->sample.value;
+
+        fprintf(fp, "%-20s ", phase->name);
+        if (phase->level == PERF_NO_LEVEL)
+        {
+            fprintf(fp, "%5s %9ld", "-", phase->nodes);
+        }
+        else
+        {
+            fprintf(fp, "%5ld %9ld", phase->level, phase->nodes);
+        }
+        PrintRate(fp, v[PERF_TASK_CLOCK], phase->leaves);
+        PrintRate(fp, v[PERF_TASK_CLOCK], phase->nodes);
+        PrintRate(fp, v[PERF_CYCLES], phase->leaves);
+        PrintRate(fp, v[PERF_CYCLES], phase->nodes);
+        if (v[PERF_CYCLES] > 0 && v[PERF_INSTRUCTIONS] != PERF_UNAVAILABLE)
+        {
+            fprintf(fp, " %8.2f\n", (double)v[PERF_INSTRUCTIONS] / v[PERF_CYCLES]);
+        }
+        else
+        {
+            fprintf(fp, " %8s\n", "n/a");
+        }
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+}
+
+void PerfClose(struct perf_counters_t *pc)
+{
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        if (pc->fd[i] >= 0)
+        {
+            close(pc->fd[i]);
+            pc->fd[i] = -1;
+        }
+    }
+}
+
+const char *PerfCounterName(enum perf_counter_id_t id)
+{
+    return id < PERF_COUNTERS ? perf_events[id].name : "?";
+}
+
+void PerfReport(FILE *fp, const struct perf_counters_t *pc, const char *phase,
+                const struct perf_sample_t *sample, long leaves, long nodes)
+{
+    const long long *v = sample->value;
+
+    fprintf(fp, "%-30s %16s %12s %12s\n", phase, "COUNT", "PER LEAF", "PER NODE");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < PERF_COUNTERS; i++)
+    {
+        if (v[i] == PERF_UNAVAILABLE)
+        {
+            fprintf(fp, "%-30s %16s %12s %12s\n", perf_events[i].name, "n/a", "n/a", "n/a");
+        }
+        else
+        {
+            fprintf(fp, "%-30s %16lld %12.1f %12.1f\n", perf_events[i].name, v[i],
+                    leaves > 0 ? (double)v[i] / leaves : 0.0,
+                    nodes > 0 ? (double)v[i] / nodes : 0.0);
+        }
+    }
+    if (v[PERF_CYCLES] > 0 && v[PERF_INSTRUCTIONS] != PERF_UNAVAILABLE)
+    {
+        fprintf(fp, "%-30s %16.2f\n", "IPC", (double)v[PERF_INSTRUCTIONS] / v[PERF_CYCLES]);
+    }
+    if (pc->error != 0)
+    {
+        fprintf(fp, "Some counters unavailable: %s (perf_event_paranoid = %d)\n",
+                strerror(pc->error), PerfParanoid());
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void PrintRate(FILE *fp, long long value, long size)
+{
+    if (value == PERF_UNAVAILABLE)
+    {
+        fprintf(fp, " %9s", "n/a");
+    }
+    else if (size <= 0)
+    {
+        fprintf(fp, " %9s", "-");
+    }
+    else
+    {
+        fprintf(fp, " %9.1f", (double)value / size);
+    }
+}
+
+static int PerfParanoid(void)
+{
+    int ret = -99;
+    FILE *fp = fopen(PERF_PARANOID_FILE, "r");
+
+    if (fp)
+    {
+        if (fscanf(fp, "%d", &ret) != 1)
+        {
+            ret = -99;
+        }
+        fclose(fp);
+    }
+
+    return ret;
+}
@@ -0,0 +1,299 @@
+/**
+ * @file placement.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Huge-page allocation, NUMA-aware thread pinning and memory counters
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#define _GNU_SOURCE                     /* CPU_SET, pthread_setaffinity_np */
+#include "../inc/placement.h"
+
+#include <stdio.h>                      /* fopen, sscanf */
+#include <string.h>                     /* strchr, memset */
+#include <stdint.h>                     /* uintptr_t */
+#include <pthread.h>                    /* pthread_once, affinity */
+#include <sched.h>                      /* cpu_set_t */
+#include <unistd.h>                     /* sysconf */
+#include <sys/mman.h>                   /* mmap, madvise */
+#include <sys/resource.h>               /* getrusage */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+atomic_long placement_allocs[PLACEMENT_MODES];
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* NUMA topology and counters exposed by the kernel */
+#define NODE_CPULIST_FORMAT  "/sys/devices/system/node/node%d/cpulist"
+#define NUMA_MAPS            "/proc/self/numa_maps"
+#define SMAPS_ROLLUP         "/proc/self/smaps_rollup"
+
+/* Longest line of numa_maps read, the file name included */
+#define NUMA_MAPS_LINE 4096
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Lists the CPUs node by node, once for the process.
+ */
+static void ReadTopology(void);
+
+/**
+ * @brief Adds the pages of one numa_maps mapping to the memory per node.
+ *
+ * @param line Line of /proc/self/numa_maps.
+ * @param node_kb Memory per node, in kB.
+ */
+static void AddNumaMapping(const char *line, long *node_kb);
+
+/**
+ * @brief Appends the CPUs of a cpulist ("0-3,8-11") to the CPU order.
+ *
+ * @param list Content of a cpulist file.
+ */
+static void AppendCpuList(const char *list);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* CPUs ordered node by node */
+static int cpu_order[CPU_SETSIZE];
+static int n_cpus = 0;
+static pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+void *PlacementAlloc(size_t bytes, enum placement_huge_t mode, size_t *mapped)
+{
+    size_t size = (bytes + PLACEMENT_HUGE_PAGE - 1) & ~(PLACEMENT_HUGE_PAGE - 1);
+    enum placement_huge_t used = PLACEMENT_PLAIN;
+    unsigned char *block = MAP_FAILED;
+
+    if (mode == PLACEMENT_HUGETLB)
+    {
+        /* fails at once when no huge page is reserved */
+        block = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        used = PLACEMENT_HUGETLB;
+    }
+
+    if (block == MAP_FAILED)
+    {
+        /* over-map to align the block on a huge page boundary */
+        unsigned char *raw = mmap(NULL, size + PLACEMENT_HUGE_PAGE, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        used = PLACEMENT_PLAIN;
+        if (raw != MAP_FAILED)
+        {
+            uintptr_t aligned = ((uintptr_t)raw + PLACEMENT_HUGE_PAGE - 1) & ~(PLACEMENT_HUGE_PAGE - 1);
+            size_t head = aligned - (uintptr_t)raw;
+
+            if (head > 0)
+            {
+                munmap(raw, head);
+            }
+            munmap((unsigned char *)aligned + size, PLACEMENT_HUGE_PAGE - head);
+            block = (unsigned char *)aligned;
+
+            if (mode != PLACEMENT_PLAIN && madvise(block, size, MADV_HUGEPAGE) == 0)
+            {
+                used = PLACEMENT_THP;
+            }
+        }
+    }
+
+    if (block == MAP_FAILED)
+    {
+        perror("PlacementAlloc: mmap");
+        block = NULL;
+    }
+    else
+    {
+        atomic_fetch_add(&placement_allocs[used], 1);
+        *mapped = size;
+    }
+
+    return block;
+}
+
+void PlacementFree(void *block, size_t mapped)
+{
+    if (block)
+    {
+        munmap(block, mapped);
+    }
+}
+
+int PlacementCpu(int worker, int n_workers)
+{
+    int ret = 0;
+
+    pthread_once(&topology_once, ReadTopology);
+    if (n_cpus > 0 && n_workers > 0)
+    {
+        ret = cpu_order[(long)worker * n_cpus / n_workers % n_cpus];
+    }
+
+    return ret;
+}
+
+bool PlacementPin(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void PlacementSample(struct placement_stats_t *stats)
+{
+    struct rusage ru;
+    char line[NUMA_MAPS_LINE];
+    FILE *fp;
+
+    memset(stats, 0, sizeof(*stats));
+    if (getrusage(RUSAGE_SELF, &ru) == 0)
+    {
+        stats->minflt = ru.ru_minflt;
+        stats->majflt = ru.ru_majflt;
+    }
+
+    fp = fopen(SMAPS_ROLLUP, "r");
+    if (fp)
+    {
+        while (fgets(line, sizeof(line), fp))
+        {
+            sscanf(line, "AnonHugePages: %ld kB", &stats->anon_huge_kb);
+        }
+        fclose(fp);
+    }
+
+    /* the pages of this process only, unlike the system-wide numastat */
+    fp = fopen(NUMA_MAPS, "r");
+    if (fp)
+    {
+        while (fgets(line, sizeof(line), fp))
+        {
+            AddNumaMapping(line, stats->node_kb);
+        }
+        fclose(fp);
+    }
+}
+
+const char *PlacementName(enum placement_huge_t mode)
+{
+    static const char *names[PLACEMENT_MODES] = { "plain", "thp", "hugetlb" };
+
+    return mode >= 0 && mode < PLACEMENT_MODES ? names[mode] : "?";
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void ReadTopology(void)
+{
+    char list[1024];
+
+    for (int node = 0; node < PLACEMENT_MAX_NODES; node++)
+    {
+        char filename[128];
+        FILE *fp;
+
+        snprintf(filename, sizeof(filename), NODE_CPULIST_FORMAT, node);
+        fp = fopen(filename, "r");
+        if (!fp)
+        {
+            break;
+        }
+        if (fgets(list, sizeof(list), fp))
+        {
+            AppendCpuList(list);
+        }
+        fclose(fp);
+    }
+
+    /* no NUMA information: the online CPUs in order */
+    if (n_cpus == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+        for (long cpu = 0; cpu < online && cpu < CPU_SETSIZE; cpu++)
+        {
+            cpu_order[n_cpus++] = (int)cpu;
+        }
+    }
+}
+
+static void AddNumaMapping(const char *line, long *node_kb)
+{
+    long pages[PLACEMENT_MAX_NODES] = {0};
+    long page_kb = 0;
+    const char *p = line;
+
+    /* "<address> <policy> ... N0=<pages> N1=<pages> kernelpagesize_kB=<kB>" */
+    while ((p = strchr(p, ' ')) != NULL)
+    {
+        int node;
+        long value;
+
+        p++;
+        if (sscanf(p, "N%d=%ld", &node, &value) == 2 && node >= 0 && node < PLACEMENT_MAX_NODES)
+        {
+            pages[node] += value;
+        }
+        else
+        {
+            sscanf(p, "kernelpagesize_kB=%ld", &page_kb);
+        }
+    }
+
+    for (int node = 0; node < PLACEMENT_MAX_NODES; node++)
+    {
+        node_kb[node] += pages[node] * page_kb;
+    }
+}
+
+static void AppendCpuList(const char *list)
+{
+    const char *p = list;
+    int first, last, used;
+
+    while (sscanf(p, "%d%n", &first, &used) == 1)
+    {
+        p += used;
+        last = first;
+        if (*p == '-' && sscanf(p + 1, "%d%n", &last, &used) == 1)
+        {
+            p += 1 + used;
+        }
+        for (int cpu = first; cpu <= last && n_cpus < CPU_SETSIZE; cpu++)
+        {
+            cpu_order[n_cpus++] = cpu;
+        }
+        if (*p != ',')
+        {
+            break;
+        }
+        p++;
+    }
+}
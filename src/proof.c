@@ -0,0 +1,338 @@
+/**
+ * @file proof.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Inclusion proofs of a leaf in a k-ary Merkle tree
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/proof.h"
+#include "../inc/diff.h"
+#include "../inc/mem.h"                 /* MemAlloc, MemFree */
+
+#include <limits.h>                     /* INT_MAX */
+#include <arpa/inet.h>                  /* htonl, ntohl */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Largest arity accepted from an encoded proof */
+#define PROOF_MAX_ARITY 256
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* Bytes allocated for the siblings: at least one, a single leaf tree has none */
+#define PROOF_SIBLINGS_SIZE(proof) (ProofSize(proof) - PROOF_HEADER_SIZE + 1)
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Allocates the siblings of a proof with its shape set.
+ *
+ * @param proof Proof with leaf, n_leaves, arity and n_levels set.
+ * @retval true  Success.
+ * @retval false Allocation failure.
+ */
+static bool ProofAlloc(struct merkle_proof_t *proof);
+
+/**
+ * @brief Returns the number of nodes of a group of siblings.
+ *
+ * @param proof Proof giving the shape of the tree.
+ * @param first Index of the first node of the group.
+ * @param count Real nodes of the level.
+ * @return arity for a padded tree, the nodes left otherwise.
+ */
+static int ProofGroup(const struct merkle_proof_t *proof, long first, int count);
+
+/**
+ * @brief Writes the header of a proof in network order.
+ *
+ * @param proof Proof with its shape set.
+ * @param buf Destination of PROOF_HEADER_SIZE bytes.
+ */
+static void ProofEncodeHeader(const struct merkle_proof_t *proof, unsigned char *buf);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool ProofBuild(const struct merkle_levels_t *lv, int leaf, struct merkle_proof_t *proof)
+{
+    struct level_source_t src;
+
+    LevelsSource(lv, &src);
+
+    return ProofBuildFromSource(&src, leaf, proof);
+}
+
+bool ProofBuildFromSource(const struct level_source_t *src, int leaf,
+                          struct merkle_proof_t *proof)
+{
+    bool ret = false;
+
+    memset(proof, 0, sizeof(*proof));
+    /* a proof counts the leaves of its tree in an int */
+    if (leaf >= 0 && leaf < src->n_leaves && src->n_leaves <= INT_MAX &&
+        src->arity <= PROOF_MAX_ARITY)
+    {
+        proof->leaf = leaf;
+        proof->n_leaves = src->n_leaves;
+        proof->arity = src->arity;
+        proof->padding = src->padding;
+        proof->n_levels = src->n_levels;
+        ret = ProofAlloc(proof);
+    }
+
+    if (ret)
+    {
+        unsigned char group_hashes[PROOF_MAX_ARITY * SHA256_DIGEST_LENGTH];
+        unsigned char *sibling = proof->siblings;
+        long idx = leaf;
+        int count = (int)src->n_leaves;
+
+        for (int l = 0; l < src->n_levels - 1 && ret; l++)
+        {
+            long first = idx - idx % src->arity;
+            int group = ProofGroup(proof, first, count);
+            int pos = (int)(idx - first);
+
+            /* the whole group in one read, minus the node on the path */
+            ret = src->read(src->ctx, l, first, group, group_hashes);
+            if (ret)
+            {
+                size_t left = (size_t)pos * SHA256_DIGEST_LENGTH;
+                size_t right = (size_t)(group - 1 - pos) * SHA256_DIGEST_LENGTH;
+
+                memcpy(sibling, group_hashes, left);
+                memcpy(sibling + left, group_hashes + left + SHA256_DIGEST_LENGTH, right);
+                sibling += left + right;
+            }
+            idx /= src->arity;
+            count = (count + src->arity - 1) / src->arity;
+        }
+
+        if (!ret)
+        {
+            fprintf(stderr, "ProofBuildFromSource: unable to read level hashes\n");
+            ProofFree(proof);
+        }
+    }
+
+    return ret;
+}
+
+bool ProofVerify(const struct merkle_proof_t *proof,
+                 const unsigned char leaf_hash[SHA256_DIGEST_LENGTH],
+                 const unsigned char root[SHA256_DIGEST_LENGTH])
+{
+    bool ret = proof->arity >= 2 && proof->arity <= PROOF_MAX_ARITY;
+    unsigned char children[PROOF_MAX_ARITY * SHA256_DIGEST_LENGTH];
+    unsigned char node[SHA256_DIGEST_LENGTH];
+    const unsigned char *sibling = proof->siblings;
+    long idx = proof->leaf;
+    int count = proof->n_leaves;
+    int k = proof->arity;
+
+    memcpy(node, leaf_hash, SHA256_DIGEST_LENGTH);
+    for (int l = 0; l < proof->n_levels - 1 && ret; l++)
+    {
+        int pos = (int)(idx % k);
+        int group = ProofGroup(proof, idx - pos, count);
+
+        /* a promoted node keeps its hash */
+        if (group > 1)
+        {
+            /* put the node back among its siblings */
+            size_t left = (size_t)pos * SHA256_DIGEST_LENGTH;
+            size_t right = (size_t)(group - 1 - pos) * SHA256_DIGEST_LENGTH;
+
+            memcpy(children, sibling, left);
+            memcpy(children + left, node, SHA256_DIGEST_LENGTH);
+            memcpy(children + left + SHA256_DIGEST_LENGTH, sibling + left, right);
+            sibling += left + right;
+
+            ret = HashChildren(children, group, node);
+        }
+        idx /= k;
+        count = (count + k - 1) / k;
+    }
+
+    return ret && !HashDiffers(node, root);
+}
+
+size_t ProofSize(const struct merkle_proof_t *proof)
+{
+    size_t ret = PROOF_HEADER_SIZE;
+    long idx = proof->leaf;
+    int count = proof->n_leaves;
+
+    for (int l = 0; l < proof->n_levels - 1; l++)
+    {
+        ret += (size_t)(ProofGroup(proof, idx - idx % proof->arity, count) - 1) *
+               SHA256_DIGEST_LENGTH;
+        idx /= proof->arity;
+        count = (count + proof->arity - 1) / proof->arity;
+    }
+
+    return ret;
+}
+
+size_t ProofEncode(const struct merkle_proof_t *proof, unsigned char *buf, size_t size)
+{
+    size_t ret = ProofSize(proof);
+
+    if (ret <= size)
+    {
+        ProofEncodeHeader(proof, buf);
+        memcpy(buf + PROOF_HEADER_SIZE, proof->siblings, ret - PROOF_HEADER_SIZE);
+    }
+    else
+    {
+        ret = 0;
+    }
+
+    return ret;
+}
+
+size_t ProofEncodeFromLevels(const struct merkle_levels_t *lv, int leaf, unsigned char *buf,
+                             size_t size)
+{
+    size_t ret = 0;
+    struct merkle_proof_t proof = {
+        .leaf = leaf,
+        .n_leaves = (int)lv->n_leaves,
+        .arity = lv->arity,
+        .padding = lv->padding,
+        .n_levels = lv->n_levels,
+    };
+
+    /* the checks of ProofBuildFromSource() */
+    if (leaf >= 0 && leaf < lv->n_leaves && lv->n_leaves <= INT_MAX &&
+        lv->arity <= PROOF_MAX_ARITY && ProofSize(&proof) <= size)
+    {
+        unsigned char *sibling = buf + PROOF_HEADER_SIZE;
+        long idx = leaf;
+        int count = proof.n_leaves;
+
+        ProofEncodeHeader(&proof, buf);
+        for (int l = 0; l < lv->n_levels - 1; l++)
+        {
+            long first = idx - idx % lv->arity;
+            int group = ProofGroup(&proof, first, count);
+            int pos = (int)(idx - first);
+            size_t left = (size_t)pos * SHA256_DIGEST_LENGTH;
+            size_t right = (size_t)(group - 1 - pos) * SHA256_DIGEST_LENGTH;
+
+            /* the group minus the node on the path, from the level itself */
+            memcpy(sibling, LEVEL_HASH(lv, l, first), left);
+            memcpy(sibling + left, LEVEL_HASH(lv, l, idx + 1), right);
+            sibling += left + right;
+            idx /= lv->arity;
+            count = (count + lv->arity - 1) / lv->arity;
+        }
+        ret = (size_t)(sibling - buf);
+    }
+
+    return ret;
+}
+
+bool ProofDecode(const unsigned char *buf, size_t size, struct merkle_proof_t *proof)
+{
+    bool ret = false;
+    uint32_t header[5];
+
+    memset(proof, 0, sizeof(*proof));
+    if (size >= PROOF_HEADER_SIZE)
+    {
+        memcpy(header, buf, PROOF_HEADER_SIZE);
+        proof->leaf = (int)ntohl(header[0]);
+        proof->n_leaves = (int)ntohl(header[1]);
+        proof->arity = (int)ntohl(header[2]);
+        proof->padding = (enum merkle_padding_t)ntohl(header[3]);
+        proof->n_levels = (int)ntohl(header[4]);
+
+        ret = proof->arity >= 2 && proof->arity <= PROOF_MAX_ARITY &&
+              proof->padding <= PADDING_PROMOTE &&
+              proof->n_levels >= 1 && proof->n_levels <= LEVELS_MAX &&
+              proof->leaf >= 0 && proof->leaf < proof->n_leaves &&
+              ProofSize(proof) == size && ProofAlloc(proof);
+    }
+
+    if (ret)
+    {
+        memcpy(proof->siblings, buf + PROOF_HEADER_SIZE, size - PROOF_HEADER_SIZE);
+    }
+    else
+    {
+        fprintf(stderr, "ProofDecode: malformed proof\n");
+        memset(proof, 0, sizeof(*proof));
+    }
+
+    return ret;
+}
+
+void ProofFree(struct merkle_proof_t *proof)
+{
+    MemFree(MEM_PROOFS, proof->siblings, PROOF_SIBLINGS_SIZE(proof));
+    memset(proof, 0, sizeof(*proof));
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static int ProofGroup(const struct merkle_proof_t *proof, long first, int count)
+{
+    int ret = proof->arity;
+
+    if (proof->padding == PADDING_PROMOTE && count - first < ret)
+    {
+        ret = (int)(count - first);
+    }
+
+    return ret;
+}
+
+static void ProofEncodeHeader(const struct merkle_proof_t *proof, unsigned char *buf)
+{
+    uint32_t header[5] = {
+        htonl((uint32_t)proof->leaf),
+        htonl((uint32_t)proof->n_leaves),
+        htonl((uint32_t)proof->arity),
+        htonl((uint32_t)proof->padding),
+        htonl((uint32_t)proof->n_levels),
+    };
+
+    memcpy(buf, header, PROOF_HEADER_SIZE);
+}
+
+static bool ProofAlloc(struct merkle_proof_t *proof)
+{
+    proof->siblings = MemAlloc(MEM_PROOFS, PROOF_SIBLINGS_SIZE(proof));
+
+    if (!proof->siblings)
+    {
+        fprintf(stderr, "ProofAlloc: allocation failed\n");
+    }
+
+    return proof->siblings != NULL;
+}
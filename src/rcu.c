@@ -0,0 +1,597 @@
+/**
+ * @file rcu.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Copy-on-write tree with epoch-based reclamation: readers never block the writer
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/rcu.h"
+#include "../inc/mem.h"                 /* MemAlloc, MemRealloc, MemFree */
+
+#include <stdio.h>                      /* fprintf */
+#include <string.h>                     /* memcpy, memset */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Initial room of the retired list */
+#define RCU_RETIRED_MIN 256
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* Size of a node with n children */
+#define RCU_NODE_SIZE(n) (sizeof(struct rcu_node_t) + (size_t)(n) * sizeof(struct rcu_node_t *))
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Copies a node, children pointers included.
+ *
+ * @param node Node to copy.
+ * @param born Version of the copy.
+ * @return Copy, NULL on allocation failure.
+ */
+static struct rcu_node_t *RcuCopy(const struct rcu_node_t *node, unsigned long born);
+
+/**
+ * @brief Appends a replaced node to the retired list, version set at publication.
+ *
+ * @param t Tree.
+ * @param node Node replaced by the update in progress.
+ * @retval true  Success.
+ * @retval false Allocation failure.
+ */
+static bool RcuRetire(struct merkle_rcu_t *t, struct rcu_node_t *node);
+
+/**
+ * @brief Prunes the versions beyond `keep`, publishes a root and reclaims.
+ *
+ * The oldest kept version moves and the pruned history slots are cleared
+ * first, so a reader that finds a stale slot rejects it. The new root is
+ * published next, then the nodes no kept version holds any more get the
+ * epoch closed last: a reader announced after it sees neither.
+ *
+ * @param t Tree, t->version already counting the new root.
+ * @param root Root of t->version to publish, NULL for none.
+ */
+static void RcuPrune(struct merkle_rcu_t *t, struct rcu_node_t *root);
+
+/**
+ * @brief Fills a snapshot from a history root, unless its version is pruned.
+ *
+ * @param t Tree.
+ * @param reader Slot of the calling thread, epoch announced.
+ * @param version Version to read.
+ * @param view Snapshot to fill.
+ * @retval true  Success.
+ * @retval false The version is not kept.
+ */
+static bool RcuOpen(struct merkle_rcu_t *t, int reader, unsigned long version,
+                    struct rcu_view_t *view);
+
+/**
+ * @brief Walks down a snapshot to a real node.
+ *
+ * @param t Tree.
+ * @param root Root of the snapshot.
+ * @param level Level of the node.
+ * @param idx Index of the node in its level.
+ * @return Node.
+ */
+static const struct rcu_node_t *RcuNodeAt(const struct merkle_rcu_t *t,
+                                          const struct rcu_node_t *root, int level, long idx);
+
+/**
+ * @brief Rehashes the nodes of a version, children first.
+ *
+ * @param t Tree.
+ * @param node Node of the new version.
+ * @param level Level of the node.
+ * @param version Version being built; older nodes are left as they are.
+ * @param scratch Room for arity hashes.
+ * @retval true  Success.
+ * @retval false Hashing failure.
+ */
+static bool RcuRehash(const struct merkle_rcu_t *t, struct rcu_node_t *node, int level,
+                      unsigned long version, unsigned char *scratch);
+
+/**
+ * @brief Frees the nodes of one version below a node (all when version is 0).
+ *
+ * @param node Subtree root.
+ * @param level Level of the node.
+ * @param version Version to free, 0 for every node.
+ */
+static void RcuFreeNodes(struct rcu_node_t *node, int level, unsigned long version);
+
+/**
+ * @brief Frees one node of the tree, NULL accepted.
+ */
+static void RcuNodeFree(struct rcu_node_t *node);
+
+/**
+ * @brief level_read_t of a snapshot.
+ */
+static bool RcuRead(void *ctx, int level, long first, int count, unsigned char *out);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool RcuFromLevels(const struct merkle_levels_t *lv, struct merkle_rcu_t *t)
+{
+    bool ret = lv->n_levels > 0 && lv->n_levels <= LEVELS_MAX;
+    struct rcu_node_t **below = NULL;
+    struct rcu_node_t **row = NULL;
+
+    memset(t, 0, sizeof(*t));
+    if (ret)
+    {
+        t->n_leaves = lv->n_leaves;
+        t->n_levels = lv->n_levels;
+        t->arity = lv->arity;
+        t->padding = lv->padding;
+        t->keep = 1;
+        atomic_init(&t->epoch, 1);
+        for (int l = 0; l < lv->n_levels; l++)
+        {
+            t->level_size[l] = lv->level_size[l];
+            t->real_size[l] = l ? (t->real_size[l - 1] + lv->arity - 1) / lv->arity : lv->n_leaves;
+            t->span[l] = LevelSpan(lv->arity, l);
+        }
+        below = MemAlloc(MEM_SCRATCH, (size_t)lv->n_leaves * sizeof(*below));
+        row = MemAlloc(MEM_SCRATCH, (size_t)lv->n_leaves * sizeof(*row));
+        ret = below && row;
+    }
+
+    /* one row of nodes per level, each pointing to its real children */
+    for (int l = 0; l < lv->n_levels && ret; l++)
+    {
+        for (int i = 0; i < t->real_size[l] && ret; i++)
+        {
+            int first = i * lv->arity;
+            int n_children = l == 0 ? 0 : t->real_size[l - 1] - first;
+
+            n_children = n_children < lv->arity ? n_children : lv->arity;
+            row[i] = MemAlloc(MEM_NODES, RCU_NODE_SIZE(n_children));
+            ret = row[i] != NULL;
+            if (ret)
+            {
+                memcpy(row[i]->hash, LEVEL_HASH(lv, l, i), SHA256_DIGEST_LENGTH);
+                row[i]->born = 0;
+                row[i]->n_children = n_children;
+                memcpy(row[i]->child, below + first, (size_t)n_children * sizeof(*below));
+            }
+            else
+            {
+                /* the rows below are unreachable from this one: free them */
+                for (int j = 0; j < i; j++)
+                {
+                    RcuFreeNodes(row[j], l, 0);
+                }
+                for (int j = i * lv->arity; l > 0 && j < t->real_size[l - 1]; j++)
+                {
+                    RcuFreeNodes(below[j], l - 1, 0);
+                }
+            }
+        }
+
+        struct rcu_node_t **swap = below;
+        below = row;
+        row = swap;
+    }
+
+    if (ret)
+    {
+        atomic_init(&t->root, below[0]);
+        atomic_init(&t->history[0], below[0]);
+    }
+    else
+    {
+        fprintf(stderr, "RcuFromLevels: empty tree or allocation failure\n");
+    }
+    MemFree(MEM_SCRATCH, below, (size_t)t->n_leaves * sizeof(*below));
+    MemFree(MEM_SCRATCH, row, (size_t)t->n_leaves * sizeof(*row));
+
+    return ret;
+}
+
+void RcuAcquire(struct merkle_rcu_t *t, int reader, struct rcu_view_t *view)
+{
+    /* announce the epoch before reading the root: a root replaced after
+     * this point is retired in this epoch or a later one */
+    atomic_store(&t->reader[reader], atomic_load(&t->epoch));
+    view->tree = t;
+    view->reader = reader;
+    view->root = atomic_load(&t->root);
+    /* every update copies the root */
+    view->version = view->root->born;
+}
+
+bool RcuAcquireVersion(struct merkle_rcu_t *t, int reader, unsigned long version,
+                       struct rcu_view_t *view)
+{
+    bool ret;
+
+    atomic_store(&t->reader[reader], atomic_load(&t->epoch));
+    ret = RcuOpen(t, reader, version, view);
+    if (!ret)
+    {
+        atomic_store(&t->reader[reader], 0);
+    }
+
+    return ret;
+}
+
+void RcuRelease(struct merkle_rcu_t *t, struct rcu_view_t *view)
+{
+    atomic_store(&t->reader[view->reader], 0);
+    view->root = NULL;
+}
+
+const unsigned char *RcuRoot(const struct rcu_view_t *view)
+{
+    return view->root->hash;
+}
+
+void RcuSource(const struct rcu_view_t *view, struct level_source_t *src)
+{
+    *src = (struct level_source_t){
+        .n_leaves = view->tree->n_leaves,
+        .n_levels = view->tree->n_levels,
+        .arity = view->tree->arity,
+        .padding = view->tree->padding,
+        .level_size = view->tree->level_size,
+        .read = RcuRead,
+        .ctx = (void *)view,
+    };
+}
+
+bool RcuUpdate(struct merkle_rcu_t *t, const int *leaves, const unsigned char *hashes, int count)
+{
+    unsigned long version = t->version + 1;
+    struct rcu_node_t *old = atomic_load(&t->root);
+    struct rcu_node_t *root = NULL;
+    unsigned char *scratch = MemAlloc(MEM_SCRATCH, (size_t)t->arity * SHA256_DIGEST_LENGTH);
+    size_t mark = t->n_retired;
+    bool ret = scratch != NULL && count >= 0;
+
+    for (int i = 0; i < count && ret; i++)
+    {
+        ret = leaves[i] >= 0 && leaves[i] < t->n_leaves;
+    }
+
+    if (ret)
+    {
+        root = RcuCopy(old, version);
+        ret = root && RcuRetire(t, old);
+    }
+
+    /* copy each path once: nodes of this version are private until published */
+    for (int i = 0; i < count && ret; i++)
+    {
+        struct rcu_node_t *node = root;
+
+        for (int l = t->n_levels - 1; l > 0 && ret; l--)
+        {
+            int pos = (int)(leaves[i] / t->span[l - 1] % t->arity);
+            struct rcu_node_t *child = node->child[pos];
+
+            if (child->born != version)
+            {
+                struct rcu_node_t *copy = RcuCopy(child, version);
+
+                ret = copy && RcuRetire(t, child);
+                if (ret)
+                {
+                    node->child[pos] = copy;
+                }
+                else
+                {
+                    RcuNodeFree(copy);
+                }
+                child = copy;
+            }
+            node = child;
+        }
+        if (ret)
+        {
+            memcpy(node->hash, hashes + (size_t)i * SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH);
+        }
+    }
+
+    ret = ret && RcuRehash(t, root, t->n_levels - 1, version, scratch);
+
+    if (ret)
+    {
+        for (size_t r = mark; r < t->n_retired; r++)
+        {
+            t->retired[r].died = version;
+        }
+        t->version = version;
+
+        RcuPrune(t, root);
+    }
+    else
+    {
+        fprintf(stderr, "RcuUpdate: invalid leaf, allocation or hashing failure\n");
+        if (root)
+        {
+            RcuFreeNodes(root, t->n_levels - 1, version);
+        }
+        t->n_retired = mark;
+    }
+    MemFree(MEM_SCRATCH, scratch, (size_t)t->arity * SHA256_DIGEST_LENGTH);
+
+    return ret;
+}
+
+bool RcuRetain(struct merkle_rcu_t *t, int keep)
+{
+    bool ret = keep >= 1 && keep <= RCU_MAX_VERSIONS;
+
+    if (ret)
+    {
+        t->keep = keep;
+        RcuPrune(t, NULL);
+    }
+    else
+    {
+        fprintf(stderr, "RcuRetain: %d versions out of range\n", keep);
+    }
+
+    return ret;
+}
+
+size_t RcuReclaim(struct merkle_rcu_t *t)
+{
+    unsigned long oldest = atomic_load(&t->epoch);
+    size_t kept = 0;
+
+    /* the oldest epoch a reader may still be in */
+    for (int r = 0; r < RCU_MAX_READERS; r++)
+    {
+        unsigned long epoch = atomic_load(&t->reader[r]);
+
+        if (epoch && epoch < oldest)
+        {
+            oldest = epoch;
+        }
+    }
+
+    for (size_t r = 0; r < t->n_retired; r++)
+    {
+        if (t->retired[r].epoch && t->retired[r].epoch < oldest)
+        {
+            RcuNodeFree(t->retired[r].node);
+            t->freed++;
+        }
+        else
+        {
+            t->retired[kept++] = t->retired[r];
+        }
+    }
+    t->n_retired = kept;
+
+    return kept;
+}
+
+void RcuFree(struct merkle_rcu_t *t)
+{
+    struct rcu_node_t *root = atomic_load(&t->root);
+
+    if (root)
+    {
+        RcuFreeNodes(root, t->n_levels - 1, 0);
+    }
+    for (size_t r = 0; r < t->n_retired; r++)
+    {
+        RcuNodeFree(t->retired[r].node);
+    }
+    MemFree(MEM_NODES, t->retired, t->retired_cap * sizeof(*t->retired));
+    memset(t, 0, sizeof(*t));
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static struct rcu_node_t *RcuCopy(const struct rcu_node_t *node, unsigned long born)
+{
+    struct rcu_node_t *copy = MemAlloc(MEM_NODES, RCU_NODE_SIZE(node->n_children));
+
+    if (copy)
+    {
+        memcpy(copy, node, RCU_NODE_SIZE(node->n_children));
+        copy->born = born;
+    }
+
+    return copy;
+}
+
+static bool RcuRetire(struct merkle_rcu_t *t, struct rcu_node_t *node)
+{
+    bool ret = true;
+
+    if (t->n_retired == t->retired_cap)
+    {
+        size_t cap = t->retired_cap ? t->retired_cap * 2 : RCU_RETIRED_MIN;
+        struct rcu_retired_t *retired = MemRealloc(MEM_NODES, t->retired,
+                                                   t->retired_cap * sizeof(*retired),
+                                                   cap * sizeof(*retired));
+
+        ret = retired != NULL;
+        if (ret)
+        {
+            t->retired = retired;
+            t->retired_cap = cap;
+        }
+    }
+
+    if (ret)
+    {
+        t->retired[t->n_retired++] = (struct rcu_retired_t){ .node = node };
+    }
+
+    return ret;
+}
+
+static void RcuPrune(struct merkle_rcu_t *t, struct rcu_node_t *root)
+{
+    unsigned long oldest = atomic_load(&t->oldest);
+
+    if (t->version + 1 > oldest + t->keep)
+    {
+        unsigned long pruned = oldest;
+
+        oldest = t->version + 1 - t->keep;
+        atomic_store(&t->oldest, oldest);
+        for (unsigned long v = pruned; v < oldest; v++)
+        {
+            atomic_store(&t->history[v % RCU_MAX_VERSIONS], NULL);
+        }
+    }
+
+    /* the history slot of the new root may be the one just cleared */
+    if (root)
+    {
+        atomic_store(&t->history[t->version % RCU_MAX_VERSIONS], root);
+        atomic_store(&t->root, root);
+    }
+
+    /* readers announced after this epoch reach neither the replaced
+     * nodes nor a pruned version */
+    unsigned long epoch = atomic_fetch_add(&t->epoch, 1);
+    for (size_t r = 0; r < t->n_retired; r++)
+    {
+        if (t->retired[r].epoch == 0 && t->retired[r].died <= oldest)
+        {
+            t->retired[r].epoch = epoch;
+        }
+    }
+    RcuReclaim(t);
+}
+
+static bool RcuOpen(struct merkle_rcu_t *t, int reader, unsigned long version,
+                    struct rcu_view_t *view)
+{
+    view->tree = t;
+    view->reader = reader;
+    view->version = version;
+    view->root = atomic_load(&t->history[version % RCU_MAX_VERSIONS]);
+
+    /* a pruned slot is cleared and a reused one moved the oldest past
+     * version: both checked before the root is dereferenced */
+    return view->root && version >= atomic_load(&t->oldest) && view->root->born == version;
+}
+
+static const struct rcu_node_t *RcuNodeAt(const struct merkle_rcu_t *t,
+                                          const struct rcu_node_t *root, int level, long idx)
+{
+    const struct rcu_node_t *node = root;
+
+    for (int l = t->n_levels - 1; l > level; l--)
+    {
+        node = node->child[idx / t->span[l - 1 - level] % t->arity];
+    }
+
+    return node;
+}
+
+static bool RcuRehash(const struct merkle_rcu_t *t, struct rcu_node_t *node, int level,
+                      unsigned long version, unsigned char *scratch)
+{
+    bool ret = true;
+
+    if (level > 0 && node->born == version)
+    {
+        for (int c = 0; c < node->n_children && ret; c++)
+        {
+            ret = RcuRehash(t, node->child[c], level - 1, version, scratch);
+        }
+
+        /* the children are done with scratch by now */
+        for (int c = 0; c < node->n_children && ret; c++)
+        {
+            memcpy(scratch + (size_t)c * SHA256_DIGEST_LENGTH, node->child[c]->hash,
+                   SHA256_DIGEST_LENGTH);
+        }
+        ret = ret && LevelsHashUp(scratch, node->n_children, t->arity, t->padding, node->hash) == 1;
+    }
+
+    return ret;
+}
+
+static void RcuFreeNodes(struct rcu_node_t *node, int level, unsigned long version)
+{
+    if (version == 0 || node->born == version)
+    {
+        for (int c = 0; c < node->n_children && level > 0; c++)
+        {
+            RcuFreeNodes(node->child[c], level - 1, version);
+        }
+        RcuNodeFree(node);
+    }
+}
+
+static void RcuNodeFree(struct rcu_node_t *node)
+{
+    if (node)
+    {
+        MemFree(MEM_NODES, node, RCU_NODE_SIZE(node->n_children));
+    }
+}
+
+static bool RcuRead(void *ctx, int level, long first, int count, unsigned char *out)
+{
+    const struct rcu_view_t *view = ctx;
+    const struct merkle_rcu_t *t = view->tree;
+    bool ret = level >= 0 && level < t->n_levels && first >= 0 &&
+               first + count <= t->level_size[level];
+
+    if (ret && level == t->n_levels - 1)
+    {
+        memcpy(out, view->root->hash, SHA256_DIGEST_LENGTH);
+    }
+    else
+    {
+        /* one walk per parent, the padding copies its last real child */
+        while (ret && count > 0)
+        {
+            const struct rcu_node_t *parent = RcuNodeAt(t, view->root, level + 1, first / t->arity);
+
+            do
+            {
+                int pos = (int)(first % t->arity);
+                const struct rcu_node_t *child = parent->child[pos < parent->n_children ?
+                                                               pos : parent->n_children - 1];
+
+                memcpy(out, child->hash, SHA256_DIGEST_LENGTH);
+                out += SHA256_DIGEST_LENGTH;
+                first++;
+                count--;
+            } while (count > 0 && first % t->arity != 0);
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,420 @@
+/**
+ * @file results.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Machine-readable benchmark results and their comparison with a baseline
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/results.h"
+#include "../inc/utils.h"               /* Median, CompareDoubles */
+
+#include <math.h>                       /* erfc, sqrt */
+#include <stdlib.h>                     /* calloc, qsort, strtod */
+#include <string.h>                     /* strstr */
+#include <time.h>                       /* time */
+#include <unistd.h>                     /* sysconf */
+#include <sys/utsname.h>                /* uname */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Revision of the build, set by the Makefile */
+#ifndef MERKLE_GIT_REV
+#define MERKLE_GIT_REV "unknown"
+#endif
+
+/* Length of a record line and of its string members */
+#define RESULTS_LINE_LEN  1024
+#define RESULTS_FIELD_LEN 128
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Samples of one metric on both sides */
+struct results_metric_t {
+    char name[RESULTS_NAME_LEN];
+    enum results_better_t better;
+    double samples[2][RESULTS_MAX_SAMPLES]; /* baseline, current */
+    int n[2];
+};
+
+/* Origin of the records of one side */
+struct results_origin_t {
+    char rev[RESULTS_FIELD_LEN];        /* revision kept */
+    char host[RESULTS_FIELD_LEN];
+    int records;                        /* records of the revision */
+    int others;                         /* records of other revisions, left out */
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Copies the revision of the last record of a stream, then rewinds it.
+ */
+static void LastRevision(FILE *fp, char *rev, size_t size);
+
+/**
+ * @brief Reads the records of one revision of one side into the metrics.
+ *
+ * The newest RESULTS_MAX_SAMPLES samples of a metric are kept.
+ *
+ * @param fp Records.
+ * @param side 0 for the baseline, 1 for the current results.
+ * @param metrics Metrics found so far.
+ * @param n_metrics Number of metrics, updated.
+ * @param origin Revision to keep; receives the host and the record counts.
+ */
+static void ReadRecords(FILE *fp, int side, struct results_metric_t *metrics, int *n_metrics,
+                        struct results_origin_t *origin);
+
+/**
+ * @brief Copies the string member `key` of a record line.
+ *
+ * @retval true  Member found.
+ * @retval false No such string member.
+ */
+static bool JsonString(const char *line, const char *key, char *out, size_t size);
+
+/**
+ * @brief Reads the number member `key` of a record line.
+ *
+ * @retval true  Member found.
+ * @retval false No such number member.
+ */
+static bool JsonNumber(const char *line, const char *key, double *out);
+
+/**
+ * @brief Copies a string, replacing the characters JSON would escape.
+ */
+static void CopySanitized(char *dst, size_t size, const char *src);
+
+/**
+ * @brief Two-sided p-value of the Mann-Whitney U test (normal approximation,
+ *        tie-corrected), 1 when it cannot be computed.
+ */
+static double MannWhitneyP(const double *a, int na, const double *b, int nb);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* Names of the directions in the records */
+static const char *better_names[] = { "lower", "higher" };
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+void ResultsStart(struct results_t *r, FILE *fp)
+{
+    struct utsname sys;
+    char host[RESULTS_FIELD_LEN] = "unknown";
+    char kernel[RESULTS_FIELD_LEN] = "unknown";
+    char cpu[RESULTS_FIELD_LEN] = "unknown";
+    char line[RESULTS_LINE_LEN];
+    FILE *cpuinfo = fopen("/proc/cpuinfo", "r");
+
+    if (uname(&sys) == 0)
+    {
+        CopySanitized(host, sizeof(host), sys.nodename);
+        CopySanitized(kernel, sizeof(kernel), sys.release);
+    }
+    while (cpuinfo && fgets(line, sizeof(line), cpuinfo))
+    {
+        char *colon = strchr(line, ':');
+
+        if (strncmp(line, "model name", 10) == 0 && colon)
+        {
+            colon[strcspn(colon, "\n")] = '\0';
+            CopySanitized(cpu, sizeof(cpu), colon + 2);
+            break;
+        }
+    }
+    if (cpuinfo)
+    {
+        fclose(cpuinfo);
+    }
+
+    r->fp = fp;
+    snprintf(r->tag, sizeof(r->tag),
+             "\"rev\":\"%s\",\"host\":\"%s\",\"cpu\":\"%s\",\"cpus\":%ld,\"kernel\":\"%s\",\"time\":%ld",
+             MERKLE_GIT_REV, host, cpu, sysconf(_SC_NPROCESSORS_ONLN), kernel, (long)time(NULL));
+}
+
+void ResultsRecord(const struct results_t *r, const char *metric, double value, const char *unit,
+                   enum results_better_t better)
+{
+    if (r->fp)
+    {
+        fprintf(r->fp, "{%s,\"metric\":\"%s\",\"value\":%.9g,\"unit\":\"%s\",\"better\":\"%s\"}\n",
+                r->tag, metric, value, unit, better_names[better]);
+        fflush(r->fp);
+    }
+}
+
+int ResultsCompare(FILE *baseline, FILE *current, const struct results_compare_t *opt, FILE *out)
+{
+    int ret = 0;
+    int n_metrics = 0;
+    int skipped = 0;
+    struct results_origin_t origin[2] = {{{0}}};
+    struct results_metric_t *metrics = calloc(RESULTS_MAX_METRICS, sizeof(*metrics));
+    bool ok = metrics != NULL;
+
+    if (!ok)
+    {
+        fprintf(stderr, "ResultsCompare: allocation failed\n");
+    }
+    else
+    {
+        FILE *streams[2] = { baseline, current };
+
+        for (int side = 0; side < 2; side++)
+        {
+            if (opt->rev[side])
+            {
+                snprintf(origin[side].rev, sizeof(origin[side].rev), "%s", opt->rev[side]);
+            }
+            else
+            {
+                LastRevision(streams[side], origin[side].rev, sizeof(origin[side].rev));
+            }
+            ReadRecords(streams[side], side, metrics, &n_metrics, &origin[side]);
+        }
+        ok = origin[0].records > 0 && origin[1].records > 0;
+        if (!ok)
+        {
+            fprintf(stderr, "ResultsCompare: no %s record\n", origin[0].records ? "current" : "baseline");
+        }
+    }
+
+    if (ok)
+    {
+        fprintf(out, "Baseline: rev %s on %s (%d samples, %d of other revisions left out)\n",
+                origin[0].rev, origin[0].host, origin[0].records, origin[0].others);
+        fprintf(out, "Current : rev %s on %s (%d samples, %d of other revisions left out)\n",
+                origin[1].rev, origin[1].host, origin[1].records, origin[1].others);
+        if (strcmp(origin[0].host, origin[1].host) != 0)
+        {
+            fprintf(out, "Warning: different hosts, the differences may not come from the code\n");
+        }
+        fprintf(out, "%-44s %6s %12s %12s %9s %8s  %s\n",
+            "METRIC", "N", "BASELINE", "CURRENT", "CHANGE %", "P", "STATUS");
+        fprintf(out, "--------------------------------------------------------------------------------------------------------\n");
+
+        for (int m = 0; m < n_metrics; m++)
+        {
+            struct results_metric_t *mt = &metrics[m];
+
+            if (mt->n[0] == 0 || mt->n[1] == 0)
+            {
+                skipped++;
+                continue;
+            }
+
+            double base = Median(mt->samples[0], mt->n[0]);
+            double cur = Median(mt->samples[1], mt->n[1]);
+            double change = base != 0.0 ? 100.0 * (cur - base) / fabs(base) : 0.0;
+            /* positive when worse, whatever the direction */
+            double worse = mt->better == RESULTS_LOWER ? change : -change;
+            bool few = mt->n[0] < RESULTS_MIN_SAMPLES || mt->n[1] < RESULTS_MIN_SAMPLES;
+            double p = MannWhitneyP(mt->samples[0], mt->n[0], mt->samples[1], mt->n[1]);
+            bool significant = few || p < opt->alpha;
+            const char *status = "same";
+
+            if (worse > opt->threshold && significant)
+            {
+                /* too few samples to conclude: shown, not counted */
+                status = few ? "worse (few samples)" : "REGRESSED";
+                ret += !few;
+            }
+            else if (-worse > opt->threshold && significant)
+            {
+                status = few ? "improved (few samples)" : "improved";
+            }
+            fprintf(out, "%-44s %2d/%-3d %12.4g %12.4g %+9.1f %8.3f  %s\n", mt->name, mt->n[0], mt->n[1],
+                    base, cur, change, p, status);
+        }
+        fprintf(out, "--------------------------------------------------------------------------------------------------------\n");
+        fprintf(out, "%d regressions beyond %.1f%% (alpha %.2f), %d metrics on one side only\n",
+                ret, opt->threshold, opt->alpha, skipped);
+    }
+    else
+    {
+        ret = -1;
+    }
+    free(metrics);
+
+    return ret;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void LastRevision(FILE *fp, char *rev, size_t size)
+{
+    char line[RESULTS_LINE_LEN];
+    char name[RESULTS_NAME_LEN];
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (JsonString(line, "metric", name, sizeof(name)))
+        {
+            JsonString(line, "rev", rev, size);
+        }
+    }
+    rewind(fp);
+}
+
+static void ReadRecords(FILE *fp, int side, struct results_metric_t *metrics, int *n_metrics,
+                        struct results_origin_t *origin)
+{
+    char line[RESULTS_LINE_LEN];
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        char name[RESULTS_NAME_LEN];
+        char better[RESULTS_FIELD_LEN] = "lower";
+        char rev[RESULTS_FIELD_LEN] = "";
+        double value = 0.0;
+        int m = 0;
+
+        if (!JsonString(line, "metric", name, sizeof(name)) || !JsonNumber(line, "value", &value))
+        {
+            continue;
+        }
+        JsonString(line, "rev", rev, sizeof(rev));
+        if (strcmp(rev, origin->rev) != 0)
+        {
+            origin->others++;
+            continue;
+        }
+        JsonString(line, "better", better, sizeof(better));
+        JsonString(line, "host", origin->host, sizeof(origin->host));
+        origin->records++;
+
+        while (m < *n_metrics && strcmp(metrics[m].name, name) != 0)
+        {
+            m++;
+        }
+        if (m == *n_metrics && m < RESULTS_MAX_METRICS)
+        {
+            snprintf(metrics[m].name, sizeof(metrics[m].name), "%s", name);
+            metrics[m].better = strcmp(better, "higher") == 0 ? RESULTS_HIGHER : RESULTS_LOWER;
+            (*n_metrics)++;
+        }
+        if (m < *n_metrics)
+        {
+            double *samples = metrics[m].samples[side];
+            int *n = &metrics[m].n[side];
+
+            /* the newest samples are kept when a metric has too many */
+            if (*n == RESULTS_MAX_SAMPLES)
+            {
+                memmove(samples, samples + 1, (RESULTS_MAX_SAMPLES - 1) * sizeof(double));
+                (*n)--;
+            }
+            samples[(*n)++] = value;
+        }
+    }
+}
+
+static bool JsonString(const char *line, const char *key, char *out, size_t size)
+{
+    char pattern[RESULTS_FIELD_LEN];
+    const char *start;
+    const char *end = NULL;
+
+    snprintf(pattern, sizeof(pattern), "\"%s\":\"", key);
+    start = strstr(line, pattern);
+    if (start)
+    {
+        start += strlen(pattern);
+        end = strchr(start, '"');
+    }
+    if (end)
+    {
+        size_t len = (size_t)(end - start) < size - 1 ? (size_t)(end - start) : size - 1;
+        memcpy(out, start, len);
+        out[len] = '\0';
+    }
+
+    return end != NULL;
+}
+
+static bool JsonNumber(const char *line, const char *key, double *out)
+{
+    char pattern[RESULTS_FIELD_LEN];
+    const char *start;
+    char *end = NULL;
+
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    start = strstr(line, pattern);
+    if (start)
+    {
+        start += strlen(pattern);
+        *out = strtod(start, &end);
+    }
+
+    return end != NULL && end != start;
+}
+
+static void CopySanitized(char *dst, size_t size, const char *src)
+{
+    size_t i = 0;
+
+    for (; src[i] && i < size - 1; i++)
+    {
+        dst[i] = (src[i] == '"' || src[i] == '\\' || (unsigned char)src[i] < ' ') ? ' ' : src[i];
+    }
+    dst[i] = '\0';
+}
+
+static double MannWhitneyP(const double *a, int na, const double *b, int nb)
+{
+    double all[2 * RESULTS_MAX_SAMPLES];
+    double rank_a = 0.0;
+    double ties = 0.0;
+    int n = na + nb;
+
+    memcpy(all, a, (size_t)na * sizeof(double));
+    memcpy(all + na, b, (size_t)nb * sizeof(double));
+    qsort(all, n, sizeof(double), CompareDoubles);
+
+    /* sum of the mid-ranks of the samples of a, and tie correction */
+    for (int i = 0; i < n; )
+    {
+        int j = i;
+        while (j < n && all[j] == all[i])
+        {
+            j++;
+        }
+        double mid_rank = (i + 1 + j) / 2.0;
+        int t = j - i;
+        for (int k = 0; k < na; k++)
+        {
+            rank_a += a[k] == all[i] ? mid_rank : 0.0;
+        }
+        ties += (double)t * t * t - t;
+        i = j;
+    }
+
+    double u = rank_a - na * (na + 1) / 2.0;
+    double mean = na * (double)nb / 2.0;
+    double var = na * (double)nb / 12.0 * ((n + 1) - ties / ((double)n * (n - 1)));
+
+    return var > 0.0 ? erfc(fabs(u - mean) / sqrt(2.0 * var)) : 1.0;
+}
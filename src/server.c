@@ -0,0 +1,690 @@
+/**
+ * @file server.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Proof server on a Unix domain socket, with batched requests and latency histograms
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#define _GNU_SOURCE                     /* accept4 */
+#include "../inc/server.h"
+#include "../inc/proof.h"
+#include "../inc/utils.h"               /* NowNs, WriteAll, ReadAll */
+#include "../inc/mem.h"                 /* MemAlloc, MemRealloc, MemFree */
+
+#include <stdio.h>                      /* fprintf, perror */
+#include <stdlib.h>                     /* qsort */
+#include <string.h>                     /* memcpy, memmove */
+#include <errno.h>                      /* EINTR, EAGAIN */
+#include <limits.h>                     /* INT_MAX */
+#include <unistd.h>                     /* read, write, close, unlink */
+#include <sys/epoll.h>                  /* epoll_* */
+#include <sys/socket.h>                 /* socket, accept4, send */
+#include <arpa/inet.h>                  /* htonl, ntohl */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* epoll tag of the listening socket, above the client slots */
+#define SERVER_LISTEN_TAG SERVER_MAX_CLIENTS
+
+/* Unsent answers beyond which the requests of a client wait */
+#define SERVER_OUT_MAX (1 << 20)
+
+/* Initial size of the answer buffer of a client */
+#define SERVER_OUT_MIN 4096
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+#define HEADER_SIZE sizeof(struct server_header_t)
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Accepts the pending connections.
+ *
+ * @param srv Server.
+ */
+static void AcceptClients(struct merkle_server_t *srv);
+
+/**
+ * @brief Reads the available requests of a client.
+ *
+ * @param srv Server.
+ * @param slot Slot of the client.
+ */
+static void ReadClient(struct merkle_server_t *srv, int slot);
+
+/**
+ * @brief Writes the queued answers of a client, without blocking.
+ *
+ * @param srv Server.
+ * @param slot Slot of the client.
+ */
+static void FlushClient(struct merkle_server_t *srv, int slot);
+
+/**
+ * @brief Adjusts the epoll events of a client to its buffers, or
+ *        disconnects it once it is closing and has nothing left.
+ *
+ * @param srv Server.
+ * @param slot Slot of the client.
+ */
+static void WatchClient(struct merkle_server_t *srv, int slot);
+
+/**
+ * @brief Disconnects a client.
+ *
+ * @param srv Server.
+ * @param slot Slot of the client.
+ */
+static void DropClient(struct merkle_server_t *srv, int slot);
+
+/**
+ * @brief Tells if the requests of a client wait for its answers to drain.
+ */
+static bool Throttled(const struct server_client_t *c);
+
+/**
+ * @brief Takes the complete requests of the clients into the batch,
+ *        one per client in turn.
+ *
+ * @param srv Server.
+ */
+static void GatherBatch(struct merkle_server_t *srv);
+
+/**
+ * @brief Answers the batch: in leaf order, then queued in request order.
+ *
+ * @param srv Server.
+ */
+static void AnswerBatch(struct merkle_server_t *srv);
+
+/**
+ * @brief Writes the answer of one request.
+ *
+ * @param srv Server.
+ * @param req Request, its answer length is set.
+ * @param buf Buffer of srv->answer_max bytes.
+ */
+static void AnswerRequest(struct merkle_server_t *srv, struct server_request_t *req, unsigned char *buf);
+
+/**
+ * @brief Appends an answer to the buffer of a client.
+ *
+ * @retval true  Success.
+ * @retval false Allocation failure.
+ */
+static bool QueueAnswer(struct server_client_t *c, const unsigned char *buf, size_t len);
+
+/**
+ * @brief qsort comparator of batch requests: by type, then by leaf.
+ */
+static int CompareRequest(const void *a, const void *b);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool ServerOpen(struct merkle_server_t *srv, const char *socket_path,
+                const struct merkle_levels_t *lv)
+{
+    /* the protocol and the proofs count the leaves in 32 bits */
+    bool ret = lv->n_levels > 0 && lv->n_leaves <= INT_MAX &&
+               strlen(socket_path) < sizeof(srv->addr.sun_path);
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = SERVER_LISTEN_TAG };
+    size_t proof_max = PROOF_HEADER_SIZE +
+                       (size_t)(lv->n_levels - 1) * (lv->arity - 1) * SHA256_DIGEST_LENGTH;
+    size_t stats_size = SERVER_TYPES * SERVER_HIST_BUCKETS * sizeof(uint32_t);
+
+    memset(srv, 0, sizeof(*srv));
+    srv->lv = lv;
+    srv->listen_fd = -1;
+    srv->epoll_fd = -1;
+
+    if (ret)
+    {
+        srv->addr.sun_family = AF_UNIX;
+        strcpy(srv->addr.sun_path, socket_path);
+        srv->answer_max = HEADER_SIZE + (proof_max > stats_size ? proof_max : stats_size);
+        srv->answers = MemAlloc(MEM_IO, SERVER_BATCH_MAX * srv->answer_max);
+
+        unlink(socket_path);
+        srv->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        srv->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        ret = srv->answers && srv->listen_fd >= 0 && srv->epoll_fd >= 0 &&
+              bind(srv->listen_fd, (struct sockaddr *)&srv->addr, sizeof(srv->addr)) == 0 &&
+              listen(srv->listen_fd, SERVER_MAX_CLIENTS) == 0 &&
+              epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, srv->listen_fd, &ev) == 0;
+    }
+
+    if (!ret)
+    {
+        perror("ServerOpen: unable to listen");
+        ServerClose(srv);
+    }
+
+    return ret;
+}
+
+int ServerPoll(struct merkle_server_t *srv, int timeout_ms)
+{
+    struct epoll_event events[SERVER_MAX_CLIENTS + 1];
+    int ret = 0;
+    /* requests left from the last batch are answered without waiting */
+    int n = epoll_wait(srv->epoll_fd, events, SERVER_MAX_CLIENTS + 1, srv->backlog ? 0 : timeout_ms);
+
+    if (n < 0 && errno != EINTR)
+    {
+        perror("ServerPoll: epoll_wait");
+        ret = -1;
+    }
+    else
+    {
+        for (int e = 0; e < n; e++)
+        {
+            int slot = (int)events[e].data.u32;
+
+            if (slot == SERVER_LISTEN_TAG)
+            {
+                AcceptClients(srv);
+            }
+            else if (srv->client[slot])
+            {
+                if (events[e].events & EPOLLOUT)
+                {
+                    FlushClient(srv, slot);
+                }
+                if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                {
+                    ReadClient(srv, slot);
+                }
+            }
+        }
+
+        GatherBatch(srv);
+        if (srv->n_batch > 0)
+        {
+            AnswerBatch(srv);
+            ret = srv->n_batch;
+        }
+
+        for (int slot = 0; slot < SERVER_MAX_CLIENTS; slot++)
+        {
+            if (srv->client[slot])
+            {
+                FlushClient(srv, slot);
+                WatchClient(srv, slot);
+            }
+        }
+    }
+
+    return ret;
+}
+
+void ServerClose(struct merkle_server_t *srv)
+{
+    for (int slot = 0; slot < SERVER_MAX_CLIENTS; slot++)
+    {
+        if (srv->client[slot])
+        {
+            DropClient(srv, slot);
+        }
+    }
+    if (srv->epoll_fd >= 0)
+    {
+        close(srv->epoll_fd);
+    }
+    if (srv->listen_fd >= 0)
+    {
+        close(srv->listen_fd);
+        unlink(srv->addr.sun_path);
+    }
+    MemFree(MEM_IO, srv->answers, SERVER_BATCH_MAX * srv->answer_max);
+    memset(srv, 0, sizeof(*srv));
+    srv->listen_fd = -1;
+    srv->epoll_fd = -1;
+}
+
+unsigned long ServerPercentile(const struct server_histogram_t *h, double q)
+{
+    unsigned long rank = (unsigned long)(q * h->count + 0.5);
+    unsigned long seen = 0;
+    unsigned long ret = 0;
+
+    rank = rank < 1 ? 1 : rank;
+    for (int b = 0; b < SERVER_HIST_BUCKETS && h->count > 0 && ret == 0; b++)
+    {
+        seen += h->bucket[b];
+        if (seen >= rank)
+        {
+            ret = 2UL << b;
+        }
+    }
+
+    return ret;
+}
+
+int ServerConnect(const char *socket_path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0)
+    {
+        perror("ServerConnect");
+    }
+
+    return fd;
+}
+
+bool ServerSend(int fd, uint8_t type, uint32_t leaf)
+{
+    struct server_header_t header = { .type = type, .a = htonl(leaf) };
+
+    return WriteAll(fd, &header, sizeof(header), -1, NULL);
+}
+
+bool ServerReceive(int fd, struct server_header_t *header, unsigned char *payload, size_t size)
+{
+    bool ret = ReadAll(fd, header, sizeof(*header), NULL);
+
+    if (ret)
+    {
+        header->a = ntohl(header->a);
+        header->b = ntohl(header->b);
+        ret = header->a <= size && ReadAll(fd, payload, header->a, NULL);
+    }
+
+    return ret;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void AcceptClients(struct merkle_server_t *srv)
+{
+    int fd;
+
+    while ((fd = accept4(srv->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        int slot = 0;
+        struct server_client_t *c = NULL;
+        struct epoll_event ev = { .events = EPOLLIN };
+
+        while (slot < SERVER_MAX_CLIENTS && srv->client[slot])
+        {
+            slot++;
+        }
+        c = slot < SERVER_MAX_CLIENTS ? MemCalloc(MEM_IO, 1, sizeof(*c)) : NULL;
+        ev.data.u32 = (uint32_t)slot;
+
+        if (c && epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0)
+        {
+            c->fd = fd;
+            c->watched = EPOLLIN;
+            srv->client[slot] = c;
+            srv->stats.clients++;
+        }
+        else
+        {
+            fprintf(stderr, "AcceptClients: client refused, %d clients at most\n", SERVER_MAX_CLIENTS);
+            MemFree(MEM_IO, c, sizeof(*c));
+            close(fd);
+        }
+    }
+}
+
+static void ReadClient(struct merkle_server_t *srv, int slot)
+{
+    struct server_client_t *c = srv->client[slot];
+
+    while (!c->closing && c->in_len < sizeof(c->in))
+    {
+        ssize_t n = read(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len);
+
+        if (n > 0)
+        {
+            unsigned long now = NowNs();
+
+            c->in_len += (size_t)n;
+            /* stamp the requests this read completed, older ones keep their time */
+            while (c->in_stamped < (int)(c->in_len / HEADER_SIZE))
+            {
+                c->in_ns[c->in_stamped++] = now;
+            }
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else
+        {
+            /* end of the requests: the pending ones are still answered */
+            c->closing = true;
+        }
+    }
+}
+
+static void FlushClient(struct merkle_server_t *srv, int slot)
+{
+    struct server_client_t *c = srv->client[slot];
+
+    while (!c->gone && c->out_sent < c->out_len)
+    {
+        ssize_t n = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if (n > 0)
+        {
+            c->out_sent += (size_t)n;
+        }
+        else if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else
+        {
+            /* the client is gone: nothing more to answer */
+            c->gone = true;
+            break;
+        }
+    }
+
+    if (c->out_sent == c->out_len)
+    {
+        c->out_sent = 0;
+        c->out_len = 0;
+    }
+}
+
+static void WatchClient(struct merkle_server_t *srv, int slot)
+{
+    struct server_client_t *c = srv->client[slot];
+    uint32_t events = 0;
+
+    if (c->gone || (c->closing && c->in_len < HEADER_SIZE && c->out_len == 0))
+    {
+        DropClient(srv, slot);
+        c = NULL;
+    }
+
+    if (c && !c->closing && c->in_len < sizeof(c->in))
+    {
+        events |= EPOLLIN;
+    }
+    if (c && c->out_len > c->out_sent)
+    {
+        events |= EPOLLOUT;
+    }
+    if (c && events != c->watched)
+    {
+        struct epoll_event ev = { .events = events, .data.u32 = (uint32_t)slot };
+
+        epoll_ctl(srv->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+        c->watched = events;
+    }
+}
+
+static void DropClient(struct merkle_server_t *srv, int slot)
+{
+    struct server_client_t *c = srv->client[slot];
+
+    epoll_ctl(srv->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    MemFree(MEM_IO, c->out, c->out_cap);
+    MemFree(MEM_IO, c, sizeof(*c));
+    srv->client[slot] = NULL;
+}
+
+static bool Throttled(const struct server_client_t *c)
+{
+    return c->out_len - c->out_sent > SERVER_OUT_MAX;
+}
+
+static void GatherBatch(struct merkle_server_t *srv)
+{
+    size_t taken[SERVER_MAX_CLIENTS] = {0};
+    bool more = true;
+
+    srv->n_batch = 0;
+    srv->backlog = false;
+
+    /* one request per client in turn, so that no client fills the batch alone */
+    while (more && srv->n_batch < SERVER_BATCH_MAX)
+    {
+        more = false;
+        for (int slot = 0; slot < SERVER_MAX_CLIENTS && srv->n_batch < SERVER_BATCH_MAX; slot++)
+        {
+            struct server_client_t *c = srv->client[slot];
+
+            if (c && !c->gone && !Throttled(c) && c->in_len - taken[slot] >= HEADER_SIZE)
+            {
+                struct server_header_t header;
+                struct server_request_t *req = &srv->batch[srv->n_batch++];
+
+                memcpy(&header, c->in + taken[slot], HEADER_SIZE);
+                req->client = slot;
+                req->type = header.type;
+                req->leaf = ntohl(header.a);
+                req->start_ns = c->in_ns[taken[slot] / HEADER_SIZE];
+                taken[slot] += HEADER_SIZE;
+                req->len = 0;
+                more = true;
+            }
+        }
+    }
+
+    for (int slot = 0; slot < SERVER_MAX_CLIENTS; slot++)
+    {
+        struct server_client_t *c = srv->client[slot];
+
+        if (c && taken[slot] > 0)
+        {
+            int done = (int)(taken[slot] / HEADER_SIZE);
+
+            memmove(c->in, c->in + taken[slot], c->in_len - taken[slot]);
+            c->in_len -= taken[slot];
+            memmove(c->in_ns, c->in_ns + done, (size_t)(c->in_stamped - done) * sizeof(c->in_ns[0]));
+            c->in_stamped -= done;
+        }
+        if (c && !c->gone && !Throttled(c) && c->in_len >= HEADER_SIZE)
+        {
+            srv->backlog = true;
+        }
+    }
+}
+
+static void AnswerBatch(struct merkle_server_t *srv)
+{
+    struct server_request_t *sorted[SERVER_BATCH_MAX];
+    unsigned long now;
+
+    for (int i = 0; i < srv->n_batch; i++)
+    {
+        sorted[i] = &srv->batch[i];
+    }
+    /* neighbour leaves share the upper nodes of their paths: proving them
+     * one after the other reads those nodes from cache */
+    qsort(sorted, srv->n_batch, sizeof(sorted[0]), CompareRequest);
+    for (int i = 0; i < srv->n_batch; i++)
+    {
+        AnswerRequest(srv, sorted[i], srv->answers + (size_t)(sorted[i] - srv->batch) * srv->answer_max);
+    }
+    srv->stats.batches++;
+
+    /* the answers of a client go out in the order of its requests */
+    now = NowNs();
+    for (int i = 0; i < srv->n_batch; i++)
+    {
+        struct server_request_t *req = &srv->batch[i];
+        struct server_client_t *c = srv->client[req->client];
+        const unsigned char *answer = srv->answers + (size_t)i * srv->answer_max;
+        uint8_t type = answer[0];       /* SERVER_ERROR for a bad request */
+        unsigned long ns = now > req->start_ns ? now - req->start_ns : 1;
+
+        if (!c->gone && !QueueAnswer(c, answer, req->len))
+        {
+            fprintf(stderr, "QueueAnswer: allocation failed, client dropped\n");
+            c->gone = true;
+        }
+        if (type >= SERVER_ROOT && type <= SERVER_TYPES)
+        {
+            struct server_histogram_t *h = &srv->stats.latency[type - 1];
+            int b = 63 - __builtin_clzl(ns);
+
+            h->bucket[b < SERVER_HIST_BUCKETS ? b : SERVER_HIST_BUCKETS - 1]++;
+            h->count++;
+        }
+    }
+}
+
+static void AnswerRequest(struct merkle_server_t *srv, struct server_request_t *req, unsigned char *buf)
+{
+    const struct merkle_levels_t *lv = srv->lv;
+    struct server_header_t header = { .type = req->type };
+    unsigned char *payload = buf + HEADER_SIZE;
+    uint32_t size = 0;
+    uint32_t b = req->leaf;
+    bool ok = true;
+
+    switch (req->type)
+    {
+        case SERVER_ROOT:
+            memcpy(payload, LevelsRoot(lv), SHA256_DIGEST_LENGTH);
+            size = SHA256_DIGEST_LENGTH;
+            b = (uint32_t)lv->n_leaves;
+            break;
+
+        case SERVER_PROOF:
+            /* straight from the levels into the answer, nothing allocated */
+            ok = req->leaf < lv->n_leaves;
+            if (ok)
+            {
+                size = (uint32_t)ProofEncodeFromLevels(lv, (int)req->leaf, payload,
+                                                       srv->answer_max - HEADER_SIZE);
+                ok = size > 0;
+            }
+            break;
+
+        case SERVER_LEAF:
+            ok = req->leaf < lv->n_leaves;
+            if (ok)
+            {
+                memcpy(payload, LEVEL_HASH(lv, 0, req->leaf), SHA256_DIGEST_LENGTH);
+                size = SHA256_DIGEST_LENGTH;
+            }
+            break;
+
+        case SERVER_STATS:
+            for (int t = 0; t < SERVER_TYPES; t++)
+            {
+                for (int k = 0; k < SERVER_HIST_BUCKETS; k++)
+                {
+                    unsigned long count = srv->stats.latency[t].bucket[k];
+                    uint32_t wire = htonl(count > UINT32_MAX ? UINT32_MAX : (uint32_t)count);
+
+                    memcpy(payload + size, &wire, sizeof(wire));
+                    size += sizeof(wire);
+                }
+            }
+            b = (uint32_t)srv->stats.requests;
+            break;
+
+        default:
+            ok = false;
+            break;
+    }
+
+    if (!ok)
+    {
+        header.type = SERVER_ERROR;
+        size = 0;
+        b = req->type;
+        srv->stats.errors++;
+    }
+    srv->stats.requests++;
+
+    header.a = htonl(size);
+    header.b = htonl(b);
+    memcpy(buf, &header, HEADER_SIZE);
+    req->len = HEADER_SIZE + size;
+}
+
+static bool QueueAnswer(struct server_client_t *c, const unsigned char *buf, size_t len)
+{
+    bool ret = true;
+
+    if (c->out_len + len > c->out_cap)
+    {
+        size_t cap = c->out_cap ? c->out_cap : SERVER_OUT_MIN;
+        unsigned char *grown;
+
+        while (cap < c->out_len + len)
+        {
+            cap *= 2;
+        }
+        grown = MemRealloc(MEM_IO, c->out, c->out_cap, cap);
+        ret = grown != NULL;
+        if (ret)
+        {
+            c->out = grown;
+            c->out_cap = cap;
+        }
+    }
+
+    if (ret)
+    {
+        memcpy(c->out + c->out_len, buf, len);
+        c->out_len += len;
+    }
+
+    return ret;
+}
+
+static int CompareRequest(const void *a, const void *b)
+{
+    const struct server_request_t *x = *(const struct server_request_t *const *)a;
+    const struct server_request_t *y = *(const struct server_request_t *const *)b;
+
+    if (x->type != y->type)
+    {
+        return (x->type > y->type) - (x->type < y->type);
+    }
+
+    return (x->leaf > y->leaf) - (x->leaf < y->leaf);
+}
+
@@ -0,0 +1,265 @@
+/**
+ * @file shared.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Tree levels published in shared memory for zero-copy queries from other processes
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/shared.h"
+
+#include <stdio.h>                      /* snprintf, fdopen */
+#include <string.h>                     /* strlen, strcmp */
+#include <fcntl.h>                      /* O_* flags */
+#include <unistd.h>                     /* ftruncate, close */
+#include <sys/mman.h>                   /* shm_open, mmap */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Attempts to map the current generation while newer ones replace it */
+#define SHARED_RETRIES 8
+
+/* Room for the ".<generation>" suffix of the segment names */
+#define SHARED_SUFFIX_MAX 24
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Builds the name of the segment of a generation.
+ *
+ * @param out Buffer of SHARED_NAME_MAX bytes.
+ * @param name Name of the tree.
+ * @param generation Generation.
+ */
+static void SegmentName(char *out, const char *name, unsigned long generation);
+
+/**
+ * @brief Maps the levels of one generation read-only.
+ *
+ * @param name Name of the tree.
+ * @param generation Generation.
+ * @param lv Levels to fill.
+ * @retval true  Success.
+ * @retval false Segment gone (replaced) or malformed.
+ */
+static bool MapGeneration(const char *name, unsigned long generation, struct merkle_levels_t *lv);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool SharedPublish(struct shared_publisher_t *pub, const char *name,
+                   const struct merkle_levels_t *lv)
+{
+    bool ret = name && name[0] == '/' && strlen(name) + SHARED_SUFFIX_MAX < SHARED_NAME_MAX;
+    char segment[SHARED_NAME_MAX];
+
+    if (ret && !pub->control)
+    {
+        int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+        void *map = MAP_FAILED;
+
+        ret = fd >= 0 && ftruncate(fd, sizeof(struct shared_control_t)) == 0;
+        if (ret)
+        {
+            map = mmap(NULL, sizeof(struct shared_control_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ret = map != MAP_FAILED;
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        if (ret)
+        {
+            snprintf(pub->name, sizeof(pub->name), "%s", name);
+            pub->control = map;
+            pub->control->magic = SHARED_MAGIC;
+            pub->control->version = SHARED_VERSION;
+            /* a restarted builder goes on from the last generation */
+            pub->generation = atomic_load(&pub->control->generation);
+        }
+    }
+    else
+    {
+        ret = ret && strcmp(name, pub->name) == 0;
+    }
+
+    if (ret)
+    {
+        /* the whole generation is written before readers can see it */
+        SegmentName(segment, pub->name, pub->generation + 1);
+        int fd = shm_open(segment, O_CREAT | O_TRUNC | O_RDWR, 0644);
+        FILE *fp = fd >= 0 ? fdopen(fd, "wb") : NULL;
+
+        ret = fp && LevelsWrite(lv, fp);
+        if (fp)
+        {
+            ret = fclose(fp) == 0 && ret;
+        }
+        else if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        if (ret)
+        {
+            atomic_store(&pub->control->generation, pub->generation + 1);
+            if (pub->generation > 0)
+            {
+                SegmentName(segment, pub->name, pub->generation);
+                shm_unlink(segment);
+            }
+            pub->generation++;
+        }
+        else
+        {
+            shm_unlink(segment);
+        }
+    }
+
+    if (!ret)
+    {
+        perror("SharedPublish: unable to publish the levels");
+    }
+
+    return ret;
+}
+
+void SharedUnpublish(struct shared_publisher_t *pub)
+{
+    char segment[SHARED_NAME_MAX];
+
+    if (pub->control)
+    {
+        if (pub->generation > 0)
+        {
+            SegmentName(segment, pub->name, pub->generation);
+            shm_unlink(segment);
+        }
+        shm_unlink(pub->name);
+        munmap(pub->control, sizeof(struct shared_control_t));
+    }
+    memset(pub, 0, sizeof(*pub));
+}
+
+bool SharedAttach(struct shared_reader_t *rd, const char *name)
+{
+    bool ret = name && strlen(name) + SHARED_SUFFIX_MAX < SHARED_NAME_MAX;
+    int fd = ret ? shm_open(name, O_RDONLY, 0) : -1;
+    const struct shared_control_t *control = MAP_FAILED;
+
+    memset(rd, 0, sizeof(*rd));
+    ret = fd >= 0;
+    if (ret)
+    {
+        control = mmap(NULL, sizeof(*control), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        ret = control != MAP_FAILED;
+    }
+
+    if (ret)
+    {
+        snprintf(rd->name, sizeof(rd->name), "%s", name);
+        rd->control = control;
+        ret = control->magic == SHARED_MAGIC && control->version == SHARED_VERSION &&
+              SharedRefresh(rd);
+    }
+
+    if (!ret)
+    {
+        fprintf(stderr, "SharedAttach: no tree published as %s\n", name ? name : "(null)");
+        SharedDetach(rd);
+    }
+
+    return ret;
+}
+
+bool SharedRefresh(struct shared_reader_t *rd)
+{
+    bool ret = false;
+    bool done = rd->control == NULL;
+
+    for (int tries = 0; tries < SHARED_RETRIES && !done; tries++)
+    {
+        unsigned long generation = atomic_load(&rd->control->generation);
+        struct merkle_levels_t lv;
+
+        if (generation == 0 || (generation == rd->generation && rd->lv.map))
+        {
+            /* nothing published yet, or already current */
+            ret = generation != 0;
+            done = true;
+        }
+        else if (MapGeneration(rd->name, generation, &lv))
+        {
+            LevelsFree(&rd->lv);
+            rd->lv = lv;
+            rd->generation = generation;
+            ret = true;
+            done = true;
+        }
+        /* otherwise replaced before it could be opened: try the newer one */
+    }
+
+    return ret;
+}
+
+void SharedDetach(struct shared_reader_t *rd)
+{
+    LevelsFree(&rd->lv);
+    if (rd->control)
+    {
+        munmap((void *)rd->control, sizeof(*rd->control));
+    }
+    memset(rd, 0, sizeof(*rd));
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void SegmentName(char *out, const char *name, unsigned long generation)
+{
+    /* names are checked shorter on entry, the bound only shows it */
+    snprintf(out, SHARED_NAME_MAX, "%.*s.%lu", SHARED_NAME_MAX - SHARED_SUFFIX_MAX, name, generation);
+}
+
+static bool MapGeneration(const char *name, unsigned long generation, struct merkle_levels_t *lv)
+{
+    char segment[SHARED_NAME_MAX];
+    int fd;
+    bool ret;
+
+    SegmentName(segment, name, generation);
+    fd = shm_open(segment, O_RDONLY, 0);
+    ret = fd >= 0 && LevelsMapFd(lv, fd);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    return ret;
+}
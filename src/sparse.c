@@ -0,0 +1,254 @@
+/**
+ * @file sparse.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Level-skipping storage: only some levels are kept, the others are recomputed
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/sparse.h"
+#include "../inc/mem.h"                 /* MEM_LEVELS and MEM_SCRATCH accounting */
+
+#include <stdio.h>                      /* fprintf */
+#include <string.h>                     /* memcpy, memset */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Tells whether a level is kept by a sparse tree.
+ *
+ * @param sp Sparse tree.
+ * @param level Level.
+ * @return true if the hashes of the level are stored.
+ */
+static bool SparseStored(const struct sparse_levels_t *sp, int level);
+
+/**
+ * @brief Recomputes one node of a skipped level.
+ *
+ * @param sp Sparse tree.
+ * @param level Skipped level.
+ * @param idx Index of the node, padding included.
+ * @param out Buffer receiving the hash.
+ * @retval true  Success.
+ * @retval false Hashing failure.
+ */
+static bool SparseNode(struct sparse_levels_t *sp, int level, long idx, unsigned char *out);
+
+/**
+ * @brief Level source read of a sparse tree.
+ */
+static bool SparseRead(void *ctx, int level, long first, int count, unsigned char *out);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool SparseFromLevels(const struct merkle_levels_t *lv, int stride, int top,
+                      struct sparse_levels_t *sp)
+{
+    bool ret = lv->n_levels > 0 && stride >= 1 && top >= 1 &&
+               LevelSpan(lv->arity, stride - 1) <= SPARSE_MAX_SPAN;
+
+    memset(sp, 0, sizeof(*sp));
+    if (ret)
+    {
+        sp->n_leaves = lv->n_leaves;
+        sp->n_levels = lv->n_levels;
+        sp->arity = lv->arity;
+        sp->padding = lv->padding;
+        sp->stride = stride;
+        sp->top = top;
+
+        /* a subtree of the widest skipped level, plus room for its padding */
+        sp->scratch = MemAlloc(MEM_SCRATCH,
+                               ((size_t)LevelSpan(lv->arity, stride - 1) + lv->arity - 1) *
+                               SHA256_DIGEST_LENGTH);
+        ret = sp->scratch != NULL;
+    }
+
+    for (int l = 0; l < lv->n_levels && ret; l++)
+    {
+        sp->level_size[l] = lv->level_size[l];
+        sp->real_size[l] = l == 0 ? lv->n_leaves
+                                  : (sp->real_size[l - 1] + lv->arity - 1) / lv->arity;
+        if (SparseStored(sp, l))
+        {
+            size_t size = (size_t)lv->level_size[l] * SHA256_DIGEST_LENGTH;
+
+            sp->level[l] = MemAlloc(MEM_LEVELS, size);
+            ret = sp->level[l] != NULL;
+            if (ret)
+            {
+                memcpy(sp->level[l], lv->level[l], size);
+            }
+        }
+    }
+
+    if (!ret)
+    {
+        fprintf(stderr, "SparseFromLevels: invalid parameters or allocation failure\n");
+        SparseFree(sp);
+    }
+
+    return ret;
+}
+
+void SparseSource(struct sparse_levels_t *sp, struct level_source_t *src)
+{
+    *src = (struct level_source_t){
+        .n_leaves = sp->n_leaves,
+        .n_levels = sp->n_levels,
+        .arity = sp->arity,
+        .padding = sp->padding,
+        .level_size = sp->level_size,
+        .read = SparseRead,
+        .ctx = sp,
+    };
+}
+
+bool SparseExpand(const struct sparse_levels_t *sp, struct merkle_levels_t *lv)
+{
+    bool ret = LevelsAlloc(lv, sp->level_size, sp->n_levels);
+
+    if (ret)
+    {
+        lv->n_leaves = sp->n_leaves;
+        lv->arity = sp->arity;
+        lv->padding = sp->padding;
+    }
+
+    /* the leaves are stored, every missing level comes from the one below */
+    for (int l = 0; l < sp->n_levels && ret; l++)
+    {
+        if (sp->level[l])
+        {
+            memcpy(lv->level[l], sp->level[l], (size_t)sp->level_size[l] * SHA256_DIGEST_LENGTH);
+        }
+        else
+        {
+            ret = LevelsHashUp(lv->level[l - 1], sp->real_size[l - 1], sp->arity,
+                               sp->padding, lv->level[l]) == sp->real_size[l];
+            if (ret && sp->padding == PADDING_DUPLICATE)
+            {
+                LevelsPad(lv->level[l], sp->real_size[l], sp->level_size[l]);
+            }
+        }
+    }
+
+    if (!ret && lv->level)
+    {
+        fprintf(stderr, "SparseExpand: hashing failure\n");
+        LevelsFree(lv);
+    }
+
+    return ret;
+}
+
+size_t SparseResidentBytes(const struct sparse_levels_t *sp)
+{
+    size_t ret = 0;
+
+    for (int l = 0; l < sp->n_levels; l++)
+    {
+        if (sp->level[l])
+        {
+            ret += (size_t)sp->level_size[l] * SHA256_DIGEST_LENGTH;
+        }
+    }
+    ret += ((size_t)LevelSpan(sp->arity, sp->stride - 1) + sp->arity - 1) * SHA256_DIGEST_LENGTH;
+
+    return ret;
+}
+
+void SparseFree(struct sparse_levels_t *sp)
+{
+    for (int l = 0; l < LEVELS_MAX; l++)
+    {
+        MemFree(MEM_LEVELS, sp->level[l], (size_t)sp->level_size[l] * SHA256_DIGEST_LENGTH);
+    }
+    MemFree(MEM_SCRATCH, sp->scratch,
+            ((size_t)LevelSpan(sp->arity, sp->stride - 1) + sp->arity - 1) * SHA256_DIGEST_LENGTH);
+    memset(sp, 0, sizeof(*sp));
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool SparseStored(const struct sparse_levels_t *sp, int level)
+{
+    return level % sp->stride == 0 || level >= sp->n_levels - sp->top;
+}
+
+static bool SparseNode(struct sparse_levels_t *sp, int level, long idx, unsigned char *out)
+{
+    int base = level - level % sp->stride;
+    int height = level - base;
+    long span = LevelSpan(sp->arity, height);
+    long first;
+    long count;
+
+    /* a padding node is a copy of the last real one */
+    if (idx >= sp->real_size[level])
+    {
+        idx = sp->real_size[level] - 1;
+    }
+    first = idx * span;
+    count = sp->real_size[base] - first < span ? sp->real_size[base] - first : span;
+
+    memcpy(sp->scratch, sp->level[base] + (size_t)first * SHA256_DIGEST_LENGTH,
+           (size_t)count * SHA256_DIGEST_LENGTH);
+    sp->recomputed++;
+
+    return SubtreeRoot(sp->scratch, (int)count, height, sp->arity, sp->padding, out);
+}
+
+static bool SparseRead(void *ctx, int level, long first, int count, unsigned char *out)
+{
+    struct sparse_levels_t *sp = ctx;
+    bool ret = level >= 0 && level < sp->n_levels && first >= 0 &&
+               first + count <= sp->level_size[level];
+
+    if (ret && sp->level[level])
+    {
+        memcpy(out, sp->level[level] + (size_t)first * SHA256_DIGEST_LENGTH,
+               (size_t)count * SHA256_DIGEST_LENGTH);
+    }
+    else
+    {
+        for (int i = 0; i < count && ret; i++)
+        {
+            ret = SparseNode(sp, level, first + i, out + (size_t)i * SHA256_DIGEST_LENGTH);
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,209 @@
+/**
+ * @file stats.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Live progress and throughput counters of the builds
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/stats.h"
+#include "../inc/utils.h"               /* NowNs */
+
+#include <pthread.h>                    /* reporter thread, pthread_sigmask */
+#include <stdio.h>                      /* snprintf */
+#include <unistd.h>                     /* write */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* Counters of the build in progress */
+struct merkle_stats_t merkle_stats;
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* Reads a counter of merkle_stats */
+#define STATS_READ(counter) atomic_load_explicit(&merkle_stats.counter, memory_order_relaxed)
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Reporter loop: waits for STATS_SIGNAL and dumps a snapshot.
+ *
+ * @param arg Unused.
+ * @return NULL.
+ */
+static void *ReporterMain(void *arg);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* Reporter thread and the destination of its dumps */
+static pthread_t reporter;
+static bool reporter_running = false;
+static atomic_int reporter_fd = -1;
+static atomic_bool reporter_stop = false;
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+void StatsBuildStart(long long files)
+{
+    atomic_store_explicit(&merkle_stats.files_total, files, memory_order_relaxed);
+    atomic_store_explicit(&merkle_stats.files_hashed, 0, memory_order_relaxed);
+    atomic_store_explicit(&merkle_stats.bytes_read, 0, memory_order_relaxed);
+    for (int l = 0; l < LEVELS_MAX; l++)
+    {
+        atomic_store_explicit(&merkle_stats.level_hashes[l], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&merkle_stats.errors, 0, memory_order_relaxed);
+    atomic_store_explicit(&merkle_stats.end_ns, 0, memory_order_relaxed);
+    atomic_store_explicit(&merkle_stats.start_ns, (long long)NowNs(), memory_order_relaxed);
+}
+
+void StatsBuildEnd(void)
+{
+    atomic_store_explicit(&merkle_stats.end_ns, (long long)NowNs(), memory_order_relaxed);
+}
+
+void StatsSnapshot(struct stats_snapshot_t *s)
+{
+    long long start = STATS_READ(start_ns);
+    long long end = STATS_READ(end_ns);
+
+    s->files_total = STATS_READ(files_total);
+    s->files_hashed = STATS_READ(files_hashed);
+    s->bytes_read = STATS_READ(bytes_read);
+    s->levels = 0;
+    for (int l = 0; l < LEVELS_MAX; l++)
+    {
+        s->level_hashes[l] = STATS_READ(level_hashes[l]);
+        s->levels = s->level_hashes[l] > 0 ? l + 1 : s->levels;
+    }
+    s->tasks_queued = STATS_READ(tasks_queued);
+    s->tasks_running = STATS_READ(tasks_running);
+    s->errors = STATS_READ(errors);
+
+    s->elapsed_s = start > 0 ? ((end > start ? end : (long long)NowNs()) - start) / 1e9 : 0.0;
+    s->mb_per_s = s->elapsed_s > 0.0 ? s->bytes_read / 1e6 / s->elapsed_s : 0.0;
+    s->files_per_s = s->elapsed_s > 0.0 ? s->files_hashed / s->elapsed_s : 0.0;
+    s->eta_s = -1.0;
+    if (s->files_total >= s->files_hashed && s->files_per_s > 0.0)
+    {
+        s->eta_s = (s->files_total - s->files_hashed) / s->files_per_s;
+    }
+}
+
+int StatsFormatJson(const struct stats_snapshot_t *s, char *buf, size_t size)
+{
+    int len = snprintf(buf, size,
+                       "{\"elapsed_s\":%.3f,\"files_total\":%lld,\"files_hashed\":%lld,"
+                       "\"bytes_read\":%lld,\"mb_per_s\":%.2f,\"files_per_s\":%.1f,",
+                       s->elapsed_s, s->files_total, s->files_hashed, s->bytes_read,
+                       s->mb_per_s, s->files_per_s);
+
+    if (s->eta_s >= 0.0)
+    {
+        len += snprintf(buf + len, len < (int)size ? size - len : 0, "\"eta_s\":%.1f,", s->eta_s);
+    }
+    else
+    {
+        len += snprintf(buf + len, len < (int)size ? size - len : 0, "\"eta_s\":null,");
+    }
+    len += snprintf(buf + len, len < (int)size ? size - len : 0, "\"level_hashes\":[");
+    for (int l = 0; l < s->levels; l++)
+    {
+        len += snprintf(buf + len, len < (int)size ? size - len : 0, "%s%lld",
+                        l > 0 ? "," : "", s->level_hashes[l]);
+    }
+    len += snprintf(buf + len, len < (int)size ? size - len : 0,
+                    "],\"tasks_queued\":%lld,\"tasks_running\":%lld,\"errors\":%lld}\n",
+                    s->tasks_queued, s->tasks_running, s->errors);
+
+    return len < (int)size ? len : (int)size - 1;
+}
+
+bool StatsReporterStart(int fd)
+{
+    bool ret = true;
+    sigset_t set;
+
+    atomic_store(&reporter_fd, fd);
+    if (!reporter_running)
+    {
+        /* only the reporter takes the signal, by sigwait() */
+        sigemptyset(&set);
+        sigaddset(&set, STATS_SIGNAL);
+        pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+        atomic_store(&reporter_stop, false);
+        ret = pthread_create(&reporter, NULL, ReporterMain, NULL) == 0;
+        reporter_running = ret;
+        if (!ret)
+        {
+            fprintf(stderr, "StatsReporterStart: unable to start the reporter\n");
+            pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+        }
+    }
+
+    return ret;
+}
+
+void StatsReporterStop(void)
+{
+    sigset_t set;
+
+    if (reporter_running)
+    {
+        atomic_store(&reporter_stop, true);
+        pthread_kill(reporter, STATS_SIGNAL);
+        pthread_join(reporter, NULL);
+        reporter_running = false;
+
+        sigemptyset(&set);
+        sigaddset(&set, STATS_SIGNAL);
+        pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+    }
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static void *ReporterMain(void *arg)
+{
+    char line[STATS_JSON_LEN];
+    sigset_t set;
+    int sig;
+
+    (void)arg;
+    sigemptyset(&set);
+    sigaddset(&set, STATS_SIGNAL);
+    while (sigwait(&set, &sig) == 0 && !atomic_load(&reporter_stop))
+    {
+        struct stats_snapshot_t s;
+
+        StatsSnapshot(&s);
+        int len = StatsFormatJson(&s, line, sizeof(line));
+        /* a normal thread: no async-signal-safety constraint on the dump */
+        if (write(atomic_load(&reporter_fd), line, (size_t)len) != len)
+        {
+            perror("StatsReporter: write");
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,530 @@
+/**
+ * @file sweep.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Scalability sweep over threads, leaf counts, leaf sizes and hash backends
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/sweep.h"
+#include "../inc/levels.h"              /* LevelsFromLeafHashes */
+#include "../inc/config.h"              /* merkle_config.threads */
+#include "../inc/parallel.h"            /* ParallelFor */
+#include "../inc/utils.h"               /* NowNs, Median, SplitMix */
+
+#include <math.h>                       /* log, exp, cos */
+#include <stdint.h>                     /* uint64_t */
+#include <stdlib.h>                     /* malloc, strtol */
+#include <string.h>                     /* strtok_r */
+#include <openssl/evp.h>                /* EVP_Digest */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Leaves hashed per task: workers claim them dynamically, so that huge
+ * leaves do not leave the other workers idle */
+#define SWEEP_CHUNK 256
+
+/* Seed of the leaf sizes and payloads */
+#define SWEEP_SEED 0x9E3779B97F4A7C15ull
+
+/* Runs per combination accepted */
+#define SWEEP_MAX_REPEATS 101
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Leaves of one combination, shared by the workers */
+struct sweep_run_t {
+    const unsigned char *pool;          /* payloads */
+    size_t pool_size;
+    const size_t *starts;               /* pool offset of the first leaf of every task */
+    const uint32_t *sizes;              /* size of every leaf */
+    long n_leaves;
+    enum sweep_backend_t backend;
+    EVP_MD *md;                         /* implementation of SWEEP_FETCHED */
+    EVP_MD_CTX *ctx[PARALLEL_MAX_THREADS]; /* one per worker */
+    unsigned char *hashes;              /* leaf hashes */
+};
+
+/* Timings of one run */
+struct sweep_sample_t {
+    double leaf_ms;
+    double level_ms;
+    double total_ms;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Draws the size of every leaf from the distribution.
+ *
+ * @param dist Size distribution.
+ * @param n_leaves Number of leaves.
+ * @param sizes Receives n_leaves sizes.
+ * @param max_size Receives the largest size.
+ * @return Total bytes of the leaves.
+ */
+static double DrawSizes(const struct sweep_dist_t *dist, long n_leaves, uint32_t *sizes,
+                        long *max_size);
+
+/**
+ * @brief Lays the leaves one after the other through the pool.
+ *
+ * A leaf that does not fit before the end of the pool starts again at its
+ * beginning; SweepLeafTask() follows the same rule from the offset of its
+ * first leaf.
+ *
+ * @param sizes Size of every leaf, at most pool_size.
+ * @param n_leaves Number of leaves.
+ * @param pool_size Size of the pool.
+ * @param starts Receives the offset of the first leaf of every SWEEP_CHUNK.
+ */
+static void LayLeaves(const uint32_t *sizes, long n_leaves, size_t pool_size, size_t *starts);
+
+/**
+ * @brief Hashes one chunk of leaves (parallel_task_t).
+ */
+static bool SweepLeafTask(void *ctx, int task, int worker);
+
+/**
+ * @brief Hashes the leaves and builds the levels on n_threads workers.
+ *
+ * @param run Leaves to hash.
+ * @param n_threads Number of workers.
+ * @param root Receives the root.
+ * @param sample Receives the timings.
+ * @retval true  Success.
+ * @retval false Hashing or allocation failure.
+ */
+static bool RunOnce(struct sweep_run_t *run, int n_threads, unsigned char root[SHA256_DIGEST_LENGTH],
+                    struct sweep_sample_t *sample);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* Names of the backends in the specification and the reports */
+static const char *backend_names[SWEEP_BACKENDS] = { "ctx", "fetched", "oneshot" };
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool SweepReadSpec(FILE *fp, struct sweep_spec_t *spec)
+{
+    bool ret = true;
+    char line[1024];
+    int line_no = 0;
+
+    memset(spec, 0, sizeof(*spec));
+    spec->repeats = 3;
+    spec->pool_mb = SWEEP_POOL_MB;
+
+    while (ret && fgets(line, sizeof(line), fp))
+    {
+        char *save = NULL;
+        char *key;
+        char *value = NULL;
+
+        line_no++;
+        line[strcspn(line, "#\n")] = '\0';
+        key = strtok_r(line, " \t", &save);
+        if (!key)
+        {
+            continue;
+        }
+        ret = strcmp(key, "threads") == 0 || strcmp(key, "leaves") == 0
+           || strcmp(key, "sizes") == 0 || strcmp(key, "backends") == 0
+           || strcmp(key, "repeats") == 0 || strcmp(key, "pool") == 0;
+
+        int n = 0;
+        while (ret && (value = strtok_r(NULL, " \t", &save)) != NULL)
+        {
+            char *end = NULL;
+            long v = strtol(value, &end, 10);
+            bool number = *end == '\0';
+
+            ret = n < SWEEP_MAX_VALUES;
+            if (!ret)
+            {
+                break;
+            }
+            if (strcmp(key, "threads") == 0)
+            {
+                ret = number && v >= 1 && v <= PARALLEL_MAX_THREADS;
+                spec->threads[n] = (int)v;
+                spec->n_threads = ++n;
+            }
+            else if (strcmp(key, "leaves") == 0)
+            {
+                ret = number && v >= 1 && v <= SWEEP_MAX_LEAVES;
+                spec->leaves[n] = v;
+                spec->n_leaves = ++n;
+            }
+            else if (strcmp(key, "sizes") == 0)
+            {
+                ret = SweepParseDist(value, &spec->sizes[n]);
+                spec->n_sizes = ++n;
+            }
+            else if (strcmp(key, "backends") == 0)
+            {
+                int b = 0;
+                while (b < SWEEP_BACKENDS && strcmp(value, backend_names[b]) != 0)
+                {
+                    b++;
+                }
+                ret = b < SWEEP_BACKENDS;
+                spec->backends[n] = (enum sweep_backend_t)b;
+                spec->n_backends = ++n;
+            }
+            else if (strcmp(key, "repeats") == 0)
+            {
+                ret = number && v >= 1 && v <= SWEEP_MAX_REPEATS && n == 0;
+                spec->repeats = (int)v;
+                n++;
+            }
+            else
+            {
+                ret = number && v >= 1 && v <= SWEEP_MAX_POOL_MB && n == 0;
+                spec->pool_mb = v;
+                n++;
+            }
+        }
+        if (!ret)
+        {
+            fprintf(stderr, "SweepReadSpec: line %d: invalid %s%s%s\n", line_no, key,
+                    value ? " value " : "", value ? value : "");
+        }
+    }
+
+    /* defaults of the omitted parameters */
+    if (spec->n_threads == 0)
+    {
+        spec->threads[spec->n_threads++] = 1;
+    }
+    if (spec->n_leaves == 0)
+    {
+        spec->leaves[spec->n_leaves++] = 65536;
+    }
+    if (spec->n_sizes == 0)
+    {
+        SweepParseDist("fixed:64", &spec->sizes[spec->n_sizes++]);
+    }
+    if (spec->n_backends == 0)
+    {
+        spec->backends[spec->n_backends++] = SWEEP_CTX;
+    }
+
+    return ret;
+}
+
+bool SweepParseDist(const char *str, struct sweep_dist_t *dist)
+{
+    bool ret = false;
+    char tail;
+
+    memset(dist, 0, sizeof(*dist));
+    if (sscanf(str, "fixed:%ld%c", &dist->size, &tail) == 1)
+    {
+        dist->kind = SWEEP_FIXED;
+        ret = dist->size >= 0 && dist->size <= SWEEP_MAX_LEAF_SIZE;
+    }
+    else if (sscanf(str, "lognormal:%ld:%lf%c", &dist->size, &dist->param, &tail) == 2)
+    {
+        dist->kind = SWEEP_LOGNORMAL;
+        ret = dist->size >= 1 && dist->size <= SWEEP_MAX_LEAF_SIZE
+           && dist->param >= 0.0 && dist->param <= 4.0;
+    }
+    else if (sscanf(str, "mixed:%ld:%ld:%lf%c", &dist->size, &dist->huge, &dist->param, &tail) == 3)
+    {
+        dist->kind = SWEEP_MIXED;
+        ret = dist->size >= 0 && dist->huge >= dist->size && dist->huge <= SWEEP_MAX_LEAF_SIZE
+           && dist->param >= 0.0 && dist->param <= 1.0;
+    }
+    snprintf(dist->label, sizeof(dist->label), "%s", str);
+
+    return ret;
+}
+
+long SweepLeafSize(const struct sweep_dist_t *dist, uint64_t seed, long leaf)
+{
+    /* two uniform draws in (0, 1] per leaf */
+    double u1 = ((SplitMix(seed ^ (uint64_t)(2 * leaf)) >> 11) + 1) * 0x1.0p-53;
+    double u2 = ((SplitMix(seed ^ (uint64_t)(2 * leaf + 1)) >> 11) + 1) * 0x1.0p-53;
+    double size = (double)dist->size;
+
+    if (dist->kind == SWEEP_LOGNORMAL)
+    {
+        /* Box-Muller normal draw */
+        double z = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+        size = dist->size * exp(dist->param * z);
+        size = size < 1.0 ? 1.0 : size > SWEEP_MAX_LEAF_SIZE ? SWEEP_MAX_LEAF_SIZE : size;
+    }
+    else if (dist->kind == SWEEP_MIXED && u1 <= dist->param)
+    {
+        size = (double)dist->huge;
+    }
+
+    return (long)size;
+}
+
+int SweepRun(const struct sweep_spec_t *spec, FILE *out, FILE *csv)
+{
+    int failed = 0;
+    int saved_threads = merkle_config.threads;
+
+    fprintf(out, "%10s %-24s %-8s %7s %10s %10s %10s %10s %8s %7s\n",
+        "LEAVES", "SIZES", "BACKEND", "THREADS", "LEAF (ms)", "LEVEL (ms)", "TOTAL (ms)",
+        "MB/s", "SPEEDUP", "EFFIC");
+    fprintf(out, "-------------------------------------------------------------------------------------------------------------\n");
+    if (csv)
+    {
+        fprintf(csv, "leaves,sizes,backend,threads,bytes,leaf_ms,level_ms,total_ms,"
+                     "leaves_per_s,mb_per_s,speedup,efficiency\n");
+    }
+
+    for (int l = 0; l < spec->n_leaves; l++)
+    {
+        long n_leaves = spec->leaves[l];
+        struct sweep_run_t run = {
+            .n_leaves = n_leaves,
+            .hashes = malloc((size_t)n_leaves * SHA256_DIGEST_LENGTH),
+        };
+        uint32_t *sizes = malloc((size_t)n_leaves * sizeof(uint32_t));
+
+        for (int d = 0; d < spec->n_sizes && run.hashes && sizes; d++)
+        {
+            const struct sweep_dist_t *dist = &spec->sizes[d];
+            long max_size = 0;
+            double bytes = DrawSizes(dist, n_leaves, sizes, &max_size);
+            long pool_size = spec->pool_mb << 20 > max_size ? spec->pool_mb << 20 : max_size;
+            unsigned char *pool = malloc((size_t)pool_size);
+            size_t *starts = malloc((size_t)(n_leaves + SWEEP_CHUNK - 1) / SWEEP_CHUNK * sizeof(size_t));
+            unsigned char ref_root[SHA256_DIGEST_LENGTH];
+            bool have_ref = false;
+
+            if (!pool || !starts)
+            {
+                fprintf(stderr, "SweepRun: unable to allocate %ld payload bytes\n", pool_size);
+                free(pool);
+                free(starts);
+                failed++;
+                continue;
+            }
+            for (long i = 0; i + 8 <= pool_size; i += 8)
+            {
+                uint64_t r = SplitMix(SWEEP_SEED + (uint64_t)i);
+                memcpy(pool + i, &r, 8);
+            }
+            LayLeaves(sizes, n_leaves, (size_t)pool_size, starts);
+            run.pool = pool;
+            run.pool_size = (size_t)pool_size;
+            run.starts = starts;
+            run.sizes = sizes;
+
+            for (int b = 0; b < spec->n_backends; b++)
+            {
+                double base_ms = 0.0;
+                int base_threads = 0;
+
+                run.backend = spec->backends[b];
+                run.md = run.backend == SWEEP_FETCHED ? EVP_MD_fetch(NULL, "SHA256", NULL) : NULL;
+
+                for (int t = 0; t < spec->n_threads; t++)
+                {
+                    int n_threads = spec->threads[t];
+                    double leaf_ms[SWEEP_MAX_REPEATS];
+                    double level_ms[SWEEP_MAX_REPEATS];
+                    double total_ms[SWEEP_MAX_REPEATS];
+                    bool ok = true;
+
+                    for (int w = 0; w < n_threads && ok; w++)
+                    {
+                        run.ctx[w] = EVP_MD_CTX_new();
+                        ok = run.ctx[w] != NULL;
+                    }
+                    for (int r = 0; r < spec->repeats && ok; r++)
+                    {
+                        unsigned char root[SHA256_DIGEST_LENGTH];
+                        struct sweep_sample_t sample;
+
+                        ok = RunOnce(&run, n_threads, root, &sample);
+                        if (ok && !have_ref)
+                        {
+                            memcpy(ref_root, root, SHA256_DIGEST_LENGTH);
+                            have_ref = true;
+                        }
+                        else if (ok && memcmp(root, ref_root, SHA256_DIGEST_LENGTH) != 0)
+                        {
+                            fprintf(stderr, "SweepRun: root mismatch with %s on %d threads\n",
+                                    backend_names[run.backend], n_threads);
+                            ok = false;
+                        }
+                        leaf_ms[r] = sample.leaf_ms;
+                        level_ms[r] = sample.level_ms;
+                        total_ms[r] = sample.total_ms;
+                    }
+                    for (int w = 0; w < n_threads; w++)
+                    {
+                        EVP_MD_CTX_free(run.ctx[w]);
+                        run.ctx[w] = NULL;
+                    }
+
+                    if (!ok)
+                    {
+                        fprintf(out, "%10ld %-24s %-8s %7d %10s\n", n_leaves, dist->label,
+                                backend_names[run.backend], n_threads, "FAILED");
+                        failed++;
+                        continue;
+                    }
+
+                    double leaf = Median(leaf_ms, spec->repeats);
+                    double level = Median(level_ms, spec->repeats);
+                    double total = Median(total_ms, spec->repeats);
+                    double mb_s = bytes / 1e6 / (total / 1e3);
+                    /* relative to the first thread count that succeeded */
+                    if (base_threads == 0)
+                    {
+                        base_ms = total;
+                        base_threads = n_threads;
+                    }
+                    double speedup = base_ms / total;
+                    double efficiency = speedup * base_threads / n_threads;
+
+                    fprintf(out, "%10ld %-24s %-8s %7d %10.2f %10.2f %10.2f %10.1f %8.2f %7.2f\n",
+                            n_leaves, dist->label, backend_names[run.backend], n_threads,
+                            leaf, level, total, mb_s, speedup, efficiency);
+                    if (csv)
+                    {
+                        fprintf(csv, "%ld,%s,%s,%d,%.0f,%.3f,%.3f,%.3f,%.0f,%.2f,%.3f,%.3f\n",
+                                n_leaves, dist->label, backend_names[run.backend], n_threads,
+                                bytes, leaf, level, total, n_leaves / (total / 1e3), mb_s,
+                                speedup, efficiency);
+                    }
+                }
+                EVP_MD_free(run.md);
+            }
+            free(pool);
+            free(starts);
+        }
+        if (!run.hashes || !sizes)
+        {
+            fprintf(stderr, "SweepRun: unable to allocate %ld leaves\n", n_leaves);
+            failed++;
+        }
+        free(run.hashes);
+        free(sizes);
+    }
+    fprintf(out, "-------------------------------------------------------------------------------------------------------------\n");
+    merkle_config.threads = saved_threads;
+
+    return failed;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static double DrawSizes(const struct sweep_dist_t *dist, long n_leaves, uint32_t *sizes,
+                        long *max_size)
+{
+    double bytes = 0.0;
+
+    *max_size = 0;
+    for (long i = 0; i < n_leaves; i++)
+    {
+        sizes[i] = (uint32_t)SweepLeafSize(dist, SWEEP_SEED, i);
+        bytes += sizes[i];
+        *max_size = sizes[i] > *max_size ? sizes[i] : *max_size;
+    }
+
+    return bytes;
+}
+
+static void LayLeaves(const uint32_t *sizes, long n_leaves, size_t pool_size, size_t *starts)
+{
+    size_t offset = 0;
+
+    for (long i = 0; i < n_leaves; i++)
+    {
+        if (i % SWEEP_CHUNK == 0)
+        {
+            starts[i / SWEEP_CHUNK] = offset;
+        }
+        offset = offset + sizes[i] > pool_size ? 0 : offset;
+        offset += sizes[i];
+    }
+}
+
+static bool SweepLeafTask(void *ctx, int task, int worker)
+{
+    struct sweep_run_t *run = ctx;
+    EVP_MD_CTX *mdctx = run->ctx[worker];
+    long first = (long)task * SWEEP_CHUNK;
+    long last = first + SWEEP_CHUNK < run->n_leaves ? first + SWEEP_CHUNK : run->n_leaves;
+    size_t offset = run->starts[task];
+    bool ret = true;
+
+    for (long i = first; i < last && ret; i++)
+    {
+        /* wraps as LayLeaves() does */
+        const unsigned char *data = offset + run->sizes[i] > run->pool_size ? run->pool : run->pool + offset;
+        unsigned char *out = run->hashes + (size_t)i * SHA256_DIGEST_LENGTH;
+
+        switch (run->backend)
+        {
+            case SWEEP_CTX:
+                ret = EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL)
+                   && EVP_DigestUpdate(mdctx, data, run->sizes[i])
+                   && EVP_DigestFinal_ex(mdctx, out, NULL);
+                break;
+            case SWEEP_FETCHED:
+                ret = EVP_DigestInit_ex(mdctx, run->md, NULL)
+                   && EVP_DigestUpdate(mdctx, data, run->sizes[i])
+                   && EVP_DigestFinal_ex(mdctx, out, NULL);
+                break;
+            default:
+                ret = EVP_Digest(data, run->sizes[i], out, NULL, EVP_sha256(), NULL);
+                break;
+        }
+        offset = (size_t)(data - run->pool) + run->sizes[i];
+    }
+
+    return ret;
+}
+
+static bool RunOnce(struct sweep_run_t *run, int n_threads, unsigned char root[SHA256_DIGEST_LENGTH],
+                    struct sweep_sample_t *sample)
+{
+    struct merkle_levels_t lv;
+    int n_tasks = (int)((run->n_leaves + SWEEP_CHUNK - 1) / SWEEP_CHUNK);
+    double start = NowNs() / 1e6;
+    bool ret = (run->backend != SWEEP_FETCHED || run->md)
+            && ParallelFor(n_tasks, n_threads, SweepLeafTask, run, NULL);
+    double hashed = NowNs() / 1e6;
+
+    merkle_config.threads = n_threads;
+    ret = ret && LevelsFromLeafHashes(run->hashes, (int)run->n_leaves, 2, PADDING_DUPLICATE, &lv);
+    sample->leaf_ms = hashed - start;
+    sample->total_ms = NowNs() / 1e6 - start;
+    sample->level_ms = sample->total_ms - sample->leaf_ms;
+    if (ret)
+    {
+        memcpy(root, LevelsRoot(&lv), SHA256_DIGEST_LENGTH);
+        LevelsFree(&lv);
+    }
+
+    return ret;
+}
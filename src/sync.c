@@ -0,0 +1,586 @@
+/**
+ * @file sync.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Anti-entropy synchronization of two trees over a stream socket
+ *
+ * Every message starts with a header { type, a, b } in network order:
+ *  - HELLO   pull -> serve
+ *  - SHAPE   serve -> pull: a = levels, b = leaves, arity, padding,
+ *            level sizes and root
+ *  - REQUEST pull -> serve: a = runs, runs of { level, first, count }
+ *  - HASHES  serve -> pull: a = hashes, the hashes of the runs in order
+ *  - DONE    pull -> serve
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/sync.h"
+#include "../inc/diff.h"
+#include "../inc/mem.h"                 /* MemAlloc, MemRealloc, MemFree */
+
+#include <stdlib.h>                     /* qsort */
+#include <limits.h>                     /* INT_MAX */
+#include <arpa/inet.h>                  /* htonl, ntohl */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Message types */
+#define SYNC_HELLO   1
+#define SYNC_SHAPE   2
+#define SYNC_REQUEST 3
+#define SYNC_HASHES  4
+#define SYNC_DONE    5
+
+/* Initial capacity of the growable arrays */
+#define SYNC_MIN_CAPACITY 64
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+/* Byte counters of the optional statistics, for WriteAll() and ReadAll() */
+#define SENT(stats)     ((stats) ? &(stats)->bytes_sent : NULL)
+#define RECEIVED(stats) ((stats) ? &(stats)->bytes_received : NULL)
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Message header */
+struct sync_header_t {
+    uint8_t type;
+    uint8_t pad[3];
+    uint32_t a;
+    uint32_t b;
+};
+
+/* Range of nodes of one level */
+struct sync_run_t {
+    uint32_t level;
+    uint32_t first;
+    uint32_t count;
+};
+
+/* Request sent and not answered yet */
+struct sync_inflight_t {
+    int n_runs;
+    struct sync_run_t runs[SYNC_REQUEST_HASHES];
+};
+
+/* State of the pulling side */
+struct sync_pull_t {
+    int fd;
+    const struct merkle_levels_t *local;
+    struct sync_stats_t *stats;
+    int remote_leaves;
+    int arity;                          /* children per node, both trees */
+    int padding;                        /* completion of the groups, both trees */
+    int *remote_size;                   /* nodes per remote level */
+    /* runs still to request, FIFO */
+    struct sync_run_t *queue;
+    int q_head, q_tail, q_capacity;
+    /* blocks to transfer */
+    int *blocks;
+    int n_blocks, b_capacity;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Sends a message header.
+ */
+static bool SendHeader(int fd, uint8_t type, uint32_t a, uint32_t b, struct sync_stats_t *stats);
+
+/**
+ * @brief Receives a message header, checking its type.
+ */
+static bool ReceiveHeader(int fd, uint8_t type, struct sync_header_t *header, struct sync_stats_t *stats);
+
+/**
+ * @brief Appends a run to the queue of the pulling side.
+ *
+ * Consecutive runs of the same level are merged.
+ */
+static bool QueuePush(struct sync_pull_t *p, uint32_t level, uint32_t first, uint32_t count);
+
+/**
+ * @brief Appends a range of blocks to transfer.
+ */
+static bool BlocksPush(struct sync_pull_t *p, long first, long last);
+
+/**
+ * @brief Compares remote hashes of a run with the local tree.
+ *
+ * Differing nodes queue their children, differing leaves and
+ * nodes missing locally add blocks to transfer.
+ *
+ * @param p Pulling side.
+ * @param run Run the hashes belong to.
+ * @param hashes run->count remote hashes.
+ * @retval true  Success.
+ * @retval false Allocation failure.
+ */
+static bool ProcessRun(struct sync_pull_t *p, const struct sync_run_t *run, const unsigned char *hashes);
+
+/**
+ * @brief Fills and sends a request with the runs at the head of the queue.
+ *
+ * @param p Pulling side.
+ * @param req Request to fill.
+ * @retval true  Success.
+ * @retval false I/O error.
+ */
+static bool SendRequest(struct sync_pull_t *p, struct sync_inflight_t *req);
+
+/**
+ * @brief Receives and processes the answer of a request.
+ *
+ * @param p Pulling side.
+ * @param req Request being answered.
+ * @retval true  Success.
+ * @retval false Protocol or I/O error.
+ */
+static bool ReceiveAnswer(struct sync_pull_t *p, const struct sync_inflight_t *req);
+
+/**
+ * @brief qsort comparator for ints.
+ */
+static int CompareInt(const void *a, const void *b);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool SyncServe(int fd, const struct merkle_levels_t *lv, struct sync_stats_t *stats)
+{
+    bool ret = false;
+    /* the protocol counts the nodes of a level in 32 bits */
+    bool running = lv->n_levels == 0 || lv->level_size[0] <= INT_MAX;
+    struct sync_header_t header;
+    struct sync_run_t runs[SYNC_REQUEST_HASHES];
+
+    if (!running)
+    {
+        fprintf(stderr, "SyncServe: %ld leaves do not fit the protocol\n", lv->level_size[0]);
+    }
+
+    while (running && ReadAll(fd, &header, sizeof(header), RECEIVED(stats)))
+    {
+        running = false;
+        switch (header.type)
+        {
+            case SYNC_HELLO:
+            {
+                uint32_t shape[2] = { htonl((uint32_t)lv->arity), htonl((uint32_t)lv->padding) };
+                running = SendHeader(fd, SYNC_SHAPE, lv->n_levels, lv->n_leaves, stats) &&
+                          WriteAll(fd, shape, sizeof(shape), -1, SENT(stats));
+                for (int l = 0; l < lv->n_levels && running; l++)
+                {
+                    uint32_t size = htonl((uint32_t)lv->level_size[l]);
+                    running = WriteAll(fd, &size, sizeof(size), -1, SENT(stats));
+                }
+                if (running && lv->n_levels > 0)
+                {
+                    running = WriteAll(fd, LevelsRoot(lv), SHA256_DIGEST_LENGTH, -1, SENT(stats));
+                }
+                break;
+            }
+
+            case SYNC_REQUEST:
+            {
+                uint32_t n_runs = ntohl(header.a);
+                uint32_t n_hashes = 0;
+
+                if (n_runs == 0 || n_runs > SYNC_REQUEST_HASHES ||
+                    !ReadAll(fd, runs, n_runs * sizeof(runs[0]), RECEIVED(stats)))
+                {
+                    break;
+                }
+                /* validate the runs before answering */
+                running = true;
+                for (uint32_t r = 0; r < n_runs && running; r++)
+                {
+                    runs[r].level = ntohl(runs[r].level);
+                    runs[r].first = ntohl(runs[r].first);
+                    runs[r].count = ntohl(runs[r].count);
+                    n_hashes += runs[r].count;
+                    running = runs[r].level < (uint32_t)lv->n_levels &&
+                              (uint64_t)runs[r].first + runs[r].count <=
+                              (uint64_t)lv->level_size[runs[r].level];
+                }
+                running = running && n_hashes <= SYNC_REQUEST_HASHES &&
+                          SendHeader(fd, SYNC_HASHES, n_hashes, 0, stats);
+                for (uint32_t r = 0; r < n_runs && running; r++)
+                {
+                    /* the runs are contiguous in the level array */
+                    running = WriteAll(fd, LEVEL_HASH(lv, runs[r].level, runs[r].first),
+                                       (size_t)runs[r].count * SHA256_DIGEST_LENGTH, -1,
+                                       SENT(stats));
+                }
+                if (stats)
+                {
+                    stats->requests++;
+                    stats->hashes += n_hashes;
+                }
+                break;
+            }
+
+            case SYNC_DONE:
+                ret = true;
+                break;
+
+            default:
+                fprintf(stderr, "SyncServe: unexpected message %d\n", header.type);
+                break;
+        }
+    }
+
+    return ret;
+}
+
+int SyncPull(int fd, const struct merkle_levels_t *local, int **blocks,
+             int *remote_leaves, struct sync_stats_t *stats)
+{
+    int ret = -1;
+    bool ok = false;
+    struct sync_header_t header;
+    struct sync_pull_t p = { .fd = fd, .local = local, .stats = stats };
+    struct sync_inflight_t *inflight = MemAlloc(MEM_IO, SYNC_PIPELINE_DEPTH * sizeof(*inflight));
+    unsigned char root[SHA256_DIGEST_LENGTH];
+    uint32_t shape[2] = {0};
+    int n_remote_levels = 0;
+
+    *blocks = NULL;
+
+    /* get the shape of the remote tree, the local one counted in 32 bits */
+    if (inflight && (local->n_levels == 0 || local->level_size[0] <= INT_MAX) &&
+        SendHeader(fd, SYNC_HELLO, 0, 0, stats) &&
+        ReceiveHeader(fd, SYNC_SHAPE, &header, stats) &&
+        ReadAll(fd, shape, sizeof(shape), RECEIVED(stats)))
+    {
+        n_remote_levels = (int)ntohl(header.a);
+        p.remote_leaves = (int)ntohl(header.b);
+        p.arity = (int)ntohl(shape[0]);
+        p.padding = (int)ntohl(shape[1]);
+        p.remote_size = MemAlloc(MEM_SCRATCH, MAX(n_remote_levels, 1) * sizeof(int));
+        ok = p.remote_size != NULL;
+        if (ok && local->n_levels > 0 &&
+            (p.arity != local->arity || p.padding != (int)local->padding))
+        {
+            /* node hashes only line up between trees of the same shape */
+            fprintf(stderr, "SyncPull: remote arity %d padding %d, local arity %d padding %d\n",
+                    p.arity, p.padding, local->arity, local->padding);
+            ok = false;
+        }
+        for (int l = 0; l < n_remote_levels && ok; l++)
+        {
+            uint32_t size;
+            ok = ReadAll(fd, &size, sizeof(size), RECEIVED(stats));
+            p.remote_size[l] = (int)ntohl(size);
+        }
+        if (ok && n_remote_levels > 0)
+        {
+            ok = ReadAll(fd, root, sizeof(root), RECEIVED(stats));
+        }
+    }
+
+    if (ok && n_remote_levels > 0)
+    {
+        if (local->n_levels == 0)
+        {
+            /* nothing local: every block is needed */
+            ok = BlocksPush(&p, 0, p.remote_leaves - 1);
+        }
+        else
+        {
+            /* nodes at the same index cover the same leaves in both trees,
+             * start from the highest level they have in common */
+            int top = MIN(local->n_levels, n_remote_levels) - 1;
+            struct sync_run_t run = { top, 0, p.remote_size[top] };
+
+            if (top == n_remote_levels - 1)
+            {
+                /* the remote root came with the shape */
+                ok = ProcessRun(&p, &run, root);
+            }
+            else
+            {
+                ok = QueuePush(&p, run.level, run.first, run.count);
+            }
+        }
+
+        /* keep up to SYNC_PIPELINE_DEPTH requests in flight,
+         * answers come back in order */
+        int sent = 0, answered = 0;
+        while (ok && (p.q_head != p.q_tail || answered < sent))
+        {
+            if (p.q_head != p.q_tail && sent - answered < SYNC_PIPELINE_DEPTH)
+            {
+                ok = SendRequest(&p, &inflight[sent % SYNC_PIPELINE_DEPTH]);
+                sent++;
+            }
+            else
+            {
+                ok = ReceiveAnswer(&p, &inflight[answered % SYNC_PIPELINE_DEPTH]);
+                answered++;
+            }
+        }
+    }
+
+    if (ok && SendHeader(fd, SYNC_DONE, 0, 0, stats))
+    {
+        qsort(p.blocks, p.n_blocks, sizeof(int), CompareInt);
+        ret = p.n_blocks;
+        /* the caller's now, released with free() */
+        if (p.blocks)
+        {
+            MemUntrack(MEM_SCRATCH, (size_t)p.b_capacity * sizeof(int));
+        }
+        *blocks = p.blocks;
+        p.blocks = NULL;
+        if (remote_leaves)
+        {
+            *remote_leaves = p.remote_leaves;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "SyncPull: synchronization failed\n");
+    }
+
+    MemFree(MEM_SCRATCH, p.blocks, (size_t)p.b_capacity * sizeof(int));
+    MemFree(MEM_SCRATCH, p.queue, (size_t)p.q_capacity * sizeof(*p.queue));
+    MemFree(MEM_SCRATCH, p.remote_size, MAX(n_remote_levels, 1) * sizeof(int));
+    MemFree(MEM_IO, inflight, SYNC_PIPELINE_DEPTH * sizeof(*inflight));
+
+    return ret;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool SendHeader(int fd, uint8_t type, uint32_t a, uint32_t b, struct sync_stats_t *stats)
+{
+    struct sync_header_t header = { .type = type, .a = htonl(a), .b = htonl(b) };
+
+    return WriteAll(fd, &header, sizeof(header), -1, SENT(stats));
+}
+
+static bool ReceiveHeader(int fd, uint8_t type, struct sync_header_t *header, struct sync_stats_t *stats)
+{
+    bool ret = ReadAll(fd, header, sizeof(*header), RECEIVED(stats)) && header->type == type;
+
+    if (!ret)
+    {
+        fprintf(stderr, "ReceiveHeader: expected message %d\n", type);
+    }
+
+    return ret;
+}
+
+static bool QueuePush(struct sync_pull_t *p, uint32_t level, uint32_t first, uint32_t count)
+{
+    bool ret = true;
+    struct sync_run_t *last = p->q_tail > p->q_head ? &p->queue[p->q_tail - 1] : NULL;
+
+    if (last && last->level == level && last->first + last->count == first)
+    {
+        last->count += count;
+        return true;
+    }
+
+    if (p->q_tail == p->q_capacity)
+    {
+        /* drop the consumed head before growing */
+        memmove(p->queue, p->queue + p->q_head, (p->q_tail - p->q_head) * sizeof(*p->queue));
+        p->q_tail -= p->q_head;
+        p->q_head = 0;
+
+        if (p->q_tail == p->q_capacity)
+        {
+            int capacity = MAX(SYNC_MIN_CAPACITY, p->q_capacity * 2);
+            struct sync_run_t *grown = MemRealloc(MEM_SCRATCH, p->queue,
+                                                  (size_t)p->q_capacity * sizeof(*grown),
+                                                  (size_t)capacity * sizeof(*grown));
+            if (grown)
+            {
+                p->queue = grown;
+                p->q_capacity = capacity;
+            }
+            else
+            {
+                fprintf(stderr, "QueuePush: allocation failed\n");
+                ret = false;
+            }
+        }
+    }
+
+    if (ret)
+    {
+        p->queue[p->q_tail++] = (struct sync_run_t){ level, first, count };
+    }
+
+    return ret;
+}
+
+static bool BlocksPush(struct sync_pull_t *p, long first, long last)
+{
+    bool ret = true;
+
+    last = MIN(last, (long)p->remote_leaves - 1);
+    for (long i = first; i <= last && ret; i++)
+    {
+        if (p->n_blocks == p->b_capacity)
+        {
+            int capacity = MAX(SYNC_MIN_CAPACITY, p->b_capacity * 2);
+            int *grown = MemRealloc(MEM_SCRATCH, p->blocks, (size_t)p->b_capacity * sizeof(int),
+                                    (size_t)capacity * sizeof(int));
+            if (grown)
+            {
+                p->blocks = grown;
+                p->b_capacity = capacity;
+            }
+            else
+            {
+                fprintf(stderr, "BlocksPush: allocation failed\n");
+                ret = false;
+            }
+        }
+        if (ret)
+        {
+            p->blocks[p->n_blocks++] = (int)i;
+        }
+    }
+
+    return ret;
+}
+
+static bool ProcessRun(struct sync_pull_t *p, const struct sync_run_t *run, const unsigned char *hashes)
+{
+    bool ret = true;
+    const struct merkle_levels_t *local = p->local;
+    int level = run->level;
+
+    for (uint32_t j = 0; j < run->count && ret; j++)
+    {
+        long idx = (long)run->first + j;
+        long first_leaf = idx * LevelSpan(p->arity, level);
+        long end_leaf = (idx + 1) * LevelSpan(p->arity, level);
+
+        if (idx >= local->level_size[level] || first_leaf >= local->n_leaves)
+        {
+            /* nothing local under this node: fetch every block */
+            ret = BlocksPush(p, first_leaf, end_leaf - 1);
+        }
+        else if (HashDiffers(hashes + j * SHA256_DIGEST_LENGTH, LEVEL_HASH(local, level, idx)) ||
+                 (end_leaf > local->n_leaves && local->n_leaves != p->remote_leaves))
+        {
+            /* differing node, or node covering local padding only */
+            if (level == 0)
+            {
+                ret = BlocksPush(p, idx, idx);
+            }
+            else
+            {
+                uint32_t child = (uint32_t)(p->arity * idx);
+                uint32_t count = MIN(p->arity, p->remote_size[level - 1] - (int)child);
+                ret = QueuePush(p, level - 1, child, count);
+            }
+        }
+    }
+
+    return ret;
+}
+
+static bool SendRequest(struct sync_pull_t *p, struct sync_inflight_t *req)
+{
+    struct sync_run_t wire[SYNC_REQUEST_HASHES];
+    uint32_t n_hashes = 0;
+
+    req->n_runs = 0;
+    while (p->q_head != p->q_tail && n_hashes < SYNC_REQUEST_HASHES)
+    {
+        struct sync_run_t *head = &p->queue[p->q_head];
+        struct sync_run_t run = *head;
+
+        /* split the run if it does not fit */
+        run.count = MIN(run.count, SYNC_REQUEST_HASHES - n_hashes);
+        head->first += run.count;
+        head->count -= run.count;
+        if (head->count == 0)
+        {
+            p->q_head++;
+        }
+
+        req->runs[req->n_runs] = run;
+        wire[req->n_runs].level = htonl(run.level);
+        wire[req->n_runs].first = htonl(run.first);
+        wire[req->n_runs].count = htonl(run.count);
+        req->n_runs++;
+        n_hashes += run.count;
+    }
+
+    if (p->stats)
+    {
+        p->stats->requests++;
+    }
+
+    return SendHeader(p->fd, SYNC_REQUEST, req->n_runs, 0, p->stats) &&
+           WriteAll(p->fd, wire, req->n_runs * sizeof(wire[0]), -1, SENT(p->stats));
+}
+
+static bool ReceiveAnswer(struct sync_pull_t *p, const struct sync_inflight_t *req)
+{
+    bool ret = false;
+    struct sync_header_t header;
+    unsigned char hashes[SYNC_REQUEST_HASHES * SHA256_DIGEST_LENGTH];
+    uint32_t expected = 0;
+
+    for (int r = 0; r < req->n_runs; r++)
+    {
+        expected += req->runs[r].count;
+    }
+
+    if (ReceiveHeader(p->fd, SYNC_HASHES, &header, p->stats) &&
+        ntohl(header.a) == expected &&
+        ReadAll(p->fd, hashes, (size_t)expected * SHA256_DIGEST_LENGTH, RECEIVED(p->stats)))
+    {
+        const unsigned char *ptr = hashes;
+
+        ret = true;
+        for (int r = 0; r < req->n_runs && ret; r++)
+        {
+            ret = ProcessRun(p, &req->runs[r], ptr);
+            ptr += (size_t)req->runs[r].count * SHA256_DIGEST_LENGTH;
+        }
+        if (p->stats)
+        {
+            p->stats->hashes += expected;
+        }
+    }
+
+    return ret;
+}
+
+static int CompareInt(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+
+    return (x > y) - (x < y);
+}
@@ -10,12 +10,46 @@
  *-----------------------------------*/
 #include "../inc/tests.h"
 #include "merkleTree.h"
+#include "diff.h"
+#include "sync.h"
+#include "verify.h"
+#include "proof.h"
+#include "levelfile.h"
+#include "sparse.h"
+#include "blocked.h"
+#include "config.h"
+#include "placement.h"
+#include "append.h"
+#include "rcu.h"
+#include "shared.h"
+#include "server.h"
+#include "trace.h"
+#include "parallel.h"
+#include "perf.h"
+#include "sweep.h"
+#include "pagecache.h"
+#include "results.h"
+#include "dataset.h"
+#include "stats.h"
+#include "mem.h"
+#include "tune.h"
 #include <stdio.h>
+#include <pthread.h>        /* producers of the append test */
+#include <stdatomic.h>      /* crypto_allocs */
+#include <openssl/crypto.h> /* CRYPTO_set_mem_functions */
+#include <stdlib.h>         /* malloc, free */
+#include <limits.h>         /* INT_MAX */
+#include <time.h>           /* clock_gettime */
 #include <unistd.h>         /* sysconf() */
 #include <sys/time.h>       /* timeval */
 #include <sys/resource.h>   /* rusage */
 #include <sys/sysinfo.h>    /* sysinfo */
 #include <sys/utsname.h>    /* utsname */
+#include <sys/socket.h>     /* socketpair */
+#include <sys/wait.h>       /* waitpid */
+#include <sys/stat.h>       /* mkdir */
+#include <arpa/inet.h>      /* ntohl */
+#include <poll.h>           /* poll */
 
 /*-----------------------------------*
  * PUBLIC VARIABLE DEFINITIONS
@@ -28,6 +62,138 @@ int numFolders = 0;
  *-----------------------------------*/
 #define RESULTS_FILE "tests_results.txt"
 
+/* Functionality tests: leaves of the synthetic trees and corrupted leaves */
+#define SYNTHETIC_LEAVES    (1 << 20)
+#define SYNTHETIC_CORRUPTED 10
+
+/* Verify test: checkpoint file with too few hashes, but consistent with its root */
+#define VERIFY_CRAFTED_FILE "data/verify_crafted.txt"
+
+/* Arity benchmark: proofs checked per arity */
+#define PROOF_SAMPLES 1000
+
+/* Counters test: parents hashed by PERF_THREADS workers */
+#define PERF_PARENTS 8192
+#define PERF_THREADS 2
+
+/* Results test: samples per side, threshold of the comparison */
+#define RESULTS_TEST_SAMPLES 5
+#define RESULTS_TEST_THRESHOLD 5.0
+/* Runs of an older revision ahead of the current ones, left out of the comparison */
+#define RESULTS_TEST_OLD_RUNS 3
+/* One sample per side, 50% worse: too few to count as a regression */
+#define RESULTS_TEST_FEW_BASE "{\"rev\":\"a\",\"host\":\"h\",\"metric\":\"test/hash_ms\",\"value\":100}\n"
+#define RESULTS_TEST_FEW_CUR  "{\"rev\":\"b\",\"host\":\"h\",\"metric\":\"test/hash_ms\",\"value\":150}\n"
+
+/* Dataset test: two copies of one dataset, written by 1 and 2 writers */
+#define DATASET_TEST_FORMAT "data/dataset_test_%d/"
+#define DATASET_TEST_FILES  3001
+#define DATASET_TEST_SIZES  "lognormal:256:1.0"
+
+/* Stats test: counter updates timed, wait for the signal dump */
+#define STATS_TEST_UPDATES 10000000
+#define STATS_TEST_WAIT_MS 5000
+
+/* Memory test: leaves of the accounted tree */
+#define MEM_TEST_LEAVES 100000
+
+/* Tune test: probes kept short, profile written then removed */
+#define TUNE_TEST_SAMPLE       512
+#define TUNE_TEST_LEVEL_LEAVES 16384
+#define TUNE_TEST_PROFILE      "data/tune_test.profile"
+#define TUNE_TEST_FOREIGN_HOST "another-host"
+
+/* Sweep test: specification, its combinations and an invalid one */
+#define SWEEP_TEST_SPEC "threads 1 2\nleaves 5001\n" \
+                        "sizes fixed:64 mixed:16:65536:0.01\nbackends ctx fetched oneshot\nrepeats 1\npool 1\n"
+#define SWEEP_TEST_ROWS (2 * 2 * 3)
+#define SWEEP_TEST_BAD  "threads 1 0\n"
+
+/* Padding test: odd number of leaves of the ambiguity check */
+#define PADDING_ODD_LEAVES 1001
+
+/* Out-of-core test: directory of the level files */
+#define OOC_TEST_DIR "data/levels_test/"
+
+/* Level-skipping test: highest levels always stored */
+#define SPARSE_TOP_LEVELS 4
+
+/* Layout benchmark: proof paths of random leaves read per layout */
+#define LAYOUT_PROOFS 200000
+
+/* Append test: leaves, producer threads, slots claimed at once and
+ * prefix roots read during the ingestion checked afterwards */
+#define APPEND_LEAVES    100003
+#define APPEND_PRODUCERS 4
+#define APPEND_CHUNK     64
+#define APPEND_SAMPLES   4
+
+/* Snapshot test: leaves, reader threads, batches of leaves changed by
+ * the writer, and proofs timed without a writer */
+#define RCU_LEAVES      100003
+#define RCU_READERS     2
+#define RCU_UPDATES     2000
+#define RCU_BATCH       16
+#define RCU_IDLE_PROOFS 20000
+
+/* Version test: leaves, updates of VERSION_BATCH leaves, versions kept */
+#define VERSION_LEAVES  4099
+#define VERSION_UPDATES 64
+#define VERSION_BATCH   8
+#define VERSION_KEEP    16
+
+/* Shared memory test: proofs built by the reader process per generation */
+#define SHARED_PROOFS 100000
+
+/* Snapshot test: leaves and arity of the tree, and where the header of
+ * the snapshot format keeps the leaf count and the level sizes */
+#define SNAPSHOT_TEST_LEAVES 4099
+#define SNAPSHOT_TEST_ARITY  4
+#define SNAPSHOT_LEAVES_AT   (2 * sizeof(uint32_t))
+#define SNAPSHOT_SIZES_AT    (6 * sizeof(uint32_t))
+
+/* Server test: clients, proofs asked by each client, and requests
+ * each client keeps in flight in the pipelined run */
+#define SERVER_CLIENTS 4
+#define SERVER_PROOFS  20000
+#define SERVER_DEPTH   64
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Level hashed by the workers of the counters test */
+struct perf_level_t {
+    unsigned char *children;
+    unsigned char *parents;
+};
+
+/* Reader thread of the snapshot test */
+struct rcu_reader_t {
+    struct merkle_rcu_t *tree;
+    int slot;                           /* reader slot of the tree */
+    atomic_bool *stop;
+    long proofs;                        /* proofs built and verified */
+    double total_us;
+    double max_us;
+    bool ok;
+};
+
+/* What the reader process of the shared memory test sends back */
+struct shared_report_t {
+    bool ok;                            /* expected root and every proof verified */
+    unsigned long generation;           /* generation mapped */
+    double rate;                        /* proofs per second */
+    long shmem_kb;                      /* resident shared memory of the reader */
+};
+
+/* Client thread of the server test */
+struct server_load_t {
+    const char *path;                   /* socket of the server */
+    int depth;                          /* requests in flight */
+    uint64_t seed;
+    bool ok;
+};
+
 /*-----------------------------------*
  * PRIVATE FUNCTION PROTOTYPES
  *-----------------------------------*/
@@ -35,7 +201,8 @@ int numFolders = 0;
  * @brief Measures execution time and system resource usage for a test run.
  *
  * This function constructs a Merkle tree from a specified folder, tracks
- * elapsed time, CPU usage, and memory consumption, then logs the results.
+ * elapsed time, CPU usage, the perf counts of each build phase, and the
+ * peak memory of each subsystem of the tree, then logs the results.
  *
  * @param fp File pointer for logging test results.
  * @param folder Directory containing transaction files for the test.
@@ -43,14 +210,469 @@ int numFolders = 0;
 static void run_test(FILE *fp, const char *folder);
 
 /**
- * @brief Prints process memory usage statistics from `/proc/self/status`.
+ * @brief Counts the heap allocations of node tree rebuilds.
+ *
+ * Builds every test folder twice through MerkleTreeBuild() with
+ * HASH_BACKEND_DIRECT: once to size the tree arena, then again counting
+ * the allocations of the tree (MemAlloc() accounting) and of OpenSSL
+ * (CRYPTO_set_mem_functions()). The first folder is then rebuilt with
+ * every backend, which must give the same root.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Every direct rebuild gave the same root without a heap
+ *               allocation, and every backend the same root.
+ * @retval false A rebuild failed, differed or allocated.
+ */
+static bool run_arena_test(FILE *fp);
+
+/**
+ * @brief Times the builds of every folder from a cold and a warm page cache.
+ *
+ * Splits the elapsed time in hashing (user CPU), system time and I/O wait
+ * (off-CPU time of the single-threaded build), with the MB/s and files/s
+ * of each mode.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Same roots in both modes and less data cached when cold.
+ * @retval false Build or page cache failure.
+ */
+static bool run_cache_test(FILE *fp);
+
+/**
+ * @brief Tests the comparison of results with a baseline.
+ *
+ * Of three metrics recorded with ResultsRecord(), one unchanged, one
+ * faster and one slower beyond the threshold, only the last must be
+ * flagged as a regression, although the current file starts with runs of
+ * the baseline under an older revision. A single worse sample per side
+ * must not count as a regression.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Exactly the slower metric regressed.
+ * @retval false Wrong verdict or stream failure.
+ */
+static bool run_results_test(FILE *fp);
+
+/**
+ * @brief Tests the dataset generator.
+ *
+ * Generates a dataset with its packed container, generates it again
+ * (the manifest must make it a reuse) and generates a copy with another
+ * number of writers. The two folders and the container must give the
+ * same root, and removing the datasets must leave nothing behind.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Same roots, reuse and removal as expected.
+ * @retval false Otherwise.
+ */
+static bool run_dataset_test(FILE *fp);
+
+/**
+ * @brief Tests the live build counters.
+ *
+ * Builds the first folder, then checks the counters against the folder:
+ * files, bytes, hashes of every level, no error and nothing left to do.
+ * Sends STATS_SIGNAL to the process and reads back the JSON line of the
+ * reporter, and times a counter update.
+ *
+ * @param fp File pointer for logging test results.
+ * @param folder Folder to build.
+ * @retval true  Exact counters and a matching JSON dump.
+ * @retval false Otherwise.
+ */
+static bool run_stats_test(FILE *fp, const char *folder);
+
+/**
+ * @brief Tests the allocation accounting.
+ *
+ * Builds levels from random leaf hashes: the bytes charged to MEM_LEVELS
+ * must be exactly their storage, the peaks must cover them, and freeing
+ * them must give every byte and allocation back. Hashing a level must
+ * count and release one digest context. The nodes of a snapshot tree
+ * and the siblings of a proof must be charged and given back too.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Exact accounting.
+ * @retval false Otherwise.
+ */
+static bool run_mem_test(FILE *fp);
+
+/**
+ * @brief Tests the calibration and its profile.
+ *
+ * Calibrates on the folder and saves the profile, which must load back
+ * the same settings, and be ignored once it names another host. Every
+ * hash backend, with the smallest and largest read buffers, must give
+ * the arity 4 root of the leaves of the binary tree.
+ *
+ * @param fp File pointer for logging test results.
+ * @param folder Folder to sample.
+ * @retval true  Profile round trip, foreign profile ignored, same roots.
+ * @retval false Otherwise.
+ */
+static bool run_tune_test(FILE *fp, const char *folder);
+
+/**
+ * @brief Builds the pair of synthetic trees used by the functionality tests.
+ *
+ * Builds a tree from random leaf hashes and a copy of it
+ * with a few corrupted leaves.
+ *
+ * @retval true  Success.
+ * @retval false Allocation or hashing failure.
+ */
+static bool build_synthetic_pair(void);
+
+/**
+ * @brief Checks and times the diff of the synthetic trees.
+ *
+ * Checks that DiffLevels() finds exactly the corrupted leaves.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  The expected leaves were found.
+ * @retval false Wrong result or allocation failure.
+ */
+static bool run_diff_test(FILE *fp);
+
+/**
+ * @brief Checks the synchronization of the synthetic trees.
+ *
+ * A forked process serves the corrupted tree on one end of a socketpair,
+ * SyncPull() must find exactly the corrupted leaves with a traffic far
+ * smaller than the leaves.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  The expected blocks were found.
+ * @retval false Wrong result or I/O failure.
+ */
+static bool run_sync_test(FILE *fp);
+
+/**
+ * @brief Checks and times the verification of a folder against checkpoints.
+ *
+ * Verifies the untouched folder, then corrupts one block and checks that
+ * the verification stops early reporting the range of that block. A
+ * checkpoint file holding one hash, with the root it leads to, must be
+ * rejected for the leaf count it records.
+ *
+ * @param fp File pointer for logging test results.
+ * @param folder Transactions folder of a generated dataset.
+ * @retval true  Both verifications gave the expected outcome, crafted file rejected.
+ * @retval false Wrong outcome or I/O failure.
+ */
+static bool run_verify_test(FILE *fp, const char *folder);
+
+/**
+ * @brief Compares trees of arity 2, 4, 8 and 16 over the same leaves.
+ *
+ * Reports the build time, the number of hash calls, the size of an
+ * encoded inclusion proof and the time to verify one.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Every proof verified, after an encode/decode round trip.
+ * @retval false Build, proof or allocation failure.
+ */
+static bool run_arity_benchmark(FILE *fp);
+
+/**
+ * @brief Builds the synthetic tree out of core and proves leaves from its files.
+ *
+ * The level files must give the root of the in-memory tree, and proofs
+ * read through RAM budgets of 0, 64 KiB and 1 MiB must all verify.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Same root and every proof verified.
+ * @retval false Wrong root, proof or I/O failure.
+ */
+static bool run_outofcore_test(FILE *fp);
+
+/**
+ * @brief Builds the level files of a folder with an odd number of files.
+ *
+ * The manifest must record the files of the folder, not the padded level 0,
+ * so that the last leaf is proven and the next index is rejected. A store
+ * of more leaves than a proof counts must be rejected too.
+ *
+ * @param fp File pointer for logging test results.
+ * @param folder Transactions folder with an odd number of files.
+ * @retval true  Leaf count of the folder, last leaf proven, next one and wide store rejected.
+ * @retval false Otherwise.
+ */
+static bool run_outofcore_odd_test(FILE *fp, const char *folder);
+
+/**
+ * @brief Measures resident size against proof latency of level-skipping storage.
+ *
+ * Keeps every stride-th level of the synthetic tree for several strides,
+ * then times proofs read through the sparse tree and the rebuild of all
+ * the levels. An odd-sized 4-ary tree is checked in both padding modes.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Every proof verified and every rebuild gave the full tree.
+ * @retval false A check failed.
+ */
+static bool run_sparse_benchmark(FILE *fp);
+
+/**
+ * @brief Compares the proof throughput of the level-order and blocked layouts.
+ *
+ * Reads the sibling groups of the proof paths of the same random leaves
+ * of the synthetic tree into a stack buffer, from the level arrays and
+ * from blocks of several heights: nothing is allocated in the timed loop,
+ * so the figures are the lookups alone. A sample of the paths is checked
+ * against the level arrays, then the proofs of an odd-sized 4-ary tree
+ * are verified in both padding modes.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Every checked path and proof matched.
+ * @retval false Layout, proof or allocation failure.
+ */
+static bool run_layout_benchmark(FILE *fp);
+
+/**
+ * @brief Ingests leaves from concurrent producers while reading prefix roots.
+ *
+ * APPEND_PRODUCERS threads claim slots of the synthetic leaves and
+ * publish each chunk backwards, while the main thread reads the root of
+ * the published prefix. The last roots read, and those of a few fixed
+ * prefixes, must equal the roots of LevelsFromLeafHashes().
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Every checked root matched.
+ * @retval false Wrong root, allocation or hashing failure.
+ */
+static bool run_append_test(FILE *fp);
+
+/**
+ * @brief Producer of the append test: claims and publishes until the tree is full.
+ *
+ * @param arg Tree of the test.
+ * @return NULL on success, the tree on failure.
+ */
+static void *append_producer(void *arg);
+
+/**
+ * @brief Serves proofs from snapshots while a writer updates the tree.
+ *
+ * RCU_READERS threads build and verify proofs against the snapshot they
+ * hold while the main thread applies batches of leaf changes. Reports
+ * the proof latency without and during the updates; the final root must
+ * be the one of a rebuild and no retired node may be left once the
+ * readers are gone.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Every proof verified and the final tree matched.
+ * @retval false A check failed.
+ */
+static bool run_rcu_test(FILE *fp);
+
+/**
+ * @brief Proves leaves against historical roots of a versioned tree.
+ *
+ * Applies VERSION_UPDATES batches keeping VERSION_KEEP versions. Every
+ * kept version must give the root of a rebuild of its leaves and prove
+ * the leaves it changed; pruned versions must be refused, and the nodes
+ * held only by them freed. Reports the nodes held per kept version.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Every check passed.
+ * @retval false A check failed.
+ */
+static bool run_version_test(FILE *fp);
+
+/**
+ * @brief Publishes the synthetic trees in shared memory for another process.
+ *
+ * Publishes pair_a, lets a forked reader map it and prove leaves from it,
+ * then publishes pair_b as the next generation and checks that the
+ * reader moves to it. The reader reports its resident shared memory,
+ * which must cover the levels it read instead of a private copy.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  The reader saw both generations and every proof verified.
+ * @retval false Publication, mapping or proof failure.
+ */
+static bool run_shared_test(FILE *fp);
+
+/**
+ * @brief Maps a snapshot, then copies with a forged leaf count or level size.
+ *
+ * The snapshot of a padded 4-ary tree must map with the root of the tree.
+ * A level 0 shrunk by one group, which still fits in the file, and a
+ * doubled leaf count must be rejected: their sizes are not the shape of
+ * the header.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  The snapshot mapped and both forgeries were rejected.
+ * @retval false Otherwise.
+ */
+static bool run_snapshot_test(FILE *fp);
+
+/**
+ * @brief Maps the snapshot in a file after overwriting one of its header words.
+ *
+ * @param f Snapshot file, restored before returning.
+ * @param offset Offset of the word.
+ * @param value Forged value.
+ * @retval true  The forged snapshot mapped.
+ * @retval false It was rejected.
+ */
+static bool snapshot_forged_maps(FILE *f, long offset, uint32_t value);
+
+/**
+ * @brief Reader process of the shared memory test.
+ *
+ * Sends one shared_report_t per generation, waiting for a byte on the
+ * socket before moving to the second one.
+ *
+ * @param sock Socket to the test process.
+ * @param name Name of the published tree.
+ * @return Exit status of the process.
+ */
+static int shared_reader_process(int sock, const char *name);
+
+/**
+ * @brief Checks the mapped generation against the tree expected and proves leaves.
+ *
+ * @param rd Attached reader.
+ * @param expected Tree published in that generation.
+ * @param report Report to fill.
+ */
+static void shared_prove(struct shared_reader_t *rd, const struct merkle_levels_t *expected,
+                         struct shared_report_t *report);
+
+/**
+ * @brief Serves pair_a and runs clients without and with pipelining.
+ *
+ * Checks the root, leaf and error answers, then measures the proof
+ * throughput, the batch size and the server latency histogram.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Every answer is correct and every sampled proof verified.
+ * @retval false Socket, protocol or proof failure.
+ */
+static bool run_server_test(FILE *fp);
+
+/**
+ * @brief Tests the hardware performance counters.
+ *
+ * Hashes a level on worker threads between PerfStart() and PerfStop():
+ * the available counters must have counted the workers, the others
+ * must read as unavailable.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Consistent counts, or no counter at all.
+ * @retval false An available counter missed the work.
+ */
+static bool run_perf_test(FILE *fp);
+
+/**
+ * @brief Tests the scalability sweep on a small specification.
+ *
+ * Every combination must give the same root, the CSV matrix must hold one
+ * row per combination and an invalid specification must be rejected.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Sweep consistent.
+ * @retval false Failed combination, wrong matrix or invalid specification accepted.
+ */
+static bool run_sweep_test(FILE *fp);
+
+/**
+ * @brief Task of run_perf_test(): hashes one range of the level.
+ */
+static bool perf_hash_task(void *ctx, int task, int worker);
+
+/**
+ * @brief Thread answering the server test until stopped.
+ *
+ * @param arg struct merkle_server_t being polled.
+ * @return NULL.
+ */
+static void *server_loop(void *arg);
+
+/**
+ * @brief Client of the server test: asks SERVER_PROOFS proofs of random leaves.
+ *
+ * @param arg struct server_load_t of the thread.
+ * @return NULL.
+ */
+static void *server_client(void *arg);
+
+/**
+ * @brief Reader of the snapshot test: proves random leaves until stopped.
+ *
+ * @param arg struct rcu_reader_t of the thread.
+ * @return NULL.
+ */
+static void *rcu_reader(void *arg);
+
+/**
+ * @brief Builds and verifies the proof of a leaf from a fresh snapshot.
+ *
+ * @param t Tree.
+ * @param slot Reader slot.
+ * @param leaf Leaf to prove.
+ * @retval true  The proof verified against the root of the snapshot.
+ * @retval false Proof failure.
+ */
+static bool rcu_prove(struct merkle_rcu_t *t, int slot, int leaf);
+
+/**
+ * @brief Builds the synthetic tree with each huge page mode.
+ *
+ * Reports the build time, the page faults, the memory on transparent
+ * huge pages, the NUMA nodes the new pages of the process landed on
+ * (numa_maps) and the loads served by another node (PERF_NODE_MISSES),
+ * for the parallel build with pinned workers. hugetlb falls back to THP
+ * when no huge page is reserved.
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Every mode gave the root of a sequential build.
+ * @retval false Build or hashing failure, or different root.
+ */
+static bool run_placement_test(FILE *fp);
+
+/**
+ * @brief Compares the duplicate and promote padding modes.
+ *
+ * Builds the node tree of every odd-sized test folder in both modes and
+ * reports nodes and hash calls. Checks that promote mode gives the same
+ * root from the node tree and from the flat levels, that its proofs
+ * verify, and that it tells n leaves apart from n leaves followed by a
+ * copy of the last one, which duplicate mode cannot. In both modes the
+ * proofs encoded straight from the levels must be those of ProofEncode().
+ *
+ * @param fp File pointer for logging test results.
+ * @retval true  Every check passed.
+ * @retval false A check failed.
+ */
+static bool run_padding_test(FILE *fp);
+
+/**
+ * @brief Allocator entry points handed to OpenSSL, counted apart.
+ */
+static void *crypto_malloc(size_t size, const char *file, int line);
+static void *crypto_realloc(void *ptr, size_t size, const char *file, int line);
+static void crypto_free(void *ptr, const char *file, int line);
+
+/**
+ * @brief Fills a buffer with pseudo-random hashes (xorshift64).
  *
- * This function extracts memory usage metrics such as peak virtual memory,
- * resident set size, and swap usage, then logs them to the results file.
+ * @param hashes Destination of n hashes.
+ * @param n Number of hashes.
+ * @param seed Generator seed, not 0.
+ */
+static void fill_random_hashes(unsigned char *hashes, int n, uint64_t seed);
+
+/**
+ * @brief Computes the time difference in microseconds between two `timespec` structures.
  *
- * @param fp File pointer for logging results.
+ * @param start Pointer to the start time.
+ * @param end Pointer to the end time.
+ * @return The time difference in microseconds.
  */
-static void printProcSelfStatus(FILE *fp);
+static double timespec_diff_us(struct timespec *start, struct timespec *end);
 
 /**
  * @brief Logs system hardware and OS information.
@@ -81,20 +703,55 @@ static void PrintBanner(FILE *fp);
  */
 static double timeval_diff_ms(struct timeval *start, struct timeval *end);
 
+/**
+ * @brief Appends a sample to the machine-readable results.
+ *
+ * The metric is named <group>/<folder name>/<name>.
+ *
+ * @param group Benchmark of the sample.
+ * @param folder Dataset folder.
+ * @param name Measured quantity.
+ * @param value Sample.
+ * @param unit Unit of the sample.
+ * @param better Direction of an improvement.
+ */
+static void record_metric(const char *group, const char *folder, const char *name, double value,
+                          const char *unit, enum results_better_t better);
+
 /*-----------------------------------*
  * PRIVATE VARIABLES
  *-----------------------------------*/
-/* None */
+/* Synthetic trees of the functionality tests:
+ * pair_b is pair_a with the pair_corrupted leaves changed */
+static struct merkle_levels_t pair_a, pair_b;
+static atomic_bool server_stop;
+static int pair_corrupted[SYNTHETIC_CORRUPTED];
+
+/* Heap allocations of OpenSSL (see crypto_malloc()) */
+static atomic_long crypto_allocs;
+
+/* Hardware counters of the builds, opened once by RunMerkleTreeTests() */
+static struct perf_counters_t perf_counters;
+
+/* Machine-readable results of the run, appended to RESULTS_JSON_FILE */
+static struct results_t results;
 
 /*-----------------------------------*
  * PUBLIC FUNCTION DEFINITIONS
  *-----------------------------------*/
-void RunMerkleTreeTests(void)
+int RunMerkleTreeTests(void)
 {
+    int failed = 0;
+    /* before the first OpenSSL allocation, otherwise it refuses the change */
+    CRYPTO_set_mem_functions(crypto_malloc, crypto_realloc, crypto_free);
     FILE *fp = fopen(RESULTS_FILE, "w");
     /* if the file is successfully opened */
     if (fp)
     {
+        /* before the first build, so that the workers inherit them */
+        PerfOpen(&perf_counters);
+        /* earlier runs are kept: the samples of a revision accumulate */
+        ResultsStart(&results, fopen(RESULTS_JSON_FILE, "a"));
         /* Print the banner to file  */
         PrintBanner(fp);
         /* Print system info to file */
@@ -104,13 +761,86 @@ void RunMerkleTreeTests(void)
         {
             run_test(fp, folders[i].folder);
         }
+        /* Run the functionality tests */
+        struct perf_sample_t pair_sample;
+        TraceReset();
+        PerfStart(&perf_counters);
+        bool pair_built = build_synthetic_pair();
+        PerfStop(&perf_counters, &pair_sample);
+        /* two trees: all their nodes but the copied leaves are hashed */
+        PerfReport(fp, &perf_counters, "PERF LEVEL BUILD", &pair_sample, 2L * SYNTHETIC_LEAVES,
+                   2L * (SYNTHETIC_LEAVES - 1));
+        if (TraceEnabled())
+        {
+            /* levels of the two parallel builds, one track per worker */
+            fprintf(fp, "\nSynthetic pair build: %d leaves, %d threads\n",
+                    SYNTHETIC_LEAVES, ParallelDefaultThreads());
+            TraceSummary(fp);
+            TraceWriteChrome(TRACE_LEVELS_FILE);
+        }
+        if (pair_built)
+        {
+            failed += !run_diff_test(fp);
+            failed += !run_sync_test(fp);
+            failed += !run_arity_benchmark(fp);
+            failed += !run_outofcore_test(fp);
+            failed += !run_sparse_benchmark(fp);
+            failed += !run_placement_test(fp);
+            failed += !run_layout_benchmark(fp);
+            failed += !run_append_test(fp);
+            failed += !run_rcu_test(fp);
+            failed += !run_version_test(fp);
+            failed += !run_shared_test(fp);
+            failed += !run_snapshot_test(fp);
+            failed += !run_server_test(fp);
+            failed += !run_perf_test(fp);
+            failed += !run_sweep_test(fp);
+            failed += !run_results_test(fp);
+            failed += !run_dataset_test(fp);
+        }
+        else
+        {
+            failed++;
+        }
+        LevelsFree(&pair_a);
+        LevelsFree(&pair_b);
+        if (numFolders > 0)
+        {
+            failed += !run_verify_test(fp, folders[numFolders - 1].folder);
+        }
+        for (int i = 0; i < numFolders; i++)
+        {
+            /* the first folder whose level 0 is padded */
+            if (folders[i].num_files % 2 == 1)
+            {
+                failed += !run_outofcore_odd_test(fp, folders[i].folder);
+                break;
+            }
+        }
+        failed += !run_padding_test(fp);
+        failed += !run_mem_test(fp);
+        if (numFolders > 0)
+        {
+            failed += !run_cache_test(fp);
+            failed += !run_stats_test(fp, folders[0].folder);
+            failed += !run_tune_test(fp, folders[0].folder);
+            failed += !run_arena_test(fp);
+        }
+        MerkleTreeRelease();
+        PerfClose(&perf_counters);
+        if (results.fp)
+        {
+            fclose(results.fp);
+        }
         fclose(fp);
     }
     else
     {
         perror("Failed to open results file");
-        return;
+        failed++;
     }
+
+    return failed;
 }
 
 /*-----------------------------------*
@@ -120,21 +850,28 @@ static void run_test(FILE *fp, const char *folder)
 {
     struct timeval start_tv, end_tv;
     struct rusage start_ru, end_ru;
+    struct perf_sample_t sample;
+    struct mem_usage_t mem;
+    int level_sizes[LEVELS_MAX];
+    long n_nodes = 0;
 
     /* Record start times */
     gettimeofday(&start_tv, NULL);
     getrusage(RUSAGE_SELF, &start_ru);
 
     /* Actual building of the Merkle Tree */
+    MemResetPeaks();
+    TraceReset();
+    PerfPhasesAttach(&perf_counters);
+    PerfStart(&perf_counters);
     BuildMerkleTree(folder);
+    PerfStop(&perf_counters, &sample);
+    PerfPhasesAttach(NULL);
 
     /* Record end times */
     gettimeofday(&end_tv, NULL);
     getrusage(RUSAGE_SELF, &end_ru);
 
-    /* Print process memory usage */
-    printProcSelfStatus(fp);
-
     /* Calculate metrics */
     double elapsed_ms   = timeval_diff_ms(&start_tv, &end_tv);
     double user_time_ms = timeval_diff_ms(&start_ru.ru_utime, &end_ru.ru_utime);
@@ -148,6 +885,7 @@ static void run_test(FILE *fp, const char *folder)
 
     fprintf(fp, "%-30s %12.2f %12.2f %12.2f %12ld\n",
            folder, elapsed_ms, user_time_ms, sys_time_ms, max_rss_kb);
+    record_metric("build", folder, "elapsed_ms", elapsed_ms, "ms", RESULTS_LOWER);
 
     fprintf(fp, "--------------------------------------------------------------------------------------------\n");
     fprintf(fp, "%-20s %15s %15s %15s\n",
@@ -160,54 +898,1753 @@ static void run_test(FILE *fp, const char *folder)
     );
     fprintf(fp, "--------------------------------------------------------------------------------------------\n");
 
-}
+    /* leaves and nodes of the tree just built, freed since */
+    int n_leaves = CountFilesInDirectory(folder);
+    for (int l = 0, n = NodesNumberLevels(level_sizes, LEVELS_MAX, n_leaves, 2, PADDING_DUPLICATE);
+         l < n; l++)
+    {
+        n_nodes += level_sizes[l];
+    }
+    PerfReport(fp, &perf_counters, "PERF BUILD", &sample, n_leaves, n_nodes);
+    PerfPhasesReport(fp, "PERF BUILD PHASES");
 
-static void printProcSelfStatus(FILE *fp)
-{
-    FILE *status_fp = fopen("/proc/self/status", "r");
-    if (!status_fp)
+    /* memory of the tree alone, peaks of the build: unlike ru_maxrss, they
+     * do not carry the high-water mark of the earlier folders */
+    MemUsage(MEM_SUBSYSTEMS, &mem);
+    MemReport(fp, "MEMORY BUILD", n_leaves);
+    record_metric("build", folder, "peak_kb", mem.peak / 1024.0, "KiB", RESULTS_LOWER);
+    if (n_leaves > 0)
     {
-        perror("Failed to open /proc/self/status");
-        return;
+        record_metric("build", folder, "peak_bytes_per_leaf", (double)mem.peak / n_leaves, "B",
+                      RESULTS_LOWER);
     }
 
+    /* phases of the build, the trace file keeps the last folder */
+    if (TraceEnabled())
+    {
+        TraceSummary(fp);
+        TraceWriteChrome(TRACE_TREE_FILE);
+    }
+}
+
+static bool build_synthetic_pair(void)
+{
+    bool ret = false;
+    unsigned char *leaves = malloc((size_t)SYNTHETIC_LEAVES * SHA256_DIGEST_LENGTH);
+
+    if (leaves)
+    {
+        fill_random_hashes(leaves, SYNTHETIC_LEAVES, 0x9E3779B97F4A7C15ull);
+        if (LevelsFromLeafHashes(leaves, SYNTHETIC_LEAVES, 2, PADDING_DUPLICATE, &pair_a))
+        {
+            /* corrupt evenly spread leaves, in ascending order */
+            for (int i = 0; i < SYNTHETIC_CORRUPTED; i++)
+            {
+                pair_corrupted[i] = (int)((long)SYNTHETIC_LEAVES * i / SYNTHETIC_CORRUPTED) + 7 * i;
+                leaves[(size_t)pair_corrupted[i] * SHA256_DIGEST_LENGTH] ^= 0x01;
+            }
+            ret = LevelsFromLeafHashes(leaves, SYNTHETIC_LEAVES, 2, PADDING_DUPLICATE, &pair_b);
+        }
+        free(leaves);
+    }
+
+    return ret;
+}
+
+static bool run_diff_test(FILE *fp)
+{
+    bool ret = false;
+    struct timespec start, end;
+    int *changed = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int n_changed = DiffLevels(&pair_a, &pair_b, &changed);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ret = n_changed == SYNTHETIC_CORRUPTED &&
+          memcmp(changed, pair_corrupted, sizeof(pair_corrupted)) == 0;
+    free(changed);
+
+    fprintf(fp, "%-20s %12s %12s %12s %8s\n",
+        "DIFF TEST", "LEAVES", "CORRUPTED", "TIME (us)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    fprintf(fp, "%-20s %12d %12d %12.2f %8s\n",
+        "DiffLevels", SYNTHETIC_LEAVES, n_changed,
+        timespec_diff_us(&start, &end), ret ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static bool run_sync_test(FILE *fp)
+{
+    bool ret = false;
+    struct sync_stats_t stats = {0};
+    struct timespec start, end;
+    int *blocks = NULL;
+    int n_blocks = -1;
+    int sv[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            /* serving process */
+            close(sv[0]);
+            _exit(SyncServe(sv[1], &pair_b, NULL) ? 0 : 1);
+        }
+        close(sv[1]);
+
+        if (pid > 0)
+        {
+            int status = 0;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            n_blocks = SyncPull(sv[0], &pair_a, &blocks, NULL, &stats);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            close(sv[0]);
+            waitpid(pid, &status, 0);
+
+            ret = WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+                  n_blocks == SYNTHETIC_CORRUPTED &&
+                  memcmp(blocks, pair_corrupted, sizeof(pair_corrupted)) == 0;
+            free(blocks);
+        }
+        else
+        {
+            perror("run_sync_test: fork");
+            close(sv[0]);
+        }
+    }
+
+    fprintf(fp, "%-20s %12s %12s %12s %12s %12s %8s\n",
+        "SYNC TEST", "LEAVES", "BLOCKS", "REQUESTS", "BYTES", "TIME (us)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    fprintf(fp, "%-20s %12d %12d %12d %12zu %12.2f %8s\n",
+        "SyncPull", SYNTHETIC_LEAVES, n_blocks, stats.requests,
+        stats.bytes_sent + stats.bytes_received,
+        timespec_diff_us(&start, &end), ret ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static bool run_verify_test(FILE *fp, const char *folder)
+{
+    bool ret = false;
+    struct merkle_levels_t lv;
+    struct merkle_checkpoint_t cp;
+    struct verify_result_t clean = {0}, corrupted = {0};
+    struct timespec t0 = {0}, t1 = {0}, t2 = {0};
+    char filename[256];
+    int block = -1;
+    int n_leaves = 0;
+    bool crafted_rejected = false;
+
+    if (BuildMerkleLevels(folder, 2, PADDING_DUPLICATE, &lv))
+    {
+        if (CheckpointFromLevels(&lv, &cp))
+        {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            bool ok = VerifyFolder(folder, &cp, 0, &clean);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+
+            /* corrupt one block in the first tenth of the folder */
+            n_leaves = lv.n_leaves;
+            block = n_leaves / 10;
+            snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, folder, block);
+            struct stat sb;
+            FILE *block_fp = stat(filename, &sb) == 0 ? fopen(filename, "a") : NULL;
+            if (ok && block_fp)
+            {
+                fprintf(block_fp, "corrupted\n");
+                fclose(block_fp);
+
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                ok = VerifyFolder(folder, &cp, 0, &corrupted);
+                clock_gettime(CLOCK_MONOTONIC, &t2);
+
+                /* restore the block, the dataset may be kept for the next runs */
+                ok = truncate(filename, sb.st_size) == 0 && ok;
+
+                ret = ok && clean.match && !corrupted.match &&
+                      corrupted.first_leaf <= block && block <= corrupted.last_leaf;
+            }
+            else if (block_fp)
+            {
+                fclose(block_fp);
+            }
+
+            /* the first checkpoint alone, with the root above it */
+            struct merkle_checkpoint_t crafted = cp;
+            struct merkle_checkpoint_t loaded;
+            unsigned char tmp[CONFIG_MAX_ARITY * SHA256_DIGEST_LENGTH];
+            memcpy(tmp, cp.hashes, SHA256_DIGEST_LENGTH);
+            crafted.count = 1;
+            crafted_rejected = cp.count > 1 &&
+                SubtreeRoot(tmp, 1, cp.n_levels - 1 - cp.level, cp.arity, cp.padding, crafted.root) &&
+                CheckpointSave(&crafted, VERIFY_CRAFTED_FILE) &&
+                !CheckpointLoad(&loaded, VERIFY_CRAFTED_FILE);
+            unlink(VERIFY_CRAFTED_FILE);
+            CheckpointFree(&cp);
+        }
+        LevelsFree(&lv);
+    }
+
+    fprintf(fp, "%-20s %12s %12s %12s %12s %8s\n",
+        "VERIFY TEST", "FILES", "HASHED", "RANGE", "TIME (ms)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    fprintf(fp, "%-20s %12d %12d %12s %12.2f %8s\n",
+        "clean folder", n_leaves, clean.files_hashed, "-",
+        timespec_diff_us(&t0, &t1) / 1e3, clean.match ? "PASS" : "FAIL");
+    snprintf(filename, sizeof(filename), "%d-%d", corrupted.first_leaf, corrupted.last_leaf);
+    fprintf(fp, "%-20s %12d %12d %12s %12.2f %8s\n",
+        "corrupted block", block, corrupted.files_hashed, filename,
+        timespec_diff_us(&t1, &t2) / 1e3, ret ? "PASS" : "FAIL");
+    fprintf(fp, "%-20s %12d %12s %12s %12s %8s\n",
+        "crafted checkpoints", 1, "-", "-", "-", crafted_rejected ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret && crafted_rejected;
+}
+
+static bool run_arity_benchmark(FILE *fp)
+{
+    static const int arities[] = { 2, 4, 8, 16 };
+    bool ret = true;
+
+    fprintf(fp, "%-20s %8s %12s %12s %10s %12s %8s\n",
+        "ARITY BENCHMARK", "LEVELS", "HASH CALLS", "BUILD (ms)", "PROOF (B)", "VERIFY (us)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    for (size_t a = 0; a < sizeof(arities) / sizeof(arities[0]); a++)
+    {
+        struct merkle_levels_t lv;
+        struct timespec t0 = {0}, t1 = {0}, t2 = {0}, t3 = {0};
+        long hash_calls = 0;
+        size_t proof_size = 0;
+        int n_levels = 0;
+        bool ok = false;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        /* the leaves of pair_a, rehashed with another arity */
+        if (LevelsFromLeafHashes(pair_a.level[0], pair_a.n_leaves, arities[a],
+                                 PADDING_DUPLICATE, &lv))
+        {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            n_levels = lv.n_levels;
+            for (int l = 1; l < lv.n_levels; l++)
+            {
+                hash_calls += lv.level_size[l - 1] / lv.arity;
+            }
+            /* arity 2 must reproduce the layout of the node tree */
+            ok = arities[a] != 2 || !HashDiffers(LevelsRoot(&lv), LevelsRoot(&pair_a));
+
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            for (int i = 0; i < PROOF_SAMPLES && ok; i++)
+            {
+                struct merkle_proof_t proof, decoded;
+                unsigned char buf[4096];
+                int leaf = (int)((long)i * lv.n_leaves / PROOF_SAMPLES);
+
+                ok = ProofBuild(&lv, leaf, &proof);
+                if (ok)
+                {
+                    proof_size = ProofEncode(&proof, buf, sizeof(buf));
+                    ok = proof_size > 0 && ProofDecode(buf, proof_size, &decoded);
+                    ProofFree(&proof);
+                }
+                if (ok)
+                {
+                    ok = ProofVerify(&decoded, LEVEL_HASH(&lv, 0, leaf), LevelsRoot(&lv));
+                    ProofFree(&decoded);
+                }
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t3);
+            LevelsFree(&lv);
+        }
+
+        char label[20];
+        snprintf(label, sizeof(label), "k = %d", arities[a]);
+        fprintf(fp, "%-20s %8d %12ld %12.2f %10zu %12.2f %8s\n",
+            label, n_levels, hash_calls, timespec_diff_us(&t0, &t1) / 1e3, proof_size,
+            timespec_diff_us(&t2, &t3) / PROOF_SAMPLES, ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static bool run_outofcore_test(FILE *fp)
+{
+    static const size_t budgets[] = { 0, 64 * 1024, 1024 * 1024 };
+    struct level_writer_t w;
+    struct timespec start = {0}, end = {0};
+    size_t working_set = 0;
+    bool ret = false;
+
+    mkdir(OOC_TEST_DIR, 0777);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (LevelWriterOpen(&w, OOC_TEST_DIR, pair_a.arity, pair_a.padding, 0))
+    {
+        ret = true;
+        for (int i = 0; i < pair_a.n_leaves && ret; i++)
+        {
+            ret = LevelWriterPush(&w, LEVEL_HASH(&pair_a, 0, i));
+        }
+        /* open groups plus one write buffer per level file */
+        working_set = (size_t)LEVELS_MAX * w.arity * SHA256_DIGEST_LENGTH;
+        for (int l = 0; l < LEVELS_MAX; l++)
+        {
+            working_set += w.fp[l] ? w.io_buffer : 0;
+        }
+        ret = LevelWriterFinish(&w) && ret &&
+              !HashDiffers(w.root, LevelsRoot(&pair_a));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    fprintf(fp, "%-20s %12s %12s %12s %12s %12s %8s\n",
+        "OUT-OF-CORE TEST", "BUDGET (KB)", "MEMORY (KB)", "PAGES/PROOF", "HIT RATE", "TIME (us)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    fprintf(fp, "%-20s %12s %12zu %12s %12s %12.0f %8s\n",
+        "build level files", "-", working_set / 1024, "-", "-",
+        timespec_diff_us(&start, &end), ret ? "PASS" : "FAIL");
+
+    for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]) && ret; b++)
+    {
+        struct level_store_t store;
+        struct level_source_t src;
+        bool ok = LevelStoreOpen(&store, OOC_TEST_DIR, budgets[b]);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (ok)
+        {
+            LevelStoreSource(&store, &src);
+            for (int i = 0; i < PROOF_SAMPLES && ok; i++)
+            {
+                struct merkle_proof_t proof;
+                /* spread the leaves, jumping around the files */
+                int leaf = (int)(((long)i * 7919) % PROOF_SAMPLES * store.n_leaves / PROOF_SAMPLES);
+
+                ok = ProofBuildFromSource(&src, leaf, &proof);
+                if (ok)
+                {
+                    ok = ProofVerify(&proof, LEVEL_HASH(&pair_a, 0, leaf), store.root);
+                    ProofFree(&proof);
+                }
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        fprintf(fp, "%-20s %12zu %12zu %12.1f %11.1f%% %12.2f %8s\n",
+            "proof lookups", budgets[b] / 1024, (size_t)store.n_pages * LEVEL_PAGE_SIZE / 1024,
+            (double)store.reads / PROOF_SAMPLES,
+            store.reads + store.hits ? 100.0 * store.hits / (store.reads + store.hits) : 0.0,
+            timespec_diff_us(&start, &end) / PROOF_SAMPLES, ok ? "PASS" : "FAIL");
+        LevelStoreClose(&store);
+        ret = ret && ok;
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    LevelFilesRemove(OOC_TEST_DIR);
+    rmdir(OOC_TEST_DIR);
+
+    return ret;
+}
+
+static bool run_outofcore_odd_test(FILE *fp, const char *folder)
+{
+    struct level_store_t store;
+    struct level_source_t src;
+    struct merkle_proof_t proof;
+    struct merkle_levels_t lv;
+    unsigned char root[SHA256_DIGEST_LENGTH];
+    int n_files = CountFilesInDirectory(folder);
+    bool last_proven = false;
+    bool past_rejected = false;
+    bool wide_rejected = false;
+    bool ret = false;
+
+    mkdir(OOC_TEST_DIR, 0777);
+    if (LevelFilesBuild(folder, OOC_TEST_DIR, 2, PADDING_DUPLICATE, root) &&
+        LevelStoreOpen(&store, OOC_TEST_DIR, 0))
+    {
+        LevelStoreSource(&store, &src);
+        if (BuildMerkleLevels(folder, 2, PADDING_DUPLICATE, &lv))
+        {
+            if (ProofBuildFromSource(&src, n_files - 1, &proof))
+            {
+                last_proven = ProofVerify(&proof, LEVEL_HASH(&lv, 0, n_files - 1), root);
+                ProofFree(&proof);
+            }
+            ret = store.n_leaves == n_files && lv.n_leaves == n_files &&
+                  !HashDiffers(root, LevelsRoot(&lv));
+            LevelsFree(&lv);
+        }
+        /* one past the last leaf: a padding copy, not a block */
+        past_rejected = !ProofBuildFromSource(&src, n_files, &proof);
+        if (!past_rejected)
+        {
+            ProofFree(&proof);
+        }
+        /* a store past the int leaf count of a proof: refused, not truncated */
+        struct level_source_t wide = src;
+        wide.n_leaves = INT_MAX + 1L;
+        wide_rejected = !ProofBuildFromSource(&wide, 0, &proof);
+        if (!wide_rejected)
+        {
+            ProofFree(&proof);
+        }
+        fprintf(fp, "%-20s %12s %12s %12s %12s %8s\n",
+            "OUT-OF-CORE ODD", "FILES", "LEVEL 0", "MANIFEST", "LAST PROOF", "RESULT");
+        fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+        fprintf(fp, "%-20s %12d %12ld %12ld %12s %8s\n",
+            "padded level 0", n_files, store.level_size[0], store.n_leaves,
+            last_proven ? "verified" : "failed",
+            ret && last_proven && past_rejected ? "PASS" : "FAIL");
+        fprintf(fp, "%-20s %12d %12s %12s %12s %8s\n",
+            "leaf past the end", n_files, "-", "-", past_rejected ? "rejected" : "proven",
+            past_rejected ? "PASS" : "FAIL");
+        fprintf(fp, "%-20s %12s %12ld %12s %12s %8s\n",
+            "leaves past INT_MAX", "-", wide.n_leaves, "-", wide_rejected ? "rejected" : "proven",
+            wide_rejected ? "PASS" : "FAIL");
+        fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+        LevelStoreClose(&store);
+    }
+
+    LevelFilesRemove(OOC_TEST_DIR);
+    rmdir(OOC_TEST_DIR);
+
+    return ret && last_proven && past_rejected && wide_rejected;
+}
+
+static bool run_sparse_benchmark(FILE *fp)
+{
+    static const int strides[] = { 1, 2, 3, 4, 6 };
+    static const enum merkle_padding_t paddings[] = { PADDING_DUPLICATE, PADDING_PROMOTE };
+    size_t full = 0;
+    bool ret = true;
+
+    for (int l = 0; l < pair_a.n_levels; l++)
+    {
+        full += (size_t)pair_a.level_size[l] * SHA256_DIGEST_LENGTH;
+    }
+
+    fprintf(fp, "%-20s %12s %12s %14s %12s %12s %8s\n",
+        "LEVEL SKIPPING", "RESIDENT (KB)", "OF FULL", "RECOMP/PROOF", "PROOF (us)", "REBUILD (ms)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    for (size_t s = 0; s < sizeof(strides) / sizeof(strides[0]); s++)
+    {
+        struct sparse_levels_t sp;
+        struct level_source_t src;
+        struct merkle_levels_t lv;
+        struct timespec t0 = {0}, t1 = {0}, t2 = {0};
+        size_t resident = 0;
+        long recomputed = 0;
+        bool ok = SparseFromLevels(&pair_a, strides[s], SPARSE_TOP_LEVELS, &sp);
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (ok)
+        {
+            resident = SparseResidentBytes(&sp);
+            SparseSource(&sp, &src);
+            for (int i = 0; i < PROOF_SAMPLES && ok; i++)
+            {
+                struct merkle_proof_t proof;
+                int leaf = (int)(((long)i * 7919) % PROOF_SAMPLES * sp.n_leaves / PROOF_SAMPLES);
+
+                ok = ProofBuildFromSource(&src, leaf, &proof);
+                if (ok)
+                {
+                    ok = ProofVerify(&proof, LEVEL_HASH(&pair_a, 0, leaf), LevelsRoot(&pair_a));
+                    ProofFree(&proof);
+                }
+            }
+            recomputed = sp.recomputed;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        /* rebuilding must give back every level of the full tree */
+        if (ok && SparseExpand(&sp, &lv))
+        {
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            ok = lv.n_levels == pair_a.n_levels &&
+                 memcmp(lv.level[0], pair_a.level[0], full) == 0;
+            LevelsFree(&lv);
+        }
+        else
+        {
+            ok = false;
+        }
+        SparseFree(&sp);
+
+        char label[20];
+        snprintf(label, sizeof(label), "stride = %d", strides[s]);
+        fprintf(fp, "%-20s %12zu %11.1f%% %14.1f %12.2f %12.2f %8s\n",
+            label, resident / 1024, 100.0 * resident / full, (double)recomputed / PROOF_SAMPLES,
+            timespec_diff_us(&t0, &t1) / PROOF_SAMPLES, timespec_diff_us(&t1, &t2) / 1e3,
+            ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+
+    /* partial groups at every level, in both modes */
+    for (size_t p = 0; p < sizeof(paddings) / sizeof(paddings[0]); p++)
+    {
+        struct merkle_levels_t ref, lv;
+        struct sparse_levels_t sp;
+        struct level_source_t src;
+        bool ok = LevelsFromLeafHashes(pair_a.level[0], PADDING_ODD_LEAVES, 4, paddings[p], &ref);
+
+        if (ok)
+        {
+            ok = SparseFromLevels(&ref, 3, 1, &sp);
+            if (ok)
+            {
+                SparseSource(&sp, &src);
+                for (int leaf = 0; leaf < ref.n_leaves && ok; leaf += 97)
+                {
+                    struct merkle_proof_t proof;
+
+                    ok = ProofBuildFromSource(&src, leaf, &proof);
+                    if (ok)
+                    {
+                        ok = ProofVerify(&proof, LEVEL_HASH(&ref, 0, leaf), LevelsRoot(&ref));
+                        ProofFree(&proof);
+                    }
+                }
+                ok = ok && SparseExpand(&sp, &lv);
+                if (ok)
+                {
+                    for (int l = 0; l < ref.n_levels && ok; l++)
+                    {
+                        ok = memcmp(lv.level[l], ref.level[l],
+                                    (size_t)ref.level_size[l] * SHA256_DIGEST_LENGTH) == 0;
+                    }
+                    LevelsFree(&lv);
+                }
+                SparseFree(&sp);
+            }
+            LevelsFree(&ref);
+        }
+
+        char label[20];
+        snprintf(label, sizeof(label), "k = 4, %s", p == 0 ? "duplicate" : "promote");
+        fprintf(fp, "%-20s %12s %12s %14s %12s %12s %8s\n",
+            label, "-", "-", "-", "-", "-", ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static bool run_arena_test(FILE *fp)
+{
+    bool ret = true;
+    enum hash_backend_t saved = merkle_config.backend;
+    unsigned char direct_root[SHA256_DIGEST_LENGTH] = {0};
+
+    fprintf(fp, "%-30s %12s %12s %12s %12s %8s\n",
+        "ARENA TEST", "1ST ALLOCS", "REBUILD", "OPENSSL", "ARENA (KB)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    merkle_config.backend = HASH_BACKEND_DIRECT;
+    for (int f = 0; f < numFolders; f++)
+    {
+        unsigned char root[SHA256_DIGEST_LENGTH];
+        struct mem_usage_t before, after;
+        long first = atomic_load(&crypto_allocs);
+        long rebuild = 0;
+        long crypto = 0;
+
+        MemUsage(MEM_SUBSYSTEMS, &before);
+        bool ok = MerkleTreeBuild(folders[f].folder, PADDING_DUPLICATE) > 0;
+        MemUsage(MEM_SUBSYSTEMS, &after);
+        first = after.count - before.count + atomic_load(&crypto_allocs) - first;
+        if (ok)
+        {
+            memcpy(root, root_node->hash, SHA256_DIGEST_LENGTH);
+            MerkleTreeFree();
+
+            /* steady state: same tree, same arena */
+            crypto = atomic_load(&crypto_allocs);
+            MemUsage(MEM_SUBSYSTEMS, &before);
+            ok = MerkleTreeBuild(folders[f].folder, PADDING_DUPLICATE) > 0;
+            MemUsage(MEM_SUBSYSTEMS, &after);
+            rebuild = after.count - before.count;
+            crypto = atomic_load(&crypto_allocs) - crypto;
+            ok = ok && rebuild == 0 && crypto == 0 && !HashDiffers(root, root_node->hash);
+            MerkleTreeFree();
+        }
+        if (f == 0)
+        {
+            memcpy(direct_root, root, SHA256_DIGEST_LENGTH);
+        }
+
+        fprintf(fp, "%-30s %12ld %12ld %12ld %12zu %8s\n",
+            folders[f].folder, first, rebuild, crypto, tree_arena.capacity / 1024,
+            ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+
+    /* the backend changes how the hashes are computed, not the tree */
+    for (int b = 0; b < HASH_BACKENDS && numFolders > 0; b++)
+    {
+        struct mem_usage_t before, after;
+        long crypto = atomic_load(&crypto_allocs);
+        char label[32];
+
+        merkle_config.backend = (enum hash_backend_t)b;
+        MemUsage(MEM_SUBSYSTEMS, &before);
+        bool ok = MerkleTreeBuild(folders[0].folder, PADDING_DUPLICATE) > 0;
+        MemUsage(MEM_SUBSYSTEMS, &after);
+        crypto = atomic_load(&crypto_allocs) - crypto;
+        ok = ok && !HashDiffers(direct_root, root_node->hash);
+        MerkleTreeFree();
+
+        snprintf(label, sizeof(label), "backend %s", ConfigBackendName(merkle_config.backend));
+        fprintf(fp, "%-30s %12s %12lld %12ld %12zu %8s\n",
+            label, "-", after.count - before.count, crypto, tree_arena.capacity / 1024,
+            ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+    merkle_config.backend = saved;
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static bool run_layout_benchmark(FILE *fp)
+{
+    static const int heights[] = { 0, 2, 3, 4, 6 };   /* 0: level order */
+    static const enum merkle_padding_t paddings[] = { PADDING_DUPLICATE, PADDING_PROMOTE };
+    int *leaves = malloc(LAYOUT_PROOFS * sizeof(int));
+    double base = 0;
+    bool ret = leaves != NULL;
+    uint64_t x = 88172645463325252ull;
+
+    for (int i = 0; i < LAYOUT_PROOFS && ret; i++)
+    {
+        x = SplitMix(x);
+        leaves[i] = (int)(x % (uint64_t)pair_a.n_leaves);
+    }
+
+    fprintf(fp, "%-20s %12s %14s %12s %12s %8s\n",
+        "LAYOUT BENCHMARK", "MEMORY (KB)", "PROOFS/s", "SPEEDUP", "PROOF (ns)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    for (size_t h = 0; h < sizeof(heights) / sizeof(heights[0]) && ret; h++)
+    {
+        struct blocked_levels_t bl = {0};
+        struct level_source_t src;
+        unsigned char group[LEVELS_MAX * SHA256_DIGEST_LENGTH];
+        size_t memory = 0;
+        double start, ns;
+        bool ok = true;
+        char label[20];
+
+        if (heights[h] == 0)
+        {
+            LevelsSource(&pair_a, &src);
+            for (int l = 0; l < pair_a.n_levels; l++)
+            {
+                memory += (size_t)pair_a.level_size[l] * SHA256_DIGEST_LENGTH;
+            }
+            snprintf(label, sizeof(label), "level order");
+        }
+        else
+        {
+            ok = BlockedFromLevels(&pair_a, heights[h], &bl);
+            BlockedSource(&bl, &src);
+            memory = bl.n_nodes * SHA256_DIGEST_LENGTH;
+            snprintf(label, sizeof(label), "blocked h = %d", heights[h]);
+        }
+
+        /* the sibling group of every level below the root, as a proof reads it */
+        start = NowNs();
+        for (int i = 0; i < LAYOUT_PROOFS && ok; i++)
+        {
+            long idx = leaves[i];
+
+            for (int l = 0; l < src.n_levels - 1 && ok; l++)
+            {
+                long first = idx - idx % src.arity;
+                int count = first + src.arity <= src.level_size[l] ? src.arity
+                          : (int)(src.level_size[l] - first);
+
+                ok = src.read(src.ctx, l, first, count, group);
+                /* only a sample is compared, the copies would hide the lookups */
+                ok = ok && (i % (LAYOUT_PROOFS / PROOF_SAMPLES) != 0 ||
+                            memcmp(group, LEVEL_HASH(&pair_a, l, first),
+                                   (size_t)count * SHA256_DIGEST_LENGTH) == 0);
+                idx /= src.arity;
+            }
+        }
+        ns = NowNs() - start;
+        BlockedFree(&bl);
+
+        double rate = ns > 0 ? LAYOUT_PROOFS / ns * 1e9 : 0;
+        if (heights[h] == 0)
+        {
+            base = rate;
+        }
+        fprintf(fp, "%-20s %12zu %14.0f %11.2fx %12.1f %8s\n",
+            label, memory / 1024, rate, base > 0 ? rate / base : 0,
+            ns / LAYOUT_PROOFS, ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+
+    /* partial groups and padding nodes, in both modes */
+    for (size_t p = 0; p < sizeof(paddings) / sizeof(paddings[0]) && ret; p++)
+    {
+        struct merkle_levels_t ref;
+        struct blocked_levels_t bl;
+        struct level_source_t src;
+        bool ok = LevelsFromLeafHashes(pair_a.level[0], PADDING_ODD_LEAVES, 4, paddings[p], &ref);
+
+        if (ok)
+        {
+            ok = BlockedFromLevels(&ref, 2, &bl);
+            if (ok)
+            {
+                BlockedSource(&bl, &src);
+                for (int leaf = 0; leaf < ref.n_leaves && ok; leaf++)
+                {
+                    struct merkle_proof_t proof;
+
+                    ok = ProofBuildFromSource(&src, leaf, &proof);
+                    if (ok)
+                    {
+                        ok = ProofVerify(&proof, LEVEL_HASH(&ref, 0, leaf), LevelsRoot(&ref));
+                        ProofFree(&proof);
+                    }
+                }
+                BlockedFree(&bl);
+            }
+            LevelsFree(&ref);
+        }
+
+        char label[20];
+        snprintf(label, sizeof(label), "k = 4, %s", p == 0 ? "duplicate" : "promote");
+        fprintf(fp, "%-20s %12s %14s %12s %12s %8s\n",
+            label, "-", "-", "-", "-", ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    free(leaves);
+
+    return ret;
+}
+
+static bool run_append_test(FILE *fp)
+{
+    static const int arities[] = { 2, 4 };
+    static const enum merkle_padding_t paddings[] = { PADDING_DUPLICATE, PADDING_PROMOTE };
+    bool ret = pair_a.n_leaves >= APPEND_LEAVES;
+
+    fprintf(fp, "%-20s %12s %14s %12s %12s %8s\n",
+        "APPEND TEST", "PRODUCERS", "LEAVES/s", "ROOTS READ", "TIME (ms)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    for (size_t m = 0; m < sizeof(arities) / sizeof(arities[0]) && ret; m++)
+    {
+        struct merkle_append_t ap;
+        pthread_t producers[APPEND_PRODUCERS];
+        int started = 0;
+        int sample_n[APPEND_SAMPLES + 3] = {0};
+        unsigned char sample_root[APPEND_SAMPLES + 3][SHA256_DIGEST_LENGTH];
+        long reads = 0;
+        struct timespec start = {0}, end = {0};
+        bool ok = AppendInit(&ap, APPEND_LEAVES, arities[m], paddings[m]);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        while (ok && started < APPEND_PRODUCERS)
+        {
+            ok = pthread_create(&producers[started], NULL, append_producer, &ap) == 0;
+            started += ok;
+        }
+
+        /* read the published prefix while the producers run */
+        for (int n = 0; ok && n < APPEND_LEAVES; )
+        {
+            int published = AppendPublished(&ap);
+
+            if (published > n)
+            {
+                int slot = reads++ % APPEND_SAMPLES;
+
+                n = published;
+                sample_n[slot] = n;
+                ok = AppendPrefixRoot(&ap, n, sample_root[slot]);
+            }
+        }
+        for (int t = 0; t < started; t++)
+        {
+            void *failure;
+
+            pthread_join(producers[t], &failure);
+            ok = ok && failure == NULL;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        /* plus a single leaf, an odd prefix and the whole tree */
+        sample_n[APPEND_SAMPLES] = 1;
+        sample_n[APPEND_SAMPLES + 1] = PADDING_ODD_LEAVES;
+        sample_n[APPEND_SAMPLES + 2] = APPEND_LEAVES;
+        for (int i = APPEND_SAMPLES; i < APPEND_SAMPLES + 3 && ok; i++)
+        {
+            ok = AppendPrefixRoot(&ap, sample_n[i], sample_root[i]);
+        }
+        for (int i = 0; i < APPEND_SAMPLES + 3 && ok; i++)
+        {
+            struct merkle_levels_t ref;
+
+            if (sample_n[i] > 0)
+            {
+                ok = LevelsFromLeafHashes(pair_a.level[0], sample_n[i], arities[m], paddings[m], &ref);
+                if (ok)
+                {
+                    ok = memcmp(LevelsRoot(&ref), sample_root[i], SHA256_DIGEST_LENGTH) == 0;
+                    LevelsFree(&ref);
+                }
+            }
+        }
+        AppendFree(&ap);
+
+        double us = timespec_diff_us(&start, &end);
+        char label[20];
+        snprintf(label, sizeof(label), "k = %d, %s", arities[m],
+                 paddings[m] == PADDING_DUPLICATE ? "duplicate" : "promote");
+        fprintf(fp, "%-20s %12d %14.0f %12ld %12.2f %8s\n",
+            label, APPEND_PRODUCERS, us > 0 ? APPEND_LEAVES / us * 1e6 : 0, reads,
+            us / 1e3, ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static void *append_producer(void *arg)
+{
+    struct merkle_append_t *ap = arg;
+    bool ok = true;
+
+    /* fewer slots once the tree is nearly full */
+    for (int count = APPEND_CHUNK; count > 0 && ok; )
+    {
+        int first = AppendClaim(ap, count);
+
+        if (first < 0)
+        {
+            count /= 2;
+        }
+        for (int slot = first + count - 1; first >= 0 && slot >= first && ok; slot--)
+        {
+            ok = AppendPublish(ap, slot, LEVEL_HASH(&pair_a, 0, slot));
+        }
+    }
+
+    return ok ? NULL : ap;
+}
+
+static bool run_rcu_test(FILE *fp)
+{
+    static const int arities[] = { 2, 4 };
+    static const enum merkle_padding_t paddings[] = { PADDING_DUPLICATE, PADDING_PROMOTE };
+    unsigned char *leaves = malloc((size_t)RCU_LEAVES * SHA256_DIGEST_LENGTH);
+    unsigned char *batch = malloc((size_t)RCU_BATCH * SHA256_DIGEST_LENGTH);
+    bool ret = leaves && batch && pair_a.n_leaves >= RCU_LEAVES;
+
+    fprintf(fp, "%-20s %12s %14s %12s %12s %8s\n",
+        "RCU TEST", "IDLE (us)", "INGEST (us)", "MAX (us)", "UPDATES/s", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    for (size_t m = 0; m < sizeof(arities) / sizeof(arities[0]) && ret; m++)
+    {
+        struct merkle_levels_t lv;
+        struct merkle_rcu_t tree;
+        struct rcu_reader_t readers[RCU_READERS];
+        pthread_t threads[RCU_READERS];
+        atomic_bool stop = false;
+        int started = 0;
+        struct timespec start = {0}, end = {0};
+        double idle_us = 0, ingest_us = 0, max_us = 0, update_us = 0;
+        long proofs = 0;
+        uint64_t x = 0x9e3779b97f4a7c15ull + m;
+        bool ok = LevelsFromLeafHashes(pair_a.level[0], RCU_LEAVES, arities[m], paddings[m], &lv);
+
+        if (!ok)
+        {
+            ret = false;
+            break;
+        }
+        memcpy(leaves, pair_a.level[0], (size_t)RCU_LEAVES * SHA256_DIGEST_LENGTH);
+        ok = RcuFromLevels(&lv, &tree);
+        LevelsFree(&lv);
+
+        /* proof latency without a writer */
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < RCU_IDLE_PROOFS && ok; i++)
+        {
+            ok = rcu_prove(&tree, 0, (int)((uint64_t)i * 7919 % RCU_LEAVES));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        idle_us = timespec_diff_us(&start, &end) / RCU_IDLE_PROOFS;
+
+        while (ok && started < RCU_READERS)
+        {
+            readers[started] = (struct rcu_reader_t){
+                .tree = &tree, .slot = started, .stop = &stop, .ok = true,
+            };
+            ok = pthread_create(&threads[started], NULL, rcu_reader, &readers[started]) == 0;
+            started += ok;
+        }
+
+        /* the writer changes random leaves while the readers prove */
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int u = 0; u < RCU_UPDATES && ok; u++)
+        {
+            int changed[RCU_BATCH];
+
+            fill_random_hashes(batch, RCU_BATCH, x);
+            for (int i = 0; i < RCU_BATCH; i++)
+            {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                changed[i] = (int)(x % RCU_LEAVES);
+                memcpy(leaves + (size_t)changed[i] * SHA256_DIGEST_LENGTH,
+                       batch + (size_t)i * SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH);
+            }
+            ok = RcuUpdate(&tree, changed, batch, RCU_BATCH);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        update_us = timespec_diff_us(&start, &end);
+
+        atomic_store(&stop, true);
+        for (int r = 0; r < started; r++)
+        {
+            pthread_join(threads[r], NULL);
+            ok = ok && readers[r].ok;
+            proofs += readers[r].proofs;
+            ingest_us += readers[r].total_us;
+            max_us = readers[r].max_us > max_us ? readers[r].max_us : max_us;
+        }
+        ingest_us = proofs > 0 ? ingest_us / proofs : 0;
+
+        /* no reader left: every replaced node goes */
+        ok = ok && RcuReclaim(&tree) == 0;
+        if (ok)
+        {
+            struct rcu_view_t view;
+
+            ok = LevelsFromLeafHashes(leaves, RCU_LEAVES, arities[m], paddings[m], &lv);
+            if (ok)
+            {
+                RcuAcquire(&tree, 0, &view);
+                ok = memcmp(RcuRoot(&view), LevelsRoot(&lv), SHA256_DIGEST_LENGTH) == 0;
+                RcuRelease(&tree, &view);
+                LevelsFree(&lv);
+            }
+        }
+        RcuFree(&tree);
+
+        char label[20];
+        snprintf(label, sizeof(label), "k = %d, %s", arities[m],
+                 paddings[m] == PADDING_DUPLICATE ? "duplicate" : "promote");
+        fprintf(fp, "%-20s %12.2f %14.2f %12.1f %12.0f %8s\n",
+            label, idle_us, ingest_us, max_us,
+            update_us > 0 ? RCU_UPDATES / update_us * 1e6 : 0, ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    free(leaves);
+    free(batch);
+
+    return ret;
+}
+
+static bool run_version_test(FILE *fp)
+{
+    static const int arities[] = { 2, 4 };
+    static const enum merkle_padding_t paddings[] = { PADDING_DUPLICATE, PADDING_PROMOTE };
+    unsigned char *leaves = malloc((size_t)VERSION_LEAVES * SHA256_DIGEST_LENGTH);
+    unsigned char (*roots)[SHA256_DIGEST_LENGTH] = malloc((VERSION_UPDATES + 1) * sizeof(*roots));
+    unsigned char (*changed_hash)[SHA256_DIGEST_LENGTH] = malloc((VERSION_UPDATES + 1) * sizeof(*changed_hash));
+    int changed_leaf[VERSION_UPDATES + 1];
+    bool ret = leaves && roots && changed_hash && pair_a.n_leaves >= VERSION_LEAVES;
+
+    fprintf(fp, "%-20s %12s %14s %12s %12s %8s\n",
+        "VERSION TEST", "VERSIONS", "KEPT", "NODES/VER", "PROOFS", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    for (size_t m = 0; m < sizeof(arities) / sizeof(arities[0]) && ret; m++)
+    {
+        struct merkle_levels_t lv;
+        struct merkle_rcu_t tree;
+        struct rcu_view_t view;
+        uint64_t x = 0x2545f4914f6cdd1dull + m;
+        long proofs = 0;
+        size_t held = 0;
+        bool ok = LevelsFromLeafHashes(pair_a.level[0], VERSION_LEAVES, arities[m], paddings[m], &lv);
+
+        if (!ok)
+        {
+            ret = false;
+            break;
+        }
+        memcpy(leaves, pair_a.level[0], (size_t)VERSION_LEAVES * SHA256_DIGEST_LENGTH);
+        memcpy(roots[0], LevelsRoot(&lv), SHA256_DIGEST_LENGTH);
+        ok = RcuFromLevels(&lv, &tree) && RcuRetain(&tree, VERSION_KEEP);
+        LevelsFree(&lv);
+
+        /* one rebuild per version gives the expected roots */
+        for (int v = 1; v <= VERSION_UPDATES && ok; v++)
+        {
+            int changed[VERSION_BATCH];
+            unsigned char batch[VERSION_BATCH * SHA256_DIGEST_LENGTH];
+
+            fill_random_hashes(batch, VERSION_BATCH, x + v);
+            for (int i = 0; i < VERSION_BATCH; i++)
+            {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                changed[i] = (int)(x % VERSION_LEAVES);
+                memcpy(leaves + (size_t)changed[i] * SHA256_DIGEST_LENGTH,
+                       batch + (size_t)i * SHA256_DIGEST_LENGTH, SHA256_DIGEST_LENGTH);
+            }
+            changed_leaf[v] = changed[VERSION_BATCH - 1];
+            memcpy(changed_hash[v], batch + (VERSION_BATCH - 1) * SHA256_DIGEST_LENGTH,
+                   SHA256_DIGEST_LENGTH);
+
+            ok = RcuUpdate(&tree, changed, batch, VERSION_BATCH) &&
+                 LevelsFromLeafHashes(leaves, VERSION_LEAVES, arities[m], paddings[m], &lv);
+            if (ok)
+            {
+                memcpy(roots[v], LevelsRoot(&lv), SHA256_DIGEST_LENGTH);
+                LevelsFree(&lv);
+            }
+        }
+
+        /* nodes held by the kept versions besides the current tree */
+        held = tree.n_retired;
+
+        for (int v = 0; v <= VERSION_UPDATES && ok; v++)
+        {
+            bool kept = v > VERSION_UPDATES - VERSION_KEEP;
+
+            ok = RcuAcquireVersion(&tree, 0, v, &view) == kept;
+            if (ok && kept)
+            {
+                struct level_source_t src;
+                struct merkle_proof_t proof;
+                unsigned char leaf_hash[SHA256_DIGEST_LENGTH];
+
+                RcuSource(&view, &src);
+                ok = memcmp(RcuRoot(&view), roots[v], SHA256_DIGEST_LENGTH) == 0;
+                if (ok && v > 0)
+                {
+                    /* the leaf as this version changed it */
+                    ok = src.read(src.ctx, 0, changed_leaf[v], 1, leaf_hash) &&
+                         memcmp(leaf_hash, changed_hash[v], SHA256_DIGEST_LENGTH) == 0 &&
+                         ProofBuildFromSource(&src, changed_leaf[v], &proof);
+                    if (ok)
+                    {
+                        ok = ProofVerify(&proof, leaf_hash, roots[v]);
+                        ProofFree(&proof);
+                        proofs++;
+                    }
+                }
+                RcuRelease(&tree, &view);
+            }
+        }
+
+        /* back to the current version only: the history goes */
+        ok = ok && RcuRetain(&tree, 1) && tree.n_retired == 0;
+        RcuFree(&tree);
+
+        char label[20];
+        snprintf(label, sizeof(label), "k = %d, %s", arities[m],
+                 paddings[m] == PADDING_DUPLICATE ? "duplicate" : "promote");
+        fprintf(fp, "%-20s %12d %14d %12zu %12ld %8s\n",
+            label, VERSION_UPDATES + 1, VERSION_KEEP, held / (VERSION_KEEP - 1), proofs,
+            ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    free(leaves);
+    free(roots);
+    free(changed_hash);
+
+    return ret;
+}
+
+static bool run_shared_test(FILE *fp)
+{
+    struct shared_publisher_t pub = {0};
+    struct shared_report_t reports[2] = {0};
+    char name[SHARED_NAME_MAX];
+    bool ret;
+    int sv[2];
+
+    snprintf(name, sizeof(name), "/merkle-test-%d", (int)getpid());
+    ret = SharedPublish(&pub, name, &pair_a) && socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0;
+
+    if (ret)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            /* reading process */
+            close(sv[0]);
+            _exit(shared_reader_process(sv[1], name));
+        }
+        close(sv[1]);
+
+        if (pid > 0)
+        {
+            int status = 0;
+            char go = 1;
+
+            ret = read(sv[0], &reports[0], sizeof(reports[0])) == sizeof(reports[0]) &&
+                  SharedPublish(&pub, name, &pair_b) &&
+                  write(sv[0], &go, 1) == 1 &&
+                  read(sv[0], &reports[1], sizeof(reports[1])) == sizeof(reports[1]);
+            close(sv[0]);
+            waitpid(pid, &status, 0);
+            ret = ret && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        else
+        {
+            perror("run_shared_test: fork");
+            close(sv[0]);
+            ret = false;
+        }
+    }
+    SharedUnpublish(&pub);
+
+    size_t segment = 0;
+    for (int l = 0; l < pair_a.n_levels; l++)
+    {
+        segment += (size_t)pair_a.level_size[l] * SHA256_DIGEST_LENGTH;
+    }
+
+    fprintf(fp, "%-20s %12s %14s %12s %12s %8s\n",
+        "SHARED TEST", "GENERATION", "PROOFS/s", "SHMEM (KB)", "TREE (KB)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    for (int g = 0; g < 2; g++)
+    {
+        bool ok = ret && reports[g].ok && reports[g].generation == (unsigned long)g + 1;
+
+        fprintf(fp, "%-20s %12lu %14.0f %12ld %12zu %8s\n",
+            g == 0 ? "pair_a" : "pair_b", reports[g].generation, reports[g].rate,
+            reports[g].shmem_kb, segment / 1024, ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static int shared_reader_process(int sock, const char *name)
+{
+    struct shared_reader_t rd;
+    struct shared_report_t report = {0};
+    char go;
+    bool ok = SharedAttach(&rd, name);
+
+    if (ok)
+    {
+        shared_prove(&rd, &pair_a, &report);
+    }
+    ok = write(sock, &report, sizeof(report)) == sizeof(report);
+
+    /* the next generation is published once the first report is read */
+    memset(&report, 0, sizeof(report));
+    if (ok && read(sock, &go, 1) == 1 && SharedRefresh(&rd))
+    {
+        shared_prove(&rd, &pair_b, &report);
+    }
+    ok = write(sock, &report, sizeof(report)) == sizeof(report) && ok;
+    SharedDetach(&rd);
+    close(sock);
+
+    return ok ? 0 : 1;
+}
+
+static void shared_prove(struct shared_reader_t *rd, const struct merkle_levels_t *expected,
+                         struct shared_report_t *report)
+{
+    struct timespec start = {0}, end = {0};
+    char line[256];
+    FILE *status;
+    uint64_t x = 88172645463325252ull;
+    bool ok = rd->lv.n_leaves == expected->n_leaves &&
+              memcmp(LevelsRoot(&rd->lv), LevelsRoot(expected), SHA256_DIGEST_LENGTH) == 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < SHARED_PROOFS && ok; i++)
+    {
+        struct merkle_proof_t proof;
+        int leaf;
+
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        leaf = (int)(x % (uint64_t)expected->n_leaves);
+        ok = ProofBuild(&rd->lv, leaf, &proof);
+        if (ok)
+        {
+            /* only a sample is verified, against the leaves of the private copy */
+            ok = i % (SHARED_PROOFS / PROOF_SAMPLES) != 0 ||
+                 ProofVerify(&proof, LEVEL_HASH(expected, 0, leaf), LevelsRoot(expected));
+            ProofFree(&proof);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double us = timespec_diff_us(&start, &end);
+    report->ok = ok;
+    report->generation = rd->generation;
+    report->rate = us > 0 ? SHARED_PROOFS / us * 1e6 : 0;
+
+    status = fopen("/proc/self/status", "r");
+    while (status && fgets(line, sizeof(line), status))
+    {
+        sscanf(line, "RssShmem: %ld kB", &report->shmem_kb);
+    }
+    if (status)
+    {
+        fclose(status);
+    }
+}
+
+static bool run_snapshot_test(FILE *fp)
+{
+    struct merkle_levels_t lv, mapped;
+    FILE *f = tmpfile();
+    bool built = LevelsFromLeafHashes(pair_a.level[0], SNAPSHOT_TEST_LEAVES, SNAPSHOT_TEST_ARITY,
+                                      PADDING_DUPLICATE, &lv);
+    bool same_root = false;
+    bool shrunk_rejected = false;
+    bool leaves_rejected = false;
+
+    if (built && f && LevelsWrite(&lv, f) && fflush(f) == 0 && LevelsMapFd(&mapped, fileno(f)))
+    {
+        same_root = mapped.n_leaves == SNAPSHOT_TEST_LEAVES &&
+                    !HashDiffers(LevelsRoot(&mapped), LevelsRoot(&lv));
+        LevelsFree(&mapped);
+
+        /* one group less in level 0: the levels above still end inside the file */
+        shrunk_rejected = !snapshot_forged_maps(f, SNAPSHOT_SIZES_AT,
+                                                (uint32_t)(lv.level_size[0] - SNAPSHOT_TEST_ARITY));
+        leaves_rejected = !snapshot_forged_maps(f, SNAPSHOT_LEAVES_AT,
+                                                (uint32_t)(2 * SNAPSHOT_TEST_LEAVES));
+    }
+
+    fprintf(fp, "%-20s %12s %12s %12s %12s %8s\n",
+        "SNAPSHOT", "LEAVES", "LEVEL 0", "ARITY", "MAPPING", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    fprintf(fp, "%-20s %12d %12ld %12d %12s %8s\n",
+        "as written", SNAPSHOT_TEST_LEAVES, built ? lv.level_size[0] : 0L, SNAPSHOT_TEST_ARITY,
+        same_root ? "same root" : "failed", same_root ? "PASS" : "FAIL");
+    fprintf(fp, "%-20s %12d %12ld %12d %12s %8s\n",
+        "level 0 shrunk", SNAPSHOT_TEST_LEAVES, built ? lv.level_size[0] - SNAPSHOT_TEST_ARITY : 0L,
+        SNAPSHOT_TEST_ARITY, shrunk_rejected ? "rejected" : "mapped",
+        shrunk_rejected ? "PASS" : "FAIL");
+    fprintf(fp, "%-20s %12d %12ld %12d %12s %8s\n",
+        "leaf count doubled", 2 * SNAPSHOT_TEST_LEAVES, built ? lv.level_size[0] : 0L,
+        SNAPSHOT_TEST_ARITY, leaves_rejected ? "rejected" : "mapped",
+        leaves_rejected ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    if (f)
+    {
+        fclose(f);
+    }
+    if (built)
+    {
+        LevelsFree(&lv);
+    }
+
+    return same_root && shrunk_rejected && leaves_rejected;
+}
+
+static bool snapshot_forged_maps(FILE *f, long offset, uint32_t value)
+{
+    struct merkle_levels_t lv;
+    uint32_t saved;
+    bool ret = false;
+
+    if (pread(fileno(f), &saved, sizeof(saved), offset) == sizeof(saved) &&
+        pwrite(fileno(f), &value, sizeof(value), offset) == sizeof(value))
+    {
+        ret = LevelsMapFd(&lv, fileno(f));
+        if (ret)
+        {
+            LevelsFree(&lv);
+        }
+        ret = pwrite(fileno(f), &saved, sizeof(saved), offset) == sizeof(saved) && ret;
+    }
+
+    return ret;
+}
+
+static bool run_server_test(FILE *fp)
+{
+    struct merkle_server_t srv;
+    struct server_header_t header;
+    unsigned char payload[SHA256_DIGEST_LENGTH];
+    char path[108];
+    bool ret;
+    int fd;
+
+    snprintf(path, sizeof(path), "/tmp/merkle-test-%d.sock", (int)getpid());
+    ret = ServerOpen(&srv, path, &pair_a);
+
+    fprintf(fp, "%-20s %12s %14s %12s %12s %12s %8s\n",
+        "SERVER TEST", "IN FLIGHT", "PROOFS/s", "BATCH", "P50 (us)", "P99 (us)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    for (int run = 0; run < 2 && ret; run++)
+    {
+        struct server_load_t load[SERVER_CLIENTS];
+        pthread_t server, clients[SERVER_CLIENTS];
+        struct timespec start, end;
+        bool ok = true;
+        bool checked = true;
+
+        if (pthread_create(&server, NULL, server_loop, &srv) != 0)
+        {
+            ret = false;
+            break;
+        }
+        if (run == 0)
+        {
+            /* the other answers, before the load */
+            fd = ServerConnect(path);
+            checked = fd >= 0 &&
+                      ServerSend(fd, SERVER_ROOT, 0) && ServerSend(fd, SERVER_LEAF, 7) &&
+                      ServerSend(fd, SERVER_PROOF, (uint32_t)pair_a.n_leaves);
+            checked = checked && ServerReceive(fd, &header, payload, sizeof(payload)) &&
+                      header.type == SERVER_ROOT && header.b == (uint32_t)pair_a.n_leaves &&
+                      memcmp(payload, LevelsRoot(&pair_a), SHA256_DIGEST_LENGTH) == 0;
+            checked = checked && ServerReceive(fd, &header, payload, sizeof(payload)) &&
+                      header.type == SERVER_LEAF && header.b == 7 &&
+                      memcmp(payload, LEVEL_HASH(&pair_a, 0, 7), SHA256_DIGEST_LENGTH) == 0;
+            checked = checked && ServerReceive(fd, &header, payload, sizeof(payload)) &&
+                      header.type == SERVER_ERROR && header.b == SERVER_PROOF;
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int started = 0;
+        while (ok && started < SERVER_CLIENTS)
+        {
+            load[started] = (struct server_load_t){ path, run == 0 ? 1 : SERVER_DEPTH,
+                                                    0x9E3779B97F4A7C15ull * (started + 1), false };
+            ok = pthread_create(&clients[started], NULL, server_client, &load[started]) == 0;
+            started += ok;
+        }
+        for (int c = 0; c < started; c++)
+        {
+            pthread_join(clients[c], NULL);
+            ok = ok && load[c].ok;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        /* the histograms as a client sees them */
+        unsigned long counted = 0;
+        unsigned char stats[SERVER_TYPES * SERVER_HIST_BUCKETS * sizeof(uint32_t)];
+        fd = ServerConnect(path);
+        checked = checked && fd >= 0 && ServerSend(fd, SERVER_STATS, 0) &&
+                  ServerReceive(fd, &header, stats, sizeof(stats)) &&
+                  header.type == SERVER_STATS && header.a == sizeof(stats);
+        for (int k = 0; k < SERVER_HIST_BUCKETS && checked; k++)
+        {
+            uint32_t count;
+            memcpy(&count, stats + ((SERVER_PROOF - 1) * SERVER_HIST_BUCKETS + k) * sizeof(count), sizeof(count));
+            counted += ntohl(count);
+        }
+        checked = checked && counted == (unsigned long)SERVER_CLIENTS * SERVER_PROOFS;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        atomic_store(&server_stop, true);
+        pthread_join(server, NULL);
+        atomic_store(&server_stop, false);
+
+        const struct server_histogram_t *h = &srv.stats.latency[SERVER_PROOF - 1];
+        double us = timespec_diff_us(&start, &end);
+        ok = ok && checked && h->count == (unsigned long)SERVER_CLIENTS * SERVER_PROOFS;
+        fprintf(fp, "%-20s %12d %14.0f %12.1f %12.1f %12.1f %8s\n",
+            run == 0 ? "sequential" : "pipelined", run == 0 ? 1 : SERVER_DEPTH,
+            us > 0 ? SERVER_CLIENTS * SERVER_PROOFS / us * 1e6 : 0,
+            srv.stats.batches ? (double)h->count / srv.stats.batches : 0,
+            ServerPercentile(h, 0.5) / 1e3, ServerPercentile(h, 0.99) / 1e3,
+            ok ? "PASS" : "FAIL");
+        memset(&srv.stats, 0, sizeof(srv.stats));
+        ret = ok;
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    ServerClose(&srv);
+
+    return ret;
+}
+
+static void *server_loop(void *arg)
+{
+    struct merkle_server_t *srv = arg;
+
+    while (!atomic_load(&server_stop) && ServerPoll(srv, 10) >= 0)
+    {
+    }
+
+    return NULL;
+}
+
+static void *server_client(void *arg)
+{
+    struct server_load_t *load = arg;
+    struct server_header_t header;
+    unsigned char *payload = malloc(PROOF_HEADER_SIZE + LEVELS_MAX * SHA256_DIGEST_LENGTH);
+    uint32_t leaves[SERVER_DEPTH];
+    uint64_t x = load->seed;
+    int fd = payload ? ServerConnect(load->path) : -1;
+    int sent = 0;
+    bool ok = fd >= 0;
+
+    for (int answered = 0; answered < SERVER_PROOFS && ok; answered++)
+    {
+        /* keep depth requests in flight, answers come back in order */
+        while (ok && sent < SERVER_PROOFS && sent - answered < load->depth)
+        {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            leaves[sent % SERVER_DEPTH] = (uint32_t)(x % (uint64_t)pair_a.n_leaves);
+            ok = ServerSend(fd, SERVER_PROOF, leaves[sent % SERVER_DEPTH]);
+            sent++;
+        }
+
+        uint32_t leaf = leaves[answered % SERVER_DEPTH];
+        ok = ok && ServerReceive(fd, &header, payload, PROOF_HEADER_SIZE + LEVELS_MAX * SHA256_DIGEST_LENGTH) &&
+             header.type == SERVER_PROOF && header.b == leaf;
+        if (ok && answered % (SERVER_PROOFS / PROOF_SAMPLES) == 0)
+        {
+            struct merkle_proof_t proof;
+
+            ok = ProofDecode(payload, header.a, &proof);
+            if (ok)
+            {
+                ok = proof.leaf == (int)leaf &&
+                     ProofVerify(&proof, LEVEL_HASH(&pair_a, 0, leaf), LevelsRoot(&pair_a));
+                ProofFree(&proof);
+            }
+        }
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    free(payload);
+    load->ok = ok;
+
+    return NULL;
+}
+
+static void *rcu_reader(void *arg)
+{
+    struct rcu_reader_t *reader = arg;
+    uint64_t x = 88172645463325252ull + reader->slot;
+
+    while (reader->ok && !atomic_load(reader->stop))
+    {
+        struct timespec start = {0}, end = {0};
+
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        reader->ok = rcu_prove(reader->tree, reader->slot, (int)(x % RCU_LEAVES));
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double us = timespec_diff_us(&start, &end);
+        reader->total_us += us;
+        reader->max_us = us > reader->max_us ? us : reader->max_us;
+        reader->proofs++;
+    }
+
+    return NULL;
+}
+
+static bool rcu_prove(struct merkle_rcu_t *t, int slot, int leaf)
+{
+    struct rcu_view_t view;
+    struct level_source_t src;
+    struct merkle_proof_t proof;
+    unsigned char leaf_hash[SHA256_DIGEST_LENGTH];
+    bool ret;
+
+    /* leaf, siblings and root all come from the same snapshot */
+    RcuAcquire(t, slot, &view);
+    RcuSource(&view, &src);
+    ret = src.read(src.ctx, 0, leaf, 1, leaf_hash) && ProofBuildFromSource(&src, leaf, &proof);
+    if (ret)
+    {
+        ret = ProofVerify(&proof, leaf_hash, RcuRoot(&view));
+        ProofFree(&proof);
+    }
+    RcuRelease(t, &view);
+
+    return ret;
+}
+
+static bool run_placement_test(FILE *fp)
+{
+    static const enum placement_huge_t modes[] = { PLACEMENT_PLAIN, PLACEMENT_THP, PLACEMENT_HUGETLB };
+    enum placement_huge_t saved = merkle_config.huge_pages;
+    unsigned char expected[SHA256_DIGEST_LENGTH];
+    unsigned char *scratch = malloc(((size_t)pair_a.n_leaves + 1) * SHA256_DIGEST_LENGTH);
+    bool ret = scratch != NULL;
+
+    /* reference root: one thread, in place */
+    if (ret)
+    {
+        memcpy(scratch, pair_a.level[0], (size_t)pair_a.n_leaves * SHA256_DIGEST_LENGTH);
+        ret = SubtreeRoot(scratch, pair_a.n_leaves, pair_a.n_levels - 1, 2, PADDING_DUPLICATE,
+                          expected);
+        free(scratch);
+    }
+
+    fprintf(fp, "%-20s %7s %10s %9s %7s %9s %5s %9s %6s\n",
+        "PLACEMENT TEST", "BLOCK", "BUILD (ms)", "MIN FLT", "MAJ FLT", "HUGE (KB)", "NODES",
+        "NODE MISS", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]) && ret; m++)
+    {
+        struct merkle_levels_t lv;
+        struct placement_stats_t before, after;
+        struct perf_sample_t sample;
+        struct timespec start = {0}, end = {0};
+        long allocs[PLACEMENT_MODES];
+        const char *block = "-";
+        char misses[24] = "n/a";
+        int nodes = 0;
+        bool ok;
+
+        for (int i = 0; i < PLACEMENT_MODES; i++)
+        {
+            allocs[i] = atomic_load(&placement_allocs[i]);
+        }
+        merkle_config.huge_pages = modes[m];
+        PlacementSample(&before);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        PerfStart(&perf_counters);
+        ok = LevelsFromLeafHashes(pair_a.level[0], pair_a.n_leaves, 2, PADDING_DUPLICATE, &lv);
+        PerfStop(&perf_counters, &sample);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        /* sampled while the tree is alive */
+        PlacementSample(&after);
+        if (ok)
+        {
+            ok = !HashDiffers(LevelsRoot(&lv), expected);
+            LevelsFree(&lv);
+        }
+        for (int i = 0; i < PLACEMENT_MODES; i++)
+        {
+            if (atomic_load(&placement_allocs[i]) != allocs[i])
+            {
+                block = PlacementName(i);
+            }
+        }
+
+        /* nodes that received pages during the build */
+        for (int n = 0; n < PLACEMENT_MAX_NODES; n++)
+        {
+            nodes += after.node_kb[n] > before.node_kb[n];
+        }
+        if (sample.value[PERF_NODE_MISSES] != PERF_UNAVAILABLE)
+        {
+            snprintf(misses, sizeof(misses), "%lld", sample.value[PERF_NODE_MISSES]);
+        }
+
+        fprintf(fp, "%-20s %7s %10.2f %9ld %7ld %9ld %5d %9s %6s\n",
+            PlacementName(modes[m]), block, timespec_diff_us(&start, &end) / 1e3,
+            after.minflt - before.minflt, after.majflt - before.majflt,
+            after.anon_huge_kb - before.anon_huge_kb, nodes, misses, ok ? "PASS" : "FAIL");
+        ret = ret && ok;
+    }
     fprintf(fp, "--------------------------------------------------------------------------------------------\n");
-    fprintf(fp, "%-15s %10s %-40s\n", "Memory Metric", "Value (kB)", "Description");
+    merkle_config.huge_pages = saved;
+
+    return ret;
+}
+
+static bool run_padding_test(FILE *fp)
+{
+    static const char *modes[] = { "duplicate", "promote" };
+    bool ret = true;
+
+    fprintf(fp, "%-20s %10s %10s %12s %12s %12s %8s\n",
+        "PADDING TEST", "MODE", "LEAVES", "NODES", "HASH CALLS", "BUILD (ms)", "RESULT");
     fprintf(fp, "--------------------------------------------------------------------------------------------\n");
 
-    char line[256];
-    while (fgets(line, sizeof(line), status_fp))
+    for (int f = 0; f < numFolders; f++)
     {
-        if (strncmp(line, "Vm", 2) == 0)
+        long nodes[2] = {0}, hashes[2] = {0};
+
+        if (folders[f].num_files % 2 == 0)
         {
-            char label[20];
-            long value;
-            char unit[10];
+            continue;
+        }
+        for (int m = PADDING_DUPLICATE; m <= PADDING_PROMOTE; m++)
+        {
+            struct merkle_levels_t lv, flat;
+            struct timespec start = {0}, end = {0};
+            bool ok = false;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (BuildMerkleLevels(folders[f].folder, 2, m, &lv))
+            {
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                for (int l = 0; l < lv.n_levels; l++)
+                {
+                    nodes[m] += lv.level_size[l];
+                }
+                hashes[m] = LevelsHashCalls(&lv);
 
-            if (sscanf(line, "%19s %ld %9s", label, &value, unit) == 3)
+                /* the node tree and the flat levels agree */
+                ok = LevelsFromLeafHashes(lv.level[0], lv.n_leaves, 2, m, &flat);
+                if (ok)
+                {
+                    ok = !HashDiffers(LevelsRoot(&flat), LevelsRoot(&lv));
+                    LevelsFree(&flat);
+                }
+                /* first, middle and last leaf proofs, encoded the same
+                 * from a built proof and straight from the levels */
+                for (int i = 0; i < 3 && ok; i++)
+                {
+                    struct merkle_proof_t proof;
+                    unsigned char built[PROOF_HEADER_SIZE + LEVELS_MAX * SHA256_DIGEST_LENGTH];
+                    unsigned char direct[sizeof(built)];
+                    int leaf = (int)((long)i * (lv.n_leaves - 1) / 2);
+
+                    ok = ProofBuild(&lv, leaf, &proof);
+                    if (ok)
+                    {
+                        size_t size = ProofEncode(&proof, built, sizeof(built));
+
+                        ok = ProofVerify(&proof, LEVEL_HASH(&lv, 0, leaf), LevelsRoot(&lv)) &&
+                             size > 0 &&
+                             ProofEncodeFromLevels(&lv, leaf, direct, sizeof(direct)) == size &&
+                             memcmp(built, direct, size) == 0;
+                        ProofFree(&proof);
+                    }
+                }
+                LevelsFree(&lv);
+            }
+
+            /* promote mode must save nodes and hashes */
+            if (m == PADDING_PROMOTE)
             {
-                const char *description = "";
-
-                if (strcmp(label, "VmPeak:") == 0) description = "Peak virtual memory size";
-                else if (strcmp(label, "VmSize:") == 0) description = "Total virtual memory size";
-                else if (strcmp(label, "VmLck:") == 0) description = "Locked memory (not swapped)";
-                else if (strcmp(label, "VmPin:") == 0) description = "Pinned memory (for real-time processes)";
-                else if (strcmp(label, "VmHWM:") == 0) description = "Peak resident set size (high-water mark)";
-                else if (strcmp(label, "VmRSS:") == 0) description = "Resident Set Size (actual RAM usage)";
-                else if (strcmp(label, "VmData:") == 0) description = "Size of data segment (heap, malloc)";
-                else if (strcmp(label, "VmStk:") == 0) description = "Size of stack segment";
-                else if (strcmp(label, "VmExe:") == 0) description = "Size of text (code) segment";
-                else if (strcmp(label, "VmLib:") == 0) description = "Size of shared libraries";
-                else if (strcmp(label, "VmPTE:") == 0) description = "Page table entries size";
-                else if (strcmp(label, "VmSwap:") == 0) description = "Swapped-out memory size";
-
-                fprintf(fp, "%-15s %10ld %s\n", label, value, description);
+                ok = ok && nodes[m] < nodes[PADDING_DUPLICATE] &&
+                     hashes[m] < hashes[PADDING_DUPLICATE];
             }
+            char label[20] = "";
+            if (m == PADDING_DUPLICATE)
+            {
+                snprintf(label, sizeof(label), "dataset %d", f);
+            }
+            fprintf(fp, "%-20s %10s %10d %12ld %12ld %12.2f %8s\n",
+                label, modes[m], folders[f].num_files, nodes[m], hashes[m],
+                timespec_diff_us(&start, &end) / 1e3, ok ? "PASS" : "FAIL");
+            ret = ret && ok;
         }
     }
 
+    /* n leaves versus n leaves and a copy of the last one */
+    unsigned char *leaves = malloc((size_t)(PADDING_ODD_LEAVES + 1) * SHA256_DIGEST_LENGTH);
+    bool ambiguous[2] = { false, false };
+    bool ok = leaves != NULL;
+
+    if (ok)
+    {
+        fill_random_hashes(leaves, PADDING_ODD_LEAVES, 0x2545F4914F6CDD1Dull);
+        memcpy(leaves + (size_t)PADDING_ODD_LEAVES * SHA256_DIGEST_LENGTH,
+               leaves + (size_t)(PADDING_ODD_LEAVES - 1) * SHA256_DIGEST_LENGTH,
+               SHA256_DIGEST_LENGTH);
+    }
+    for (int m = PADDING_DUPLICATE; m <= PADDING_PROMOTE && ok; m++)
+    {
+        struct merkle_levels_t odd, even;
+
+        ok = LevelsFromLeafHashes(leaves, PADDING_ODD_LEAVES, 2, m, &odd);
+        if (ok)
+        {
+            ok = LevelsFromLeafHashes(leaves, PADDING_ODD_LEAVES + 1, 2, m, &even);
+            if (ok)
+            {
+                ambiguous[m] = !HashDiffers(LevelsRoot(&odd), LevelsRoot(&even));
+                LevelsFree(&even);
+            }
+            LevelsFree(&odd);
+        }
+    }
+    free(leaves);
+    ok = ok && ambiguous[PADDING_DUPLICATE] && !ambiguous[PADDING_PROMOTE];
+    fprintf(fp, "%-20s %10s %10d %12s %12s %12s %8s\n",
+        "last leaf copied", ambiguous[PADDING_PROMOTE] ? "same root" : "distinct",
+        PADDING_ODD_LEAVES, "-", "-", "-", ok ? "PASS" : "FAIL");
     fprintf(fp, "--------------------------------------------------------------------------------------------\n");
-    fclose(status_fp);
+
+    return ret && ok;
+}
+
+static void *crypto_malloc(size_t size, const char *file, int line)
+{
+    (void)file;
+    (void)line;
+    atomic_fetch_add_explicit(&crypto_allocs, 1, memory_order_relaxed);
+    return malloc(size);
+}
+
+static void *crypto_realloc(void *ptr, size_t size, const char *file, int line)
+{
+    (void)file;
+    (void)line;
+    atomic_fetch_add_explicit(&crypto_allocs, 1, memory_order_relaxed);
+    return realloc(ptr, size);
+}
+
+static void crypto_free(void *ptr, const char *file, int line)
+{
+    (void)file;
+    (void)line;
+    free(ptr);
+}
+
+static void fill_random_hashes(unsigned char *hashes, int n, uint64_t seed)
+{
+    uint64_t x = seed;
+
+    for (size_t i = 0; i < (size_t)n * SHA256_DIGEST_LENGTH; i += sizeof(x))
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        memcpy(hashes + i, &x, sizeof(x));
+    }
 }
 
 static void PrintSysInfo(FILE *fp)
@@ -290,3 +2727,622 @@ static double timeval_diff_ms(struct timeval *start, struct timeval *end)
     double end_ms   = (double)end->tv_sec * 1000.0 + (double)end->tv_usec / 1000.0;
     return end_ms - start_ms;
 }
+
+static double timespec_diff_us(struct timespec *start, struct timespec *end)
+{
+    return (double)(end->tv_sec - start->tv_sec) * 1e6 +
+           (double)(end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+static bool run_perf_test(FILE *fp)
+{
+    bool ret = false;
+    struct perf_sample_t sample;
+    struct perf_level_t level = {
+        malloc((size_t)PERF_PARENTS * 2 * SHA256_DIGEST_LENGTH),
+        malloc((size_t)PERF_PARENTS * SHA256_DIGEST_LENGTH),
+    };
+
+    if (level.children && level.parents)
+    {
+        fill_random_hashes(level.children, PERF_PARENTS * 2, 0x2545F4914F6CDD1Dull);
+        PerfStart(&perf_counters);
+        ret = ParallelForStatic(PERF_THREADS, PERF_THREADS, perf_hash_task, &level, false);
+        PerfStop(&perf_counters, &sample);
+        PerfReport(fp, &perf_counters, "PERF TEST (2 workers)", &sample, PERF_PARENTS * 2,
+                   PERF_PARENTS);
+
+        /* the work of the exited workers is counted: over one instruction
+         * and one ns per hash, whatever the scaling */
+        for (int i = 0; i < PERF_COUNTERS; i++)
+        {
+            ret &= sample.value[i] == PERF_UNAVAILABLE || sample.value[i] >= 0;
+        }
+        ret &= sample.value[PERF_INSTRUCTIONS] == PERF_UNAVAILABLE
+            || sample.value[PERF_INSTRUCTIONS] > PERF_PARENTS;
+        ret &= sample.value[PERF_TASK_CLOCK] == PERF_UNAVAILABLE
+            || sample.value[PERF_TASK_CLOCK] > PERF_PARENTS;
+    }
+    free(level.children);
+    free(level.parents);
+
+    fprintf(fp, "%-30s %16s\n", "PERF TEST", ret ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static bool perf_hash_task(void *ctx, int task, int worker)
+{
+    const struct perf_level_t *level = ctx;
+    int first = PERF_PARENTS * task / PERF_THREADS;
+    int last = PERF_PARENTS * (task + 1) / PERF_THREADS;
+
+    (void)worker;
+
+    return HashLevel(level->children + (size_t)first * 2 * SHA256_DIGEST_LENGTH, last - first, 2,
+                     level->parents + (size_t)first * SHA256_DIGEST_LENGTH);
+}
+
+static bool run_sweep_test(FILE *fp)
+{
+    bool ret = false;
+    struct sweep_spec_t spec;
+    char *matrix = NULL;
+    size_t matrix_len = 0;
+    FILE *spec_fp = fmemopen(SWEEP_TEST_SPEC, strlen(SWEEP_TEST_SPEC), "r");
+    FILE *csv = open_memstream(&matrix, &matrix_len);
+    int rows = -1;
+
+    fprintf(fp, "\nSWEEP TEST\n");
+    if (spec_fp && csv && SweepReadSpec(spec_fp, &spec))
+    {
+        ret = SweepRun(&spec, fp, csv) == 0;
+        fclose(csv);
+        csv = NULL;
+        /* header and one row per combination */
+        for (size_t i = 0; i < matrix_len; i++)
+        {
+            rows += matrix[i] == '\n';
+        }
+        ret = ret && rows == SWEEP_TEST_ROWS;
+    }
+    if (spec_fp)
+    {
+        fclose(spec_fp);
+    }
+    if (csv)
+    {
+        fclose(csv);
+    }
+    free(matrix);
+
+    spec_fp = fmemopen(SWEEP_TEST_BAD, strlen(SWEEP_TEST_BAD), "r");
+    if (spec_fp)
+    {
+        ret = ret && !SweepReadSpec(spec_fp, &spec);
+        fclose(spec_fp);
+    }
+
+    fprintf(fp, "%-20s %12d %12s\n", "SWEEP MATRIX ROWS", rows, ret ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static bool run_cache_test(FILE *fp)
+{
+    static const enum pagecache_mode_t modes[] = { PAGECACHE_COLD, PAGECACHE_WARM };
+    bool ret = true;
+
+    fprintf(fp, "%-26s %6s %9s %11s %9s %9s %9s %9s %10s\n",
+        "PAGE CACHE TEST", "MODE", "CACHED %", "ELAPSED ms", "HASH ms", "SYS ms", "IOWAIT ms",
+        "MB/s", "FILES/s");
+    fprintf(fp, "--------------------------------------------------------------------------------------------------------\n");
+
+    for (int f = 0; f < numFolders; f++)
+    {
+        unsigned char roots[2][SHA256_DIGEST_LENGTH];
+        long long cached[2] = {0};
+
+        for (int m = 0; m < 2; m++)
+        {
+            struct pagecache_stats_t st;
+            struct timespec start, end;
+            struct rusage start_ru, end_ru;
+            bool ok = PageCachePrepare(folders[f].folder, modes[m], &st);
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            getrusage(RUSAGE_SELF, &start_ru);
+            ok = ok && MerkleTreeBuild(folders[f].folder, PADDING_DUPLICATE) > 0;
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            getrusage(RUSAGE_SELF, &end_ru);
+            if (ok)
+            {
+                memcpy(roots[m], root_node->hash, SHA256_DIGEST_LENGTH);
+            }
+            MerkleTreeFree();
+
+            double elapsed_ms = timespec_diff_us(&start, &end) / 1e3;
+            double user_ms = timeval_diff_ms(&start_ru.ru_utime, &end_ru.ru_utime);
+            double sys_ms = timeval_diff_ms(&start_ru.ru_stime, &end_ru.ru_stime);
+            /* the build is single-threaded: time off the CPU is spent waiting */
+            double wait_ms = elapsed_ms - user_ms - sys_ms;
+
+            cached[m] = st.resident_bytes;
+            record_metric(PageCacheModeName(modes[m]), folders[f].folder, "mb_per_s",
+                          st.bytes / 1e3 / elapsed_ms, "MB/s", RESULTS_HIGHER);
+            fprintf(fp, "%-26s %6s %9.1f %11.2f %9.2f %9.2f %9.2f %9.1f %10.0f\n",
+                    folders[f].folder, PageCacheModeName(modes[m]),
+                    st.bytes ? 100.0 * st.resident_bytes / st.bytes : 0.0, elapsed_ms,
+                    user_ms, sys_ms, wait_ms > 0.0 ? wait_ms : 0.0,
+                    st.bytes / 1e3 / elapsed_ms, st.files * 1e3 / elapsed_ms);
+            ret = ret && ok;
+        }
+        ret = ret && memcmp(roots[0], roots[1], SHA256_DIGEST_LENGTH) == 0 && cached[0] <= cached[1];
+    }
+    fprintf(fp, "%-26s %6s\n", "RESULT", ret ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static bool run_results_test(FILE *fp)
+{
+    bool ret = false;
+    char *streams[2] = { NULL, NULL };
+    size_t lens[2] = { 0, 0 };
+    struct results_compare_t opt = { RESULTS_TEST_THRESHOLD, RESULTS_DEFAULT_ALPHA, { NULL, NULL } };
+
+    fprintf(fp, "\nRESULTS TEST\n");
+    for (int side = 0; side < 2; side++)
+    {
+        struct results_t r;
+        FILE *mem = open_memstream(&streams[side], &lens[side]);
+
+        /* the current file starts with runs of the baseline under an older revision */
+        ResultsStart(&r, mem);
+        snprintf(r.tag, sizeof(r.tag), "\"rev\":\"older\",\"host\":\"test\"");
+        for (int i = 0; mem && side && i < RESULTS_TEST_OLD_RUNS * RESULTS_TEST_SAMPLES; i++)
+        {
+            ResultsRecord(&r, "test/steady_ms", 100.0 + i % RESULTS_TEST_SAMPLES, "ms", RESULTS_LOWER);
+            ResultsRecord(&r, "test/hash_ms", 100.0 + i % RESULTS_TEST_SAMPLES, "ms", RESULTS_LOWER);
+            ResultsRecord(&r, "test/mb_per_s", 500.0 + i % RESULTS_TEST_SAMPLES, "MB/s", RESULTS_HIGHER);
+        }
+        ResultsStart(&r, mem);
+        for (int i = 0; mem && i < RESULTS_TEST_SAMPLES; i++)
+        {
+            /* current side: same build time, 20% faster hashing, 20% less throughput */
+            ResultsRecord(&r, "test/steady_ms", 100.0 + i, "ms", RESULTS_LOWER);
+            ResultsRecord(&r, "test/hash_ms", (side ? 80.0 : 100.0) + i, "ms", RESULTS_LOWER);
+            ResultsRecord(&r, "test/mb_per_s", (side ? 400.0 : 500.0) + i, "MB/s", RESULTS_HIGHER);
+        }
+        if (mem)
+        {
+            fclose(mem);
+        }
+    }
+
+    FILE *baseline = streams[0] ? fmemopen(streams[0], lens[0], "r") : NULL;
+    FILE *current = streams[1] ? fmemopen(streams[1], lens[1], "r") : NULL;
+    if (baseline && current)
+    {
+        ret = ResultsCompare(baseline, current, &opt, fp) == 1;
+    }
+    if (baseline)
+    {
+        fclose(baseline);
+    }
+    if (current)
+    {
+        fclose(current);
+    }
+    free(streams[0]);
+    free(streams[1]);
+
+    baseline = fmemopen(RESULTS_TEST_FEW_BASE, strlen(RESULTS_TEST_FEW_BASE), "r");
+    current = fmemopen(RESULTS_TEST_FEW_CUR, strlen(RESULTS_TEST_FEW_CUR), "r");
+    ret = ret && baseline && current && ResultsCompare(baseline, current, &opt, fp) == 0;
+    if (baseline)
+    {
+        fclose(baseline);
+    }
+    if (current)
+    {
+        fclose(current);
+    }
+
+    fprintf(fp, "%-20s %12s\n", "RESULTS TEST", ret ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static bool run_stats_test(FILE *fp, const char *folder)
+{
+    bool ret = false;
+    struct stats_snapshot_t s;
+    struct timespec t0, t1;
+    struct stat sb;
+    int level_sizes[LEVELS_MAX];
+    char filename[512];
+    char line[STATS_JSON_LEN] = "";
+    char expected[64];
+    long long bytes = 0;
+    long long parents = 0;
+    long long counted = 0;
+    int pipe_fd[2];
+    int n_files = CountFilesInDirectory(folder);
+    int n_levels = NodesNumberLevels(level_sizes, LEVELS_MAX, n_files, 2, PADDING_DUPLICATE);
+
+    for (int i = 0; i < n_files; i++)
+    {
+        snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, folder, i);
+        bytes += stat(filename, &sb) == 0 ? sb.st_size : 0;
+    }
+    for (int l = 1; l < n_levels; l++)
+    {
+        parents += level_sizes[l];
+    }
+
+    if (MerkleTreeBuild(folder, PADDING_DUPLICATE) > 0)
+    {
+        StatsSnapshot(&s);
+        MerkleTreeFree();
+        for (int l = 1; l < s.levels; l++)
+        {
+            counted += s.level_hashes[l];
+        }
+        ret = s.files_total == n_files && s.files_hashed == n_files && s.bytes_read == bytes
+           && s.level_hashes[0] == n_files && s.levels == n_levels && counted == parents
+           && s.errors == 0 && s.tasks_queued == 0 && s.tasks_running == 0 && s.eta_s == 0.0;
+    }
+
+    /* the reporter thread answers the signal sent to the process */
+    if (pipe(pipe_fd) == 0)
+    {
+        struct pollfd pfd = { .fd = pipe_fd[0], .events = POLLIN };
+        ssize_t n = 0;
+
+        ret = StatsReporterStart(pipe_fd[1]) && ret;
+        ret = kill(getpid(), STATS_SIGNAL) == 0 && ret;
+        if (poll(&pfd, 1, STATS_TEST_WAIT_MS) == 1)
+        {
+            n = read(pipe_fd[0], line, sizeof(line) - 1);
+            line[n > 0 ? n : 0] = '\0';
+        }
+        snprintf(expected, sizeof(expected), "\"files_hashed\":%d,", n_files);
+        ret = ret && n > 1 && line[0] == '{' && line[n - 1] == '\n' && strstr(line, expected);
+        /* back to the harness destination */
+        StatsReporterStart(STDERR_FILENO);
+        close(pipe_fd[0]);
+        close(pipe_fd[1]);
+    }
+    else
+    {
+        ret = false;
+    }
+
+    /* cost of an update, uncontended */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < STATS_TEST_UPDATES; i++)
+    {
+        STATS_ADD(errors, 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    fprintf(fp, "%-20s %12s %14s %12s %12s %8s\n",
+        "STATS TEST", "FILES", "BYTES", "PARENTS", "UPDATE (ns)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    fprintf(fp, "%-20s %12d %14lld %12lld %12.2f %8s\n",
+        "build counters", n_files, bytes, parents,
+        timespec_diff_us(&t0, &t1) * 1e3 / STATS_TEST_UPDATES, ret ? "PASS" : "FAIL");
+    fprintf(fp, "SIGUSR1 dump: %s", line[0] ? line : "none\n");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static bool run_dataset_test(FILE *fp)
+{
+    bool ret = true;
+    char dirs[2][64];
+    struct dataset_stats_t st[3] = { 0 };
+    struct merkle_levels_t lv[3] = { 0 };
+    struct dataset_pack_t pack;
+    unsigned char *leaves = malloc((size_t)DATASET_TEST_FILES * SHA256_DIGEST_LENGTH);
+    struct dataset_spec_t spec = {
+        .files = DATASET_TEST_FILES,
+        .seed = DATASET_DEFAULT_SEED,
+        .pack = true,
+        .threads = 1,
+    };
+
+    ret = leaves && SweepParseDist(DATASET_TEST_SIZES, &spec.size);
+    for (int i = 0; i < 2; i++)
+    {
+        snprintf(dirs[i], sizeof(dirs[i]), DATASET_TEST_FORMAT, i);
+        ret = ret && DatasetRemove(dirs[i]);
+    }
+
+    /* first generation, then a reuse of the same specification */
+    ret = ret && DatasetGenerate(dirs[0], &spec, &st[0]) && !st[0].reused;
+    ret = ret && DatasetGenerate(dirs[0], &spec, &st[1]) && st[1].reused;
+    ret = ret && CountFilesInDirectory(dirs[0]) == DATASET_TEST_FILES;
+
+    /* the same bytes whatever the number of writers */
+    spec.pack = false;
+    spec.threads = 2;
+    ret = ret && DatasetGenerate(dirs[1], &spec, &st[2]) && !st[2].reused;
+    ret = ret && st[0].bytes == st[1].bytes && st[0].bytes == st[2].bytes;
+    for (int i = 0; i < 2; i++)
+    {
+        ret = ret && BuildMerkleLevels(dirs[i], 2, PADDING_DUPLICATE, &lv[i]);
+    }
+
+    /* the container holds the leaves of the folders */
+    if (ret && DatasetPackOpen(dirs[0], &pack))
+    {
+        ret = pack.files == DATASET_TEST_FILES;
+        for (long i = 0; ret && i < pack.files; i++)
+        {
+            size_t size;
+            const unsigned char *leaf = DatasetPackLeaf(&pack, i, &size);
+
+            ret = EVP_Digest(leaf, size, leaves + i * SHA256_DIGEST_LENGTH, NULL, EVP_sha256(), NULL);
+        }
+        DatasetPackClose(&pack);
+        ret = ret && LevelsFromLeafHashes(leaves, DATASET_TEST_FILES, 2, PADDING_DUPLICATE, &lv[2]);
+    }
+    else
+    {
+        ret = false;
+    }
+    ret = ret && !HashDiffers(LevelsRoot(&lv[0]), LevelsRoot(&lv[1]))
+              && !HashDiffers(LevelsRoot(&lv[0]), LevelsRoot(&lv[2]));
+
+    for (int i = 0; i < 2; i++)
+    {
+        ret = DatasetRemove(dirs[i]) && access(dirs[i], F_OK) != 0 && ret;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        LevelsFree(&lv[i]);
+    }
+    free(leaves);
+
+    fprintf(fp, "%-20s %12s %14s %12s %12s %10s\n",
+        "DATASET TEST", "FILES", "BYTES", "TIME (ms)", "MB/s", "REUSED");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < 3; i++)
+    {
+        static const char *rows[3] = { "1 writer + pack", "same spec", "2 writers" };
+
+        fprintf(fp, "%-20s %12ld %14lld %12.2f %12.1f %10s\n",
+            rows[i], st[i].files, st[i].bytes, st[i].elapsed_ms,
+            st[i].elapsed_ms > 0.0 ? st[i].bytes / 1e3 / st[i].elapsed_ms : 0.0,
+            st[i].reused ? "yes" : "no");
+    }
+    fprintf(fp, "%-20s %12s\n", "DATASET TEST", ret ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
+
+static void record_metric(const char *group, const char *folder, const char *name, double value,
+                          const char *unit, enum results_better_t better)
+{
+    char metric[RESULTS_NAME_LEN];
+    const char *end = folder + strlen(folder);
+    const char *base;
+
+    /* last component of the folder path, without its trailing slash */
+    while (end > folder && end[-1] == '/')
+    {
+        end--;
+    }
+    base = end;
+    while (base > folder && base[-1] != '/')
+    {
+        base--;
+    }
+    snprintf(metric, sizeof(metric), "%s/%.*s/%s", group, (int)(end - base), base, name);
+    ResultsRecord(&results, metric, value, unit, better);
+}
+
+static bool run_mem_test(FILE *fp)
+{
+    bool ret = false;
+    struct mem_usage_t before, built, after, ctx_before, ctx_after;
+    struct mem_usage_t nodes_before = { 0 }, nodes_after = { 0 };
+    struct mem_usage_t proofs_before = { 0 }, proofs_after = { 0 };
+    struct merkle_levels_t lv = { 0 };
+    struct merkle_rcu_t tree;
+    struct merkle_proof_t proof;
+    long long nodes_held = 0;
+    long long proof_held = 0;
+    bool nodes_ok = false;
+    bool proof_ok = false;
+    unsigned char *leaves = malloc((size_t)MEM_TEST_LEAVES * SHA256_DIGEST_LENGTH);
+    unsigned char parent[SHA256_DIGEST_LENGTH];
+    size_t expected = 0;
+
+    MemUsage(MEM_LEVELS, &before);
+    if (leaves)
+    {
+        fill_random_hashes(leaves, MEM_TEST_LEAVES, 0xC2B2AE3D27D4EB4Full);
+        MemResetPeaks();
+        ret = LevelsFromLeafHashes(leaves, MEM_TEST_LEAVES, 2, PADDING_DUPLICATE, &lv);
+    }
+    if (ret)
+    {
+        /* the arrays, then the block: heap or a mapping of whole pages */
+        expected = lv.n_levels * (sizeof(long) + sizeof(unsigned char *));
+        for (int l = 0; l < lv.n_levels && !lv.map; l++)
+        {
+            expected += (size_t)lv.level_size[l] * SHA256_DIGEST_LENGTH;
+        }
+        expected += lv.map ? lv.map_size : 0;
+
+        MemUsage(MEM_LEVELS, &built);
+        MemReport(fp, "MEM TEST USAGE", MEM_TEST_LEAVES);
+        ret = built.current - before.current == (long long)expected &&
+              built.peak >= built.current && built.live == before.live + 1 &&
+              built.count == before.count + 1;
+
+        /* the EVP backends take a context per level, the direct one none */
+        enum hash_backend_t saved = merkle_config.backend;
+
+        merkle_config.backend = HASH_BACKEND_CTX;
+        MemUsage(MEM_HASH_CTX, &ctx_before);
+        ret = HashLevel(leaves, 1, 2, parent) && ret;
+        MemUsage(MEM_HASH_CTX, &ctx_after);
+        ret = ret && ctx_after.count == ctx_before.count + 1 && ctx_after.live == ctx_before.live;
+        merkle_config.backend = HASH_BACKEND_DIRECT;
+        MemUsage(MEM_HASH_CTX, &ctx_before);
+        ret = HashLevel(leaves, 1, 2, parent) && ret;
+        MemUsage(MEM_HASH_CTX, &ctx_after);
+        ret = ret && ctx_after.count == ctx_before.count;
+        merkle_config.backend = saved;
+
+        /* a snapshot tree and its copies on update, all returned on release */
+        MemUsage(MEM_NODES, &nodes_before);
+        if (RcuFromLevels(&lv, &tree))
+        {
+            int leaf = MEM_TEST_LEAVES / 2;
+
+            nodes_ok = RcuUpdate(&tree, &leaf, leaves, 1);
+            MemUsage(MEM_NODES, &nodes_after);
+            nodes_held = nodes_after.current - nodes_before.current;
+            RcuFree(&tree);
+        }
+        MemUsage(MEM_NODES, &nodes_after);
+        nodes_ok = nodes_ok && nodes_held > 0 && nodes_after.current == nodes_before.current &&
+                   nodes_after.live == nodes_before.live;
+
+        /* the siblings of a proof, one block */
+        MemUsage(MEM_PROOFS, &proofs_before);
+        if (ProofBuild(&lv, MEM_TEST_LEAVES - 1, &proof))
+        {
+            MemUsage(MEM_PROOFS, &proofs_after);
+            proof_held = proofs_after.current - proofs_before.current;
+            proof_ok = proof_held == (long long)(ProofSize(&proof) - PROOF_HEADER_SIZE + 1) &&
+                       proofs_after.live == proofs_before.live + 1;
+            ProofFree(&proof);
+        }
+        MemUsage(MEM_PROOFS, &proofs_after);
+        proof_ok = proof_ok && proofs_after.current == proofs_before.current &&
+                   proofs_after.live == proofs_before.live;
+    }
+    LevelsFree(&lv);
+    MemUsage(MEM_LEVELS, &after);
+    ret = ret && after.current == before.current && after.live == before.live;
+
+    fprintf(fp, "%-20s %12s %14s %14s %12s %8s\n",
+        "MEM TEST", "LEAVES", "LEVELS (B)", "B/LEAF", "AFTER (B)", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    fprintf(fp, "%-20s %12d %14zu %14.2f %12lld %8s\n",
+        "level storage", MEM_TEST_LEAVES, expected, (double)expected / MEM_TEST_LEAVES,
+        after.current - before.current, ret ? "PASS" : "FAIL");
+    fprintf(fp, "%-20s %12d %14lld %14.2f %12lld %8s\n",
+        "snapshot nodes", MEM_TEST_LEAVES, nodes_held, (double)nodes_held / MEM_TEST_LEAVES,
+        nodes_after.current - nodes_before.current, nodes_ok ? "PASS" : "FAIL");
+    fprintf(fp, "%-20s %12d %14lld %14s %12lld %8s\n",
+        "proof siblings", MEM_TEST_LEAVES, proof_held, "-",
+        proofs_after.current - proofs_before.current, proof_ok ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    free(leaves);
+
+    return ret && nodes_ok && proof_ok;
+}
+
+static bool run_tune_test(FILE *fp, const char *folder)
+{
+    static const int buffers[] = { CONFIG_DEFAULT_READ_BUFFER, CONFIG_MAX_READ_BUFFER };
+    struct merkle_config_t saved = merkle_config;
+    struct merkle_config_t tuned;
+    struct tune_options_t opt = {
+        .sample = TUNE_TEST_SAMPLE,
+        .repeats = 1,
+        .level_leaves = TUNE_TEST_LEVEL_LEAVES,
+    };
+    struct tune_result_t result;
+    struct merkle_levels_t lv;
+    unsigned char expected[SHA256_DIGEST_LENGTH];
+    bool loaded = false;
+    bool foreign = false;
+    bool same_roots = true;
+    bool first = true;
+    bool ret;
+    FILE *pf;
+
+    ret = TuneRun(folder, &opt, &result, fp) && ConfigSaveProfile(TUNE_TEST_PROFILE);
+    tuned = merkle_config;
+
+    /* back to the defaults, then the profile */
+    merkle_config = saved;
+    loaded = ret && ConfigLoadProfile(TUNE_TEST_PROFILE) &&
+             merkle_config.threads == tuned.threads &&
+             merkle_config.read_buffer == tuned.read_buffer &&
+             merkle_config.backend == tuned.backend;
+
+    /* the last host line wins: the profile now belongs to another host */
+    merkle_config = saved;
+    pf = fopen(TUNE_TEST_PROFILE, "a");
+    if (pf)
+    {
+        fprintf(pf, "host=%s\n", TUNE_TEST_FOREIGN_HOST);
+        fclose(pf);
+        foreign = !ConfigLoadProfile(TUNE_TEST_PROFILE) &&
+                  merkle_config.read_buffer == saved.read_buffer &&
+                  merkle_config.backend == saved.backend;
+    }
+    unlink(TUNE_TEST_PROFILE);
+
+    /* arity 4: the leaves are hashed without the node tree, the reference
+     * rebuilds the levels from the leaves of the binary tree */
+    if (BuildMerkleLevels(folder, 2, PADDING_DUPLICATE, &lv))
+    {
+        struct merkle_levels_t quad;
+
+        if (LevelsFromLeafHashes(lv.level[0], lv.n_leaves, 4, PADDING_DUPLICATE, &quad))
+        {
+            memcpy(expected, LevelsRoot(&quad), SHA256_DIGEST_LENGTH);
+            first = false;
+            LevelsFree(&quad);
+        }
+        LevelsFree(&lv);
+    }
+    same_roots = !first;
+    for (int b = 0; b < HASH_BACKENDS; b++)
+    {
+        for (size_t k = 0; k < sizeof(buffers) / sizeof(buffers[0]); k++)
+        {
+            merkle_config.backend = (enum hash_backend_t)b;
+            merkle_config.read_buffer = buffers[k];
+            if (BuildMerkleLevels(folder, 4, PADDING_DUPLICATE, &lv))
+            {
+                same_roots = same_roots && (first || !HashDiffers(expected, LevelsRoot(&lv)));
+                memcpy(expected, LevelsRoot(&lv), SHA256_DIGEST_LENGTH);
+                first = false;
+                LevelsFree(&lv);
+            }
+            else
+            {
+                same_roots = false;
+            }
+        }
+    }
+    merkle_config = saved;
+    ret = ret && loaded && foreign && same_roots;
+
+    fprintf(fp, "%-20s %12s %12s %12s %12s %8s\n",
+        "TUNE TEST", "BACKEND", "READ BUFFER", "THREADS", "PROFILE", "RESULT");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    fprintf(fp, "%-20s %12s %12d %12d %12s %8s\n",
+        "calibration", ConfigBackendName(result.backend), result.read_buffer, result.best_threads,
+        loaded && foreign ? "reloaded" : "mismatch", ret ? "PASS" : "FAIL");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+
+    return ret;
+}
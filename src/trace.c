@@ -0,0 +1,216 @@
+/**
+ * @file trace.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Timed spans of the build phases, exported as Chrome trace events
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/trace.h"
+#include "../inc/utils.h"               /* NowNs */
+
+#include <string.h>                     /* strcmp */
+#include <stdatomic.h>                  /* atomic_long */
+#include <unistd.h>                     /* getpid */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Distinct span names and arguments of the summary */
+#define TRACE_SUMMARY_MAX 256
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Recorded span */
+struct trace_event_t {
+    const char *name;
+    long arg;
+    int tid;                            /* 1 for the first thread that recorded */
+    unsigned long start_ns;
+    unsigned long dur_ns;
+};
+
+/* Spans of one name and argument */
+struct trace_total_t {
+    const char *name;
+    long arg;
+    long count;
+    unsigned long total_ns;
+    unsigned long max_ns;
+    unsigned long threads;              /* bit tid % 64 of the recording threads */
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* Spans recorded by all the threads; a slot is claimed with one atomic
+ * add, its pages are only touched when the tracing is compiled in */
+static struct trace_event_t trace_events[TRACE_MAX_EVENTS];
+static atomic_long trace_count;
+
+/* Identifier of the calling thread in the trace, 0 until its first span */
+static _Thread_local int trace_tid;
+static atomic_int trace_threads;
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool TraceEnabled(void)
+{
+#ifdef MERKLE_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+struct trace_span_t TraceBegin(const char *name, long arg)
+{
+    struct trace_span_t span = { name, arg, NowNs() };
+
+    return span;
+}
+
+void TraceEnd(const struct trace_span_t *span)
+{
+    unsigned long end = NowNs();
+    long slot = atomic_fetch_add_explicit(&trace_count, 1, memory_order_relaxed);
+
+    if (trace_tid == 0)
+    {
+        trace_tid = atomic_fetch_add_explicit(&trace_threads, 1, memory_order_relaxed) + 1;
+    }
+    if (slot < TRACE_MAX_EVENTS)
+    {
+        trace_events[slot] = (struct trace_event_t){
+            span->name, span->arg, trace_tid, span->start_ns, end - span->start_ns
+        };
+    }
+}
+
+void TraceReset(void)
+{
+    atomic_store(&trace_count, 0);
+}
+
+bool TraceWriteChrome(const char *path)
+{
+    long n = atomic_load(&trace_count);
+    unsigned long origin = ~0UL;
+    FILE *fp = fopen(path, "w");
+    bool ret = fp != NULL;
+
+    n = n < TRACE_MAX_EVENTS ? n : TRACE_MAX_EVENTS;
+    for (long i = 0; i < n; i++)
+    {
+        origin = trace_events[i].start_ns < origin ? trace_events[i].start_ns : origin;
+    }
+
+    if (ret)
+    {
+        /* complete events ("X"), timestamps in us from the first span */
+        fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+        for (long i = 0; i < n; i++)
+        {
+            const struct trace_event_t *e = &trace_events[i];
+
+            fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"merkle\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                        "\"ts\":%.3f,\"dur\":%.3f",
+                    i ? "," : "", e->name, (int)getpid(), e->tid,
+                    (e->start_ns - origin) / 1e3, e->dur_ns / 1e3);
+            if (e->arg != TRACE_NO_ARG)
+            {
+                fprintf(fp, ",\"args\":{\"level\":%ld}", e->arg);
+            }
+            fprintf(fp, "}");
+        }
+        fprintf(fp, "\n]}\n");
+        ret = fclose(fp) == 0;
+    }
+
+    if (!ret)
+    {
+        perror("TraceWriteChrome: unable to write the trace");
+    }
+
+    return ret;
+}
+
+void TraceSummary(FILE *fp)
+{
+    static struct trace_total_t totals[TRACE_SUMMARY_MAX];
+    long recorded = atomic_load(&trace_count);
+    long n = recorded < TRACE_MAX_EVENTS ? recorded : TRACE_MAX_EVENTS;
+    int n_totals = 0;
+
+    for (long i = 0; i < n; i++)
+    {
+        const struct trace_event_t *e = &trace_events[i];
+        int t = 0;
+
+        while (t < n_totals && (totals[t].arg != e->arg || strcmp(totals[t].name, e->name) != 0))
+        {
+            t++;
+        }
+        if (t == n_totals && n_totals < TRACE_SUMMARY_MAX)
+        {
+            totals[n_totals++] = (struct trace_total_t){ .name = e->name, .arg = e->arg };
+        }
+        if (t < n_totals)
+        {
+            totals[t].count++;
+            totals[t].total_ns += e->dur_ns;
+            totals[t].max_ns = e->dur_ns > totals[t].max_ns ? e->dur_ns : totals[t].max_ns;
+            totals[t].threads |= 1UL << (e->tid % 64);
+        }
+    }
+
+    fprintf(fp, "%-30s %8s %12s %12s %12s %8s\n",
+        "TRACE SPAN", "COUNT", "TOTAL (ms)", "MEAN (us)", "MAX (us)", "THREADS");
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+    for (int t = 0; t < n_totals; t++)
+    {
+        char label[64];
+
+        if (totals[t].arg == TRACE_NO_ARG)
+        {
+            snprintf(label, sizeof(label), "%s", totals[t].name);
+        }
+        else
+        {
+            snprintf(label, sizeof(label), "%s [%ld]", totals[t].name, totals[t].arg);
+        }
+        fprintf(fp, "%-30s %8ld %12.3f %12.2f %12.2f %8d\n",
+            label, totals[t].count, totals[t].total_ns / 1e6,
+            totals[t].total_ns / 1e3 / totals[t].count, totals[t].max_ns / 1e3,
+            __builtin_popcountl(totals[t].threads));
+    }
+    if (recorded > n)
+    {
+        fprintf(fp, "%ld spans dropped beyond %d\n", recorded - n, TRACE_MAX_EVENTS);
+    }
+    fprintf(fp, "--------------------------------------------------------------------------------------------\n");
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+/* None */
@@ -0,0 +1,361 @@
+/**
+ * @file tune.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Calibration of the hash backend, read buffer and threads on a dataset sample
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/tune.h"
+#include "../inc/merkleTree.h"          /* LEAF_FILE_FORMAT */
+#include "../inc/levels.h"              /* LevelsFromLeafHashes */
+#include "../inc/parallel.h"            /* ParallelFor */
+#include "../inc/mem.h"                 /* MemHashCtxNew */
+#include "../inc/utils.h"               /* NowNs, Median */
+
+#include <stdlib.h>                     /* malloc */
+#include <string.h>                     /* memcpy, memcmp */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Leaf files per task of the parallel probe */
+#define TUNE_CHUNK 64
+
+/* Gain a candidate needs over the best one before it */
+#define TUNE_MIN_GAIN 0.03
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* Sample hashed by the probes */
+struct tune_probe_t {
+    const char *folder;
+    int files;
+    unsigned char *hashes;              /* files hashes, rewritten by every run */
+    EVP_MD_CTX *ctx[PARALLEL_MAX_THREADS]; /* one per worker */
+    int n_ctx;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Hashes a chunk of the sample with the context of the worker.
+ */
+static bool HashSampleTask(void *ctx, int task, int worker);
+
+/**
+ * @brief Hashes the whole sample on the calling thread.
+ */
+static bool HashSample(struct tune_probe_t *p);
+
+/**
+ * @brief Sets the contexts up for the SHA-256 of merkle_config.backend.
+ */
+static bool InitContexts(struct tune_probe_t *p);
+
+/**
+ * @brief Builds the levels of leaf hashes and returns the root.
+ */
+static bool BuildRoot(const unsigned char *leaves, int n_leaves,
+                      unsigned char root[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Lists the thread counts to probe: powers of two, then the online CPUs.
+ */
+static void CandidateThreads(struct tune_result_t *result);
+
+/**
+ * @brief Returns the index of the best candidate, see TUNE_MIN_GAIN.
+ */
+static int Best(const double *ms, int n);
+
+/**
+ * @brief Prints the measurements and the chosen settings.
+ */
+static void Report(FILE *out, const struct tune_result_t *result);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* Read buffers probed, the default first */
+static const int read_buffers[TUNE_READ_BUFFERS] = {
+    CONFIG_DEFAULT_READ_BUFFER, 16384, CONFIG_MAX_READ_BUFFER
+};
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool TuneRun(const char *folder, const struct tune_options_t *opt,
+             struct tune_result_t *result, FILE *out)
+{
+    struct tune_options_t o = {
+        .sample = TUNE_DEFAULT_SAMPLE,
+        .repeats = TUNE_DEFAULT_REPEATS,
+        .level_leaves = TUNE_DEFAULT_LEVEL_LEAVES,
+    };
+    struct merkle_config_t saved = merkle_config;
+    struct tune_probe_t probe = { .folder = folder };
+    unsigned char *reference = NULL;    /* hashes of the first pass */
+    unsigned char *leaves = NULL;       /* the reference, repeated to level_leaves */
+    unsigned char expected[SHA256_DIGEST_LENGTH];
+    unsigned char root[SHA256_DIGEST_LENGTH];
+    double runs[TUNE_MAX_REPEATS];
+    double start;
+    bool ret;
+
+    o = opt ? *opt : o;
+    o.repeats = o.repeats < 1 ? 1 : o.repeats > TUNE_MAX_REPEATS ? TUNE_MAX_REPEATS : o.repeats;
+    memset(result, 0, sizeof(*result));
+    probe.files = CountFilesInDirectory(folder);
+    probe.files = probe.files > o.sample ? o.sample : probe.files;
+    result->files = probe.files;
+    CandidateThreads(result);
+    probe.n_ctx = result->threads[result->n_threads - 1];
+
+    ret = probe.files > 0 && o.level_leaves > 0;
+    if (ret)
+    {
+        probe.hashes = malloc((size_t)probe.files * SHA256_DIGEST_LENGTH);
+        reference = malloc((size_t)probe.files * SHA256_DIGEST_LENGTH);
+        leaves = malloc((size_t)o.level_leaves * SHA256_DIGEST_LENGTH);
+        ret = probe.hashes && reference && leaves;
+    }
+    for (int w = 0; w < probe.n_ctx && ret; w++)
+    {
+        probe.ctx[w] = MemHashCtxNew();
+        ret = probe.ctx[w] != NULL;
+    }
+
+    /* first pass with the defaults: warms the cache, gives the reference */
+    merkle_config.backend = HASH_BACKEND_CTX;
+    merkle_config.read_buffer = CONFIG_DEFAULT_READ_BUFFER;
+    merkle_config.threads = 1;
+    ret = ret && InitContexts(&probe) && HashSample(&probe);
+    if (ret)
+    {
+        memcpy(reference, probe.hashes, (size_t)probe.files * SHA256_DIGEST_LENGTH);
+        for (int i = 0; i < o.level_leaves; i++)
+        {
+            memcpy(leaves + (size_t)i * SHA256_DIGEST_LENGTH,
+                   reference + (size_t)(i % probe.files) * SHA256_DIGEST_LENGTH,
+                   SHA256_DIGEST_LENGTH);
+        }
+        for (int i = 0; i < probe.files; i++)
+        {
+            char filename[512];
+            struct stat sb;
+
+            snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, folder, i);
+            result->bytes += stat(filename, &sb) == 0 ? sb.st_size : 0;
+        }
+        ret = BuildRoot(leaves, o.level_leaves, expected);
+    }
+
+    /* hash backends: the leaf files, then the parents of a level, on one
+     * thread, as a build hashes both with the backend */
+    for (int b = 0; b < HASH_BACKENDS && ret; b++)
+    {
+        merkle_config.backend = (enum hash_backend_t)b;
+        merkle_config.threads = 1;
+        ret = InitContexts(&probe);
+        for (int r = 0; r < o.repeats && ret; r++)
+        {
+            start = NowNs() / 1e6;
+            ret = HashSample(&probe) && BuildRoot(leaves, o.level_leaves, root);
+            runs[r] = NowNs() / 1e6 - start;
+            ret = ret && memcmp(root, expected, SHA256_DIGEST_LENGTH) == 0 &&
+                  memcmp(probe.hashes, reference, (size_t)probe.files * SHA256_DIGEST_LENGTH) == 0;
+        }
+        result->backend_ms[b] = ret ? Median(runs, o.repeats) : 0.0;
+    }
+    result->backend = (enum hash_backend_t)Best(result->backend_ms, HASH_BACKENDS);
+    merkle_config.backend = result->backend;
+    ret = ret && InitContexts(&probe);
+
+    /* read buffers: the leaf files, on one thread */
+    for (int k = 0; k < TUNE_READ_BUFFERS && ret; k++)
+    {
+        result->read_buffers[k] = read_buffers[k];
+        merkle_config.read_buffer = read_buffers[k];
+        for (int r = 0; r < o.repeats && ret; r++)
+        {
+            start = NowNs() / 1e6;
+            ret = HashSample(&probe);
+            runs[r] = NowNs() / 1e6 - start;
+            ret = ret && memcmp(probe.hashes, reference,
+                                (size_t)probe.files * SHA256_DIGEST_LENGTH) == 0;
+        }
+        result->read_ms[k] = ret ? Median(runs, o.repeats) : 0.0;
+    }
+    result->read_buffer = result->read_buffers[Best(result->read_ms, TUNE_READ_BUFFERS)];
+    merkle_config.read_buffer = result->read_buffer;
+
+    /* thread counts: the leaf files in parallel, then the levels */
+    for (int k = 0; k < result->n_threads && ret; k++)
+    {
+        int n_tasks = (probe.files + TUNE_CHUNK - 1) / TUNE_CHUNK;
+
+        merkle_config.threads = result->threads[k];
+        for (int r = 0; r < o.repeats && ret; r++)
+        {
+            start = NowNs() / 1e6;
+            ret = ParallelFor(n_tasks, result->threads[k], HashSampleTask, &probe, NULL) &&
+                  BuildRoot(leaves, o.level_leaves, root);
+            runs[r] = NowNs() / 1e6 - start;
+            ret = ret && memcmp(root, expected, SHA256_DIGEST_LENGTH) == 0 &&
+                  memcmp(probe.hashes, reference, (size_t)probe.files * SHA256_DIGEST_LENGTH) == 0;
+        }
+        result->threads_ms[k] = ret ? Median(runs, o.repeats) : 0.0;
+    }
+    result->best_threads = result->threads[Best(result->threads_ms, result->n_threads)];
+    merkle_config.threads = result->best_threads;
+
+    for (int w = 0; w < probe.n_ctx; w++)
+    {
+        MemHashCtxFree(probe.ctx[w]);
+    }
+    free(probe.hashes);
+    free(reference);
+    free(leaves);
+
+    if (ret && out)
+    {
+        Report(out, result);
+    }
+    if (!ret)
+    {
+        fprintf(stderr, "TuneRun: no leaves in %s, I/O error or differing hashes\n", folder);
+        merkle_config = saved;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool HashSampleTask(void *ctx, int task, int worker)
+{
+    struct tune_probe_t *p = ctx;
+    char filename[512];
+    int first = task * TUNE_CHUNK;
+    int last = first + TUNE_CHUNK < p->files ? first + TUNE_CHUNK : p->files;
+    bool ret = true;
+
+    for (int i = first; i < last && ret; i++)
+    {
+        snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, p->folder, i);
+        ret = HashFileBackend(p->ctx[worker], filename, p->hashes + (size_t)i * SHA256_DIGEST_LENGTH);
+    }
+
+    return ret;
+}
+
+static bool HashSample(struct tune_probe_t *p)
+{
+    bool ret = true;
+
+    for (int task = 0; task * TUNE_CHUNK < p->files && ret; task++)
+    {
+        ret = HashSampleTask(p, task, 0);
+    }
+
+    return ret;
+}
+
+static bool InitContexts(struct tune_probe_t *p)
+{
+    bool ret = true;
+
+    for (int w = 0; w < p->n_ctx && ret; w++)
+    {
+        ret = EVP_DigestInit_ex(p->ctx[w], HashBackendMd(), NULL);
+    }
+
+    return ret;
+}
+
+static bool BuildRoot(const unsigned char *leaves, int n_leaves,
+                      unsigned char root[SHA256_DIGEST_LENGTH])
+{
+    struct merkle_levels_t lv;
+    bool ret = LevelsFromLeafHashes(leaves, n_leaves, 2, PADDING_DUPLICATE, &lv);
+
+    if (ret)
+    {
+        memcpy(root, LevelsRoot(&lv), SHA256_DIGEST_LENGTH);
+        LevelsFree(&lv);
+    }
+
+    return ret;
+}
+
+static void CandidateThreads(struct tune_result_t *result)
+{
+    int cpus = ParallelDefaultThreads();
+
+    result->n_threads = 0;
+    for (int n = 1; n < cpus && result->n_threads < TUNE_MAX_THREADS - 1; n *= 2)
+    {
+        result->threads[result->n_threads++] = n;
+    }
+    result->threads[result->n_threads++] = cpus;
+}
+
+static int Best(const double *ms, int n)
+{
+    int ret = 0;
+
+    for (int i = 1; i < n; i++)
+    {
+        if (ms[i] < ms[ret] * (1.0 - TUNE_MIN_GAIN))
+        {
+            ret = i;
+        }
+    }
+
+    return ret;
+}
+
+static void Report(FILE *out, const struct tune_result_t *result)
+{
+    fprintf(out, "%-20s %12s %14s %12s %8s\n",
+        "CALIBRATION", "CANDIDATE", "MEDIAN (ms)", "MB/s", "CHOSEN");
+    fprintf(out, "--------------------------------------------------------------------------------------------\n");
+    for (int b = 0; b < HASH_BACKENDS; b++)
+    {
+        fprintf(out, "%-20s %12s %14.3f %12s %8s\n", "hash backend", ConfigBackendName(b),
+                result->backend_ms[b], "-", b == (int)result->backend ? "*" : "");
+    }
+    for (int k = 0; k < TUNE_READ_BUFFERS; k++)
+    {
+        fprintf(out, "%-20s %12d %14.3f %12.1f %8s\n", "read buffer", result->read_buffers[k],
+                result->read_ms[k], result->bytes / 1e3 / result->read_ms[k],
+                result->read_buffers[k] == result->read_buffer ? "*" : "");
+    }
+    for (int k = 0; k < result->n_threads; k++)
+    {
+        fprintf(out, "%-20s %12d %14.3f %12.1f %8s\n", "threads", result->threads[k],
+                result->threads_ms[k], result->bytes / 1e3 / result->threads_ms[k],
+                result->threads[k] == result->best_threads ? "*" : "");
+    }
+    fprintf(out, "--------------------------------------------------------------------------------------------\n");
+    fprintf(out, "%d leaf files, %lld bytes: backend=%s read_buffer=%d threads=%d\n",
+            result->files, result->bytes, ConfigBackendName(result->backend),
+            result->read_buffer, result->best_threads);
+}
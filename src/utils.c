@@ -7,7 +7,20 @@
  * INCLUDE FILES
  *-----------------------------------*/
 
+ #define _GNU_SOURCE                    /* getdents64 */
+ #define OPENSSL_SUPPRESS_DEPRECATED    /* SHA256_Init(): the allocation-free SHA-256 */
  #include "../inc/utils.h"
+ #include "../inc/stats.h"              /* STATS_ADD */
+ #include "../inc/mem.h"                /* MEM_HASH_CTX accounting */
+ #include "../inc/config.h"             /* read buffer and hash backend */
+
+ #include <fcntl.h>                     /* open */
+ #include <pthread.h>                   /* pthread_once */
+ #include <stdlib.h>                    /* qsort */
+ #include <time.h>                      /* clock_gettime */
+ #include <unistd.h>                    /* read, write, pwrite, close */
+ #include <errno.h>                     /* EINTR, ENOTSOCK */
+ #include <sys/socket.h>                /* send */
 
 /*-----------------------------------*
  * PUBLIC VARIABLE DEFINITIONS
@@ -17,7 +30,7 @@
 /*-----------------------------------*
  * PRIVATE DEFINES
  *-----------------------------------*/
-#define BUFFER_SIZE_FILE_READ 4096      /* File reading buffer size (4KB) */
+#define DIRENT_BUFFER_SIZE 8192         /* Directory entries read at once */
 
 /*-----------------------------------*
  * PRIVATE MACROS
@@ -32,66 +45,82 @@
 /*-----------------------------------*
  * PRIVATE FUNCTION PROTOTYPES
  *-----------------------------------*/
-/* None */
+
+/**
+ * @brief Fetches the SHA-256 implementation of HASH_BACKEND_FETCHED, once.
+ */
+static void FetchMd(void);
+
+/**
+ * @brief Hashes a file with either a digest context or a low-level SHA-256 state.
+ *
+ * @param mdctx Digest context already set up for SHA-256, or NULL.
+ * @param sha Low-level state, used when mdctx is NULL.
+ * @param filename Path to the file.
+ * @param output Buffer to store the 32-byte hash result.
+ * @retval true  Success.
+ * @retval false Error opening or reading the file.
+ */
+static bool HashFileWith(EVP_MD_CTX *mdctx, SHA256_CTX *sha, const char *filename,
+                         unsigned char output[SHA256_DIGEST_LENGTH]);
 
 /*-----------------------------------*
  * PRIVATE VARIABLES
  *-----------------------------------*/
-/* None */
+/* Implementation of HASH_BACKEND_FETCHED, kept for the process */
+static pthread_once_t fetch_once = PTHREAD_ONCE_INIT;
+static EVP_MD *fetched_md = NULL;
 
 /*-----------------------------------*
  * PUBLIC FUNCTION DEFINITIONS
  *-----------------------------------*/
-bool HashFile(const char *filename, unsigned char output[SHA256_DIGEST_LENGTH])
+const EVP_MD *HashBackendMd(void)
 {
-    bool ret = false;  /* Return status, initialized to false */
+    const EVP_MD *ret = EVP_sha256();
 
-    /* Open file in binary mode for reading */
-    FILE *file = fopen(filename, "rb");
-    if (file)
+    if (merkle_config.backend == HASH_BACKEND_FETCHED)
     {
-        /* Create a hashing context for EVP (Message Digest) */
-        EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
-        if (mdctx)
-        {
-            /* Get SHA-256 digest method */
-            const EVP_MD *md = EVP_sha256();
-            if (md)
-            {
-                /* Initialize SHA-256 hashing process */
-                EVP_DigestInit_ex(mdctx, md, NULL);
-
-                /* Declare a buffer to read the file in chunks */
-                unsigned char buffer[BUFFER_SIZE_FILE_READ];
-                size_t bytesRead;
-
-                /* Read file in chunks and feed data to the hashing function */
-                while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
-                {
-                    EVP_DigestUpdate(mdctx, buffer, bytesRead);
-                }
+        pthread_once(&fetch_once, FetchMd);
+        ret = fetched_md ? fetched_md : ret;
+    }
 
-                /* Finalize the hashing process and store result in 'output' */
-                EVP_DigestFinal_ex(mdctx, output, NULL);
+    return ret;
+}
 
-                /* Free the hashing context */
-                EVP_MD_CTX_free(mdctx);
+bool HashFile(const char *filename, unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    bool ret = false;
 
-                /* Indicate success */
-                ret = true;
-            }
-        }
-        /* Close the file before returning */
-        fclose(file);
-    }
-    else
+    /* Create a hashing context for EVP (Message Digest) */
+    EVP_MD_CTX *mdctx = MemHashCtxNew();
+    if (mdctx)
     {
-        perror("HashFile: Unable to open file");
-        printf("file failed: %s\n", filename);
+        ret = EVP_DigestInit_ex(mdctx, HashBackendMd(), NULL) &&
+              HashFileCtx(mdctx, filename, output);
+        /* Free the hashing context */
+        MemHashCtxFree(mdctx);
     }
 
+    return ret;
+}
 
-    return ret; /* Return whether the hashing was successful */
+bool HashFileCtx(EVP_MD_CTX *mdctx, const char *filename, unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    return HashFileWith(mdctx, NULL, filename, output);
+}
+
+bool HashFileDirect(const char *filename, unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    SHA256_CTX sha;
+
+    return HashFileWith(NULL, &sha, filename, output);
+}
+
+bool HashFileBackend(EVP_MD_CTX *mdctx, const char *filename,
+                     unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    return merkle_config.backend == HASH_BACKEND_DIRECT ? HashFileDirect(filename, output)
+                                                        : HashFileCtx(mdctx, filename, output);
 }
 
 bool HashTwoHashes(const unsigned char hashA[SHA256_DIGEST_LENGTH], 
@@ -100,32 +129,149 @@ bool HashTwoHashes(const unsigned char hashA[SHA256_DIGEST_LENGTH],
 {
     bool ret = false;
 
+    /* Create a new message digest context */
+    EVP_MD_CTX *mdctx = MemHashCtxNew();
+    if (mdctx)
+    {
+        ret = EVP_DigestInit_ex(mdctx, HashBackendMd(), NULL) &&
+              HashTwoHashesCtx(mdctx, hashA, hashB, output);
+        /* Free allocated memory */
+        MemHashCtxFree(mdctx);
+    }
+    return ret;
+}
+
+bool HashTwoHashesCtx(EVP_MD_CTX *mdctx,
+                      const unsigned char hashA[SHA256_DIGEST_LENGTH],
+                      const unsigned char hashB[SHA256_DIGEST_LENGTH],
+                      unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    bool ret = false;
+    unsigned int output_length = 0;  // Store actual hash length
+
     /* Buffer to hold concatenated hashes */
     unsigned char combined[2 * SHA256_DIGEST_LENGTH];
     /* Copy first and second hash into buffer */
     memcpy(combined, hashA, SHA256_DIGEST_LENGTH);
     memcpy(combined + SHA256_DIGEST_LENGTH, hashB, SHA256_DIGEST_LENGTH);
-    /* Create a new message digest context */
-    EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
-    if (mdctx)
+
+    /* the digest is already set, no lookup of the implementation */
+    if (EVP_DigestInit_ex(mdctx, NULL, NULL) &&
+        EVP_DigestUpdate(mdctx, combined, sizeof(combined)) &&
+        EVP_DigestFinal_ex(mdctx, output, &output_length))
     {
-        unsigned int output_length = 0;  // Store actual hash length
+        /* Ensure correct hash length */
+        ret = (output_length == SHA256_DIGEST_LENGTH);
+    }
+
+    return ret;
+}
+
+void HashTwoHashesDirect(const unsigned char hashA[SHA256_DIGEST_LENGTH],
+                         const unsigned char hashB[SHA256_DIGEST_LENGTH],
+                         unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    SHA256_CTX sha;
+
+    SHA256_Init(&sha);
+    SHA256_Update(&sha, hashA, SHA256_DIGEST_LENGTH);
+    SHA256_Update(&sha, hashB, SHA256_DIGEST_LENGTH);
+    SHA256_Final(output, &sha);
+}
+
+bool HashTwoHashesBackend(EVP_MD_CTX *mdctx,
+                          const unsigned char hashA[SHA256_DIGEST_LENGTH],
+                          const unsigned char hashB[SHA256_DIGEST_LENGTH],
+                          unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    bool ret = true;
 
-        if (EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL) &&
-            EVP_DigestUpdate(mdctx, combined, sizeof(combined)) &&
-            EVP_DigestFinal_ex(mdctx, output, &output_length))
+    switch (merkle_config.backend)
+    {
+        case HASH_BACKEND_DIRECT:
+            HashTwoHashesDirect(hashA, hashB, output);
+            break;
+        case HASH_BACKEND_ONESHOT:
         {
-            /* Ensure correct hash length */
-            ret = (output_length == SHA256_DIGEST_LENGTH);
+            unsigned char combined[2 * SHA256_DIGEST_LENGTH];
+
+            memcpy(combined, hashA, SHA256_DIGEST_LENGTH);
+            memcpy(combined + SHA256_DIGEST_LENGTH, hashB, SHA256_DIGEST_LENGTH);
+            ret = EVP_Digest(combined, sizeof(combined), output, NULL, EVP_sha256(), NULL);
+            break;
         }
+        default:
+            ret = HashTwoHashesCtx(mdctx, hashA, hashB, output);
+            break;
+    }
 
-        /* Free allocated memory */
-        EVP_MD_CTX_free(mdctx);
+    return ret;
+}
+
+bool HashChildren(const unsigned char *children, int count,
+                  unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    return HashLevel(children, 1, count, output);
+}
+
+bool HashLevel(const unsigned char *children, int n_parents, int arity,
+               unsigned char *parents)
+{
+    bool ret = false;
+    size_t group = (size_t)arity * SHA256_DIGEST_LENGTH;
+    unsigned int output_length = SHA256_DIGEST_LENGTH;
+
+    if (merkle_config.backend == HASH_BACKEND_DIRECT)
+    {
+        /* low-level state on the stack: nothing allocated per parent */
+        SHA256_CTX sha;
+
+        for (int i = 0; i < n_parents; i++)
+        {
+            SHA256_Init(&sha);
+            SHA256_Update(&sha, children + i * group, group);
+            SHA256_Final(parents + (size_t)i * SHA256_DIGEST_LENGTH, &sha);
+        }
+        ret = true;
+    }
+    else if (merkle_config.backend == HASH_BACKEND_ONESHOT)
+    {
+        /* no context to keep: EVP_Digest() sets one up per parent */
+        ret = true;
+        for (int i = 0; i < n_parents && ret; i++)
+        {
+            ret = EVP_Digest(children + i * group, group,
+                             parents + (size_t)i * SHA256_DIGEST_LENGTH, &output_length,
+                             EVP_sha256(), NULL) &&
+                  output_length == SHA256_DIGEST_LENGTH;
+        }
+    }
+    else
+    {
+        /* One message digest context for the whole level */
+        EVP_MD_CTX *mdctx = MemHashCtxNew();
+        const EVP_MD *md = HashBackendMd();
+        if (mdctx)
+        {
+            ret = true;
+            for (int i = 0; i < n_parents && ret; i++)
+            {
+                /* the children of a parent are contiguous */
+                ret = EVP_DigestInit_ex(mdctx, md, NULL) &&
+                      EVP_DigestUpdate(mdctx, children + i * group, group) &&
+                      EVP_DigestFinal_ex(mdctx, parents + (size_t)i * SHA256_DIGEST_LENGTH,
+                                         &output_length) &&
+                      output_length == SHA256_DIGEST_LENGTH;
+            }
+
+            /* Free allocated memory */
+            MemHashCtxFree(mdctx);
+        }
     }
     return ret;
 }
 
-bool HashNodeFromChildren(struct node_t** node)
+bool HashNodeFromChildren(EVP_MD_CTX *mdctx, struct node_t** node)
 {
     bool ret = false;
 
@@ -139,18 +285,18 @@ bool HashNodeFromChildren(struct node_t** node)
     {
         /* copy the left brother's hash */
         memcpy((*node)->hash, (*node)->parent->lchild->hash, SHA256_DIGEST_LENGTH);
+        ret = true;
     }
-    /* If ONLY right node is null something has gone
-    terribly wrong */
+    /* If ONLY right node is null the left child is alone
+    (unpadded tree): it moves up without hashing */
     else if ((*node)->rchild == NULL)
     {
-        fprintf(stderr, "HashNodeFromChildren: Rchild == NULL ");
+        memcpy((*node)->hash, (*node)->lchild->hash, SHA256_DIGEST_LENGTH);
+        ret = true;
     }
-    else if (HashTwoHashes((*node)->lchild->hash,
-                           (*node)->rchild->hash,
-                           (*node)->hash))
+    else
     {
-        ret = true;
+        ret = HashTwoHashesBackend(mdctx, (*node)->lchild->hash, (*node)->rchild->hash, (*node)->hash);
     }
 
     return ret;
@@ -158,28 +304,31 @@ bool HashNodeFromChildren(struct node_t** node)
 
 int CountFilesInDirectory(const char *file_name)
 {
-    /* open the directory */
-    DIR *dir = opendir(file_name);
+    /* open the directory, read its raw entries (no DIR stream to allocate) */
+    int fd = open(file_name, O_RDONLY | O_DIRECTORY);
 
     /* files counter */
     int count = 0;
-    if (dir)
+    if (fd >= 0)
     {
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL)
+        char buffer[DIRENT_BUFFER_SIZE];
+        ssize_t n_read;
+
+        while ((n_read = getdents64(fd, buffer, sizeof(buffer))) > 0)
         {
-            // Skip "." and ".." entries.
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            for (ssize_t pos = 0; pos < n_read; )
             {
-                continue;
-            }
+                struct dirent64 *entry = (struct dirent64 *)(buffer + pos);
 
-            // If d_type is available and indicates a regular file.
-            if (entry->d_type == DT_REG)
-            {
-                count++;
+                /* "." and ".." are directories, only regular files count */
+                if (entry->d_type == DT_REG)
+                {
+                    count++;
+                }
+                pos += entry->d_reclen;
             }
         }
+        close(fd);
     }
 
     return count;
@@ -189,10 +338,38 @@ int NodesNumberArrayFromFile(int **nodes_number_arr, const char *folder)
 {
     int n_files = CountFilesInDirectory(folder);
     printf("\nN FILES: %d in folder %s\n", n_files, folder);
+
+    return NodesNumberArray(nodes_number_arr, n_files, 2, PADDING_DUPLICATE);
+}
+
+int NodesNumberArray(int **nodes_number_arr, int n_files, int arity,
+                     enum merkle_padding_t padding)
+{
+    int ret = 0;
+    int n_row = NodesNumberLevels(NULL, 0, n_files, arity, padding);
+
+    if (n_row > 0)
+    {
+        /* allocate the array of ints */
+        *nodes_number_arr = malloc(n_row * sizeof(int));
+        /* check if malloc succeeded */
+        if (*nodes_number_arr)
+        {
+            /* set return to total number of rows */
+            ret = NodesNumberLevels(*nodes_number_arr, n_row, n_files, arity, padding);
+        }
+    }
+
+    return ret;
+}
+
+int NodesNumberLevels(int *nodes_number_arr, int max_levels, int n_files, int arity,
+                      enum merkle_padding_t padding)
+{
     int ret = 0;
     int n_row = 0;
 
-    if (n_files >= 1)
+    if (n_files >= 1 && arity >= 2)
     {
         int n_nodes = n_files;
 
@@ -200,38 +377,34 @@ int NodesNumberArrayFromFile(int **nodes_number_arr, const char *folder)
         while (n_nodes > 1)
         {
             n_row++;
-            n_nodes = (n_nodes + 1) / 2;  // if odd, round up before halving
-            // printf("n_row = %d, n_nodes = %d\n", n_row, n_nodes);
+            n_nodes = (n_nodes + arity - 1) / arity;  // round up before dividing
         }
         /* account for the root node */
         n_row++;
-    
-        /* allocate the array of ints */
-        *nodes_number_arr = malloc(n_row * sizeof(int));
-        /* check if malloc succeeded */
-        if (*nodes_number_arr)
+        /* set return to total number of rows */
+        ret = n_row;
+    }
+
+    if (ret > 0 && nodes_number_arr)
+    {
+        ret = ret <= max_levels ? ret : 0;
+        /* restore the nodes counter */
+        int n_nodes = n_files;
+        /* put in the nodes number for each row */
+        for (int i = 0; i < ret; i++)
         {
-            /* set return to total number of rows */
-            ret = n_row;
-            /* restore the nodes counter */
-            n_nodes = n_files;
-            /* put in the nodes number for each row */
-            for (int i = 0; i < n_row; i++)
+            /* pad the row to a multiple of the arity */
+            if(padding == PADDING_DUPLICATE && n_nodes % arity && n_nodes != 1)
             {
-                
-                /* double the nodes number if odd */
-                if(n_nodes & 1 && n_nodes != 1)
-                {
-                    n_nodes++;
-                }
-                /* assign n_nodes to the array */
-                (*nodes_number_arr)[i] = n_nodes;
-                /* halve the nodes counter */
-                n_nodes /= 2;
+                n_nodes += arity - n_nodes % arity;
             }
+            /* assign n_nodes to the array */
+            nodes_number_arr[i] = n_nodes;
+            /* divide the nodes counter, a partial group still has a parent */
+            n_nodes = (n_nodes + arity - 1) / arity;
         }
     }
-    
+
     return ret;
 }
 
@@ -252,6 +425,116 @@ bool isValidFile(const char *filename)
     return ret;
 }
 
+bool WriteAll(int fd, const void *buf, size_t len, off_t offset, size_t *bytes)
+{
+    const unsigned char *ptr = buf;
+    bool ret = true;
+
+    while (ret && len > 0)
+    {
+        ssize_t n;
+
+        if (offset >= 0)
+        {
+            n = pwrite(fd, ptr, len, offset);
+        }
+        else
+        {
+            /* a peer gone is an error to report, not a SIGPIPE */
+            n = send(fd, ptr, len, MSG_NOSIGNAL);
+            if (n < 0 && errno == ENOTSOCK)
+            {
+                n = write(fd, ptr, len);
+            }
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        ret = n > 0;
+        if (ret)
+        {
+            ptr += n;
+            len -= (size_t)n;
+            offset = offset < 0 ? offset : offset + n;
+            if (bytes)
+            {
+                *bytes += (size_t)n;
+            }
+        }
+        else
+        {
+            perror("WriteAll");
+        }
+    }
+
+    return ret;
+}
+
+bool ReadAll(int fd, void *buf, size_t len, size_t *bytes)
+{
+    unsigned char *ptr = buf;
+    bool ret = true;
+
+    while (ret && len > 0)
+    {
+        ssize_t n = read(fd, ptr, len);
+
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        /* end of stream before len bytes: a failure too */
+        ret = n > 0;
+        if (ret)
+        {
+            ptr += n;
+            len -= (size_t)n;
+            if (bytes)
+            {
+                *bytes += (size_t)n;
+            }
+        }
+    }
+
+    return ret;
+}
+
+unsigned long NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long)ts.tv_sec * 1000000000UL + (unsigned long)ts.tv_nsec;
+}
+
+double Median(double *v, int n)
+{
+    qsort(v, n, sizeof(double), CompareDoubles);
+
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+int CompareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+uint64_t SplitMix(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+
+    return x ^ (x >> 31);
+}
+
 /* ######################################################################
  * PRINT FUNCTIONS 
 ###################################################################### */
@@ -358,4 +641,60 @@ void pIntArr(int *arr, int size)
 /*-----------------------------------*
  * PRIVATE FUNCTION DEFINITIONS
  *-----------------------------------*/
-/* None */
+static void FetchMd(void)
+{
+    fetched_md = EVP_MD_fetch(NULL, "SHA256", NULL);
+    if (!fetched_md)
+    {
+        fprintf(stderr, "HashBackendMd: unable to fetch SHA256, using EVP_sha256()\n");
+    }
+}
+
+static bool HashFileWith(EVP_MD_CTX *mdctx, SHA256_CTX *sha, const char *filename,
+                         unsigned char output[SHA256_DIGEST_LENGTH])
+{
+    bool ret = false;  /* Return status, initialized to false */
+
+    /* Open the file without stdio: no FILE nor stream buffer to allocate */
+    int fd = open(filename, O_RDONLY);
+    if (fd >= 0)
+    {
+        /* Declare a buffer to read the file in chunks, of the configured size */
+        unsigned char buffer[CONFIG_MAX_READ_BUFFER];
+        size_t chunk = merkle_config.read_buffer > 0 && merkle_config.read_buffer < CONFIG_MAX_READ_BUFFER
+                     ? (size_t)merkle_config.read_buffer : sizeof(buffer);
+        ssize_t bytesRead = 0;
+        long long total = 0;
+
+        /* Restart the SHA-256 hashing process, the digest is already set */
+        ret = mdctx ? EVP_DigestInit_ex(mdctx, NULL, NULL) : SHA256_Init(sha);
+
+        /* Read file in chunks and feed data to the hashing function */
+        while (ret && (bytesRead = read(fd, buffer, chunk)) > 0)
+        {
+            ret = mdctx ? EVP_DigestUpdate(mdctx, buffer, bytesRead)
+                        : SHA256_Update(sha, buffer, bytesRead);
+            total += bytesRead;
+        }
+
+        /* Finalize the hashing process and store result in 'output' */
+        ret = ret && bytesRead == 0 &&
+              (mdctx ? EVP_DigestFinal_ex(mdctx, output, NULL) : SHA256_Final(output, sha));
+
+        /* one update per file for the live counters */
+        STATS_ADD(bytes_read, total);
+        STATS_ADD(files_hashed, ret);
+        STATS_ADD(errors, !ret);
+
+        /* Close the file before returning */
+        close(fd);
+    }
+    else
+    {
+        STATS_ADD(errors, 1);
+        perror("HashFile: Unable to open file");
+        printf("file failed: %s\n", filename);
+    }
+
+    return ret; /* Return whether the hashing was successful */
+}
@@ -0,0 +1,383 @@
+/**
+ * @file verify.c
+ * @author Roman Horshkov
+ * @date 19 Oct 2026
+ * @brief Integrity check of a folder against a stored root and checkpoints
+ */
+
+/*-----------------------------------*
+ * INCLUDE FILES
+ *-----------------------------------*/
+#include "../inc/verify.h"
+#include "../inc/merkleTree.h"
+#include "../inc/diff.h"
+#include "../inc/parallel.h"
+#include "../inc/mem.h"                 /* MEM_LEVELS and MEM_SCRATCH accounting */
+
+/*-----------------------------------*
+ * PUBLIC VARIABLE DEFINITIONS
+ *-----------------------------------*/
+/* None */
+
+/*-----------------------------------*
+ * PRIVATE DEFINES
+ *-----------------------------------*/
+/* Length of a hash in hexadecimal, with terminator */
+#define HASH_HEX_LENGTH (2 * SHA256_DIGEST_LENGTH + 1)
+
+/* Longest padding mode name, with terminator */
+#define PADDING_NAME_LENGTH 16
+
+/*-----------------------------------*
+ * PRIVATE MACROS
+ *-----------------------------------*/
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/*-----------------------------------*
+ * PRIVATE TYPEDEFS
+ *-----------------------------------*/
+/* State shared by the verification workers */
+struct verify_ctx_t {
+    const char *folder;
+    const struct merkle_checkpoint_t *cp;
+    int span;                           /* leaves per subtree */
+    int stride;                         /* span + arity - 1 hashes per worker */
+    unsigned char *scratch;             /* stride hashes per worker */
+    atomic_bool cancel;
+    atomic_int mismatch;                /* first mismatching subtree */
+    atomic_int files_hashed;
+    atomic_int subtrees_checked;
+};
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION PROTOTYPES
+ *-----------------------------------*/
+
+/**
+ * @brief Hashes the files of one subtree and compares its root.
+ *
+ * @param ctx struct verify_ctx_t of the verification.
+ * @param task Subtree index at the checkpoint level.
+ * @param worker Worker index, selects the scratch buffer.
+ * @retval true  The subtree matches, or the verification was cancelled.
+ * @retval false The subtree does not match.
+ */
+static bool VerifySubtree(void *ctx, int task, int worker);
+
+/**
+ * @brief Returns the number of nodes of a level, padding excluded.
+ *
+ * @param n_leaves Number of leaves (at least 1).
+ * @param arity Number of children per node.
+ * @param level Level of the nodes.
+ * @return ceil(n_leaves / arity^level), without overflow.
+ */
+static int LevelNodes(int n_leaves, int arity, int level);
+
+/**
+ * @brief Writes a hash in hexadecimal followed by a new line.
+ */
+static void WriteHashHex(FILE *fp, const unsigned char hash[SHA256_DIGEST_LENGTH]);
+
+/**
+ * @brief Reads a hash in hexadecimal.
+ *
+ * @param fp Source file.
+ * @param hash Buffer to store the 32-byte hash.
+ * @retval true  Success.
+ * @retval false Missing or malformed hash.
+ */
+static bool ReadHashHex(FILE *fp, unsigned char hash[SHA256_DIGEST_LENGTH]);
+
+/*-----------------------------------*
+ * PRIVATE VARIABLES
+ *-----------------------------------*/
+/* Names of the padding modes in the root hash file */
+static const char *padding_names[] = {
+    [PADDING_DUPLICATE] = "duplicate",
+    [PADDING_PROMOTE] = "promote",
+};
+
+/*-----------------------------------*
+ * PUBLIC FUNCTION DEFINITIONS
+ *-----------------------------------*/
+bool CheckpointFromLevels(const struct merkle_levels_t *lv, struct merkle_checkpoint_t *cp)
+{
+    bool ret = false;
+
+    memset(cp, 0, sizeof(*cp));
+    if (lv->n_levels > 0)
+    {
+        /* lowest level with few enough nodes */
+        int level = 0;
+        while (lv->level_size[level] > CHECKPOINT_MAX_NODES)
+        {
+            level++;
+        }
+
+        cp->hashes = MemAlloc(MEM_LEVELS, (size_t)lv->level_size[level] * SHA256_DIGEST_LENGTH);
+        if (cp->hashes)
+        {
+            cp->n_leaves = lv->n_leaves;
+            cp->n_levels = lv->n_levels;
+            cp->arity = lv->arity;
+            cp->padding = lv->padding;
+            cp->level = level;
+            cp->count = lv->level_size[level];
+            memcpy(cp->root, LevelsRoot(lv), SHA256_DIGEST_LENGTH);
+            memcpy(cp->hashes, lv->level[level], (size_t)cp->count * SHA256_DIGEST_LENGTH);
+            ret = true;
+        }
+    }
+
+    return ret;
+}
+
+bool CheckpointSave(const struct merkle_checkpoint_t *cp, const char *filename)
+{
+    bool ret = false;
+    FILE *fp = fopen(filename, "w");
+
+    if (fp)
+    {
+        fprintf(fp, "# Merkle tree root hash and checkpoint hashes\n");
+        fprintf(fp, "root ");
+        WriteHashHex(fp, cp->root);
+        fprintf(fp, "leaves %d\n", cp->n_leaves);
+        fprintf(fp, "levels %d\n", cp->n_levels);
+        fprintf(fp, "arity %d\n", cp->arity);
+        fprintf(fp, "padding %s\n", padding_names[cp->padding]);
+        fprintf(fp, "checkpoints %d %d\n", cp->level, cp->count);
+        for (int i = 0; i < cp->count; i++)
+        {
+            WriteHashHex(fp, cp->hashes + (size_t)i * SHA256_DIGEST_LENGTH);
+        }
+        ret = fclose(fp) == 0;
+    }
+
+    if (!ret)
+    {
+        perror("CheckpointSave: unable to write root hash file");
+    }
+
+    return ret;
+}
+
+bool CheckpointLoad(struct merkle_checkpoint_t *cp, const char *filename)
+{
+    bool ret = false;
+    FILE *fp = fopen(filename, "r");
+    int header_end = -1;
+    char padding[PADDING_NAME_LENGTH] = "";
+
+    memset(cp, 0, sizeof(*cp));
+    if (fp)
+    {
+        ret = fscanf(fp, "# Merkle tree root hash and checkpoint hashes root%n", &header_end) >= 0 &&
+              header_end > 0 &&
+              ReadHashHex(fp, cp->root) &&
+              fscanf(fp, " leaves %d levels %d arity %d padding %15s checkpoints %d %d",
+                     &cp->n_leaves, &cp->n_levels, &cp->arity, padding, &cp->level, &cp->count) == 6 &&
+              cp->arity >= 2 && cp->n_leaves > 0 && cp->level >= 0 && cp->level < cp->n_levels &&
+              /* one checkpoint per subtree of VerifyFolder(), no more, no less */
+              cp->count == LevelNodes(cp->n_leaves, cp->arity, cp->level);
+
+        /* padding mode by name */
+        if (ret)
+        {
+            ret = false;
+            for (size_t i = 0; i < sizeof(padding_names) / sizeof(padding_names[0]); i++)
+            {
+                if (strcmp(padding, padding_names[i]) == 0)
+                {
+                    cp->padding = (enum merkle_padding_t)i;
+                    ret = true;
+                }
+            }
+        }
+
+        if (ret)
+        {
+            cp->hashes = MemAlloc(MEM_LEVELS, (size_t)cp->count * SHA256_DIGEST_LENGTH);
+            ret = cp->hashes != NULL;
+        }
+        for (int i = 0; i < cp->count && ret; i++)
+        {
+            ret = ReadHashHex(fp, cp->hashes + (size_t)i * SHA256_DIGEST_LENGTH);
+        }
+        fclose(fp);
+
+        /* the checkpoints must lead to the stored root */
+        if (ret)
+        {
+            /* extra room for the padding of SubtreeRoot() */
+            size_t tmp_size = (size_t)(cp->count + cp->arity - 1) * SHA256_DIGEST_LENGTH;
+            unsigned char *tmp = MemAlloc(MEM_SCRATCH, tmp_size);
+            unsigned char root[SHA256_DIGEST_LENGTH];
+
+            ret = tmp != NULL;
+            if (ret)
+            {
+                memcpy(tmp, cp->hashes, (size_t)cp->count * SHA256_DIGEST_LENGTH);
+                ret = SubtreeRoot(tmp, cp->count, cp->n_levels - 1 - cp->level, cp->arity,
+                                  cp->padding, root) &&
+                      !HashDiffers(root, cp->root);
+                MemFree(MEM_SCRATCH, tmp, tmp_size);
+            }
+        }
+
+        if (!ret)
+        {
+            fprintf(stderr, "CheckpointLoad: malformed or inconsistent %s\n", filename);
+            CheckpointFree(cp);
+        }
+    }
+
+    return ret;
+}
+
+void CheckpointFree(struct merkle_checkpoint_t *cp)
+{
+    MemFree(MEM_LEVELS, cp->hashes, (size_t)cp->count * SHA256_DIGEST_LENGTH);
+    memset(cp, 0, sizeof(*cp));
+}
+
+bool VerifyFolder(const char *folder, const struct merkle_checkpoint_t *cp,
+                  int n_threads, struct verify_result_t *result)
+{
+    bool ret = true;
+    int n_files = CountFilesInDirectory(folder);
+
+    memset(result, 0, sizeof(*result));
+    result->first_leaf = -1;
+    result->last_leaf = -1;
+
+    if (n_files != cp->n_leaves)
+    {
+        /* blocks added or removed: no need to hash anything */
+        result->first_leaf = MIN(n_files, cp->n_leaves);
+        result->last_leaf = (n_files > cp->n_leaves ? n_files : cp->n_leaves) - 1;
+        return ret;
+    }
+
+    struct verify_ctx_t ctx = {
+        .folder = folder,
+        .cp = cp,
+        .span = (int)LevelSpan(cp->arity, cp->level),
+        .stride = (int)LevelSpan(cp->arity, cp->level) + cp->arity - 1,
+    };
+    int n_tasks = (cp->n_leaves + ctx.span - 1) / ctx.span;
+
+    if (n_threads <= 0)
+    {
+        n_threads = ParallelDefaultThreads();
+    }
+    atomic_init(&ctx.cancel, false);
+    atomic_init(&ctx.mismatch, -1);
+    atomic_init(&ctx.files_hashed, 0);
+    atomic_init(&ctx.subtrees_checked, 0);
+    size_t scratch_size = (size_t)n_threads * ctx.stride * SHA256_DIGEST_LENGTH;
+    ctx.scratch = MemAlloc(MEM_SCRATCH, scratch_size);
+
+    if (ctx.scratch)
+    {
+        ParallelFor(n_tasks, n_threads, VerifySubtree, &ctx, &ctx.cancel);
+
+        int mismatch = atomic_load(&ctx.mismatch);
+        result->match = mismatch < 0;
+        if (!result->match)
+        {
+            result->first_leaf = mismatch * ctx.span;
+            result->last_leaf = MIN((mismatch + 1) * ctx.span, cp->n_leaves) - 1;
+        }
+        result->files_hashed = atomic_load(&ctx.files_hashed);
+        result->subtrees_checked = atomic_load(&ctx.subtrees_checked);
+        MemFree(MEM_SCRATCH, ctx.scratch, scratch_size);
+    }
+    else
+    {
+        fprintf(stderr, "VerifyFolder: allocation failed\n");
+        ret = false;
+    }
+
+    return ret;
+}
+
+/*-----------------------------------*
+ * PRIVATE FUNCTION DEFINITIONS
+ *-----------------------------------*/
+static bool VerifySubtree(void *arg, int task, int worker)
+{
+    struct verify_ctx_t *ctx = arg;
+    unsigned char *hashes = ctx->scratch + (size_t)worker * ctx->stride * SHA256_DIGEST_LENGTH;
+    unsigned char root[SHA256_DIGEST_LENGTH];
+    char filename[256];
+    int first = task * ctx->span;
+    int count = MIN(ctx->span, ctx->cp->n_leaves - first);
+    bool ok = true;
+
+    for (int i = 0; i < count && ok; i++)
+    {
+        /* another subtree already failed */
+        if (atomic_load_explicit(&ctx->cancel, memory_order_relaxed))
+        {
+            return true;
+        }
+        snprintf(filename, sizeof(filename), LEAF_FILE_FORMAT, ctx->folder, first + i);
+        ok = HashFile(filename, hashes + (size_t)i * SHA256_DIGEST_LENGTH);
+        if (ok)
+        {
+            atomic_fetch_add_explicit(&ctx->files_hashed, 1, memory_order_relaxed);
+        }
+    }
+
+    ok = ok && SubtreeRoot(hashes, count, ctx->cp->level, ctx->cp->arity,
+                           ctx->cp->padding, root) &&
+         !HashDiffers(root, ctx->cp->hashes + (size_t)task * SHA256_DIGEST_LENGTH);
+    atomic_fetch_add_explicit(&ctx->subtrees_checked, 1, memory_order_relaxed);
+
+    if (!ok)
+    {
+        /* keep the first confirmed mismatch */
+        int none = -1;
+        atomic_compare_exchange_strong(&ctx->mismatch, &none, task);
+    }
+
+    return ok;
+}
+
+static int LevelNodes(int n_leaves, int arity, int level)
+{
+    int ret = n_leaves;
+
+    for (int l = 0; l < level; l++)
+    {
+        ret = ret / arity + (ret % arity != 0);
+    }
+
+    return ret;
+}
+
+static void WriteHashHex(FILE *fp, const unsigned char hash[SHA256_DIGEST_LENGTH])
+{
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++)
+    {
+        fprintf(fp, "%02x", hash[i]);
+    }
+    fprintf(fp, "\n");
+}
+
+static bool ReadHashHex(FILE *fp, unsigned char hash[SHA256_DIGEST_LENGTH])
+{
+    char hex[HASH_HEX_LENGTH];
+    bool ret = fscanf(fp, " %64s", hex) == 1 && strlen(hex) == HASH_HEX_LENGTH - 1;
+
+    for (int i = 0; i < SHA256_DIGEST_LENGTH && ret; i++)
+    {
+        unsigned int byte;
+        ret = sscanf(hex + 2 * i, "%2x", &byte) == 1;
+        hash[i] = (unsigned char)byte;
+    }
+
+    return ret;
+}